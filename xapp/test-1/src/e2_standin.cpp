@@ -0,0 +1,111 @@
+// Loopback stand-in for the RIC side of the SCTP E2 transport: accepts
+// associations on one one-to-many socket, answers every subscription request
+// on the stream it came in on, then sends periodic indications there.
+//
+// Usage: e2-standin [port] [indications per subscription, 0 for endless]
+//                   [interval ms] [streams]
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#include "sctp_transport.hpp"
+
+namespace {
+
+constexpr uint8_t kSubscriptionRequest = 1;
+constexpr uint8_t kSubscriptionResponse = 2;
+constexpr uint8_t kIndication = 3;
+constexpr size_t kIndicationSize = 256;
+
+volatile sig_atomic_t running = 1;
+
+void signal_handler(int) {
+    running = 0;
+}
+
+struct Subscription {
+    sctp_assoc_t assoc_id;
+    uint16_t stream;
+    uint32_t id;
+    int remaining;
+    uint32_t sequence;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? std::atoi(argv[1]) : 36422;
+    int indications = argc > 2 ? std::atoi(argv[2]) : 10;
+    int interval_ms = argc > 3 ? std::atoi(argv[3]) : 100;
+    uint16_t streams = static_cast<uint16_t>(argc > 4 ? std::atoi(argv[4]) : 8);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    transport::SctpTransport server(transport::SctpMode::OneToMany, streams);
+    if (!server.listen(port)) {
+        return 1;
+    }
+    std::cout << "E2 stand-in listening on SCTP port " << port << " (" << streams << " streams)" << std::endl;
+
+    std::vector<Subscription> subscriptions;
+    std::vector<uint8_t> message(kIndicationSize);
+
+    auto on_message = [&](const transport::SctpMessage& in) {
+        if (in.size < 7 || in.data[0] != kSubscriptionRequest) {
+            std::cout << "Ignoring " << in.size << " bytes on stream " << in.stream << '\n';
+            return;
+        }
+
+        // Type, RAN function ID, subscription ID: echo the ID back
+        uint8_t response[5] = { kSubscriptionResponse };
+        std::memcpy(response + 1, in.data + 3, 4);
+        uint32_t id;
+        std::memcpy(&id, in.data + 3, sizeof(id));
+        id = ntohl(id);
+
+        std::cout << "Subscription " << id << " from association " << in.assoc_id << " on stream " << in.stream << '\n';
+        if (server.send(in.stream, response, sizeof(response), in.assoc_id)) {
+            subscriptions.push_back(Subscription{ in.assoc_id, in.stream, id, indications, 0 });
+        }
+    };
+
+    auto next_tick = std::chrono::steady_clock::now();
+    while (running) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - std::chrono::steady_clock::now());
+        pollfd ready{ server.fd(), POLLIN, 0 };
+        if (poll(&ready, 1, static_cast<int>(std::max<int64_t>(wait.count(), 0))) > 0) {
+            server.receive(on_message);
+        }
+        if (std::chrono::steady_clock::now() < next_tick) continue;
+        next_tick += std::chrono::milliseconds(interval_ms);
+
+        // One indication per subscription per tick: type, subscription ID,
+        // sequence number, filler
+        for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+            message[0] = kIndication;
+            uint32_t wire_id = htonl(it->id);
+            uint32_t wire_sequence = htonl(it->sequence++);
+            std::memcpy(message.data() + 1, &wire_id, sizeof(wire_id));
+            std::memcpy(message.data() + 5, &wire_sequence, sizeof(wire_sequence));
+
+            bool sent = server.send(it->stream, message.data(), message.size(), it->assoc_id);
+            if (!sent || --it->remaining == 0) {
+                it = subscriptions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::cout << "E2 stand-in stopped." << std::endl;
+    return 0;
+}
@@ -1,38 +1,444 @@
 #include <iostream>
-#include <thread>
-#include <chrono>
+#include <algorithm>
 #include <csignal>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
 
+#ifdef HAVE_SCTP
+#include "sctp_transport.hpp"
+#endif
+
 // Mock E2AP/FlexRIC headers for demonstration
 // In a real scenario, you would include the actual FlexRIC headers
 namespace E2AP {
-    struct E2AP_PDU {};
+    enum class MessageType : uint8_t {
+        SubscriptionRequest = 1,
+        SubscriptionResponse = 2,
+        Indication = 3
+    };
+
+    // Decoded view of one message; payload points into the receive buffer
+    struct E2AP_PDU {
+        MessageType type;
+        const uint8_t* payload;
+        size_t size;
+        uint16_t stream;         // SCTP stream it arrived on, 0 over TCP
+    };
     struct RIC_subscription_request {};
     struct RIC_subscription_response {};
     struct RIC_indication {};
 }
 
+// Every connection carries frames: a 4-byte big-endian length, then the
+// PDU (one message type byte and its payload)
+constexpr size_t kFrameHeaderSize = 4;
+constexpr size_t kMaxFrameSize = 64 * 1024;
+constexpr size_t kInitialBufferSize = 4096;
+constexpr int kMaxEvents = 64;
+
 // Flag to control the main loop
 volatile sig_atomic_t running = 1;
 
+// eventfd that wakes the event loop on shutdown
+int wake_fd = -1;
+
 // Signal handler to gracefully shut down the xApp
 void signal_handler(int signum) {
     std::cout << "Caught signal " << signum << ", shutting down..." << std::endl;
     running = 0;
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
 }
 
-// Real function to connect to FlexRIC using TCP/SCTP (TCP for demo)
-bool connect_to_flexric(const char* address, int port) {
-    std::cout << "Connecting to FlexRIC at " << address << ":" << port << "..." << std::endl;
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0); // Use SOCK_STREAM for TCP, SOCK_SEQPACKET for SCTP
+// One open socket with its partial input and unsent output
+struct Connection {
+    int fd;
+    std::string name;
+    bool ric;                    // The RIC connection; the xApp stops when it closes
+    std::vector<uint8_t> rx;
+    size_t rx_len = 0;
+    std::vector<uint8_t> tx;
+    size_t tx_offset = 0;
+};
+
+// Edge-triggered epoll loop over the RIC connection, the indication
+// listener and every accepted indication connection. Sockets are
+// non-blocking and drained until EAGAIN on each event; complete frames are
+// decoded in place and passed to the handler. An SCTP association to the
+// RIC joins the loop as a source that reads its own messages.
+class Reactor {
+public:
+    using Handler = std::function<void(const std::string&, const E2AP::E2AP_PDU&)>;
+    using Reader = std::function<bool()>;
+
+    explicit Reactor(Handler handler) : handler_(std::move(handler)) {}
+
+    ~Reactor() {
+        for (auto& entry : connections_) {
+            close(entry.first);
+        }
+        if (listen_fd_ >= 0) close(listen_fd_);
+        if (wake_fd >= 0) {
+            close(wake_fd);
+            wake_fd = -1;
+        }
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    bool init() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || wake_fd < 0) {
+            std::cerr << "Event loop creation failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return watch(wake_fd, EPOLLIN);
+    }
+
+    bool listen_on(int port) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            std::cerr << "Socket creation failed." << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port);
+        if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, SOMAXCONN) < 0) {
+            std::cerr << "Cannot listen on port " << port << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return watch(listen_fd_, EPOLLIN | EPOLLET);
+    }
+
+    // Take over a connected socket
+    Connection* add_connection(int fd, std::string name, bool ric) {
+        if (!set_nonblocking(fd)) {
+            close(fd);
+            return nullptr;
+        }
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->name = std::move(name);
+        conn->ric = ric;
+        conn->rx.resize(kInitialBufferSize);
+        if (!watch(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET)) {
+            close(fd);
+            return nullptr;
+        }
+
+        Connection* raw = conn.get();
+        connections_[fd] = std::move(conn);
+        return raw;
+    }
+
+    // Watch a RIC socket owned by its transport. The reader drains it until
+    // EAGAIN and returns false once the association is gone.
+    bool add_ric_source(int fd, Reader reader) {
+        if (!watch(fd, EPOLLIN | EPOLLET)) return false;
+        sources_[fd] = std::move(reader);
+        return true;
+    }
+
+    void dispatch(const std::string& source, const E2AP::E2AP_PDU& pdu) {
+        handler_(source, pdu);
+    }
+
+    // Queue one frame and write as much of it as the socket takes now
+    bool send(Connection& conn, E2AP::MessageType type, const uint8_t* payload, size_t size) {
+        if (size + 1 > kMaxFrameSize) return false;
+
+        uint32_t length = htonl(static_cast<uint32_t>(size + 1));
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(&length);
+        conn.tx.insert(conn.tx.end(), header, header + kFrameHeaderSize);
+        conn.tx.push_back(static_cast<uint8_t>(type));
+        conn.tx.insert(conn.tx.end(), payload, payload + size);
+        return flush(conn);
+    }
+
+    void run() {
+        epoll_event events[kMaxEvents];
+
+        while (running) {
+            int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            for (int i = 0; i < count && running; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wake_fd) continue;
+                if (fd == listen_fd_) {
+                    accept_all();
+                    continue;
+                }
+
+                auto source = sources_.find(fd);
+                if (source != sources_.end()) {
+                    if (!source->second()) {
+                        std::cerr << "Connection to FlexRIC lost." << std::endl;
+                        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+                        sources_.erase(source);
+                        running = 0;
+                    }
+                    continue;
+                }
+
+                // Looked up per event: an earlier event may have closed it
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) continue;
+                Connection& conn = *it->second;
+
+                bool open = true;
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    open = on_readable(conn);
+                }
+                if (open && (events[i].events & EPOLLOUT)) {
+                    open = flush(conn);
+                }
+                if (!open) {
+                    close_connection(fd);
+                }
+            }
+        }
+    }
+
+private:
+    bool watch(int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::cerr << "epoll_ctl failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void accept_all() {
+        for (;;) {
+            sockaddr_in peer{};
+            socklen_t peer_len = sizeof(peer);
+            int fd = accept4(listen_fd_, (struct sockaddr*)&peer, &peer_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+                }
+                return;
+            }
+
+            char address[INET_ADDRSTRLEN] = "?";
+            inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address));
+            std::string name = std::string(address) + ":" + std::to_string(ntohs(peer.sin_port));
+            if (add_connection(fd, name, false)) {
+                std::cout << "Indication connection from " << name << '\n';
+            }
+        }
+    }
+
+    // Read until EAGAIN, dispatching every complete frame. False once the
+    // connection is closed by the peer or breaks the framing.
+    bool on_readable(Connection& conn) {
+        for (;;) {
+            if (conn.rx_len == conn.rx.size()) {
+                if (conn.rx.size() >= kFrameHeaderSize + kMaxFrameSize) return false;
+                conn.rx.resize(std::min(conn.rx.size() * 2, kFrameHeaderSize + kMaxFrameSize));
+            }
+
+            ssize_t received = recv(conn.fd, conn.rx.data() + conn.rx_len, conn.rx.size() - conn.rx_len, 0);
+            if (received > 0) {
+                conn.rx_len += static_cast<size_t>(received);
+                if (!dispatch_frames(conn)) return false;
+                continue;
+            }
+            if (received == 0) return false;
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+
+    bool dispatch_frames(Connection& conn) {
+        size_t offset = 0;
+
+        while (conn.rx_len - offset >= kFrameHeaderSize) {
+            uint32_t length;
+            std::memcpy(&length, conn.rx.data() + offset, sizeof(length));
+            length = ntohl(length);
+            if (length == 0 || length > kMaxFrameSize) {
+                std::cerr << "Bad frame length " << length << " from " << conn.name << std::endl;
+                return false;
+            }
+            if (conn.rx_len - offset < kFrameHeaderSize + length) break;
+
+            const uint8_t* frame = conn.rx.data() + offset + kFrameHeaderSize;
+            E2AP::E2AP_PDU pdu{ static_cast<E2AP::MessageType>(frame[0]), frame + 1, length - 1, 0 };
+            handler_(conn.name, pdu);
+            offset += kFrameHeaderSize + length;
+        }
+
+        // Keep the partial frame at the front of the buffer
+        if (offset > 0) {
+            std::memmove(conn.rx.data(), conn.rx.data() + offset, conn.rx_len - offset);
+            conn.rx_len -= offset;
+        }
+        return true;
+    }
+
+    bool flush(Connection& conn) {
+        while (conn.tx_offset < conn.tx.size()) {
+            ssize_t sent = ::send(conn.fd, conn.tx.data() + conn.tx_offset, conn.tx.size() - conn.tx_offset, MSG_NOSIGNAL);
+            if (sent > 0) {
+                conn.tx_offset += static_cast<size_t>(sent);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) continue;
+            return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+
+        conn.tx.clear();
+        conn.tx_offset = 0;
+        return true;
+    }
+
+    void close_connection(int fd) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) return;
+
+        if (it->second->ric) {
+            std::cerr << "Connection to FlexRIC lost." << std::endl;
+            running = 0;
+        } else {
+            std::cout << "Indication connection from " << it->second->name << " closed" << '\n';
+        }
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections_.erase(it);
+    }
+
+    Handler handler_;
+    int epoll_fd_ = -1;
+    int listen_fd_ = -1;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::unordered_map<int, Reader> sources_;
+};
+
+// Outgoing side of the E2 connection to the RIC
+class RicLink {
+public:
+    virtual ~RicLink() = default;
+    virtual bool send(uint16_t stream, E2AP::MessageType type, const uint8_t* payload, size_t size) = 0;
+    virtual uint16_t stream_for(uint32_t subscription_id) const = 0;
+};
+
+// Framed TCP connection in the event loop: one ordered byte stream, so every
+// subscription shares it
+class TcpRicLink : public RicLink {
+public:
+    TcpRicLink(Reactor& reactor, Connection& conn) : reactor_(reactor), conn_(conn) {}
+
+    bool send(uint16_t, E2AP::MessageType type, const uint8_t* payload, size_t size) override {
+        return reactor_.send(conn_, type, payload, size);
+    }
+
+    uint16_t stream_for(uint32_t) const override { return 0; }
+
+private:
+    Reactor& reactor_;
+    Connection& conn_;
+};
+
+#ifdef HAVE_SCTP
+// SCTP association: each message is one PDU on a stream of its own choosing
+class SctpRicLink : public RicLink {
+public:
+    explicit SctpRicLink(std::unique_ptr<transport::SctpTransport> transport)
+        : transport_(std::move(transport)) {
+        message_.reserve(transport::kMaxMessageSize);
+    }
+
+    bool send(uint16_t stream, E2AP::MessageType type, const uint8_t* payload, size_t size) override {
+        if (size + 1 > transport::kMaxMessageSize) return false;
+
+        message_.clear();
+        message_.push_back(static_cast<uint8_t>(type));
+        message_.insert(message_.end(), payload, payload + size);
+        return transport_->send(stream, message_.data(), message_.size());
+    }
+
+    uint16_t stream_for(uint32_t subscription_id) const override {
+        return transport_->stream_for(subscription_id);
+    }
+
+    transport::SctpTransport& transport() { return *transport_; }
+
+private:
+    std::unique_ptr<transport::SctpTransport> transport_;
+    std::vector<uint8_t> message_;
+};
+
+// Associate with FlexRIC over kernel SCTP and keep the association in the
+// event loop
+std::unique_ptr<RicLink> connect_sctp(Reactor& reactor, const char* address, int port,
+                                      transport::SctpMode mode, uint16_t streams) {
+    auto transport = std::make_unique<transport::SctpTransport>(mode, streams);
+    if (!transport->connect(address, port, 5000)) {
+        std::cerr << "Connection to FlexRIC failed." << std::endl;
+        return nullptr;
+    }
+    std::cout << "Association established (" << transport->out_streams() << " outbound streams)." << std::endl;
+
+    auto link = std::make_unique<SctpRicLink>(std::move(transport));
+    transport::SctpTransport& sctp = link->transport();
+    std::string name = std::string(address) + ":" + std::to_string(port);
+    bool watched = reactor.add_ric_source(sctp.fd(), [&reactor, &sctp, name]() {
+        return sctp.receive([&reactor, &name](const transport::SctpMessage& message) {
+            if (message.size == 0) return;
+            E2AP::E2AP_PDU pdu{ static_cast<E2AP::MessageType>(message.data[0]), message.data + 1,
+                                message.size - 1, message.stream };
+            reactor.dispatch(name, pdu);
+        });
+    });
+    return watched ? std::move(link) : nullptr;
+}
+#endif
+
+// Connect to FlexRIC using TCP and keep the connection in the event loop
+std::unique_ptr<RicLink> connect_tcp(Reactor& reactor, const char* address, int port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (sockfd < 0) {
         std::cerr << "Socket creation failed." << std::endl;
-        return false;
+        return nullptr;
     }
     sockaddr_in serv_addr{};
     serv_addr.sin_family = AF_INET;
@@ -40,60 +446,92 @@ bool connect_to_flexric(const char* address, int port) {
     if (inet_pton(AF_INET, address, &serv_addr.sin_addr) <= 0) {
         std::cerr << "Invalid address." << std::endl;
         close(sockfd);
-        return false;
+        return nullptr;
     }
     if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
         std::cerr << "Connection to FlexRIC failed." << std::endl;
         close(sockfd);
-        return false;
+        return nullptr;
     }
     std::cout << "Connection established." << std::endl;
-    close(sockfd); // For demo, close immediately. In real code, keep open.
-    return true;
+
+    Connection* conn = reactor.add_connection(sockfd, std::string(address) + ":" + std::to_string(port), true);
+    return conn ? std::make_unique<TcpRicLink>(reactor, *conn) : nullptr;
 }
 
-// Real function to send a subscription request (dummy payload)
-bool subscribe_to_kpm() {
-    std::cout << "Sending E2SM-KPM subscription request..." << std::endl;
-    // In real code, you would encode and send a RIC_subscription_request PDU over the socket.
-    // Here, just simulate a delay and success.
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    std::cout << "Subscription successful." << std::endl;
+// Connect to FlexRIC over the transport named by E2_TRANSPORT: "sctp"
+// (one-to-one), "sctp-many" (one-to-many) or "tcp"
+std::unique_ptr<RicLink> connect_to_flexric(Reactor& reactor, const char* address, int port,
+                                            const std::string& kind, uint16_t streams) {
+    std::cout << "Connecting to FlexRIC at " << address << ":" << port << " over " << kind << "..." << std::endl;
+    if (kind == "tcp") {
+        return connect_tcp(reactor, address, port);
+    }
+#ifdef HAVE_SCTP
+    if (kind == "sctp" || kind == "sctp-many") {
+        auto mode = kind == "sctp" ? transport::SctpMode::OneToOne : transport::SctpMode::OneToMany;
+        return connect_sctp(reactor, address, port, mode, streams);
+    }
+#else
+    (void)streams;
+#endif
+    std::cerr << "Unsupported transport " << kind << "." << std::endl;
+    return nullptr;
+}
+
+// Send subscription requests (dummy payload: RAN function ID, then a 4-byte
+// big-endian subscription ID), each on its own stream where the transport
+// has them; the responses arrive through the event loop
+bool subscribe_to_kpm(RicLink& ric, int subscriptions) {
+    for (int i = 1; i <= subscriptions; i++) {
+        uint32_t id = static_cast<uint32_t>(i);
+        uint16_t stream = ric.stream_for(id);
+        std::cout << "Sending E2SM-KPM subscription request " << id << " on stream " << stream << "..." << std::endl;
+
+        // In real code, you would encode a RIC_subscription_request PDU here.
+        uint8_t request[6] = { 0, 2 };
+        uint32_t wire_id = htonl(id);
+        std::memcpy(request + 2, &wire_id, sizeof(wire_id));
+        if (!ric.send(stream, E2AP::MessageType::SubscriptionRequest, request, sizeof(request))) {
+            return false;
+        }
+    }
     return true;
 }
 
-// Real function to listen for indications (simulate with socket accept)
-void listen_for_indications() {
-    int listen_port = 36422; // Dummy port for indication simulation
-    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(listen_port);
-    bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr));
-    listen(listen_fd, 1);
-
-    std::cout << "Listening for RIC Indications on port " << listen_port << "..." << std::endl;
-    while (running) {
-        std::cout << "Waiting for RIC Indication..." << std::endl;
-        // Simulate a blocking accept (in real code, use SCTP and parse E2AP_PDU)
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(listen_fd, &fds);
-        timeval tv = {5, 0}; // 5 seconds timeout
-        int rv = select(listen_fd + 1, &fds, NULL, NULL, &tv);
-        if (rv > 0 && FD_ISSET(listen_fd, &fds)) {
-            int client_fd = accept(listen_fd, NULL, NULL);
-            if (client_fd >= 0) {
-                std::cout << "Received RIC Indication (simulated)" << std::endl;
-                // In real xApp, decode E2AP_PDU and process KPM report here
-                close(client_fd);
+// Handle one decoded message from the RIC or an indication connection
+void handle_message(const std::string& source, const E2AP::E2AP_PDU& pdu) {
+    switch (pdu.type) {
+        case E2AP::MessageType::SubscriptionResponse:
+            std::cout << "Subscription successful";
+            if (pdu.size >= 4) {
+                uint32_t id;
+                std::memcpy(&id, pdu.payload, sizeof(id));
+                std::cout << " (subscription " << ntohl(id) << ", stream " << pdu.stream << ")";
             }
-        } else {
-            std::cout << "No indication received (timeout)." << std::endl;
-        }
+            std::cout << "." << std::endl;
+            break;
+        case E2AP::MessageType::Indication:
+            // In real xApp, decode the KPM report here
+            std::cout << "Received RIC Indication (" << pdu.size << " bytes) from " << source
+                      << " on stream " << pdu.stream << '\n';
+            break;
+        default:
+            std::cout << "Ignoring message type " << static_cast<int>(pdu.type) << " from " << source << '\n';
+            break;
     }
-    close(listen_fd);
+}
+
+int env_port(const char* name, int fallback) {
+    const char* value = std::getenv(name);
+    int port = value ? std::atoi(value) : 0;
+    return port > 0 && port < 65536 ? port : fallback;
+}
+
+int env_count(const char* name, int fallback, int limit) {
+    const char* value = std::getenv(name);
+    int count = value ? std::atoi(value) : 0;
+    return count > 0 && count <= limit ? count : fallback;
 }
 
 int main() {
@@ -104,20 +542,45 @@ int main() {
     if (!flexric_address) {
         flexric_address = "127.0.0.1"; // Default address
     }
+    int flexric_port = env_port("FLEXRIC_PORT", 36422);
+    int indication_port = env_port("INDICATION_PORT", 36423);
+    int streams = env_count("SCTP_STREAMS", 8, 65535);
+    int subscriptions = env_count("KPM_SUBSCRIPTIONS", 1, 1024);
+
+    const char* transport_kind = std::getenv("E2_TRANSPORT");
+    if (!transport_kind) {
+#ifdef HAVE_SCTP
+        transport_kind = "sctp";
+#else
+        transport_kind = "tcp";
+#endif
+    }
 
     std::cout << "Starting hello-xapp..." << std::endl;
 
-    if (!connect_to_flexric(flexric_address, 36422)) { // Standard SCTP port for E2
+    Reactor reactor(handle_message);
+    if (!reactor.init()) {
+        return 1;
+    }
+
+    std::unique_ptr<RicLink> ric = connect_to_flexric(reactor, flexric_address, flexric_port, transport_kind,
+                                                      static_cast<uint16_t>(streams));
+    if (!ric) {
         std::cerr << "Failed to connect to FlexRIC." << std::endl;
         return 1;
     }
 
-    if (!subscribe_to_kpm()) {
+    if (!subscribe_to_kpm(*ric, subscriptions)) {
         std::cerr << "Failed to subscribe to E2SM-KPM service." << std::endl;
         return 1;
     }
 
-    listen_for_indications();
+    if (!reactor.listen_on(indication_port)) {
+        return 1;
+    }
+    std::cout << "Listening for RIC Indications on port " << indication_port << "..." << std::endl;
+
+    reactor.run();
 
     std::cout << "xApp has been shut down." << std::endl;
 
@@ -0,0 +1,231 @@
+#include "sctp_transport.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace transport {
+
+SctpTransport::SctpTransport(SctpMode mode, uint16_t streams)
+    : mode_(mode), streams_(std::max<uint16_t>(streams, 1)), buffer_(kMaxMessageSize) {}
+
+SctpTransport::~SctpTransport() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool SctpTransport::open_socket() {
+    int type = mode_ == SctpMode::OneToOne ? SOCK_STREAM : SOCK_SEQPACKET;
+    fd_ = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_SCTP);
+    if (fd_ < 0) {
+        std::cerr << "SCTP socket creation failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Ask for as many streams each way as there are subscriptions to spread
+    sctp_initmsg init{};
+    init.sinit_num_ostreams = streams_;
+    init.sinit_max_instreams = streams_;
+
+    // Stream and PPID of every message, plus association up and down
+    sctp_event_subscribe events{};
+    events.sctp_data_io_event = 1;
+    events.sctp_association_event = 1;
+    events.sctp_shutdown_event = 1;
+
+    // PDUs are small and latency matters more than bundling
+    int nodelay = 1;
+
+    if (setsockopt(fd_, IPPROTO_SCTP, SCTP_INITMSG, &init, sizeof(init)) < 0 ||
+        setsockopt(fd_, IPPROTO_SCTP, SCTP_EVENTS, &events, sizeof(events)) < 0 ||
+        setsockopt(fd_, IPPROTO_SCTP, SCTP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
+        std::cerr << "SCTP socket options failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SctpTransport::connect(const char* address, int port, int timeout_ms) {
+    sockaddr_in peer{};
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &peer.sin_addr) <= 0) {
+        std::cerr << "Invalid address." << std::endl;
+        return false;
+    }
+    if (!open_socket()) return false;
+
+    if (::connect(fd_, (struct sockaddr*)&peer, sizeof(peer)) < 0 && errno != EINPROGRESS) {
+        std::cerr << "SCTP connect failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // The association is usable once its COMM_UP notification arrives,
+    // which also carries the negotiated stream counts
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    auto ignore = [](const SctpMessage&) {};
+    while (!up_ && !closed_) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            std::cerr << "SCTP association setup timed out." << std::endl;
+            return false;
+        }
+
+        pollfd ready{ fd_, POLLIN, 0 };
+        int count = poll(&ready, 1, static_cast<int>(left.count()));
+        if (count < 0 && errno != EINTR) return false;
+        if (count <= 0) continue;
+
+        if (!(ready.revents & POLLIN)) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length);
+            std::cerr << "SCTP association setup failed: " << std::strerror(error ? error : ECONNREFUSED) << std::endl;
+            return false;
+        }
+        receive(ignore);
+    }
+    return up_;
+}
+
+bool SctpTransport::listen(int port) {
+    if (mode_ != SctpMode::OneToMany) {
+        std::cerr << "SCTP server needs a one-to-many socket." << std::endl;
+        return false;
+    }
+    if (!open_socket()) return false;
+
+    int reuse = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd_, SOMAXCONN) < 0) {
+        std::cerr << "Cannot listen on SCTP port " << port << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    server_ = true;
+    return true;
+}
+
+bool SctpTransport::receive(const Handler& handler) {
+    for (;;) {
+        // Nothing we accept is this large: drop the rest of the message
+        if (fill_ == buffer_.size()) {
+            discarding_ = true;
+            fill_ = 0;
+        }
+
+        sctp_sndrcvinfo info{};
+        int flags = 0;
+        int received = sctp_recvmsg(fd_, buffer_.data() + fill_, buffer_.size() - fill_, nullptr, nullptr, &info, &flags);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return !closed_;
+            std::cerr << "SCTP receive failed: " << std::strerror(errno) << std::endl;
+            closed_ = !server_;
+            return !closed_;
+        }
+        if (received == 0) {
+            // End of file on a one-to-one socket: the peer shut down
+            closed_ = !server_;
+            return !closed_;
+        }
+
+        fill_ += static_cast<size_t>(received);
+        if (!(flags & MSG_EOR)) continue;
+
+        size_t size = fill_;
+        fill_ = 0;
+        if (discarding_) {
+            discarding_ = false;
+            dropped_++;
+            std::cerr << "Dropped SCTP message larger than " << buffer_.size() << " bytes" << std::endl;
+            continue;
+        }
+
+        if (flags & MSG_NOTIFICATION) {
+            handle_notification(buffer_.data(), size);
+            if (closed_) return false;
+            continue;
+        }
+
+        SctpMessage message{ info.sinfo_assoc_id, info.sinfo_stream, ntohl(info.sinfo_ppid), buffer_.data(), size };
+        handler(message);
+    }
+}
+
+void SctpTransport::handle_notification(const uint8_t* data, size_t size) {
+    const sctp_notification* notification = reinterpret_cast<const sctp_notification*>(data);
+    if (size < sizeof(notification->sn_header)) return;
+
+    if (notification->sn_header.sn_type == SCTP_SHUTDOWN_EVENT) {
+        if (!server_) closed_ = true;
+        return;
+    }
+    if (notification->sn_header.sn_type != SCTP_ASSOC_CHANGE || size < sizeof(sctp_assoc_change)) return;
+
+    const sctp_assoc_change& change = notification->sn_assoc_change;
+    switch (change.sac_state) {
+        case SCTP_COMM_UP:
+        case SCTP_RESTART:
+            if (server_) {
+                std::cout << "Association " << change.sac_assoc_id << " up (" << change.sac_inbound_streams
+                          << " in, " << change.sac_outbound_streams << " out streams)" << '\n';
+            } else {
+                up_ = true;
+                assoc_id_ = change.sac_assoc_id;
+                out_streams_ = std::max<uint16_t>(change.sac_outbound_streams, 1);
+            }
+            break;
+        case SCTP_COMM_LOST:
+        case SCTP_SHUTDOWN_COMP:
+        case SCTP_CANT_STR_ASSOC:
+            if (server_) {
+                std::cout << "Association " << change.sac_assoc_id << " closed" << '\n';
+            } else {
+                closed_ = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool SctpTransport::send(uint16_t stream, const uint8_t* data, size_t size, sctp_assoc_t assoc_id) {
+    sctp_sndrcvinfo info{};
+    info.sinfo_stream = stream;
+    info.sinfo_ppid = htonl(kE2apPpid);
+    info.sinfo_assoc_id = assoc_id ? assoc_id : assoc_id_;
+
+    for (;;) {
+        if (sctp_send(fd_, data, size, &info, MSG_NOSIGNAL) >= 0) return true;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            std::cerr << "SCTP send on stream " << stream << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // The send buffer is full; the peer is slow, so wait a little for it
+        pollfd ready{ fd_, POLLOUT, 0 };
+        if (poll(&ready, 1, kSendTimeoutMs) <= 0) {
+            std::cerr << "SCTP send on stream " << stream << " timed out." << std::endl;
+            return false;
+        }
+    }
+}
+
+uint16_t SctpTransport::stream_for(uint32_t subscription_id) const {
+    if (out_streams_ <= 1) return 0;
+    return static_cast<uint16_t>(1 + subscription_id % (out_streams_ - 1));
+}
+
+} // namespace transport
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/sctp.h>
+
+namespace transport {
+
+// Payload protocol identifier registered for E2AP (E2-CP)
+constexpr uint32_t kE2apPpid = 70;
+constexpr size_t kMaxMessageSize = 64 * 1024;
+constexpr int kSendTimeoutMs = 1000;
+
+enum class SctpMode {
+    OneToOne,   // SOCK_STREAM: the socket is the association
+    OneToMany   // SOCK_SEQPACKET: associations are addressed by ID on one socket
+};
+
+// One received message; data points into the transport's receive buffer and
+// is only valid inside the handler
+struct SctpMessage {
+    sctp_assoc_t assoc_id;
+    uint16_t stream;
+    uint32_t ppid;
+    const uint8_t* data;
+    size_t size;
+};
+
+// Kernel SCTP endpoint whose association stays open for the life of the
+// xApp. Each message is one PDU, so there is no framing. Stream 0 carries
+// global procedures and subscriptions are spread over the other streams, so
+// a message held for retransmission on one stream does not delay the rest.
+// Messages are received with sctp_recvmsg into one buffer allocated up front.
+class SctpTransport {
+public:
+    using Handler = std::function<void(const SctpMessage&)>;
+
+    SctpTransport(SctpMode mode, uint16_t streams);
+    ~SctpTransport();
+
+    SctpTransport(const SctpTransport&) = delete;
+    SctpTransport& operator=(const SctpTransport&) = delete;
+
+    // Client: associate with the peer and wait until the association is up
+    bool connect(const char* address, int port, int timeout_ms);
+
+    // Server: accept associations from any peer on one one-to-many socket
+    bool listen(int port);
+
+    // Read until EAGAIN, passing every complete message to the handler.
+    // False once a client's association is gone.
+    bool receive(const Handler& handler);
+
+    // Send one message; the client's own association when assoc_id is 0
+    bool send(uint16_t stream, const uint8_t* data, size_t size, sctp_assoc_t assoc_id = 0);
+
+    // Outbound stream for a subscription, never stream 0 when there are others
+    uint16_t stream_for(uint32_t subscription_id) const;
+
+    int fd() const { return fd_; }
+    uint16_t out_streams() const { return out_streams_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    bool open_socket();
+    void handle_notification(const uint8_t* data, size_t size);
+
+    SctpMode mode_;
+    uint16_t streams_;
+    int fd_ = -1;
+    bool server_ = false;
+    bool up_ = false;
+    bool closed_ = false;         // A client's association is gone
+    sctp_assoc_t assoc_id_ = 0;
+    uint16_t out_streams_ = 1;
+
+    // Partial deliveries are assembled here until MSG_EOR
+    std::vector<uint8_t> buffer_;
+    size_t fill_ = 0;
+    bool discarding_ = false;
+    uint64_t dropped_ = 0;
+};
+
+} // namespace transport
@@ -0,0 +1,209 @@
+/*
+ * Sharded Analytics Benchmark for Smart Monitor xApp
+ *
+ * Measures how analytics throughput scales with the shard count:
+ * - The same seeded metric stream replayed through 1, 2, 4, ... shards
+ * - metrics/s and speedup against the first shard count
+ * - Time to read fleet-wide statistics merged across shards
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "../include/analytics_shards.h"
+#include "../include/utils.h"
+
+#define BENCH_MAX_SHARD_COUNTS 8
+#define BENCH_SUBMIT_CHUNK 4096
+
+typedef struct {
+    int shard_counts[BENCH_MAX_SHARD_COUNTS];
+    int shard_count_count;
+    int metrics;
+    int cells;
+    int batch_size;
+    uint64_t seed;
+} bench_options_t;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: the value at a given index
+static uint64_t bench_random(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Reports of every cell in turn, one metric type per cell, one report per
+// cell and second
+static metric_data_t* bench_generate(const bench_options_t* options) {
+    metric_data_t* metrics = malloc((size_t)options->metrics * sizeof(metric_data_t));
+    if (!metrics) {
+        return NULL;
+    }
+
+    for (int i = 0; i < options->metrics; i++) {
+        int cell = i % options->cells;
+        uint64_t noise = bench_random(options->seed, (uint64_t)i) % 1000;
+        metrics[i] = (metric_data_t){
+            .type = (metric_type_t)(cell % METRIC_COUNT),
+            .value = 50.0 + (double)noise / 100.0,
+            .node_id = 1 + (uint32_t)(cell / 64),
+            .cell_id = (uint32_t)(cell % 64),
+            .timestamp = 1700000000 + i / options->cells
+        };
+    }
+    return metrics;
+}
+
+// Replay the stream through shard_count shards; returns metrics/s
+static double bench_run(const bench_options_t* options, const metric_data_t* metrics, int shard_count,
+                        double* fleet_read_us) {
+    analytics_shards_t* shards = analytics_shards_create(NULL, shard_count, 65536, options->batch_size);
+    if (!shards || analytics_shards_start(shards) != 0) {
+        analytics_shards_destroy(shards);
+        return -1.0;
+    }
+
+    uint64_t start = bench_now_ns();
+    for (int at = 0; at < options->metrics; ) {
+        size_t chunk = (size_t)MIN(options->metrics - at, BENCH_SUBMIT_CHUNK);
+        size_t queued = analytics_shards_submit(shards, &metrics[at], chunk);
+        at += (int)queued;
+
+        // A full queue takes part of a chunk; let the workers catch up
+        if (queued < chunk) {
+            utils_sleep_ms(1);
+        }
+    }
+    analytics_shards_flush(shards);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    stats_result_t stats;
+    int count = 0;
+    uint64_t read_start = bench_now_ns();
+    analytics_shards_get_fleet_stats(shards, METRIC_THROUGHPUT, &stats, NULL, &count);
+    *fleet_read_us = (double)(bench_now_ns() - read_start) / 1000.0;
+
+    analytics_shards_destroy(shards);
+    return (double)options->metrics * 1e9 / (double)elapsed;
+}
+
+static int bench_shards(const bench_options_t* options) {
+    metric_data_t* metrics = bench_generate(options);
+    if (!metrics) {
+        fprintf(stderr, "Failed to allocate %d metrics\n", options->metrics);
+        return -1;
+    }
+
+    printf("%8s %14s %10s %14s\n", "shards", "metrics/s", "speedup", "fleet read us");
+
+    double baseline = 0.0;
+    for (int i = 0; i < options->shard_count_count; i++) {
+        int shard_count = options->shard_counts[i];
+        double fleet_read_us = 0.0;
+        double rate = bench_run(options, metrics, shard_count, &fleet_read_us);
+        if (rate < 0.0) {
+            fprintf(stderr, "Failed to run %d shards\n", shard_count);
+            free(metrics);
+            return -1;
+        }
+
+        if (i == 0) {
+            baseline = rate;
+        }
+        printf("%8d %14.0f %9.2fx %14.1f\n", shard_count, rate, rate / baseline, fleet_read_us);
+    }
+
+    free(metrics);
+    return 0;
+}
+
+static void bench_usage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --shards N          Shard count; repeat for several (default 1, 2, 4, 8)\n"
+           "  --metrics N         Metrics replayed per shard count (default 1000000)\n"
+           "  --cells N           Distinct cells in the stream (default 4096)\n"
+           "  --batch N           Metrics a worker takes per batch (default 256)\n"
+           "  --seed N            Value generator seed (default 1)\n",
+           program);
+}
+
+static int bench_parse_options(int argc, char* argv[], bench_options_t* options) {
+    static const struct option long_options[] = {
+        { "shards", required_argument, NULL, 's' },
+        { "metrics", required_argument, NULL, 'm' },
+        { "cells", required_argument, NULL, 'c' },
+        { "batch", required_argument, NULL, 'b' },
+        { "seed", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(options, 0, sizeof(bench_options_t));
+    options->metrics = 1000000;
+    options->cells = 4096;
+    options->batch_size = 256;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                if (options->shard_count_count == BENCH_MAX_SHARD_COUNTS) {
+                    fprintf(stderr, "At most %d shard counts\n", BENCH_MAX_SHARD_COUNTS);
+                    return -1;
+                }
+                options->shard_counts[options->shard_count_count++] = atoi(optarg);
+                break;
+            case 'm': options->metrics = atoi(optarg); break;
+            case 'c': options->cells = atoi(optarg); break;
+            case 'b': options->batch_size = atoi(optarg); break;
+            case 'e': options->seed = strtoull(optarg, NULL, 10); break;
+            default: return -1;
+        }
+    }
+
+    if (options->shard_count_count == 0) {
+        options->shard_counts[options->shard_count_count++] = 1;
+        options->shard_counts[options->shard_count_count++] = 2;
+        options->shard_counts[options->shard_count_count++] = 4;
+        options->shard_counts[options->shard_count_count++] = 8;
+    }
+
+    for (int i = 0; i < options->shard_count_count; i++) {
+        if (options->shard_counts[i] <= 0 || options->shard_counts[i] > ANALYTICS_MAX_SHARDS) {
+            fprintf(stderr, "Shard counts must be between 1 and %d\n", ANALYTICS_MAX_SHARDS);
+            return -1;
+        }
+    }
+    if (options->metrics <= 0 || options->cells <= 0 || options->batch_size <= 0) {
+        fprintf(stderr, "Metrics, cells and batch size must be positive\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    bench_options_t options;
+    if (bench_parse_options(argc, argv, &options) != 0) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    utils_init_logging(NULL, LOG_LEVEL_ERROR);
+
+    printf("Sharded analytics benchmark: %d metrics over %d cells, %d CPUs, seed %llu\n\n",
+           options.metrics, options.cells, utils_get_cpu_count(), (unsigned long long)options.seed);
+
+    return bench_shards(&options) != 0 ? 1 : 0;
+}
@@ -0,0 +1,575 @@
+/*
+ * Storage Benchmark for Smart Monitor xApp
+ *
+ * Drives the database layer with reproducible workload profiles:
+ * - insert: database_insert_metric, one row per call, from one or more threads
+ * - batch: database_insert_metrics_batch
+ * - mixed: ingestion beside reader threads running range statistics
+ * - retention: ingestion while a sweep drops several days of partitions
+ *
+ * Every profile reports rows/s, p50/p99/p999 latency and database growth.
+ * Samples come from a seeded generator, so equal options give equal data.
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/database.h"
+#include "../include/utils.h"
+
+#define BENCH_TMPFS_DIR "/dev/shm"
+#define BENCH_RETENTION_DAYS 8       // Days of partitions the retention profile fills
+#define BENCH_RETENTION_KEEP 4       // Days the sweep keeps
+#define BENCH_STATS_WINDOW 600       // Seconds each mixed-profile query covers
+
+typedef struct {
+    char profile[16];
+    char path[512];
+    char journal[16];
+    char synchronous[16];
+    char storage[16];
+    long long rows;
+    int series;
+    int threads;
+    int batch;
+    bool writer;
+    uint64_t seed;
+} bench_options_t;
+
+// Latencies of one thread, in nanoseconds
+typedef struct {
+    uint64_t* samples;
+    size_t count;
+    size_t capacity;
+} bench_latency_t;
+
+typedef struct {
+    const bench_options_t* options;
+    database_context_t* ctx;
+    long long first;             // Index of the first row this thread writes
+    long long rows;
+    int64_t base;                // Timestamp of row 0
+    int64_t spacing;             // Seconds between rounds of every series
+    bool commit;                 // Time each call up to its commit
+    atomic_bool* stop;           // Stops early once set, if not NULL
+    long long written;
+    bench_latency_t latency;
+} bench_writer_t;
+
+typedef struct {
+    const bench_options_t* options;
+    database_context_t* ctx;
+    int64_t base;
+    int64_t end;
+    uint64_t seed;
+    atomic_bool* stop;
+    long long failures;
+    bench_latency_t latency;
+} bench_reader_t;
+
+typedef struct {
+    const char* name;
+    long long rows;
+    double seconds;
+    bench_latency_t latency;
+    long long size_before;
+    long long size_after;
+} bench_result_t;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: the sample at a given index, independent of thread layout
+static uint64_t bench_random(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Row `index` of the workload: series round-robin, one round every spacing seconds
+static void bench_metric(const bench_options_t* options, long long index, int64_t base, int64_t spacing,
+                         metric_data_t* metric) {
+    int series = (int)(index % options->series);
+    uint64_t random = bench_random(options->seed, (uint64_t)index);
+
+    metric->type = (metric_type_t)(series % METRIC_COUNT);
+    metric->node_id = (uint32_t)(series / METRIC_COUNT / 4 + 1);
+    metric->cell_id = (uint32_t)(series / METRIC_COUNT % 4 + 1);
+    metric->timestamp = base + index / options->series * spacing;
+    metric->value = 100.0 + (double)(random % 100000) / 1000.0;
+}
+
+static void bench_latency_add(bench_latency_t* latency, uint64_t ns) {
+    if (latency->count == latency->capacity) {
+        size_t capacity = latency->capacity ? latency->capacity * 2 : 4096;
+        uint64_t* samples = realloc(latency->samples, capacity * sizeof(uint64_t));
+        if (!samples) return;
+        latency->samples = samples;
+        latency->capacity = capacity;
+    }
+    latency->samples[latency->count++] = ns;
+}
+
+static void bench_latency_merge(bench_latency_t* into, const bench_latency_t* from) {
+    for (size_t i = 0; i < from->count; i++) {
+        bench_latency_add(into, from->samples[i]);
+    }
+}
+
+static int bench_compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, in microseconds
+static double bench_percentile(const bench_latency_t* latency, double percentile) {
+    if (latency->count == 0) return 0.0;
+
+    size_t rank = (size_t)(percentile * (double)latency->count + 0.999999);
+    rank = CLAMP(rank, (size_t)1, latency->count);
+    return (double)latency->samples[rank - 1] / 1000.0;
+}
+
+// Database file plus its WAL
+static long long bench_database_size(const char* path) {
+    char wal_path[600];
+    struct stat st;
+    long long size = 0;
+
+    if (stat(path, &st) == 0) size += st.st_size;
+    snprintf(wal_path, sizeof(wal_path), "%s-wal", path);
+    if (stat(wal_path, &st) == 0) size += st.st_size;
+    return size;
+}
+
+static void bench_remove_database(const char* path) {
+    char side_path[600];
+
+    unlink(path);
+    snprintf(side_path, sizeof(side_path), "%s-wal", path);
+    unlink(side_path);
+    snprintf(side_path, sizeof(side_path), "%s-shm", path);
+    unlink(side_path);
+}
+
+// Fresh database in the requested modes
+static database_context_t* bench_open(const bench_options_t* options) {
+    bench_remove_database(options->path);
+
+    database_context_t* ctx = database_init(options->path);
+    if (!ctx) {
+        fprintf(stderr, "Failed to open %s\n", options->path);
+        return NULL;
+    }
+
+    if (strcmp(options->storage, "blocks") == 0) {
+        ctx->config.metric_storage = DATABASE_METRIC_STORAGE_BLOCKS;
+    }
+
+    if (database_set_journal_mode(ctx, options->journal, options->synchronous) != 0) {
+        fprintf(stderr, "Failed to set journal mode %s, synchronous %s\n", options->journal, options->synchronous);
+        database_cleanup(ctx);
+        return NULL;
+    }
+
+    return ctx;
+}
+
+static void bench_close(const bench_options_t* options, database_context_t* ctx) {
+    database_cleanup(ctx);
+    bench_remove_database(options->path);
+}
+
+// Producer: write this thread's rows one call at a time or in batches
+static void* bench_writer_thread(void* arg) {
+    bench_writer_t* writer = (bench_writer_t*)arg;
+    const bench_options_t* options = writer->options;
+    int batch = MAX(options->batch, 1);
+    metric_data_t* metrics = malloc((size_t)batch * sizeof(metric_data_t));
+    if (!metrics) return NULL;
+
+    for (long long done = 0; done < writer->rows; ) {
+        if (writer->stop && atomic_load(writer->stop)) break;
+
+        int count = (int)MIN((long long)batch, writer->rows - done);
+        for (int i = 0; i < count; i++) {
+            bench_metric(options, writer->first + done + i, writer->base, writer->spacing, &metrics[i]);
+        }
+
+        uint64_t start = bench_now_ns();
+        int ret = batch == 1 ? database_insert_metric(writer->ctx, metrics)
+                             : database_insert_metrics_batch(writer->ctx, metrics, count);
+        if (ret == 0 && writer->commit) {
+            ret = database_flush(writer->ctx);
+        }
+        bench_latency_add(&writer->latency, bench_now_ns() - start);
+
+        if (ret == 0) writer->written += count;
+        done += count;
+    }
+
+    free(metrics);
+    return NULL;
+}
+
+// Reader: range statistics of random series over random windows
+static void* bench_reader_thread(void* arg) {
+    bench_reader_t* reader = (bench_reader_t*)arg;
+    const bench_options_t* options = reader->options;
+    int64_t span = MAX(reader->end - reader->base - BENCH_STATS_WINDOW, (int64_t)1);
+
+    for (uint64_t i = 0; !atomic_load(reader->stop); i++) {
+        metric_data_t metric;
+        uint64_t random = bench_random(reader->seed, i);
+        bench_metric(options, (long long)(random % (uint64_t)options->series), 0, 0, &metric);
+        time_t start_time = (time_t)(reader->base + (int64_t)(random >> 32) % span);
+
+        stats_result_t stats;
+        uint64_t start = bench_now_ns();
+        if (database_get_metric_stats(reader->ctx, metric.type, metric.node_id, start_time,
+                                      start_time + BENCH_STATS_WINDOW, &stats) != 0) {
+            reader->failures++;
+        }
+        bench_latency_add(&reader->latency, bench_now_ns() - start);
+    }
+
+    return NULL;
+}
+
+// Run `threads` producers over rows; the calling thread waits for them
+static long long bench_run_writers(const bench_options_t* options, database_context_t* ctx, int threads,
+                                   long long rows, int64_t base, int64_t spacing, bool commit,
+                                   atomic_bool* stop, bench_latency_t* latency) {
+    bench_writer_t* writers = calloc((size_t)threads, sizeof(bench_writer_t));
+    pthread_t* handles = calloc((size_t)threads, sizeof(pthread_t));
+    long long written = 0;
+    if (!writers || !handles) {
+        free(writers);
+        free(handles);
+        return 0;
+    }
+
+    // Contiguous runs of whole rounds, so threads write disjoint rows
+    long long per_thread = rows / threads;
+    for (int t = 0; t < threads; t++) {
+        writers[t] = (bench_writer_t){
+            .options = options, .ctx = ctx, .first = t * per_thread,
+            .rows = t == threads - 1 ? rows - t * per_thread : per_thread,
+            .base = base, .spacing = spacing, .commit = commit, .stop = stop
+        };
+        pthread_create(&handles[t], NULL, bench_writer_thread, &writers[t]);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+        written += writers[t].written;
+        bench_latency_merge(latency, &writers[t].latency);
+        free(writers[t].latency.samples);
+    }
+
+    free(writers);
+    free(handles);
+    return written;
+}
+
+// insert and batch: threads producers, through the writer if requested or needed
+static int bench_profile_ingest(const bench_options_t* options, bench_result_t* result, int batch) {
+    database_context_t* ctx = bench_open(options);
+    if (!ctx) return -1;
+
+    // Without the writer the connection takes one writing thread
+    bench_options_t run = *options;
+    run.batch = batch;
+    run.writer = options->writer || options->threads > 1;
+    if (run.writer && database_start_writer(ctx) != 0) {
+        bench_close(options, ctx);
+        return -1;
+    }
+
+    int64_t base = (int64_t)time(NULL) - options->rows / options->series;
+    result->size_before = bench_database_size(options->path);
+
+    uint64_t start = bench_now_ns();
+    result->rows = bench_run_writers(&run, ctx, options->threads, options->rows, base, 1, false, NULL, &result->latency);
+    if (run.writer) {
+        database_flush(ctx);
+    }
+    result->seconds = (double)(bench_now_ns() - start) / 1e9;
+
+    database_stop_writer(ctx);
+    result->size_after = bench_database_size(options->path);
+    bench_close(options, ctx);
+    return 0;
+}
+
+// mixed: one producer through the writer, threads readers until it finishes
+static int bench_profile_mixed(const bench_options_t* options, bench_result_t* result, bench_result_t* reads) {
+    database_context_t* ctx = bench_open(options);
+    if (!ctx) return -1;
+
+    // Half the rows first, so readers always find data
+    int64_t base = (int64_t)time(NULL) - options->rows / options->series;
+    bench_latency_t preload = { 0 };
+    bench_run_writers(options, ctx, 1, options->rows / 2, base, 1, false, NULL, &preload);
+    free(preload.samples);
+
+    if (database_start_writer(ctx) != 0) {
+        bench_close(options, ctx);
+        return -1;
+    }
+
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    bench_reader_t* readers = calloc((size_t)options->threads, sizeof(bench_reader_t));
+    pthread_t* handles = calloc((size_t)options->threads, sizeof(pthread_t));
+    if (!readers || !handles) {
+        free(readers);
+        free(handles);
+        bench_close(options, ctx);
+        return -1;
+    }
+
+    result->size_before = bench_database_size(options->path);
+    uint64_t start = bench_now_ns();
+
+    for (int t = 0; t < options->threads; t++) {
+        readers[t] = (bench_reader_t){
+            .options = options, .ctx = ctx, .base = base, .end = base + options->rows / 2 / options->series,
+            .seed = options->seed + (uint64_t)t + 1, .stop = &stop
+        };
+        pthread_create(&handles[t], NULL, bench_reader_thread, &readers[t]);
+    }
+
+    // The second half, in batches of the configured size
+    bench_writer_t writer = {
+        .options = options, .ctx = ctx, .first = options->rows / 2, .rows = options->rows - options->rows / 2,
+        .base = base, .spacing = 1
+    };
+    bench_writer_thread(&writer);
+    database_flush(ctx);
+    result->seconds = (double)(bench_now_ns() - start) / 1e9;
+    result->rows = writer.written;
+    result->latency = writer.latency;
+
+    atomic_store(&stop, true);
+    reads->seconds = result->seconds;
+    for (int t = 0; t < options->threads; t++) {
+        pthread_join(handles[t], NULL);
+        reads->rows += (long long)readers[t].latency.count - readers[t].failures;
+        bench_latency_merge(&reads->latency, &readers[t].latency);
+        free(readers[t].latency.samples);
+    }
+    free(readers);
+    free(handles);
+
+    database_stop_writer(ctx);
+    result->size_after = bench_database_size(options->path);
+    reads->size_before = result->size_before;
+    reads->size_after = result->size_after;
+    bench_close(options, ctx);
+    return 0;
+}
+
+// retention: BENCH_RETENTION_DAYS of partitions, then batches committed one
+// by one while the writer sweeps everything older than BENCH_RETENTION_KEEP
+static int bench_profile_retention(const bench_options_t* options, bench_result_t* result) {
+    database_context_t* ctx = bench_open(options);
+    if (!ctx) return -1;
+
+    // The preload spreads rows evenly over the days, ending now
+    int64_t now = (int64_t)time(NULL);
+    int64_t rounds = MAX(options->rows / options->series, 1LL);
+    int64_t spacing = MAX((int64_t)BENCH_RETENTION_DAYS * 86400 / rounds, (int64_t)1);
+    bench_latency_t preload = { 0 };
+    bench_options_t run = *options;
+    run.batch = MAX(options->batch, 1000);
+    bench_run_writers(&run, ctx, 1, options->rows, now - rounds * spacing, spacing, false, NULL, &preload);
+    free(preload.samples);
+
+    if (database_start_writer(ctx) != 0) {
+        bench_close(options, ctx);
+        return -1;
+    }
+
+    result->size_before = bench_database_size(options->path);
+    uint64_t dropped = ctx->dropped_partitions;
+    uint64_t swept = ctx->swept_rows;
+
+    // Ingest until the sweep is done, each batch timed up to its commit
+    uint64_t start = bench_now_ns();
+    database_cleanup_old_data(ctx, BENCH_RETENTION_KEEP);
+
+    bench_writer_t writer = {
+        .options = options, .ctx = ctx, .rows = options->batch, .base = now, .spacing = 1, .commit = true
+    };
+    while (atomic_load(&ctx->cleanup_cutoff) != 0) {
+        bench_writer_thread(&writer);
+        writer.first += writer.rows;
+    }
+    database_flush(ctx);
+    result->seconds = (double)(bench_now_ns() - start) / 1e9;
+    result->rows = writer.written;
+    result->latency = writer.latency;
+
+    database_stop_writer(ctx);
+    result->size_after = bench_database_size(options->path);
+    printf("  retention: dropped %llu partitions and %llu rows in %.2f s\n",
+           (unsigned long long)(ctx->dropped_partitions - dropped), (unsigned long long)(ctx->swept_rows - swept),
+           result->seconds);
+    bench_close(options, ctx);
+    return 0;
+}
+
+static void bench_print_result(bench_result_t* result, const char* unit) {
+    qsort(result->latency.samples, result->latency.count, sizeof(uint64_t), bench_compare_u64);
+
+    long long growth = result->size_after - result->size_before;
+    printf("%-10s %10lld %-7s %8.2f s %12.0f %s/s   p50 %9.1f us   p99 %9.1f us   p999 %9.1f us   size %+9.2f MiB",
+           result->name, result->rows, unit, result->seconds,
+           result->seconds > 0 ? (double)result->rows / result->seconds : 0.0, unit,
+           bench_percentile(&result->latency, 0.50), bench_percentile(&result->latency, 0.99),
+           bench_percentile(&result->latency, 0.999), (double)growth / (1024.0 * 1024.0));
+    if (result->rows > 0 && strcmp(unit, "rows") == 0) {
+        printf(" (%.1f B/row)", (double)growth / (double)result->rows);
+    }
+    printf("\n");
+}
+
+static void bench_usage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --profile NAME      insert, batch, mixed, retention or all (default all)\n"
+           "  --rows N            Rows each profile writes (default 100000)\n"
+           "  --series N          Distinct series the rows cycle through (default 64)\n"
+           "  --threads N         Producers for insert and batch, readers for mixed (default 1)\n"
+           "  --batch N           Rows per batch call (default 500)\n"
+           "  --writer            Insert through the write-behind writer\n"
+           "  --journal MODE      wal, delete, truncate, persist, memory or off (default wal)\n"
+           "  --synchronous MODE  off, normal, full or extra (default normal)\n"
+           "  --storage KIND      rows or blocks (default rows)\n"
+           "  --path FILE         Database file, on tmpfs by default\n"
+           "  --seed N            Workload seed (default 1)\n", program);
+}
+
+static int bench_parse_options(int argc, char* argv[], bench_options_t* options) {
+    static const struct option long_options[] = {
+        { "profile", required_argument, NULL, 'p' },
+        { "rows", required_argument, NULL, 'r' },
+        { "series", required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 't' },
+        { "batch", required_argument, NULL, 'b' },
+        { "writer", no_argument, NULL, 'w' },
+        { "journal", required_argument, NULL, 'j' },
+        { "synchronous", required_argument, NULL, 'y' },
+        { "storage", required_argument, NULL, 'k' },
+        { "path", required_argument, NULL, 'f' },
+        { "seed", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(options, 0, sizeof(bench_options_t));
+    strcpy(options->profile, "all");
+    strcpy(options->journal, "wal");
+    strcpy(options->synchronous, "normal");
+    strcpy(options->storage, "rows");
+    snprintf(options->path, sizeof(options->path), "%s/bench_xapp.db",
+             access(BENCH_TMPFS_DIR, W_OK) == 0 ? BENCH_TMPFS_DIR : "/tmp");
+    options->rows = 100000;
+    options->series = 64;
+    options->threads = 1;
+    options->batch = 500;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p': snprintf(options->profile, sizeof(options->profile), "%s", optarg); break;
+            case 'r': options->rows = atoll(optarg); break;
+            case 's': options->series = atoi(optarg); break;
+            case 't': options->threads = atoi(optarg); break;
+            case 'b': options->batch = atoi(optarg); break;
+            case 'w': options->writer = true; break;
+            case 'j': snprintf(options->journal, sizeof(options->journal), "%s", optarg); break;
+            case 'y': snprintf(options->synchronous, sizeof(options->synchronous), "%s", optarg); break;
+            case 'k': snprintf(options->storage, sizeof(options->storage), "%s", optarg); break;
+            case 'f': snprintf(options->path, sizeof(options->path), "%s", optarg); break;
+            case 'e': options->seed = strtoull(optarg, NULL, 10); break;
+            default: return -1;
+        }
+    }
+
+    if (options->rows <= 0 || options->series <= 0 || options->threads <= 0 || options->batch <= 0) {
+        fprintf(stderr, "rows, series, threads and batch must be positive\n");
+        return -1;
+    }
+
+    const char* profiles[] = { "all", "insert", "batch", "mixed", "retention" };
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        if (strcmp(options->profile, profiles[i]) == 0) return 0;
+    }
+    fprintf(stderr, "Unknown profile: %s\n", options->profile);
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    bench_options_t options;
+    if (bench_parse_options(argc, argv, &options) != 0) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    utils_init_logging(NULL, LOG_LEVEL_ERROR);
+
+    bool all = strcmp(options.profile, "all") == 0;
+    printf("Storage benchmark: %s, journal %s, synchronous %s, %s storage%s\n", options.path, options.journal,
+           options.synchronous, options.storage, options.writer ? ", write-behind writer" : "");
+    printf("%lld rows over %d series, %d threads, batches of %d, seed %llu\n\n", options.rows, options.series,
+           options.threads, options.batch, (unsigned long long)options.seed);
+
+    int ret = 0;
+
+    if (all || strcmp(options.profile, "insert") == 0) {
+        bench_result_t result = { .name = "insert" };
+        ret |= bench_profile_ingest(&options, &result, 1);
+        bench_print_result(&result, "rows");
+        free(result.latency.samples);
+    }
+
+    if (all || strcmp(options.profile, "batch") == 0) {
+        bench_result_t result = { .name = "batch" };
+        ret |= bench_profile_ingest(&options, &result, options.batch);
+        bench_print_result(&result, "rows");
+        free(result.latency.samples);
+    }
+
+    if (all || strcmp(options.profile, "mixed") == 0) {
+        bench_result_t writes = { .name = "mixed-w" };
+        bench_result_t reads = { .name = "mixed-r" };
+        ret |= bench_profile_mixed(&options, &writes, &reads);
+        bench_print_result(&writes, "rows");
+        bench_print_result(&reads, "queries");
+        free(writes.latency.samples);
+        free(reads.latency.samples);
+    }
+
+    if (all || strcmp(options.profile, "retention") == 0) {
+        bench_result_t result = { .name = "retention" };
+        ret |= bench_profile_retention(&options, &result);
+        bench_print_result(&result, "rows");
+        free(result.latency.samples);
+    }
+
+    utils_cleanup_logging();
+    return ret != 0 ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * KPM Decoder Benchmark for Smart Monitor xApp
+ *
+ * Replays E2SM-KPM indication payloads through the decoder:
+ * - Recorded payloads from capture files, or synthesized reports
+ * - Decoding in KPM_DECODE_BATCH stack batches, as the xApp does
+ * - Records/s, MB/s and p50/p99/p999 latency per indication
+ *
+ * A capture file is a sequence of little-endian u32 lengths, each followed
+ * by one payload; --save writes the synthesized set in that format.
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <endian.h>
+#include "../include/kpm_decoder.h"
+#include "../include/utils.h"
+
+#define BENCH_MEASUREMENT_KINDS 7   // Standard measurements kpm_decoder_init maps
+
+typedef struct {
+    char input[512];
+    char save[512];
+    int messages;
+    int cells;
+    int measurements;
+    int periods;
+    int iterations;
+    uint64_t seed;
+} bench_options_t;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} bench_payload_t;
+
+typedef struct {
+    bench_payload_t* payloads;
+    size_t count;
+    size_t capacity;
+    size_t bytes;
+} bench_capture_t;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: the value at a given index
+static uint64_t bench_random(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int bench_capture_add(bench_capture_t* capture, uint8_t* data, size_t size) {
+    if (capture->count == capture->capacity) {
+        size_t capacity = capture->capacity ? capture->capacity * 2 : 256;
+        bench_payload_t* payloads = realloc(capture->payloads, capacity * sizeof(bench_payload_t));
+        if (!payloads) return -1;
+        capture->payloads = payloads;
+        capture->capacity = capacity;
+    }
+    capture->payloads[capture->count++] = (bench_payload_t){ .data = data, .size = size };
+    capture->bytes += size;
+    return 0;
+}
+
+static void bench_capture_free(bench_capture_t* capture) {
+    for (size_t i = 0; i < capture->count; i++) {
+        free(capture->payloads[i].data);
+    }
+    free(capture->payloads);
+}
+
+// Load every length-prefixed payload of a capture file
+static int bench_capture_load(bench_capture_t* capture, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -1;
+    }
+
+    uint32_t length;
+    int ret = 0;
+    while (fread(&length, sizeof(length), 1, file) == 1) {
+        size_t size = le32toh(length);
+        uint8_t* data = malloc(size ? size : 1);
+        if (!data || fread(data, 1, size, file) != size || bench_capture_add(capture, data, size) != 0) {
+            fprintf(stderr, "Truncated capture %s after %zu payloads\n", path, capture->count);
+            free(data);
+            ret = -1;
+            break;
+        }
+    }
+
+    fclose(file);
+    return ret;
+}
+
+static int bench_capture_save(const bench_capture_t* capture, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create %s\n", path);
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < capture->count && ret == 0; i++) {
+        uint32_t length = htole32((uint32_t)capture->payloads[i].size);
+        if (fwrite(&length, sizeof(length), 1, file) != 1 ||
+            fwrite(capture->payloads[i].data, 1, capture->payloads[i].size, file) != capture->payloads[i].size) {
+            ret = -1;
+        }
+    }
+
+    if (fclose(file) != 0) ret = -1;
+    return ret;
+}
+
+// Reports of cells x periods x measurements, cycling over the mapped
+// measurement kinds; about 1% of the records carry no value
+static int bench_capture_synthesize(bench_capture_t* capture, const bench_options_t* options) {
+    size_t meas_count = (size_t)options->measurements;
+    size_t records = (size_t)options->periods * meas_count;
+    size_t capacity = KPM_HEADER_SIZE + (size_t)options->cells *
+                      (KPM_CELL_HEADER_SIZE + meas_count * KPM_MEAS_TYPE_SIZE + records * KPM_RECORD_SIZE);
+    uint16_t* ids = malloc(meas_count * sizeof(uint16_t));
+    uint8_t* kinds = malloc(meas_count);
+    double* values = malloc(records * sizeof(double));
+    int ret = ids && kinds && values ? 0 : -1;
+
+    for (size_t meas = 0; meas < meas_count && ret == 0; meas++) {
+        ids[meas] = (uint16_t)(meas % BENCH_MEASUREMENT_KINDS + 1);
+        kinds[meas] = ids[meas] == 1 ? KPM_RECORD_INTEGER : KPM_RECORD_REAL;
+    }
+
+    uint64_t index = 0;
+    for (int message = 0; message < options->messages && ret == 0; message++) {
+        uint8_t* data = malloc(capacity);
+        kpm_writer_t writer;
+        kpm_writer_init(&writer, data, data ? capacity : 0, 1700000000000LL + message * 1000LL, 250);
+
+        for (int cell = 0; cell < options->cells && ret == 0; cell++) {
+            for (size_t i = 0; i < records; i++) {
+                uint64_t random = bench_random(options->seed, index++);
+                values[i] = random % 100 == 0 ? NAN : (double)(random % 1000000) / 100.0;
+            }
+            ret = kpm_writer_add_cell(&writer, (uint32_t)cell + 1, ids, kinds, (uint16_t)meas_count,
+                                      (uint16_t)options->periods, values);
+        }
+
+        size_t size = kpm_writer_finish(&writer);
+        if (ret != 0 || size == 0 || bench_capture_add(capture, data, size) != 0) {
+            free(data);
+            ret = -1;
+        }
+    }
+
+    free(ids);
+    free(kinds);
+    free(values);
+    return ret;
+}
+
+static int bench_compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, in microseconds
+static double bench_percentile(const uint64_t* samples, size_t count, double percentile) {
+    if (count == 0) return 0.0;
+
+    size_t rank = (size_t)(percentile * (double)count + 0.999999);
+    rank = CLAMP(rank, (size_t)1, count);
+    return (double)samples[rank - 1] / 1000.0;
+}
+
+// Decode every payload `iterations` times, timing each indication
+static int bench_decode(const bench_capture_t* capture, const bench_options_t* options) {
+    kpm_decoder_t decoder;
+    kpm_decoder_init(&decoder);
+
+    size_t samples_count = capture->count * (size_t)options->iterations;
+    uint64_t* samples = malloc(samples_count * sizeof(uint64_t));
+    if (!samples) return -1;
+
+    metric_data_t metrics[KPM_DECODE_BATCH];
+    uint64_t records = 0, skipped = 0, rejected = 0;
+    double checksum = 0.0;
+    size_t sample = 0;
+    uint64_t start = bench_now_ns();
+
+    for (int iteration = 0; iteration < options->iterations; iteration++) {
+        for (size_t i = 0; i < capture->count; i++) {
+            uint64_t begin = bench_now_ns();
+            kpm_reader_t reader;
+            if (kpm_reader_init(&reader, &decoder, capture->payloads[i].data, capture->payloads[i].size,
+                                (uint32_t)i) != 0) {
+                rejected++;
+            } else {
+                size_t count;
+                while ((count = kpm_reader_next(&reader, metrics, KPM_DECODE_BATCH)) > 0) {
+                    records += count;
+                    checksum += metrics[count - 1].value;
+                }
+                skipped += reader.skipped;
+            }
+            samples[sample++] = bench_now_ns() - begin;
+        }
+    }
+
+    double seconds = (double)(bench_now_ns() - start) / 1e9;
+    qsort(samples, sample, sizeof(uint64_t), bench_compare_u64);
+
+    double bytes = (double)capture->bytes * options->iterations;
+    printf("%-10s %12s %12s %10s %10s %10s %10s\n", "payloads", "metrics/s", "MB/s", "p50 us", "p99 us", "p999 us",
+           "rejected");
+    printf("%-10zu %12.0f %12.1f %10.2f %10.2f %10.2f %10llu\n", capture->count,
+           seconds > 0 ? (double)records / seconds : 0.0, seconds > 0 ? bytes / seconds / 1e6 : 0.0,
+           bench_percentile(samples, sample, 0.50), bench_percentile(samples, sample, 0.99),
+           bench_percentile(samples, sample, 0.999), (unsigned long long)(rejected / options->iterations));
+    printf("\n%llu metrics, %llu records without value or mapping, checksum %.3f\n", (unsigned long long)records,
+           (unsigned long long)skipped, checksum);
+
+    free(samples);
+    return rejected > 0 ? -1 : 0;
+}
+
+static void bench_usage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --input FILE        Replay recorded payloads from a capture file\n"
+           "  --save FILE         Write the synthesized payloads as a capture file\n"
+           "  --messages N        Synthesized indications (default 256)\n"
+           "  --cells N           Cells per indication (default 4)\n"
+           "  --measurements N    Measurements per cell (default 256)\n"
+           "  --periods N         Granularity periods per report (default 4)\n"
+           "  --iterations N      Passes over the payloads (default 20)\n"
+           "  --seed N            Value generator seed (default 1)\n",
+           program);
+}
+
+static int bench_parse_options(int argc, char* argv[], bench_options_t* options) {
+    static const struct option long_options[] = {
+        { "input", required_argument, NULL, 'i' },
+        { "save", required_argument, NULL, 'o' },
+        { "messages", required_argument, NULL, 'm' },
+        { "cells", required_argument, NULL, 'c' },
+        { "measurements", required_argument, NULL, 'n' },
+        { "periods", required_argument, NULL, 'g' },
+        { "iterations", required_argument, NULL, 'r' },
+        { "seed", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(options, 0, sizeof(bench_options_t));
+    options->messages = 256;
+    options->cells = 4;
+    options->measurements = 256;
+    options->periods = 4;
+    options->iterations = 20;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': snprintf(options->input, sizeof(options->input), "%s", optarg); break;
+            case 'o': snprintf(options->save, sizeof(options->save), "%s", optarg); break;
+            case 'm': options->messages = atoi(optarg); break;
+            case 'c': options->cells = atoi(optarg); break;
+            case 'n': options->measurements = atoi(optarg); break;
+            case 'g': options->periods = atoi(optarg); break;
+            case 'r': options->iterations = atoi(optarg); break;
+            case 'e': options->seed = strtoull(optarg, NULL, 10); break;
+            default: return -1;
+        }
+    }
+
+    if (options->messages <= 0 || options->cells <= 0 || options->cells > UINT16_MAX || options->periods <= 0 ||
+        options->periods > UINT16_MAX || options->iterations <= 0 || options->measurements <= 0 ||
+        options->measurements > KPM_MAX_MEASUREMENTS) {
+        fprintf(stderr, "messages, cells, periods and iterations must be positive, measurements 1 to %d\n",
+                KPM_MAX_MEASUREMENTS);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    bench_options_t options;
+    if (bench_parse_options(argc, argv, &options) != 0) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    bench_capture_t capture = { 0 };
+    int ret;
+    if (options.input[0]) {
+        ret = bench_capture_load(&capture, options.input);
+        printf("KPM decoder benchmark: %zu recorded payloads from %s, %zu bytes\n", capture.count, options.input,
+               capture.bytes);
+    } else {
+        ret = bench_capture_synthesize(&capture, &options);
+        printf("KPM decoder benchmark: %d indications of %d cells x %d measurements x %d periods, seed %llu\n",
+               options.messages, options.cells, options.measurements, options.periods,
+               (unsigned long long)options.seed);
+    }
+    printf("%d passes, batches of %d metrics\n\n", options.iterations, KPM_DECODE_BATCH);
+
+    if (ret == 0 && options.save[0]) {
+        ret = bench_capture_save(&capture, options.save);
+    }
+    if (ret == 0 && capture.count == 0) {
+        fprintf(stderr, "No payloads to decode\n");
+        ret = -1;
+    }
+    if (ret == 0) {
+        ret = bench_decode(&capture, &options);
+    }
+
+    bench_capture_free(&capture);
+    return ret != 0 ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Statistics Kernels Benchmark for Smart Monitor xApp
+ *
+ * Times the reduction kernels the analytics module runs per window:
+ * - The kernels picked for the running CPU against the scalar reference
+ * - Several array lengths, from one analytics window to large scans
+ * - ns per call, GB/s and speedup per kernel
+ * - A cross-check of every result against the scalar kernels
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include "../include/stats_kernels.h"
+#include "../include/utils.h"
+
+#define BENCH_MAX_LENGTHS 8
+
+typedef struct {
+    int lengths[BENCH_MAX_LENGTHS];
+    int length_count;
+    int min_ms;
+    uint64_t seed;
+} bench_options_t;
+
+// One kernel call over n values; returns a value that depends on the result
+typedef double (*bench_kernel_fn)(const stats_kernels_t* kernels, const double* a, const double* b, int n);
+
+typedef struct {
+    const char* name;
+    bench_kernel_fn run;
+    int arrays;                  // Input arrays read per call
+} bench_kernel_t;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: the value at a given index
+static uint64_t bench_random(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double bench_sum(const stats_kernels_t* kernels, const double* a, const double* b, int n) {
+    (void)b;
+    return kernels->sum(a, n);
+}
+
+static double bench_sum_sq_dev(const stats_kernels_t* kernels, const double* a, const double* b, int n) {
+    (void)b;
+    return kernels->sum_sq_dev(a, n, 50.0);
+}
+
+static double bench_min_max(const stats_kernels_t* kernels, const double* a, const double* b, int n) {
+    (void)b;
+    double min, max;
+    kernels->min_max(a, n, &min, &max);
+    return max - min;
+}
+
+static double bench_regression_sums(const stats_kernels_t* kernels, const double* a, const double* b, int n) {
+    (void)b;
+    double sum_y, sum_xy, sum_yy;
+    kernels->regression_sums(a, n, a[0], &sum_y, &sum_xy, &sum_yy);
+    return sum_y + sum_xy + sum_yy;
+}
+
+static double bench_dot(const stats_kernels_t* kernels, const double* a, const double* b, int n) {
+    return kernels->dot(a, b, n);
+}
+
+static const bench_kernel_t BENCH_KERNELS[] = {
+    { "sum", bench_sum, 1 },
+    { "sum_sq_dev", bench_sum_sq_dev, 1 },
+    { "min_max", bench_min_max, 1 },
+    { "regression", bench_regression_sums, 1 },
+    { "dot", bench_dot, 2 }
+};
+
+#define BENCH_KERNEL_COUNT (int)(sizeof(BENCH_KERNELS) / sizeof(BENCH_KERNELS[0]))
+
+// Best of five runs of at least min_ms / 5 each, in ns per call
+static double bench_time(const bench_kernel_t* kernel, const stats_kernels_t* kernels, const double* a,
+                         const double* b, int n, int min_ms, double* checksum) {
+    uint64_t budget = (uint64_t)min_ms * 1000000ULL / 5;
+    double best = INFINITY;
+
+    for (int run = 0; run < 5; run++) {
+        uint64_t calls = 0;
+        uint64_t start = bench_now_ns();
+        uint64_t elapsed;
+        do {
+            for (int i = 0; i < 64; i++) {
+                *checksum += kernel->run(kernels, a, b, n);
+            }
+            calls += 64;
+            elapsed = bench_now_ns() - start;
+        } while (elapsed < budget);
+
+        best = MIN(best, (double)elapsed / (double)calls);
+    }
+    return best;
+}
+
+// Time every kernel at every length, best against scalar
+static int bench_kernels(const bench_options_t* options) {
+    const stats_kernels_t* scalar = stats_kernels_scalar();
+    const stats_kernels_t* best = stats_kernels_get();
+
+    int max_length = 0;
+    for (int i = 0; i < options->length_count; i++) {
+        max_length = MAX(max_length, options->lengths[i]);
+    }
+
+    // Gauge-like values around 50, as the analytics windows hold
+    double* a = malloc((size_t)max_length * sizeof(double));
+    double* b = malloc((size_t)max_length * sizeof(double));
+    if (!a || !b) {
+        free(a);
+        free(b);
+        return -1;
+    }
+    for (int i = 0; i < max_length; i++) {
+        a[i] = 50.0 + (double)(bench_random(options->seed, (uint64_t)i) % 10000) / 100.0 - 50.0;
+        b[i] = (double)(bench_random(options->seed, (uint64_t)(i + max_length)) % 1000) / 1000.0;
+    }
+
+    printf("%-12s %8s %12s %12s %10s %10s\n", "kernel", "values", "scalar ns", "best ns", "speedup", "best GB/s");
+
+    int mismatches = 0;
+    double checksum = 0.0;
+    for (int k = 0; k < BENCH_KERNEL_COUNT; k++) {
+        const bench_kernel_t* kernel = &BENCH_KERNELS[k];
+
+        for (int i = 0; i < options->length_count; i++) {
+            int n = options->lengths[i];
+
+            // Vector kernels sum in a different order: allow rounding
+            double expected = kernel->run(scalar, a, b, n);
+            double actual = kernel->run(best, a, b, n);
+            if (fabs(actual - expected) > 1e-9 * MAX(1.0, fabs(expected))) {
+                fprintf(stderr, "%s over %d values: %.17g, scalar %.17g\n", kernel->name, n, actual, expected);
+                mismatches++;
+            }
+
+            double scalar_ns = bench_time(kernel, scalar, a, b, n, options->min_ms, &checksum);
+            double best_ns = bench_time(kernel, best, a, b, n, options->min_ms, &checksum);
+            double bytes = (double)n * sizeof(double) * kernel->arrays;
+
+            printf("%-12s %8d %12.1f %12.1f %9.2fx %10.2f\n", kernel->name, n, scalar_ns, best_ns,
+                   scalar_ns / best_ns, bytes / best_ns);
+        }
+    }
+    printf("\nchecksum %.6g\n", checksum);
+
+    free(a);
+    free(b);
+    return mismatches > 0 ? -1 : 0;
+}
+
+static void bench_usage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --length N          Values per call; repeat for several (default 64, 1000, 16384)\n"
+           "  --time MS           Time spent per kernel, length and implementation (default 200)\n"
+           "  --seed N            Value generator seed (default 1)\n",
+           program);
+}
+
+static int bench_parse_options(int argc, char* argv[], bench_options_t* options) {
+    static const struct option long_options[] = {
+        { "length", required_argument, NULL, 'n' },
+        { "time", required_argument, NULL, 't' },
+        { "seed", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(options, 0, sizeof(bench_options_t));
+    options->min_ms = 200;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                if (options->length_count == BENCH_MAX_LENGTHS) {
+                    fprintf(stderr, "At most %d lengths\n", BENCH_MAX_LENGTHS);
+                    return -1;
+                }
+                options->lengths[options->length_count++] = atoi(optarg);
+                break;
+            case 't': options->min_ms = atoi(optarg); break;
+            case 'e': options->seed = strtoull(optarg, NULL, 10); break;
+            default: return -1;
+        }
+    }
+
+    if (options->length_count == 0) {
+        options->lengths[options->length_count++] = 64;
+        options->lengths[options->length_count++] = 1000;
+        options->lengths[options->length_count++] = 16384;
+    }
+
+    for (int i = 0; i < options->length_count; i++) {
+        if (options->lengths[i] <= 0) {
+            fprintf(stderr, "Lengths must be positive\n");
+            return -1;
+        }
+    }
+    if (options->min_ms <= 0) {
+        fprintf(stderr, "Time must be positive\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    bench_options_t options;
+    if (bench_parse_options(argc, argv, &options) != 0) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    printf("Statistics kernels benchmark: %s against %s, seed %llu\n\n", stats_kernels_get()->name,
+           stats_kernels_scalar()->name, (unsigned long long)options.seed);
+
+    return bench_kernels(&options) != 0 ? 1 : 0;
+}
@@ -9,6 +9,18 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "sliding_window.h"
+
+// Capacity of the per-metric history ring
+#define ANALYTICS_HISTORY_SIZE 1000
+
+// Default memory budget for per-(node, cell) series
+#define ANALYTICS_DEFAULT_SERIES_BUDGET (64 * 1024 * 1024)
+
+// Order and NLMS step size of the per-history autoregressive model
+#define ANALYTICS_AR_ORDER 10
+#define ANALYTICS_AR_STEP 0.5
+
 // Metric types
 typedef enum {
     METRIC_THROUGHPUT,
@@ -41,6 +53,12 @@ typedef enum {
     RECOMMENDATION_PARAMETER_ADJUSTMENT
 } recommendation_type_t;
 
+// When anomaly detection runs for batched samples
+typedef enum {
+    ANALYTICS_DETECT_PER_BATCH,    // Once per series per batch, on its most extreme sample
+    ANALYTICS_DETECT_PER_SAMPLE    // On every sample, as analytics_process_metric does
+} analytics_detection_mode_t;
+
 // Metric data point
 typedef struct {
     metric_type_t type;
@@ -58,6 +76,8 @@ typedef struct {
     double min;
     double max;
     double median;
+    double p95;
+    double p99;
     double z_score;
     bool is_outlier;
 } stats_result_t;
@@ -109,26 +129,90 @@ typedef struct {
     threshold_config_t thresholds[METRIC_COUNT];
     int window_size;
     int trend_window;
+    bool trend_use_timestamps;     // Regress trends against sample time instead of sample index
+    size_t series_memory_budget;   // Bytes available to per-(node, cell) series
     double outlier_threshold;
     double correlation_threshold;
+    analytics_detection_mode_t detection_mode;
     bool enable_ml_detection;
     bool enable_prediction;
 } analytics_config_t;
 
-// Metric history for trend analysis
+// Running sums of the trend regression over the newest `window` samples of a
+// history. x is the sample index, or the sample timestamp in seconds when
+// use_timestamps is set. Sums are kept relative to an origin near the data
+// and re-derived from the history ring once per `window` evictions.
+typedef struct {
+    int window;                // Samples regressed, 0 disables the regression
+    bool use_timestamps;
+    int count;
+    uint64_t next_index;       // x of the next sample in index mode
+    double x_origin;
+    double y_origin;
+    double sum_x;
+    double sum_y;
+    double sum_xy;
+    double sum_x2;
+    double sum_y2;
+    int resync_countdown;
+} trend_regression_t;
+
+// Online AR(ANALYTICS_AR_ORDER) model forecasting the next sample of a
+// history. Inputs are deviations from a running level; the weights are
+// updated with normalized LMS on every sample, in O(order), or fitted in one
+// go from the history with analytics_history_fit_model.
 typedef struct {
-    metric_data_t data[1000];  // Circular buffer
+    double weights[ANALYTICS_AR_ORDER];   // weights[k] applies to the sample k + 1 steps back
+    double lags[ANALYTICS_AR_ORDER];      // Newest samples, lags[0] most recent
+    int lag_count;
+    double level;              // Running level the model predicts deviations from
+    double center;             // Level the current forecast was made with
+    double forecast;           // Forecast of the next sample
+    double residual_var;       // Running mean of squared forecast errors
+    double last_error;         // Error of the newest sample against its forecast
+    double last_scale;         // Residual standard deviation before the newest sample
+    uint64_t samples;
+    uint64_t updates;          // Samples that had a forecast
+} ar_model_t;
+
+// Metric history for trend analysis. Samples are stored column-wise so the
+// statistics kernels read contiguous values instead of striding over
+// metric_data_t records.
+typedef struct {
+    double* values;            // Circular buffer of `capacity` sample values
+    time_t* timestamps;        // Sample timestamps, same slots as values
+    int capacity;
     int head;
     int tail;
     int count;
+    sliding_window_t window;   // Rolling statistics over the newest window_size samples
+    trend_regression_t regression;   // Trend over the newest trend_window samples
+    ar_model_t model;          // One-step forecast used by ML detection
     stats_result_t last_stats;
     trend_result_t last_trend;
 } metric_history_t;
 
+// Per-(metric_type, node_id, cell_id) series store (see series_store.h)
+typedef struct series_store series_store_t;
+
+// Stream of anomalies and recommendations (see analytics_events.h)
+typedef struct analytics_event_log analytics_event_log_t;
+
+// Series touched by a batch, with its smallest and largest sample and the
+// run of its samples in the grouped batch
+typedef struct {
+    metric_history_t* history; // NULL once evicted within the batch
+    int low;                   // Index into the batch
+    int high;
+    int offset;                // First sample in batch_values
+    int count;
+} analytics_batch_series_t;
+
 // Analytics context
 typedef struct {
     analytics_config_t config;
-    metric_history_t history[METRIC_COUNT];
+    metric_history_t history[METRIC_COUNT];   // Fleet-wide view per metric type
+    series_store_t* series;                   // Per-entity histories used for detection
     
     // Anomaly detection state
     anomaly_result_t recent_anomalies[100];
@@ -138,13 +222,16 @@ typedef struct {
     recommendation_result_t recent_recommendations[100];
     int recommendation_count;
     
-    // ML models (simplified)
-    struct {
-        bool initialized;
-        double weights[10];
-        double bias;
-        double learning_rate;
-    } ml_model;
+    // Event stream results are also appended to, not owned
+    analytics_event_log_t* events;
+    
+    // Batch ingestion scratch, reused across batches
+    analytics_batch_series_t* batch_series;
+    int32_t* batch_index;      // Open-addressing set of batch_series slots
+    int32_t* batch_slot;       // batch_series slot of each sample, -1 if none
+    double* batch_values;      // Samples grouped into runs per series or type
+    time_t* batch_timestamps;
+    int batch_capacity;
     
     // Performance counters
     uint64_t processed_metrics;
@@ -159,14 +246,33 @@ typedef struct {
 analytics_context_t* analytics_init(const char* config_file);
 void analytics_cleanup(analytics_context_t* ctx);
 int analytics_load_config(analytics_context_t* ctx, const char* config_file);
+int analytics_set_series_budget(analytics_context_t* ctx, size_t memory_budget);
+void analytics_set_event_log(analytics_context_t* ctx, analytics_event_log_t* events);
 
 // Metric processing
 int analytics_process_metric(analytics_context_t* ctx, const metric_data_t* metric);
+int analytics_process_metrics_batch(analytics_context_t* ctx, const metric_data_t* metrics, int count);
 int analytics_add_metric(analytics_context_t* ctx, metric_type_t type, double value, uint32_t node_id, uint32_t cell_id);
 
+// History management
+int analytics_history_init(metric_history_t* history, int capacity, int window_size);
+void analytics_history_free(metric_history_t* history);
+void analytics_history_reset(metric_history_t* history);
+void analytics_history_set_trend(metric_history_t* history, int trend_window, bool use_timestamps);
+trend_result_t analytics_history_trend(const metric_history_t* history);
+int analytics_history_fit_model(metric_history_t* history);
+bool analytics_history_model_ready(const metric_history_t* history);
+void analytics_history_append(metric_history_t* history, const metric_data_t* metric);
+void analytics_history_append_bulk(metric_history_t* history, const double* values, const time_t* timestamps, int count);
+int analytics_history_copy(const metric_history_t* history, double* values, time_t* timestamps, int max_count);
+int analytics_history_merge(const analytics_context_t* ctx, metric_history_t* merged, const double* values,
+                            const time_t* timestamps, const int* run_counts, int run_count);
+
 // Statistical analysis
 stats_result_t analytics_calculate_stats(const metric_data_t* data, int count);
 trend_result_t analytics_calculate_trend(const metric_data_t* data, int count);
+stats_result_t analytics_calculate_stats_values(const double* values, int count);
+trend_result_t analytics_calculate_trend_values(const double* values, int count);
 double analytics_calculate_z_score(double value, double mean, double std_dev);
 bool analytics_is_outlier(double z_score, double threshold);
 
@@ -189,6 +295,8 @@ int analytics_update_ml_model(analytics_context_t* ctx, const metric_data_t* met
 
 // Data access
 metric_history_t* analytics_get_history(analytics_context_t* ctx, metric_type_t type);
+metric_history_t* analytics_get_series_history(analytics_context_t* ctx, metric_type_t type, uint32_t node_id, uint32_t cell_id);
+int analytics_get_series_count(const analytics_context_t* ctx);
 anomaly_result_t* analytics_get_recent_anomalies(analytics_context_t* ctx, int* count);
 recommendation_result_t* analytics_get_recent_recommendations(analytics_context_t* ctx, int* count);
 
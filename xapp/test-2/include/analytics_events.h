@@ -0,0 +1,67 @@
+#ifndef ANALYTICS_EVENTS_H
+#define ANALYTICS_EVENTS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analytics.h"
+
+// Kind of an analytics event
+typedef enum {
+    ANALYTICS_EVENT_ANOMALY,
+    ANALYTICS_EVENT_RECOMMENDATION
+} analytics_event_kind_t;
+
+// One anomaly or recommendation with its place in the stream
+typedef struct {
+    uint64_t sequence;         // 1 for the first event, +1 per event
+    analytics_event_kind_t kind;
+    uint32_t node_id;
+    uint32_t cell_id;
+    union {
+        anomaly_result_t anomaly;
+        recommendation_result_t recommendation;
+    };
+} analytics_event_t;
+
+// Bounded log of analytics events. Producers append under the lock and wake
+// waiting consumers; the newest `capacity` events stay readable.
+struct analytics_event_log {
+    analytics_event_t* events;
+    size_t capacity;           // Power of two
+    size_t mask;
+    uint64_t next_sequence;
+    int waiters;
+    bool closed;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+// Position of one consumer in the log
+typedef struct {
+    uint64_t next_sequence;    // Next event to read
+    uint64_t missed;           // Events overwritten before the consumer read them
+} analytics_event_cursor_t;
+
+// Lifecycle
+analytics_event_log_t* analytics_event_log_create(size_t capacity);
+void analytics_event_log_destroy(analytics_event_log_t* log);
+void analytics_event_log_close(analytics_event_log_t* log);
+
+// Producers
+uint64_t analytics_event_log_append_anomaly(analytics_event_log_t* log, const anomaly_result_t* anomaly,
+                                            uint32_t node_id, uint32_t cell_id);
+uint64_t analytics_event_log_append_recommendation(analytics_event_log_t* log, const recommendation_result_t* recommendation);
+
+// Consumers. A cursor starts at the next event to be appended, or at the
+// oldest retained one with from_oldest. read copies up to max_count events
+// and advances the cursor; with timeout_ms > 0 it waits for the first event.
+// It returns -1 once the log is closed and the cursor has read everything.
+void analytics_event_cursor_init(analytics_event_log_t* log, analytics_event_cursor_t* cursor, bool from_oldest);
+int analytics_event_log_read(analytics_event_log_t* log, analytics_event_cursor_t* cursor,
+                             analytics_event_t* events, int max_count, int timeout_ms);
+uint64_t analytics_event_log_last_sequence(analytics_event_log_t* log);
+
+#endif // ANALYTICS_EVENTS_H
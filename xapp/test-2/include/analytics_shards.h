@@ -0,0 +1,80 @@
+#ifndef ANALYTICS_SHARDS_H
+#define ANALYTICS_SHARDS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analytics.h"
+#include "analytics_events.h"
+#include "utils.h"
+
+#define ANALYTICS_MAX_SHARDS 64
+#define ANALYTICS_EVENT_LOG_CAPACITY 4096
+
+typedef struct analytics_shards analytics_shards_t;
+
+// One analytics worker. The worker thread is the only writer of ctx; it holds
+// lock while it processes a batch so readers can copy results out between
+// batches.
+typedef struct {
+    int index;
+    analytics_shards_t* owner;
+    analytics_context_t* ctx;
+    circular_buffer_t* queue;          // Metrics routed to this shard
+    pthread_t thread;
+    bool thread_started;
+    pthread_mutex_t lock;
+    _Atomic uint64_t accepted;         // Metrics queued to this shard
+    _Atomic uint64_t completed;        // Metrics the worker has processed
+} analytics_shard_t;
+
+// Analytics partitioned into shards by (node_id, cell_id). Every series of a
+// cell lives in exactly one shard, so shards never share state and scale with
+// the number of cores. Each shard keeps the fleet-wide history of its own
+// cells; analytics_shards_get_fleet_stats merges them on read.
+struct analytics_shards {
+    analytics_shard_t* shards;
+    int shard_count;
+    int batch_size;                    // Metrics a worker takes per batch
+    analytics_event_log_t* events;     // Anomalies and recommendations of all shards
+    atomic_bool running;
+};
+
+// Merged performance counters
+typedef struct {
+    uint64_t processed_metrics;
+    uint64_t detected_anomalies;
+    uint64_t generated_recommendations;
+    uint64_t queued_metrics;
+    int series_count;
+    size_t series_memory;
+} analytics_shards_totals_t;
+
+// Lifecycle. Each shard gets its own context loaded from config_file and
+// 1/shard_count of the configured series memory budget.
+analytics_shards_t* analytics_shards_create(const char* config_file, int shard_count,
+                                            size_t queue_capacity, int batch_size);
+int analytics_shards_start(analytics_shards_t* shards);
+void analytics_shards_stop(analytics_shards_t* shards);
+void analytics_shards_destroy(analytics_shards_t* shards);
+
+// Routing and ingestion. submit may be called from any thread; it returns the
+// number of metrics queued, which is less than count when a shard queue is full.
+int analytics_shards_route(const analytics_shards_t* shards, uint32_t node_id, uint32_t cell_id);
+size_t analytics_shards_submit(analytics_shards_t* shards, const metric_data_t* metrics, size_t count);
+void analytics_shards_flush(analytics_shards_t* shards);
+
+// Cross-shard reads, merged on demand. Results are copied out newest first.
+int analytics_shards_get_recent_anomalies(analytics_shards_t* shards, anomaly_result_t* anomalies, int max_count);
+int analytics_shards_get_recent_recommendations(analytics_shards_t* shards, recommendation_result_t* recommendations, int max_count);
+bool analytics_shards_get_series_stats(analytics_shards_t* shards, metric_type_t type, uint32_t node_id, uint32_t cell_id,
+                                       stats_result_t* stats, trend_result_t* trend);
+bool analytics_shards_get_fleet_stats(analytics_shards_t* shards, metric_type_t type,
+                                      stats_result_t* stats, trend_result_t* trend, int* count);
+void analytics_shards_get_totals(analytics_shards_t* shards, analytics_shards_totals_t* totals);
+void analytics_shards_print_performance(analytics_shards_t* shards);
+
+#endif // ANALYTICS_SHARDS_H
@@ -6,10 +6,194 @@
 #include <string.h>
 #include <time.h>
 #include <sqlite3.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #include "analytics.h"
+#include "metric_blocks.h"
+#include "utils.h"
+
+// Write-behind defaults
+#define DATABASE_GROUP_COMMIT_MS 5
+#define DATABASE_GROUP_COMMIT_ROWS 4096
+#define DATABASE_WRITE_QUEUE_CAPACITY 65536
+#define DATABASE_RECORD_QUEUE_CAPACITY 1024
+
+// Day partitions and retention defaults
+#define DATABASE_SECONDS_PER_DAY 86400
+#define DATABASE_PARTITION_CACHE 4
+#define DATABASE_METRIC_RETENTION_DAYS 7
+#define DATABASE_EVENT_RETENTION_DAYS 30
+#define DATABASE_RETENTION_CHUNK_ROWS 1000
+#define DATABASE_RETENTION_INTERVAL_MS 100
+
+// Rollups: per-series count, sum, sum of squares, min and max per bucket
+#define DATABASE_ROLLUP_SLOTS 4096
+#define DATABASE_MINUTE_ROLLUP_RETENTION_DAYS 30
+#define DATABASE_HOUR_ROLLUP_RETENTION_DAYS 365
+
+typedef enum {
+    DATABASE_ROLLUP_SECOND,
+    DATABASE_ROLLUP_MINUTE,
+    DATABASE_ROLLUP_HOUR,
+    DATABASE_ROLLUP_COUNT
+} database_rollup_resolution_t;
+
+// Rollup bucket accumulated in memory until the transaction commits
+typedef struct {
+    bool used;
+    int resolution;
+    int metric_type;
+    uint32_t node_id;
+    uint32_t cell_id;
+    int64_t bucket;               // Bucket start time
+    int64_t count;
+    double shift;                 // First value; sums are of value - shift so
+    double sum;                   // they stay well conditioned for large values
+    double sum_sq;
+    double min;
+    double max;
+} database_rollup_t;
+
+// Where metric samples are stored
+typedef enum {
+    DATABASE_METRIC_STORAGE_ROWS,         // One row per sample in day partitions
+    DATABASE_METRIC_STORAGE_BLOCKS        // Compressed blocks per series
+} database_metric_storage_t;
+
+// Compressed blocks: a block is sealed once it holds block_samples samples
+// or spans DATABASE_BLOCK_SPAN_SECONDS, so retention and range scans work
+// in whole blocks of bounded length
+#define DATABASE_BLOCK_SAMPLES 512
+#define DATABASE_BLOCK_SPAN_SECONDS 3600
+#define DATABASE_OPEN_BLOCK_SLOTS 256
+
+// An open block is written back once this many samples are unwritten, when
+// it seals, and on database_sync_blocks, not on every commit
+#define DATABASE_BLOCK_FLUSH_SAMPLES 128
+
+// Block of one series still taking samples
+typedef struct {
+    int metric_type;
+    uint32_t node_id;
+    uint32_t cell_id;
+    int64_t block_id;             // Row holding the block, 0 until first written
+    bool dirty;                   // Listed in dirty_blocks
+    int unwritten;                // Samples appended since the row was written
+    metric_block_t block;
+    
+    // State before the open transaction touched the block, restored on
+    // rollback. A block sealed by the transaction is kept in sealed until
+    // commit, since its samples from before the transaction may be unwritten.
+    bool marked;
+    metric_block_t mark;          // Shares the buffer of block or sealed
+    int64_t mark_block_id;
+    int mark_unwritten;
+    metric_block_t sealed;
+} database_open_block_t;
+
+// Decoded block being merged into a metric cursor
+typedef struct {
+    int64_t* times;
+    double* values;
+    int capacity;
+    int position;                 // Next sample, counting down to the oldest
+    int metric_type;
+    uint32_t node_id;
+    uint32_t cell_id;
+} database_block_run_t;
+
+// Read connection pool: queries run on read-only connections of their own,
+// each keeping its prepared statements, so under WAL they read a snapshot
+// in parallel with the writer
+#define DATABASE_READ_CONNECTIONS 4
+#define DATABASE_READER_STMT_CACHE 16
+
+// Prepared statement cached on a read connection, keyed by its SQL
+typedef struct {
+    char* sql;
+    sqlite3_stmt* stmt;
+    uint64_t last_used;           // Reader clock at last use, for LRU eviction
+} database_cached_stmt_t;
+
+// Read-only connection, lent to one thread at a time
+typedef struct {
+    sqlite3* db;
+    database_cached_stmt_t stmts[DATABASE_READER_STMT_CACHE];
+    uint64_t clock;
+} database_reader_t;
+
+// Cursor chunk size and filter wildcards
+#define DATABASE_CURSOR_CHUNK_BYTES 65536
+#define DATABASE_ANY -1                // Any metric, recommendation or event type
+#define DATABASE_ANY_NODE 0
+
+// Tables stored as one partition per UTC day
+typedef enum {
+    DATABASE_PARTITION_METRICS,
+    DATABASE_PARTITION_EVENTS,
+    DATABASE_PARTITION_KIND_COUNT
+} database_partition_kind_t;
+
+// Cached insert statement of one day partition
+typedef struct {
+    int64_t day;                  // Days since the epoch
+    sqlite3_stmt* stmt;
+} database_partition_stmt_t;
+
+// Event types for logging
+typedef enum {
+    EVENT_XAPP_START,
+    EVENT_XAPP_STOP,
+    EVENT_NODE_CONNECT,
+    EVENT_NODE_DISCONNECT,
+    EVENT_SUBSCRIPTION_CREATE,
+    EVENT_SUBSCRIPTION_DELETE,
+    EVENT_INDICATION_RECEIVED,
+    EVENT_CONTROL_SENT,
+    EVENT_ANOMALY_DETECTED,
+    EVENT_RECOMMENDATION_GENERATED,
+    EVENT_ERROR,
+    EVENT_TYPE_COUNT
+} event_type_t;
+
+// How database_log_event stores an event type
+typedef enum {
+    DATABASE_EVENT_LOG,                   // One row per event
+    DATABASE_EVENT_COUNT                  // Counted in memory, one summary row per interval
+} database_event_policy_t;
+
+// Event counters: occurrences per (type, node, subscription) since the last
+// summary, in an open-addressing table of DATABASE_EVENT_COUNTER_SLOTS entries
+#define DATABASE_EVENT_SUMMARY_MS 10000
+#define DATABASE_EVENT_COUNTER_SLOTS 1024
+#define DATABASE_EVENT_COUNTER_MESSAGE 128
+
+typedef struct {
+    bool used;
+    int type;
+    uint32_t node_id;
+    uint32_t subscription_id;
+    uint32_t count;
+    int64_t first_seen;
+    int64_t last_seen;
+    char message[DATABASE_EVENT_COUNTER_MESSAGE];   // Of the first occurrence
+} database_event_counter_t;
+
+// Online backup: pages copied per step and pause between steps
+#define DATABASE_BACKUP_STEP_PAGES 256
+#define DATABASE_BACKUP_STEP_MS 10
+
+// Progress of the latest online backup
+typedef struct {
+    bool running;
+    int result;                   // 1 while running, then 0 or -1
+    int total_pages;
+    int remaining_pages;
+    uint64_t elapsed_us;
+} database_backup_progress_t;
 
 // Database configuration
 typedef struct {
@@ -19,6 +203,21 @@ typedef struct {
     bool enable_wal;
     bool enable_foreign_keys;
     int cache_size;
+    int group_commit_ms;          // Longest a writer transaction stays open
+    int group_commit_rows;        // Most rows per writer transaction
+    int write_queue_capacity;     // Metrics the writer queue holds
+    int metric_retention_days;    // Metric partitions older than this are dropped
+    int event_retention_days;     // Event partitions older than this are dropped
+    int retention_chunk_rows;     // Most rows one retention sweep step deletes
+    int retention_interval_ms;    // Pause between retention sweep steps
+    database_metric_storage_t metric_storage;   // Set before the first metric is stored
+    int block_samples;            // Most samples per compressed block
+    int block_flush_samples;      // Unwritten samples that write an open block back, 0 only on seal
+    int read_connections;         // Read-only connections opened by database_init, 0 for none
+    database_event_policy_t event_policy[EVENT_TYPE_COUNT];
+    int event_summary_ms;         // Interval of counted event summary rows
+    int backup_step_pages;        // Pages one online backup step copies
+    int backup_step_ms;           // Pause between online backup steps
 } database_config_t;
 
 // Database context
@@ -28,47 +227,140 @@ typedef struct {
     bool initialized;
     
     // Prepared statements for performance
-    sqlite3_stmt* insert_metric_stmt;
     sqlite3_stmt* insert_anomaly_stmt;
     sqlite3_stmt* insert_recommendation_stmt;
-    sqlite3_stmt* insert_event_stmt;
-    sqlite3_stmt* select_recent_metrics_stmt;
-    sqlite3_stmt* select_node_metrics_stmt;
-    sqlite3_stmt* select_anomalies_stmt;
-    sqlite3_stmt* select_recommendations_stmt;
+    
+    // Read connection pool. Only opened under WAL; without it, or when every
+    // reader stays busy for busy_timeout, queries read on db while the writer
+    // thread is stopped and fail while it runs.
+    database_reader_t* readers;
+    int reader_count;
+    database_reader_t** idle_readers;
+    int idle_reader_count;
+    pthread_mutex_t reader_lock;
+    pthread_cond_t reader_cond;           // Signalled when a reader is released
+    _Atomic uint64_t reader_waits;        // Acquires that found every reader busy
+    _Atomic uint64_t reader_fallbacks;    // Acquires that gave up and read on db
+    _Atomic uint64_t reader_timeouts;     // Queries refused with the writer running
+    _Atomic uint64_t stmt_cache_hits;
+    _Atomic uint64_t stmt_cache_misses;
+    
+    // Rollups touched by the open transaction, an open-addressing table of
+    // DATABASE_ROLLUP_SLOTS entries written back before every commit
+    database_rollup_t* rollups;
+    int rollup_count;
+    sqlite3_stmt* upsert_rollup_stmts[DATABASE_ROLLUP_COUNT];
+    uint64_t rollup_writes;
+    
+    // Open compressed block of every series, an open-addressing table of
+    // open_block_slots entries. Blocks holding unwritten samples are listed in
+    // dirty_blocks; a commit writes back those with block_flush_samples of
+    // them. marked_block_count blocks are marked by the open transaction.
+    database_open_block_t** open_blocks;
+    size_t open_block_slots;
+    size_t open_block_count;
+    database_open_block_t** dirty_blocks;
+    size_t dirty_block_count;
+    size_t dirty_block_capacity;
+    size_t marked_block_count;
+    sqlite3_stmt* insert_block_stmt;
+    sqlite3_stmt* update_block_stmt;
+    uint64_t block_writes;
+    uint64_t sealed_blocks;
+    
+    // Insert statements of the most recently written day partitions
+    database_partition_stmt_t partition_stmts[DATABASE_PARTITION_KIND_COUNT][DATABASE_PARTITION_CACHE];
+    int partition_victim[DATABASE_PARTITION_KIND_COUNT];
+    
+    // Retention, run by whichever thread writes
+    bool legacy_metrics;                  // Unpartitioned tables from schema 1
+    bool legacy_events;
+    uint64_t next_retention_us;
+    _Atomic int64_t cleanup_cutoff;       // Requested by database_cleanup_old_data, 0 if none
+    atomic_bool retention_wakeup;         // Run the sweep now instead of when due
+    uint64_t dropped_partitions;
+    uint64_t swept_rows;
+    
+    // Counted events. Callers count under event_counter_lock; a flush swaps
+    // in the spare table and writes out the full one under event_flush_lock.
+    database_event_counter_t* event_counters;
+    database_event_counter_t* spare_event_counters;
+    int event_counter_count;
+    pthread_mutex_t event_counter_lock;
+    pthread_mutex_t event_flush_lock;
+    _Atomic uint64_t next_event_summary_us;
+    _Atomic uint64_t counted_events;
+    uint64_t summary_rows;
+    
+    // Online backup, copied by a background thread from its own read-only
+    // connection into backup_path's temporary file, renamed when complete
+    pthread_t backup_thread;
+    bool backup_started;                  // backup_thread is joinable
+    atomic_bool backup_cancel;
+    char backup_path[512];
+    sqlite3* backup_source;
+    sqlite3* backup_dest;
+    sqlite3_backup* backup;
+    bool backup_snapshot;                 // Source holds one read transaction throughout
+    _Atomic int backup_result;
+    _Atomic int backup_total_pages;
+    _Atomic int backup_remaining_pages;
+    _Atomic uint64_t backup_started_us;
+    _Atomic uint64_t backup_finished_us;
+    _Atomic uint64_t completed_backups;
     
     // Statistics
     uint64_t total_inserts;
-    uint64_t total_queries;
-    uint64_t total_errors;
+    _Atomic uint64_t total_queries;       // Queries run on any thread
+    _Atomic uint64_t total_errors;
+    
+    // Write-behind writer. While it runs, inserts only queue the row and the
+    // writer thread owns the insert statements and the transaction.
+    circular_buffer_t* metric_queue;      // Metrics waiting for the writer
+    circular_buffer_t* record_queue;      // Anomalies, recommendations and events
+    metric_data_t* metric_batch;          // Writer-side copies of one group
+    struct database_write* record_batch;
+    pthread_t writer_thread;
+    atomic_bool writer_running;
+    pthread_mutex_t writer_lock;
+    pthread_cond_t writer_cond;           // Wakes an idle writer
+    pthread_cond_t flush_cond;            // Signalled after every group commit
+    _Atomic uint64_t queued_writes;       // Rows accepted by the queues
+    _Atomic uint64_t written_rows;        // Rows the writer has taken off the queues
+    _Atomic uint64_t block_sync_rows;     // Rows database_flush wants in written back blocks
+    _Atomic uint64_t block_synced_rows;   // Rows written when the writer last synced blocks
+    _Atomic uint64_t dropped_writes;      // Rows rejected because a queue was full
+    uint64_t group_commits;
     
 } database_context_t;
 
-// Event types for logging
-typedef enum {
-    EVENT_XAPP_START,
-    EVENT_XAPP_STOP,
-    EVENT_NODE_CONNECT,
-    EVENT_NODE_DISCONNECT,
-    EVENT_SUBSCRIPTION_CREATE,
-    EVENT_SUBSCRIPTION_DELETE,
-    EVENT_INDICATION_RECEIVED,
-    EVENT_CONTROL_SENT,
-    EVENT_ANOMALY_DETECTED,
-    EVENT_RECOMMENDATION_GENERATED,
-    EVENT_ERROR
-} event_type_t;
-
 // Event structure
 typedef struct {
     event_type_t type;
     uint32_t node_id;
     uint32_t subscription_id;
-    time_t timestamp;
+    time_t timestamp;             // Last occurrence for a summary row
+    uint32_t count;               // Occurrences the row stands for, 1 for a single event
     char message[512];
     char details[1024];
 } event_data_t;
 
+// Row queued for the writer thread; metrics have their own queue
+typedef enum {
+    DATABASE_WRITE_ANOMALY,
+    DATABASE_WRITE_RECOMMENDATION,
+    DATABASE_WRITE_EVENT
+} database_write_kind_t;
+
+typedef struct database_write {
+    database_write_kind_t kind;
+    union {
+        anomaly_result_t anomaly;
+        recommendation_result_t recommendation;
+        event_data_t event;
+    };
+} database_write_t;
+
 // Query result structures
 typedef struct {
     metric_data_t* metrics;
@@ -94,6 +386,63 @@ typedef struct {
     int capacity;
 } event_query_result_t;
 
+// Table a cursor reads
+typedef enum {
+    DATABASE_CURSOR_METRICS,
+    DATABASE_CURSOR_ANOMALIES,
+    DATABASE_CURSOR_RECOMMENDATIONS,
+    DATABASE_CURSOR_EVENTS
+} database_cursor_kind_t;
+
+// Streaming query, newest rows first. Each next call decodes up to chunk_rows
+// rows into one fixed buffer, so a scan runs in constant memory however many
+// rows match. Metric and event cursors walk the day partitions of the range.
+// A cursor holds a read connection until closed and reads one snapshot.
+typedef struct {
+    database_context_t* ctx;
+    database_cursor_kind_t kind;
+    database_reader_t* reader;         // NULL when reading on the main connection
+    sqlite3* db;                       // Connection the cursor reads
+    sqlite3_stmt* stmt;                // Statement of the current table
+    
+    // Filters
+    int type;                          // Metric, recommendation or event type, or DATABASE_ANY
+    int min_severity;                  // Anomalies only
+    uint32_t node_id;                  // Metrics only, or DATABASE_ANY_NODE
+    int64_t start_time;
+    int64_t end_time;
+    int64_t remaining;                 // Rows left under the limit, -1 if unlimited
+    
+    // Day partitions still to read, newest first
+    int64_t* days;
+    int day_count;
+    int day_index;
+    bool base_table_pending;           // Unpartitioned table still to read
+    
+    // Compressed blocks overlapping the range, merged newest sample first.
+    // stmt lists blocks by end time; runs is a max-heap on the next sample.
+    bool from_blocks;
+    bool block_row_pending;            // stmt is on a block not decoded yet
+    database_block_run_t* runs;
+    int run_count;
+    int run_capacity;
+    
+    // Current chunk
+    union {
+        void* rows;
+        metric_data_t* metrics;
+        anomaly_result_t* anomalies;
+        recommendation_result_t* recommendations;
+        event_data_t* events;
+    };
+    int chunk_rows;
+    int count;
+    bool finished;
+} database_cursor_t;
+
+// Called once per chunk; return non-zero to stop the scan
+typedef int (*database_chunk_callback_t)(const database_cursor_t* cursor, void* user_data);
+
 // Function prototypes
 
 // Context management
@@ -111,12 +460,46 @@ int database_check_schema_version(database_context_t* ctx);
 int database_prepare_statements(database_context_t* ctx);
 void database_finalize_statements(database_context_t* ctx);
 
+// Read connections. acquire waits up to busy_timeout for an idle reader and
+// returns NULL if there is none; read on ctx->db then, unless the writer
+// thread is running. prepare returns the
+// reader's cached statement for sql, reset and unbound; reset it after use
+// and release the reader once done with its statements.
+database_reader_t* database_acquire_reader(database_context_t* ctx);
+void database_release_reader(database_context_t* ctx, database_reader_t* reader);
+sqlite3_stmt* database_reader_prepare(database_context_t* ctx, database_reader_t* reader, const char* sql);
+
+// Streaming cursors. Times are inclusive bounds; limit -1 reads every match.
+// next returns the number of rows in the chunk, 0 at the end and -1 on error.
+// Cursors may be used from different threads, each from one at a time.
+database_cursor_t* database_open_metric_cursor(database_context_t* ctx, int type, uint32_t node_id,
+                                               time_t start_time, time_t end_time, int limit);
+database_cursor_t* database_open_anomaly_cursor(database_context_t* ctx, anomaly_severity_t min_severity,
+                                                time_t start_time, time_t end_time, int limit);
+database_cursor_t* database_open_recommendation_cursor(database_context_t* ctx, int type,
+                                                       time_t start_time, time_t end_time, int limit);
+database_cursor_t* database_open_event_cursor(database_context_t* ctx, int type,
+                                              time_t start_time, time_t end_time, int limit);
+int database_cursor_next(database_cursor_t* cursor);
+int64_t database_cursor_scan(database_cursor_t* cursor, database_chunk_callback_t callback, void* user_data);
+void database_cursor_close(database_cursor_t* cursor);
+
 // Metric operations
 int database_insert_metric(database_context_t* ctx, const metric_data_t* metric);
 int database_insert_metrics_batch(database_context_t* ctx, const metric_data_t* metrics, int count);
 metric_query_result_t* database_query_metrics(database_context_t* ctx, metric_type_t type, uint32_t node_id, time_t start_time, time_t end_time);
 metric_query_result_t* database_query_recent_metrics(database_context_t* ctx, metric_type_t type, int limit);
 
+// Write back every open block holding unwritten samples, so readers see them.
+// Joins a transaction the caller opened. Needs a context whose writer is not
+// running; database_flush has the writer do it.
+int database_sync_blocks(database_context_t* ctx);
+
+// Segment log compaction. Stores the metrics of one sealed segment and its
+// sequence in one transaction; returns 1 when stored, 0 if the sequence was
+// stored before, -1 on error. Needs a context whose writer is not running.
+int database_compact_segment(database_context_t* ctx, uint64_t sequence, const metric_data_t* metrics, int count);
+
 // Anomaly operations
 int database_insert_anomaly(database_context_t* ctx, const anomaly_result_t* anomaly);
 anomaly_query_result_t* database_query_anomalies(database_context_t* ctx, anomaly_severity_t severity, time_t start_time, time_t end_time);
@@ -127,22 +510,52 @@ int database_insert_recommendation(database_context_t* ctx, const recommendation
 recommendation_query_result_t* database_query_recommendations(database_context_t* ctx, recommendation_type_t type, time_t start_time, time_t end_time);
 recommendation_query_result_t* database_query_recent_recommendations(database_context_t* ctx, int limit);
 
-// Event operations
+// Event operations. log_event follows the type's policy: logged types are
+// inserted, counted types only increment a counter. flush_event_counters
+// writes one summary row per counter now; it also runs every
+// event_summary_ms, on the writer thread when it runs and otherwise on the
+// next log_event call, and on cleanup.
 int database_insert_event(database_context_t* ctx, const event_data_t* event);
 int database_log_event(database_context_t* ctx, event_type_t type, uint32_t node_id, uint32_t subscription_id, const char* message, const char* details);
+int database_flush_event_counters(database_context_t* ctx);
 event_query_result_t* database_query_events(database_context_t* ctx, event_type_t type, time_t start_time, time_t end_time);
 event_query_result_t* database_query_recent_events(database_context_t* ctx, int limit);
 
-// Statistics operations
+// Statistics operations. get_metric_stats answers from the rollups, reading
+// whole hours from the hourly table and only the ragged edges of the range
+// from the minute and second tables. It fills mean, variance, std_dev, min
+// and max and returns -1 if no sample falls in the range.
 int database_get_metric_stats(database_context_t* ctx, metric_type_t type, uint32_t node_id, time_t start_time, time_t end_time, stats_result_t* stats);
 int database_get_node_stats(database_context_t* ctx, uint32_t node_id, time_t start_time, time_t end_time, char* stats_json, int json_size);
 int database_get_overall_stats(database_context_t* ctx, time_t start_time, time_t end_time, char* stats_json, int json_size);
 
-// Maintenance operations
+// Day partitions. list fills days with the partitions of a kind, oldest first,
+// and returns their number.
+void database_partition_name(database_partition_kind_t kind, int64_t day, char* name, size_t name_size);
+int database_list_partitions(database_context_t* ctx, database_partition_kind_t kind, int64_t* days, int max_count);
+
+// Maintenance operations. cleanup_old_data drops whole partitions and deletes
+// the rest in chunks of retention_chunk_rows; with the writer running it only
+// schedules the sweep on the writer thread.
 int database_vacuum(database_context_t* ctx);
 int database_analyze(database_context_t* ctx);
 int database_cleanup_old_data(database_context_t* ctx, int retention_days);
+
+// Online backup. start_backup copies the database to backup_path in steps of
+// backup_step_pages on a low-priority thread, pausing backup_step_ms between
+// steps, and returns at once; the file appears only when the copy is
+// complete. Under WAL the copy is the snapshot of the moment it started and
+// writers are never blocked. wait_backup returns its result, cancel_backup
+// stops it, and backup starts one and waits for it.
+int database_start_backup(database_context_t* ctx, const char* backup_path);
+int database_wait_backup(database_context_t* ctx);
+void database_cancel_backup(database_context_t* ctx);
+void database_get_backup_progress(database_context_t* ctx, database_backup_progress_t* progress);
 int database_backup(database_context_t* ctx, const char* backup_path);
+
+// Restore replaces the whole database with a checked backup in one
+// transaction, so it is either fully restored or unchanged. Meant for startup:
+// the writer, any backup and every cursor must be stopped.
 int database_restore(database_context_t* ctx, const char* backup_path);
 
 // Result management
@@ -156,6 +569,16 @@ int database_begin_transaction(database_context_t* ctx);
 int database_commit_transaction(database_context_t* ctx);
 int database_rollback_transaction(database_context_t* ctx);
 
+// Write-behind writer. Once started, inserts return as soon as the row is
+// queued (-1 if the queue is full) and the writer commits them in groups of at
+// most group_commit_rows rows or group_commit_ms milliseconds. flush waits
+// until everything queued before the call is committed and the open blocks
+// are written back; stop drains the queues and must only be called after
+// producers have stopped.
+int database_start_writer(database_context_t* ctx);
+void database_stop_writer(database_context_t* ctx);
+int database_flush(database_context_t* ctx);
+
 // Utility functions
 const char* database_event_type_to_string(event_type_t type);
 const char* database_get_error_message(database_context_t* ctx);
@@ -165,7 +588,11 @@ int database_get_last_error_code(database_context_t* ctx);
 void database_print_performance(const database_context_t* ctx);
 int database_get_table_sizes(database_context_t* ctx, char* sizes_json, int json_size);
 
-// Configuration
+// Configuration. set_journal_mode switches the journal ("wal", "delete",
+// "truncate", "persist", "memory" or "off") and synchronous ("off",
+// "normal", "full" or "extra") settings of an idle context, opening the
+// read connections only under WAL. Either may be NULL to keep it.
+int database_set_journal_mode(database_context_t* ctx, const char* journal_mode, const char* synchronous);
 int database_load_config(database_context_t* ctx, const char* config_file);
 void database_print_config(const database_config_t* config);
 
@@ -178,6 +605,8 @@ char* database_build_event_query(event_type_t type, time_t start_time, time_t en
 // Database schema SQL
 extern const char* DATABASE_SCHEMA_SQL;
 extern const char* DATABASE_INDEXES_SQL;
-extern const char* DATABASE_TRIGGERS_SQL;
+extern const char* DATABASE_DROP_TRIGGERS_SQL;
+extern const char* DATABASE_METRIC_PARTITION_SQL;
+extern const char* DATABASE_EVENT_PARTITION_SQL;
 
 #endif // DATABASE_H
\ No newline at end of file
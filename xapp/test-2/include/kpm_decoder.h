@@ -0,0 +1,100 @@
+#ifndef KPM_DECODER_H
+#define KPM_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analytics.h"
+
+// E2SM-KPM indication payload as the E2 termination hands it over: the
+// Format 3 message, one Format 1 report per cell, flattened into a
+// little-endian layout that is read in place.
+//
+//   header   magic u32 "KPMI", version u8, format u8, cell_count u16,
+//            collect_start_ms u64, granularity_ms u32, reserved u32
+//   cell     cell_id u32, meas_count u16, period_count u16,
+//            meas_count x { meas_id u16, kind u8, reserved u8 },
+//            period_count x meas_count records of 8 bytes
+//
+// A record is an int64 or a double according to its measurement's kind;
+// INT64_MIN and NaN stand for KPM's noValue.
+#define KPM_MAGIC 0x494D504BU          // "KPMI"
+#define KPM_VERSION 1
+#define KPM_FORMAT_MULTI_CELL 3
+#define KPM_HEADER_SIZE 24
+#define KPM_CELL_HEADER_SIZE 8
+#define KPM_MEAS_TYPE_SIZE 4
+#define KPM_RECORD_SIZE 8
+#define KPM_MAX_MEAS_ID 1024           // Measurement IDs a decoder maps
+#define KPM_MAX_MEASUREMENTS 1024      // Measurements per cell
+#define KPM_DECODE_BATCH 256           // Metrics decoded per ingestion batch
+
+typedef enum {
+    KPM_RECORD_INTEGER,
+    KPM_RECORD_REAL
+} kpm_record_kind_t;
+
+// Metric type and unit scale of every measurement ID, from the RAN
+// function definition. Records of unmapped IDs are skipped.
+typedef struct {
+    int8_t metrics[KPM_MAX_MEAS_ID];   // metric_type_t, -1 if not collected
+    double scales[KPM_MAX_MEAS_ID];
+} kpm_decoder_t;
+
+// Position in one validated indication. Nothing is copied out of the
+// payload until next() writes metrics.
+typedef struct {
+    const kpm_decoder_t* decoder;
+    const uint8_t* data;
+    uint32_t node_id;
+    int64_t start_ms;
+    uint32_t granularity_ms;
+    uint16_t cells_left;       // Cells after the current one
+    size_t position;           // Next cell header
+    size_t total_records;
+
+    // Current cell
+    uint32_t cell_id;
+    uint16_t meas_count;
+    uint16_t period_count;
+    const uint8_t* meas_types;
+    const uint8_t* records;
+    uint16_t period;           // Next record
+    uint16_t meas;
+
+    uint64_t skipped;          // Records with no value or an unmapped measurement
+} kpm_reader_t;
+
+// Builds payloads in the same layout, for simulators, tests and benchmarks
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t size;
+    uint16_t cell_count;
+    bool overflow;
+} kpm_writer_t;
+
+// Decoders. init maps the standard measurement names to IDs 1, 2, ... in
+// the order of kpm_measurement_name; map assigns an ID to a name as the RAN
+// function definition announces it and returns -1 for unknown names.
+void kpm_decoder_init(kpm_decoder_t* decoder);
+int kpm_decoder_map(kpm_decoder_t* decoder, uint16_t meas_id, const char* meas_name);
+const char* kpm_measurement_name(int index);
+
+// Readers. init validates the whole payload and returns -1 if it is
+// malformed or truncated, so next() never fails: it writes up to max_count
+// metrics, one per record with a value, and returns 0 at the end.
+int kpm_reader_init(kpm_reader_t* reader, const kpm_decoder_t* decoder, const void* payload, size_t size,
+                    uint32_t node_id);
+size_t kpm_reader_next(kpm_reader_t* reader, metric_data_t* metrics, size_t max_count);
+
+// Writers. values holds period_count rows of meas_count values; integer
+// measurements are rounded. finish returns the payload size, 0 if it did
+// not fit.
+void kpm_writer_init(kpm_writer_t* writer, void* buffer, size_t capacity, int64_t start_ms, uint32_t granularity_ms);
+int kpm_writer_add_cell(kpm_writer_t* writer, uint32_t cell_id, const uint16_t* meas_ids, const uint8_t* kinds,
+                        uint16_t meas_count, uint16_t period_count, const double* values);
+size_t kpm_writer_finish(kpm_writer_t* writer);
+
+#endif // KPM_DECODER_H
@@ -0,0 +1,59 @@
+#ifndef METRIC_BLOCKS_H
+#define METRIC_BLOCKS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bits of the largest encoded sample: a timestamp escape with a full 64-bit
+// delta of delta, and a value with a new window of 64 meaningful bits
+#define METRIC_BLOCK_MAX_SAMPLE_BITS (4 + 64 + 2 + 5 + 6 + 64)
+
+// Compressed samples of one series (Gorilla encoding). The first sample is
+// stored in full; every later timestamp as the change of its delta to the
+// previous one, every later value as its XOR with the previous value, both
+// bit-packed with short codes for the common cases: a regular interval costs
+// one bit, a repeated value one bit.
+typedef struct {
+    uint8_t* data;
+    size_t capacity;           // Bytes allocated, zeroed past the written bits
+    size_t bits;               // Bits written
+    int count;                 // Samples in the block
+    int64_t first_time;
+    int64_t last_time;
+    int64_t last_delta;
+    uint64_t last_value;       // Bit pattern of the previous value
+    int leading;               // Leading zeros of the current XOR window, -1 before the first
+    int trailing;              // Trailing zeros of the current XOR window
+    double min;
+    double max;
+} metric_block_t;
+
+// Sequential reader of an encoded block
+typedef struct {
+    const uint8_t* data;
+    size_t size;               // Bytes
+    size_t position;           // Next bit to read
+    int remaining;             // Samples left
+    bool started;
+    int64_t time;
+    int64_t delta;
+    uint64_t value;
+    int leading;
+    int trailing;
+} metric_block_reader_t;
+
+// Blocks. append returns -1 if the block cannot grow. rewind drops the samples
+// appended since mark, a copy of the block taken earlier.
+void metric_block_init(metric_block_t* block);
+void metric_block_free(metric_block_t* block);
+void metric_block_reset(metric_block_t* block);
+void metric_block_rewind(metric_block_t* block, const metric_block_t* mark);
+int metric_block_append(metric_block_t* block, int64_t timestamp, double value);
+size_t metric_block_size(const metric_block_t* block);
+
+// Readers. read returns false after `count` samples or when the data ends.
+void metric_block_reader_init(metric_block_reader_t* reader, const void* data, size_t size, int count);
+bool metric_block_read(metric_block_reader_t* reader, int64_t* timestamp, double* value);
+
+#endif // METRIC_BLOCKS_H
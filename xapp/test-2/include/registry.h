@@ -0,0 +1,91 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REGISTRY_MAX_READERS 64        // Read sections open at once, power of two
+#define REGISTRY_INITIAL_CAPACITY 64   // Slots of a new map, power of two
+
+// Open-addressing table of entry pointers. Readers probe a snapshot of it;
+// writers publish a larger copy when it fills up.
+typedef struct {
+    uint32_t mask;
+    _Atomic(void*) slots[];
+} registry_table_t;
+
+// Map of heap-allocated entries whose first member is a uint32_t key
+typedef struct {
+    _Atomic(registry_table_t*) table;
+    uint32_t used;                 // Entries plus removed slots, writers only
+    _Atomic uint32_t count;
+} registry_map_t;
+
+// Announced epoch of one open read section, 0 when the slot is free
+typedef struct {
+    _Alignas(64) _Atomic uint64_t epoch;
+} registry_reader_t;
+
+// Object waiting for every reader that may still see it
+typedef struct registry_retired {
+    struct registry_retired* next;
+    uint64_t epoch;
+    void* object;
+} registry_retired_t;
+
+// Epoch-based reclamation domain shared by a set of maps. Readers never
+// lock: a read section claims a reader slot and announces the global epoch.
+// Writers serialize on lock and never wait for readers; what they unlink
+// is retired and freed once the epoch has advanced twice past it, which
+// only happens when every open read section has seen the newer epoch.
+typedef struct registry {
+    registry_reader_t readers[REGISTRY_MAX_READERS];
+    _Atomic uint64_t epoch;
+    pthread_mutex_t lock;
+    registry_retired_t* retired;   // Newest first, guarded by lock
+    size_t retired_count;
+
+    // Performance counters
+    _Atomic uint64_t reclaimed;
+    _Atomic uint64_t resizes;
+} registry_t;
+
+// Iteration over one table snapshot, inside a read section
+typedef struct {
+    registry_table_t* table;
+    uint32_t slot;
+} registry_iter_t;
+
+// Lifecycle
+registry_t* registry_create(void);
+void registry_destroy(registry_t* registry);
+registry_map_t* registry_map_create(uint32_t capacity);
+void registry_map_destroy(registry_map_t* map);    // Frees the remaining entries; no readers left
+
+// Readers. Entries found inside a read section stay valid until it ends;
+// the returned slot goes back to registry_read_unlock. A read section must
+// not write: collect what to change and write after unlocking.
+int registry_read_lock(registry_t* registry);
+void registry_read_unlock(registry_t* registry, int slot);
+void* registry_map_find(const registry_map_t* map, uint32_t key);
+uint32_t registry_map_count(const registry_map_t* map);
+void registry_iter_init(registry_iter_t* iter, const registry_map_t* map);
+void* registry_iter_next(registry_iter_t* iter);
+
+// Writers, between registry_write_lock and registry_write_unlock. insert
+// fails for a key already present; remove returns the unlinked entry, to
+// be passed to registry_retire once nothing links to it anymore.
+void registry_write_lock(registry_t* registry);
+void registry_write_unlock(registry_t* registry);
+int registry_map_insert(registry_t* registry, registry_map_t* map, void* entry);
+void* registry_map_remove(registry_map_t* map, uint32_t key);
+void registry_retire(registry_t* registry, void* object);
+
+// Free what no reader can see anymore; also done by registry_write_unlock
+size_t registry_reclaim(registry_t* registry);
+size_t registry_pending(registry_t* registry);
+
+#endif // REGISTRY_H
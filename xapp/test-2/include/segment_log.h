@@ -0,0 +1,150 @@
+#ifndef SEGMENT_LOG_H
+#define SEGMENT_LOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analytics.h"
+
+#define SEGMENT_LOG_MAGIC 0x314C474553504158ULL   // "XAPSEGL1"
+#define SEGMENT_LOG_VERSION 1
+#define SEGMENT_LOG_RECORDS 65536                 // Records per segment, 2 MiB
+#define SEGMENT_LOG_SYNC_MS 100
+#define SEGMENT_LOG_COMPACT_MS 1000               // Compactor poll and retry interval
+
+// Segment file header, written once when the segment is created
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t sequence;
+    uint64_t capacity;         // Records the segment holds
+    int64_t created_at;
+    uint32_t reserved[5];
+    uint32_t checksum;         // CRC-32 of the fields above
+} segment_header_t;
+
+// One metric sample. The checksum covers the fields, the segment sequence
+// and the record's index, so torn and stale records never validate.
+typedef struct {
+    int64_t timestamp;
+    double value;
+    uint32_t node_id;
+    uint32_t cell_id;
+    uint32_t metric_type;
+    uint32_t checksum;
+} segment_record_t;
+
+// Stores the records of one sealed segment. Return 0 once they are durable;
+// the segment file is deleted afterwards. A crash between the two repeats
+// the call for the same sequence, so it must be idempotent per sequence.
+typedef int (*segment_compact_fn)(uint64_t sequence, const metric_data_t* metrics, size_t count, void* user_data);
+
+#define SEGMENT_LOG_FILES 4                       // Mapped segments: active, spare and retiring
+
+typedef enum {
+    SEGMENT_FILE_FREE,
+    SEGMENT_FILE_SPARE,        // Created ahead, waiting to become active
+    SEGMENT_FILE_ACTIVE,
+    SEGMENT_FILE_RETIRING      // Sealed, unmapped once its writers are done
+} segment_file_state_t;
+
+// One mapped segment. Appenders reserve record ranges with a fetch-add on
+// reserved and count themselves in writers while they copy; sealing pushes
+// reserved past capacity so no range is handed out afterwards.
+typedef struct {
+    segment_file_state_t state;    // Guarded by the log lock
+    uint64_t sequence;
+    int fd;
+    uint8_t* map;
+    size_t map_size;
+    segment_record_t* records;
+    size_t capacity;
+    size_t count;                  // Records written, set when sealed
+    _Atomic size_t reserved;       // Records handed out
+    _Atomic size_t synced;         // Records handed to msync
+    _Atomic int writers;           // Appenders and syncs using the mapping
+} segment_file_t;
+
+// Append-only log of fixed-size metric records in memory-mapped segment
+// files. Appending reserves a range of the active segment with one atomic
+// add and copies into the mapping without a lock. The maintainer thread keeps
+// the next segment created and mapped, unmaps sealed ones and hands new
+// records to an asynchronous msync every sync_interval_ms, so a full segment
+// only costs the appender that fills it a pointer swap under the lock.
+// Sealed segments wait for the compactor.
+typedef struct segment_log {
+    char directory[512];
+    size_t segment_records;
+    int sync_interval_ms;
+
+    // Segment slots. Appenders find the active one without the lock; the
+    // lock guards slot states, the spare and sequence numbers.
+    pthread_mutex_t lock;
+    segment_file_t files[SEGMENT_LOG_FILES];
+    segment_file_t* _Atomic active;
+    segment_file_t* spare;
+    uint64_t sequence;             // Sequence of the active segment
+    uint64_t next_sequence;        // Sequence of the next segment created
+
+    // Maintainer
+    pthread_t maintainer_thread;
+    bool maintainer_started;
+    atomic_bool maintainer_running;
+    pthread_cond_t maintain_cond;  // Signalled when a segment is sealed
+
+    // Sealed segments waiting for compaction, oldest first, guarded by lock
+    uint64_t* sealed;
+    size_t sealed_count;
+    size_t sealed_capacity;
+
+    // Compactor
+    metric_data_t* compact_buffer;
+    size_t compact_capacity;
+    segment_compact_fn compact;
+    void* compact_data;
+    pthread_t compactor_thread;
+    bool compactor_started;
+    atomic_bool compactor_running;
+    pthread_cond_t compact_cond;   // Signalled when a segment is sealed
+
+    // Statistics
+    _Atomic uint64_t appended_records;
+    _Atomic uint64_t failed_records;     // Rejected because no segment could be created
+    _Atomic uint64_t stalled_rollovers;  // Rollovers that found no spare and created one inline
+    uint64_t recovered_records;    // Valid records found in the newest segment on open
+    uint64_t compacted_segments;
+    uint64_t compacted_records;
+} segment_log_t;
+
+// Lifecycle. open recovers the segments in directory, creating it if needed:
+// the newest one is scanned to its last valid record and sealed, and a new
+// segment and the maintainer are started. close stops the compactor and the
+// maintainer and syncs the active segment; no append may run meanwhile.
+segment_log_t* segment_log_open(const char* directory, size_t segment_records, int sync_interval_ms);
+void segment_log_close(segment_log_t* log);
+
+// Writing. append may be called from any thread and returns the number of
+// records written. sync blocks until the active segment is on disk; rollover
+// seals it now.
+size_t segment_log_append(segment_log_t* log, const metric_data_t* metrics, size_t count);
+int segment_log_sync(segment_log_t* log);
+int segment_log_rollover(segment_log_t* log);
+
+// Compaction. compact_pending folds every sealed segment, oldest first, and
+// returns how many it folded, or -1 if the first one failed. The compactor
+// thread does the same whenever a segment is sealed; stop drains it. Only
+// one of them may run at a time.
+int segment_log_compact_pending(segment_log_t* log, segment_compact_fn compact, void* user_data);
+int segment_log_start_compactor(segment_log_t* log, segment_compact_fn compact, void* user_data);
+void segment_log_stop_compactor(segment_log_t* log);
+
+// Information
+size_t segment_log_pending_segments(segment_log_t* log);
+void segment_log_segment_path(const segment_log_t* log, uint64_t sequence, char* path, size_t path_size);
+void segment_log_print_performance(segment_log_t* log);
+
+#endif // SEGMENT_LOG_H
@@ -0,0 +1,73 @@
+#ifndef SERIES_STORE_H
+#define SERIES_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analytics.h"
+
+// Series identity
+typedef struct {
+    metric_type_t type;
+    uint32_t node_id;
+    uint32_t cell_id;
+} series_key_t;
+
+// One time series with its own history ring and rolling window
+typedef struct {
+    series_key_t key;
+    uint32_t hash;
+    int32_t lru_prev;          // Towards the most recently updated series
+    int32_t lru_next;          // Towards the least recently updated series
+    metric_history_t history;
+} series_entry_t;
+
+// Open-addressing index slot
+typedef struct {
+    uint32_t hash;
+    int32_t slot;              // Index into series[], -1 when empty
+} series_index_entry_t;
+
+// Keyed store of per-(metric_type, node_id, cell_id) series.
+//
+// Series live in a slab bounded by the memory budget. Lookups go through a
+// linear-probing hash index sized to at most 50% load, so cost stays flat
+// regardless of the number of cells. When the budget is exhausted the least
+// recently updated series is evicted and its storage reused.
+struct series_store {
+    series_entry_t** series;
+    int32_t series_count;
+    int32_t max_series;
+
+    series_index_entry_t* index;
+    uint32_t index_mask;
+
+    int32_t lru_head;
+    int32_t lru_tail;
+
+    int history_size;
+    int window_size;
+    int trend_window;
+    bool trend_timestamps;
+    size_t series_bytes;       // Approximate footprint of one series
+    size_t memory_budget;
+
+    uint64_t evictions;
+};
+
+// Lifecycle
+series_store_t* series_store_create(size_t memory_budget, int history_size, int window_size,
+                                    int trend_window, bool trend_timestamps);
+void series_store_destroy(series_store_t* store);
+
+// Lookup
+metric_history_t* series_store_find(series_store_t* store, metric_type_t type, uint32_t node_id, uint32_t cell_id);
+metric_history_t* series_store_get_or_create(series_store_t* store, metric_type_t type, uint32_t node_id, uint32_t cell_id);
+const series_key_t* series_store_key_of(const metric_history_t* history);
+
+// Information
+int series_store_count(const series_store_t* store);
+size_t series_store_memory_usage(const series_store_t* store);
+
+#endif // SERIES_STORE_H
@@ -0,0 +1,72 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Order statistics tree node (treap), one per window slot
+typedef struct {
+    int32_t left;
+    int32_t right;
+    int32_t size;              // Nodes in this subtree
+    uint32_t priority;
+} sliding_window_node_t;
+
+// Sliding window over the newest `capacity` samples of a series.
+//
+// Mean, variance, min and max are O(1) per push: mean and variance are
+// maintained with a sliding Welford update and min/max with monotonic
+// deques of sample sequence numbers. The running moments are re-derived
+// from the stored values once per `capacity` evictions so floating point
+// drift stays bounded.
+//
+// Quantiles come from a treap ordered by (value, slot) whose nodes are the
+// window slots themselves, so an update is one O(log n) erase plus one
+// O(log n) insert and never allocates.
+typedef struct {
+    int capacity;
+    int count;
+    uint64_t seq;              // Total samples pushed so far
+    double* values;            // Ring of samples, slot = seq % capacity
+
+    // Running moments
+    double mean;
+    double m2;                 // Sum of squared deviations from the mean
+    int resync_countdown;
+
+    // Monotonic deques (rings of sequence numbers)
+    uint64_t* max_deque;
+    int max_head;
+    int max_len;
+    uint64_t* min_deque;
+    int min_head;
+    int min_len;
+
+    // Order statistics
+    sliding_window_node_t* nodes;
+    int32_t root;
+    uint32_t rng_state;
+} sliding_window_t;
+
+// Lifecycle
+int sliding_window_init(sliding_window_t* window, int capacity);
+void sliding_window_free(sliding_window_t* window);
+void sliding_window_reset(sliding_window_t* window);
+
+// Updates
+void sliding_window_push(sliding_window_t* window, double value);
+void sliding_window_push_bulk(sliding_window_t* window, const double* values, int count);
+
+// Queries
+bool sliding_window_is_full(const sliding_window_t* window);
+double sliding_window_mean(const sliding_window_t* window);
+double sliding_window_variance(const sliding_window_t* window);
+double sliding_window_min(const sliding_window_t* window);
+double sliding_window_max(const sliding_window_t* window);
+double sliding_window_last(const sliding_window_t* window);
+double sliding_window_at(const sliding_window_t* window, int index);  // 0 = oldest
+int sliding_window_copy(const sliding_window_t* window, double* out);
+double sliding_window_kth(const sliding_window_t* window, int k);           // 0 = smallest
+double sliding_window_quantile(const sliding_window_t* window, double q);   // q in [0, 1]
+
+#endif // SLIDING_WINDOW_H
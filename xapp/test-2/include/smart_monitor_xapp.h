@@ -78,7 +78,11 @@ static inline void e2ap_cleanup(e2ap_handle_t handle) { (void)handle; }
 
 // Application includes
 #include "analytics.h"
+#include "analytics_shards.h"
 #include "database.h"
+#include "kpm_decoder.h"
+#include "registry.h"
+#include "segment_log.h"
 #include "utils.h"
 
 // Constants
@@ -91,8 +95,13 @@ static inline void e2ap_cleanup(e2ap_handle_t handle) { (void)handle; }
 #define DEFAULT_RIC_IP "127.0.0.1"
 #define DEFAULT_RIC_PORT 36421
 #define MAX_BUFFER_SIZE 4096
-#define MAX_NODES 32
+#define NODE_EXPIRY_SECONDS 600      // Disconnected nodes are forgotten after this
 #define MAX_METRICS 1000
+#define METRIC_QUEUE_CAPACITY 16384   // Metrics buffered per analytics shard
+#define ANALYTICS_BATCH_SIZE 1024     // Metrics a shard worker takes per batch
+#define ANALYTICS_REPORT_INTERVAL 10  // seconds between analytics performance reports
+#define ANALYTICS_EVENT_BATCH 64      // Events the analytics thread reads at a time
+#define DEFAULT_BACKUP_INTERVAL 86400 // seconds between online backups
 
 // Global states
 typedef enum {
@@ -110,6 +119,8 @@ typedef struct {
     char version[32];
     int monitoring_interval;
     char database_path[512];
+    char metric_storage[16];  // "rows" or "blocks"
+    char segment_log_dir[512];  // Raw metric capture ahead of the database, empty to disable
     char log_level[16];
     char ric_ip[64];
     int ric_port;
@@ -127,41 +138,72 @@ typedef struct {
     bool trend_analysis;
     bool recommendations;
     double alert_threshold;
+    int analytics_shards;  // 0 for one per core
+    
+    // Event logging configuration
+    database_event_policy_t event_policy[EVENT_TYPE_COUNT];  // Log each event or count per interval
+    int event_summary_ms;
+    
+    // Backup configuration
+    char backup_path[512];   // Online backup target, empty to disable
+    int backup_interval;     // seconds
+    char restore_path[512];  // Backup restored at startup, empty for none
 } xapp_config_t;
 
-// Node information
+// E2 service models the xApp subscribes to
+typedef enum {
+    SERVICE_MODEL_KMP,
+    SERVICE_MODEL_RC,
+    SERVICE_MODEL_MAC,
+    SERVICE_MODEL_RLC,
+    SERVICE_MODEL_PDCP,
+    SERVICE_MODEL_GTP,
+    SERVICE_MODEL_COUNT
+} service_model_t;
+
+struct xapp_context;
+
+// Turns one indication of a service model into metrics
+typedef void (*indication_handler_t)(struct xapp_context* ctx, const e2ap_indication_t* indication);
+
+// Node information. The ID is the registry key and must stay first; status
+// fields are atomic as callbacks update them while other threads read.
 typedef struct {
     uint32_t node_id;
     char node_name[128];
-    bool connected;
-    time_t last_update;
-    uint32_t subscription_count;
+    _Atomic bool connected;
+    _Atomic time_t last_update;
+    _Atomic uint32_t subscription_count;
 } node_info_t;
 
-// Subscription information
+// Subscription information, keyed like node_info_t
 typedef struct {
     uint32_t subscription_id;
     uint32_t node_id;
     uint16_t ran_func_id;
     char sm_name[64];
-    bool active;
-    time_t created_at;
-    uint32_t indication_count;
+    service_model_t service_model;
+    indication_handler_t handler;    // Resolved from the service model at creation
+    _Atomic bool active;
+    _Atomic time_t created_at;
+    _Atomic uint32_t indication_count;
 } subscription_info_t;
 
 // Main application context
-typedef struct {
+typedef struct xapp_context {
     xapp_state_t state;
     xapp_config_t config;
     
     // E2AP context
     e2ap_handle_t e2ap_handle;
-    node_info_t nodes[MAX_NODES];
-    uint32_t node_count;
     
-    // Subscription management
-    subscription_info_t subscriptions[MAX_NODES * 6];  // Max 6 SMs per node
-    uint32_t subscription_count;
+    // Nodes and subscriptions by ID. Lookups run inside registry read
+    // sections without locks; connect, disconnect and subscription changes
+    // serialize on the registry and free what they unlink only once no
+    // reader can still hold it.
+    registry_t* registry;
+    registry_map_t* nodes;
+    registry_map_t* subscriptions;
     
     // Threading
     pthread_t main_thread;
@@ -173,17 +215,25 @@ typedef struct {
     // Database context
     database_context_t* db_ctx;
     
-    // Analytics context
-    analytics_context_t* analytics_ctx;
+    // Raw metric capture, folded into the database through its own connection
+    segment_log_t* segment_log;
+    database_context_t* compactor_db;
+    
+    // Analytics shards, fed by E2 callbacks and the monitor thread
+    analytics_shards_t* analytics;
+    _Atomic uint64_t dropped_metrics;
+    
+    // KPM measurement mapping, read by indication callbacks
+    kpm_decoder_t kpm_decoder;
     
     // Runtime controls
     bool running;
     int duration;  // seconds, 0 for infinite
     time_t start_time;
     
-    // Statistics
-    uint64_t total_indications;
-    uint64_t total_errors;
+    // Statistics. Indications and errors are counted by E2 callbacks too.
+    _Atomic uint64_t total_indications;
+    _Atomic uint64_t total_errors;
     uint64_t total_anomalies;
     uint64_t total_recommendations;
     
@@ -207,6 +257,7 @@ void e2ap_indication_callback(e2ap_handle_t handle, uint32_t subscription_id, co
 void e2ap_control_callback(e2ap_handle_t handle, uint32_t request_id, bool success);
 
 // Service Model handlers
+int enqueue_metrics(xapp_context_t* ctx, const metric_data_t* metrics, size_t count);
 void handle_kmp_indication(xapp_context_t* ctx, const e2ap_indication_t* indication);
 void handle_rc_indication(xapp_context_t* ctx, const e2ap_indication_t* indication);
 void handle_mac_indication(xapp_context_t* ctx, const e2ap_indication_t* indication);
@@ -217,7 +268,13 @@ void handle_gtp_indication(xapp_context_t* ctx, const e2ap_indication_t* indicat
 // Subscription management
 int create_subscriptions(xapp_context_t* ctx);
 int remove_subscriptions(xapp_context_t* ctx);
+subscription_info_t* add_subscription(xapp_context_t* ctx, uint32_t subscription_id, uint32_t node_id, service_model_t service_model);
 subscription_info_t* find_subscription(xapp_context_t* ctx, uint32_t subscription_id);
+const char* service_model_to_string(service_model_t service_model);
+
+// Node management. Returned pointers are valid inside a registry read section.
+node_info_t* add_node(xapp_context_t* ctx, uint32_t node_id, const char* name);
+int remove_node(xapp_context_t* ctx, uint32_t node_id);
 node_info_t* find_node(xapp_context_t* ctx, uint32_t node_id);
 
 // Thread functions
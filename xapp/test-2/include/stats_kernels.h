@@ -0,0 +1,38 @@
+#ifndef STATS_KERNELS_H
+#define STATS_KERNELS_H
+
+// Reduction kernels over contiguous arrays of doubles.
+//
+// Each kernel has a scalar implementation and, where the CPU supports it,
+// an AVX2 (x86-64) or NEON (AArch64) one. The best implementation for the
+// running CPU is picked once at first use; AVX2 code is compiled with a
+// per-function target attribute, so the build needs no -mavx2 flag and the
+// binary still runs on CPUs without it.
+typedef struct {
+    const char* name;
+
+    // Sum of values
+    double (*sum)(const double* values, int count);
+
+    // Sum of (value - center)^2; center = 0 gives the plain sum of squares
+    double (*sum_sq_dev)(const double* values, int count, double center);
+
+    // Smallest and largest value, count must be > 0
+    void (*min_max)(const double* values, int count, double* min, double* max);
+
+    // Regression sums against x = 0, 1, ..., count - 1 with y = value - shift.
+    // Shifting y by a value close to the data keeps the sums well conditioned.
+    void (*regression_sums)(const double* values, int count, double shift,
+                            double* sum_y, double* sum_xy, double* sum_yy);
+
+    // Sum of a[i] * b[i]
+    double (*dot)(const double* a, const double* b, int count);
+} stats_kernels_t;
+
+// Best kernels for the running CPU
+const stats_kernels_t* stats_kernels_get(void);
+
+// Portable reference kernels
+const stats_kernels_t* stats_kernels_scalar(void);
+
+#endif // STATS_KERNELS_H
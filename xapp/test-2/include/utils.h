@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <json-c/json.h>
 
 // Log levels
@@ -73,15 +74,27 @@ typedef struct {
     bool running;
 } performance_timer_t;
 
-// Circular buffer for metrics
+// Circular buffer for metrics.
+//
+// Lock-free multi-producer / single-consumer ring. Producers claim a range
+// of slots with one CAS on `tail`, copy their elements in and publish each
+// slot by storing its sequence number. The single consumer reads published
+// slots in order and releases them by advancing `head`. Push never blocks:
+// it stores what fits and reports how many elements were accepted.
+//
+// Push functions may be called from any thread; pop, peek and clear only
+// from the one consumer thread.
+#define CIRCULAR_BUFFER_CACHE_LINE 64
+
 typedef struct {
     void* data;
     size_t element_size;
-    size_t capacity;
-    size_t head;
-    size_t tail;
-    size_t count;
-    pthread_mutex_t mutex;
+    size_t capacity;           // Power of two
+    size_t mask;
+    _Atomic size_t* published; // Per slot: position + 1 once the element is written
+    
+    _Alignas(CIRCULAR_BUFFER_CACHE_LINE) _Atomic size_t tail;   // Next position producers claim
+    _Alignas(CIRCULAR_BUFFER_CACHE_LINE) _Atomic size_t head;   // Next position the consumer reads
 } circular_buffer_t;
 
 // Function prototypes
@@ -168,7 +181,9 @@ char* utils_get_local_ip(char* buffer, size_t buffer_size);
 circular_buffer_t* utils_circular_buffer_create(size_t capacity, size_t element_size);
 void utils_circular_buffer_destroy(circular_buffer_t* buffer);
 bool utils_circular_buffer_push(circular_buffer_t* buffer, const void* element);
+size_t utils_circular_buffer_push_bulk(circular_buffer_t* buffer, const void* elements, size_t count);
 bool utils_circular_buffer_pop(circular_buffer_t* buffer, void* element);
+size_t utils_circular_buffer_pop_bulk(circular_buffer_t* buffer, void* elements, size_t max_count);
 bool utils_circular_buffer_peek(circular_buffer_t* buffer, void* element, size_t index);
 size_t utils_circular_buffer_size(const circular_buffer_t* buffer);
 bool utils_circular_buffer_is_full(const circular_buffer_t* buffer);
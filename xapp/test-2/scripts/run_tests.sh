@@ -68,6 +68,13 @@ else
     TESTS_FAILED=$((TESTS_FAILED + 1))
 fi
 
+# Run utility tests
+if run_test "Utility Tests" "./tests/test_utils"; then
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
 # Run integration test (quick xApp test)
 echo -e "${YELLOW}🔍 Running Integration Test...${NC}"
 
@@ -12,6 +12,9 @@
  */
 
 #include "analytics.h"
+#include "analytics_events.h"
+#include "series_store.h"
+#include "stats_kernels.h"
 #include "utils.h"
 #include <json-c/json.h>
 
@@ -53,6 +56,555 @@ const char* analytics_recommendation_type_to_string(recommendation_type_t type)
     }
 }
 
+// Effective rolling window length for the current configuration
+static int analytics_window_length(const analytics_config_t* config) {
+    return CLAMP(config->window_size, 2, ANALYTICS_HISTORY_SIZE);
+}
+
+// History ring length for per-entity series
+static int analytics_series_history_size(const analytics_config_t* config) {
+    int size = MAX(analytics_window_length(config), config->trend_window);
+    return CLAMP(size, 20, ANALYTICS_HISTORY_SIZE);
+}
+
+// Effective trend regression length for the current configuration
+static int analytics_trend_length(const analytics_config_t* config) {
+    return CLAMP(config->trend_window, 2, ANALYTICS_HISTORY_SIZE);
+}
+
+// (Re)allocate histories and rolling windows to match the configuration
+static int analytics_configure_storage(analytics_context_t* ctx) {
+    int length = analytics_window_length(&ctx->config);
+    int trend_length = analytics_trend_length(&ctx->config);
+    bool trend_timestamps = ctx->config.trend_use_timestamps;
+    
+    // Fleet-wide history per metric type
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        metric_history_t* history = &ctx->history[i];
+        
+        if (!history->values) {
+            if (analytics_history_init(history, ANALYTICS_HISTORY_SIZE, length) != 0) {
+                return -1;
+            }
+            analytics_history_set_trend(history, trend_length, trend_timestamps);
+            continue;
+        }
+        
+        if (history->regression.window != trend_length ||
+            history->regression.use_timestamps != trend_timestamps) {
+            analytics_history_set_trend(history, trend_length, trend_timestamps);
+        }
+        
+        sliding_window_t* window = &history->window;
+        if (window->capacity == length) {
+            continue;
+        }
+        
+        sliding_window_free(window);
+        if (sliding_window_init(window, length) != 0) {
+            return -1;
+        }
+        
+        // Seed the new window with the newest samples already in history
+        int seed = MIN(history->count, length);
+        for (int j = seed; j > 0; j--) {
+            int idx = (history->head - j + history->capacity) % history->capacity;
+            sliding_window_push(window, history->values[idx]);
+        }
+    }
+    
+    // Per-entity series
+    int series_history_size = analytics_series_history_size(&ctx->config);
+    if (ctx->series &&
+        ctx->series->history_size == series_history_size &&
+        ctx->series->window_size == length &&
+        ctx->series->trend_window == trend_length &&
+        ctx->series->trend_timestamps == trend_timestamps &&
+        ctx->series->memory_budget == ctx->config.series_memory_budget) {
+        return 0;
+    }
+    
+    if (ctx->series) {
+        LOG_INFO("Analytics window configuration changed, resetting %d series",
+                 series_store_count(ctx->series));
+        series_store_destroy(ctx->series);
+    }
+    
+    ctx->series = series_store_create(ctx->config.series_memory_budget, series_history_size, length,
+                                      trend_length, trend_timestamps);
+    return ctx->series ? 0 : -1;
+}
+
+// Select the k-th smallest value (0-based), partially reordering values
+static double analytics_select_kth(double* values, int count, int k) {
+    int left = 0;
+    int right = count - 1;
+    
+    while (left < right) {
+        double pivot = values[(left + right) / 2];
+        int i = left;
+        int j = right;
+        
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                double temp = values[i];
+                values[i] = values[j];
+                values[j] = temp;
+                i++;
+                j--;
+            }
+        }
+        
+        if (k <= j) {
+            right = j;
+        } else if (k >= i) {
+            left = i;
+        } else {
+            break;
+        }
+    }
+    
+    return values[k];
+}
+
+// Quantiles with linear interpolation between closest ranks, partially
+// reordering values. `qs` must be ascending: each selection leaves its rank
+// in place with larger values to the right, so the next one only searches
+// the upper part of the array.
+static void analytics_quantiles_inplace(double* values, int count, const double* qs, double* out, int nq,
+                                        const stats_kernels_t* kernels) {
+    int base = 0;
+    
+    for (int q = 0; q < nq; q++) {
+        double position = qs[q] * (count - 1);
+        int lower = (int)position;
+        double fraction = position - lower;
+        
+        double low_value = analytics_select_kth(values + base, count - base, lower - base);
+        out[q] = low_value;
+        
+        if (fraction > 0.0) {
+            // Next rank is the smallest value right of the selected one
+            double high_value, unused;
+            kernels->min_max(values + lower + 1, count - lower - 1, &high_value, &unused);
+            out[q] = low_value + (high_value - low_value) * fraction;
+        }
+        
+        base = lower;
+    }
+}
+
+// Full statistics over a scratch copy of the samples (reordered on return)
+static stats_result_t analytics_stats_inplace(double* values, int count) {
+    static const double quantiles[3] = {0.50, 0.95, 0.99};
+    const stats_kernels_t* kernels = stats_kernels_get();
+    stats_result_t stats = {0};
+    
+    stats.mean = kernels->sum(values, count) / count;
+    stats.variance = kernels->sum_sq_dev(values, count, stats.mean) / count;
+    stats.std_dev = sqrt(stats.variance);
+    kernels->min_max(values, count, &stats.min, &stats.max);
+    
+    // Calculate z-score for last value before selection reorders the samples
+    stats.z_score = analytics_calculate_z_score(values[count - 1], stats.mean, stats.std_dev);
+    stats.is_outlier = analytics_is_outlier(stats.z_score, 2.0);
+    
+    // Calculate median and tail quantiles by selection
+    double results[3];
+    analytics_quantiles_inplace(values, count, quantiles, results, 3, kernels);
+    stats.median = results[0];
+    stats.p95 = results[1];
+    stats.p99 = results[2];
+    
+    return stats;
+}
+
+// Trend from regression sums of n samples, with x and y taken relative to
+// an origin. The intercept is reported at the oldest sample, x_first.
+static trend_result_t analytics_trend_from_sums(double n, double sum_x, double sum_y, double sum_xy,
+                                                double sum_x2, double sum_y2, double x_first, double y_origin) {
+    trend_result_t trend = {0};
+    
+    // Simple linear regression (flat when every sample shares the same x)
+    double denominator = n * sum_x2 - sum_x * sum_x;
+    if (denominator > 0) {
+        trend.slope = (n * sum_xy - sum_x * sum_y) / denominator;
+    }
+    trend.intercept = y_origin + (sum_y - trend.slope * sum_x) / n + trend.slope * x_first;
+    
+    // Calculate correlation coefficient
+    double sum_x_dev = sum_x2 - sum_x * sum_x / n;
+    double sum_y_dev = sum_y2 - sum_y * sum_y / n;
+    double sum_xy_dev = sum_xy - sum_x * sum_y / n;
+    
+    if (sum_x_dev > 0 && sum_y_dev > 0) {
+        trend.correlation = CLAMP(sum_xy_dev / sqrt(sum_x_dev * sum_y_dev), -1.0, 1.0);
+    }
+    
+    // Determine trend direction
+    const double slope_threshold = 0.1;
+    trend.is_increasing = (trend.slope > slope_threshold);
+    trend.is_decreasing = (trend.slope < -slope_threshold);
+    trend.is_stable = (fabs(trend.slope) <= slope_threshold);
+    
+    return trend;
+}
+
+// Regression of values against their index
+static trend_result_t analytics_trend_from_values(const double* values, int count) {
+    // Sums of x are closed form
+    double n = (double)count;
+    double sum_x = n * (n - 1.0) / 2.0;
+    double sum_x2 = (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+    
+    // Regress y - shift so large offsets do not swamp the deviations
+    double shift = values[0];
+    double sum_y, sum_xy, sum_y2;
+    stats_kernels_get()->regression_sums(values, count, shift, &sum_y, &sum_xy, &sum_y2);
+    
+    return analytics_trend_from_sums(n, sum_x, sum_y, sum_xy, sum_x2, sum_y2, 0.0, shift);
+}
+
+// x of the sample in ring slot `pos` whose sample index is `index`
+static inline double analytics_regression_x(const metric_history_t* history, int pos, uint64_t index) {
+    return history->regression.use_timestamps ? (double)history->timestamps[pos] : (double)index;
+}
+
+// Re-derive the regression sums from the newest samples in the ring
+static void analytics_regression_resync(metric_history_t* history) {
+    trend_regression_t* regression = &history->regression;
+    int n = MIN(history->count, regression->window);
+    int first = (history->head - n + history->capacity) % history->capacity;
+    uint64_t first_index = regression->next_index - n;
+    
+    regression->count = n;
+    regression->sum_x = regression->sum_y = 0.0;
+    regression->sum_xy = regression->sum_x2 = regression->sum_y2 = 0.0;
+    regression->resync_countdown = regression->window;
+    
+    if (n == 0) {
+        return;
+    }
+    
+    // Re-anchor the origin at the oldest sample
+    regression->x_origin = analytics_regression_x(history, first, first_index);
+    regression->y_origin = history->values[first];
+    
+    for (int i = 0; i < n; i++) {
+        int pos = (first + i) % history->capacity;
+        double x = analytics_regression_x(history, pos, first_index + i) - regression->x_origin;
+        double y = history->values[pos] - regression->y_origin;
+        
+        regression->sum_x += x;
+        regression->sum_y += y;
+        regression->sum_xy += x * y;
+        regression->sum_x2 += x * x;
+        regression->sum_y2 += y * y;
+    }
+}
+
+// Slide the regression over a new sample. Must run before the sample is
+// written to the ring, while the sample leaving the window is still there.
+static void analytics_regression_push(metric_history_t* history, double value, time_t timestamp) {
+    trend_regression_t* regression = &history->regression;
+    
+    if (regression->window <= 0) {
+        return;
+    }
+    
+    double x = regression->use_timestamps ? (double)timestamp : (double)regression->next_index;
+    
+    if (regression->count == 0) {
+        regression->x_origin = x;
+        regression->y_origin = value;
+    }
+    
+    if (regression->count == regression->window) {
+        int pos = (history->head - regression->window + history->capacity) % history->capacity;
+        double old_x = analytics_regression_x(history, pos, regression->next_index - regression->window) - regression->x_origin;
+        double old_y = history->values[pos] - regression->y_origin;
+        
+        regression->sum_x -= old_x;
+        regression->sum_y -= old_y;
+        regression->sum_xy -= old_x * old_y;
+        regression->sum_x2 -= old_x * old_x;
+        regression->sum_y2 -= old_y * old_y;
+        regression->count--;
+        regression->resync_countdown--;
+    }
+    
+    x -= regression->x_origin;
+    double y = value - regression->y_origin;
+    
+    regression->sum_x += x;
+    regression->sum_y += y;
+    regression->sum_xy += x * y;
+    regression->sum_x2 += x * x;
+    regression->sum_y2 += y * y;
+    regression->count++;
+    regression->next_index++;
+}
+
+// Trend over the newest regression window of a history
+trend_result_t analytics_history_trend(const metric_history_t* history) {
+    trend_result_t trend = {0};
+    
+    if (!history || history->regression.count < 2) {
+        return trend;
+    }
+    
+    const trend_regression_t* regression = &history->regression;
+    
+    int first = (history->head - regression->count + history->capacity) % history->capacity;
+    double x_first = analytics_regression_x(history, first, regression->next_index - regression->count) -
+                     regression->x_origin;
+    
+    return analytics_trend_from_sums(regression->count, regression->sum_x, regression->sum_y,
+                                     regression->sum_xy, regression->sum_x2, regression->sum_y2,
+                                     x_first, regression->y_origin);
+}
+
+// Forecast the next sample from the lags held by the model
+static void analytics_ar_forecast(ar_model_t* model) {
+    model->center = model->level;
+    
+    // Persistence until the model has a full set of lags
+    if (model->lag_count < ANALYTICS_AR_ORDER) {
+        model->forecast = model->lag_count > 0 ? model->lags[0] : 0.0;
+        return;
+    }
+    
+    double deviation = 0.0;
+    for (int k = 0; k < ANALYTICS_AR_ORDER; k++) {
+        deviation += model->weights[k] * (model->lags[k] - model->center);
+    }
+    model->forecast = model->center + deviation;
+}
+
+// Normalized LMS step moving the current forecast towards `error` more
+static void analytics_ar_adapt(ar_model_t* model, double error) {
+    double phi[ANALYTICS_AR_ORDER];
+    double norm = 0.0;
+    
+    for (int k = 0; k < ANALYTICS_AR_ORDER; k++) {
+        phi[k] = model->lags[k] - model->center;
+        norm += phi[k] * phi[k];
+    }
+    
+    // Regularize with the residual variance so near-flat inputs do not
+    // produce huge weight steps
+    norm += 0.01 * ANALYTICS_AR_ORDER * model->residual_var + 1e-12;
+    
+    double step = ANALYTICS_AR_STEP * error / norm;
+    for (int k = 0; k < ANALYTICS_AR_ORDER; k++) {
+        model->weights[k] = CLAMP(model->weights[k] + step * phi[k], -4.0, 4.0);
+    }
+}
+
+// Feed one sample: score it against the forecast, adapt, forecast the next one
+static void analytics_ar_push(ar_model_t* model, double value) {
+    if (model->lag_count == ANALYTICS_AR_ORDER) {
+        double error = value - model->forecast;
+        double scale = sqrt(model->residual_var);
+        model->last_error = error;
+        model->last_scale = scale;
+        
+        // Clip outliers so one spike does not drag the model along
+        double clipped = error;
+        if (model->updates >= ANALYTICS_AR_ORDER && scale > 0.0) {
+            clipped = CLAMP(error, -3.0 * scale, 3.0 * scale);
+        }
+        
+        analytics_ar_adapt(model, clipped);
+        
+        model->updates++;
+        double weight = 1.0 / (double)MIN(model->updates, 64);
+        model->residual_var += (clipped * clipped - model->residual_var) * weight;
+    }
+    
+    model->samples++;
+    model->level += (value - model->level) / (double)MIN(model->samples, 64);
+    
+    memmove(&model->lags[1], &model->lags[0], (ANALYTICS_AR_ORDER - 1) * sizeof(double));
+    model->lags[0] = value;
+    if (model->lag_count < ANALYTICS_AR_ORDER) {
+        model->lag_count++;
+    }
+    
+    analytics_ar_forecast(model);
+}
+
+// Whether the model has seen enough samples for its forecast to be scored
+bool analytics_history_model_ready(const metric_history_t* history) {
+    return history && history->model.updates >= 2 * ANALYTICS_AR_ORDER;
+}
+
+// Fit the AR model to the whole history ring by least squares. The normal
+// equations are built from the vectorized dot kernel and solved with a
+// Cholesky factorization, O(count * order^2 + order^3).
+int analytics_history_fit_model(metric_history_t* history) {
+    if (!history || history->count < 4 * ANALYTICS_AR_ORDER) {
+        return -1;
+    }
+    
+    int n = history->count;
+    double stack_values[ANALYTICS_HISTORY_SIZE];
+    double* x = stack_values;
+    if (n > ANALYTICS_HISTORY_SIZE) {
+        x = malloc(n * sizeof(double));
+        if (!x) {
+            return -1;
+        }
+    }
+    
+    // Oldest to newest, in at most two segments of the ring
+    int first = MIN(n, history->capacity - history->tail);
+    memcpy(x, &history->values[history->tail], first * sizeof(double));
+    memcpy(x + first, history->values, (n - first) * sizeof(double));
+    
+    const stats_kernels_t* kernels = stats_kernels_get();
+    double mean = kernels->sum(x, n) / n;
+    for (int i = 0; i < n; i++) {
+        x[i] -= mean;
+    }
+    
+    // Equation t predicts x[p + t] from x[p + t - 1 - k], k = 0..p-1
+    const int p = ANALYTICS_AR_ORDER;
+    const int m = n - p;
+    const double* target = x + p;
+    double gram[ANALYTICS_AR_ORDER][ANALYTICS_AR_ORDER];
+    double rhs[ANALYTICS_AR_ORDER];
+    double trace = 0.0;
+    
+    for (int j = 0; j < p; j++) {
+        const double* lag_j = x + p - 1 - j;
+        rhs[j] = kernels->dot(target, lag_j, m);
+        for (int k = j; k < p; k++) {
+            gram[j][k] = gram[k][j] = kernels->dot(lag_j, x + p - 1 - k, m);
+        }
+        trace += gram[j][j];
+    }
+    
+    // Small ridge keeps flat or collinear series solvable
+    for (int j = 0; j < p; j++) {
+        gram[j][j] += 1e-9 * trace / p + 1e-300;
+    }
+    
+    // Cholesky factorization in place (lower triangle)
+    bool solvable = true;
+    for (int j = 0; j < p && solvable; j++) {
+        double diag = gram[j][j];
+        for (int k = 0; k < j; k++) {
+            diag -= gram[j][k] * gram[j][k];
+        }
+        if (diag <= 0.0) {
+            solvable = false;
+            break;
+        }
+        gram[j][j] = sqrt(diag);
+        for (int i = j + 1; i < p; i++) {
+            double value = gram[i][j];
+            for (int k = 0; k < j; k++) {
+                value -= gram[i][k] * gram[j][k];
+            }
+            gram[i][j] = value / gram[j][j];
+        }
+    }
+    
+    double a[ANALYTICS_AR_ORDER] = {0};
+    double residual = 0.0;
+    if (solvable) {
+        // Forward then backward substitution
+        for (int i = 0; i < p; i++) {
+            double value = rhs[i];
+            for (int k = 0; k < i; k++) {
+                value -= gram[i][k] * a[k];
+            }
+            a[i] = value / gram[i][i];
+        }
+        for (int i = p - 1; i >= 0; i--) {
+            double value = a[i];
+            for (int k = i + 1; k < p; k++) {
+                value -= gram[k][i] * a[k];
+            }
+            a[i] = value / gram[i][i];
+        }
+        
+        // Residual sum of squares of the least squares solution
+        residual = kernels->dot(target, target, m);
+        for (int j = 0; j < p; j++) {
+            residual -= a[j] * rhs[j];
+        }
+    }
+    
+    if (!solvable) {
+        if (x != stack_values) {
+            free(x);
+        }
+        return -1;
+    }
+    
+    ar_model_t* model = &history->model;
+    for (int k = 0; k < ANALYTICS_AR_ORDER; k++) {
+        model->weights[k] = CLAMP(a[k], -4.0, 4.0);
+        model->lags[k] = x[n - 1 - k] + mean;
+    }
+    model->lag_count = ANALYTICS_AR_ORDER;
+    model->level = mean;
+    model->residual_var = MAX(residual / m, 0.0);
+    model->samples = MAX(model->samples, (uint64_t)n);
+    model->updates = MAX(model->updates, (uint64_t)(2 * ANALYTICS_AR_ORDER));
+    analytics_ar_forecast(model);
+    
+    if (x != stack_values) {
+        free(x);
+    }
+    return 0;
+}
+
+// Snapshot statistics from the rolling window of a history
+static stats_result_t analytics_window_stats(const analytics_context_t* ctx, const metric_history_t* history) {
+    stats_result_t stats = {0};
+    const sliding_window_t* window = &history->window;
+    
+    if (window->count == 0) {
+        return stats;
+    }
+    
+    stats.mean = sliding_window_mean(window);
+    stats.variance = sliding_window_variance(window);
+    stats.std_dev = sqrt(stats.variance);
+    stats.min = sliding_window_min(window);
+    stats.max = sliding_window_max(window);
+    stats.median = sliding_window_quantile(window, 0.50);
+    stats.p95 = sliding_window_quantile(window, 0.95);
+    stats.p99 = sliding_window_quantile(window, 0.99);
+    
+    stats.z_score = analytics_calculate_z_score(sliding_window_last(window), stats.mean, stats.std_dev);
+    stats.is_outlier = analytics_is_outlier(stats.z_score, ctx->config.outlier_threshold);
+    
+    return stats;
+}
+
+// Refresh last_stats and last_trend of a history after an append
+static void analytics_update_history_stats(const analytics_context_t* ctx, metric_history_t* history) {
+    // Snapshot statistics over the newest window_size samples
+    history->last_stats = analytics_window_stats(ctx, history);
+    
+    // Trend over the newest trend_window samples, once the window is full
+    if (history->regression.window > 0 && history->regression.count >= history->regression.window) {
+        history->last_trend = analytics_history_trend(history);
+    }
+}
+
+// History used for detection: the metric's own series, else the fleet-wide view
+static metric_history_t* analytics_detection_history(analytics_context_t* ctx, const metric_data_t* metric) {
+    metric_history_t* history = series_store_find(ctx->series, metric->type, metric->node_id, metric->cell_id);
+    return history ? history : &ctx->history[metric->type];
+}
+
 // Initialize analytics context
 analytics_context_t* analytics_init(const char* config_file) {
     analytics_context_t* ctx = malloc(sizeof(analytics_context_t));
@@ -66,8 +618,10 @@ analytics_context_t* analytics_init(const char* config_file) {
     // Initialize default configuration
     ctx->config.window_size = 100;
     ctx->config.trend_window = 50;
+    ctx->config.series_memory_budget = ANALYTICS_DEFAULT_SERIES_BUDGET;
     ctx->config.outlier_threshold = 2.0;
     ctx->config.correlation_threshold = 0.7;
+    ctx->config.detection_mode = ANALYTICS_DETECT_PER_BATCH;
     ctx->config.enable_ml_detection = true;
     ctx->config.enable_prediction = true;
     
@@ -96,19 +650,18 @@ analytics_context_t* analytics_init(const char* config_file) {
     ctx->config.thresholds[METRIC_PACKET_LOSS].warning_threshold = 1.0;
     ctx->config.thresholds[METRIC_PACKET_LOSS].critical_threshold = 5.0;
     
-    // Initialize ML model with random weights
-    ctx->ml_model.initialized = false;
-    ctx->ml_model.learning_rate = 0.01;
-    ctx->ml_model.bias = 0.0;
-    for (int i = 0; i < 10; i++) {
-        ctx->ml_model.weights[i] = (rand() / (double)RAND_MAX) - 0.5;
-    }
-    
     // Load configuration from file if provided
     if (config_file) {
         analytics_load_config(ctx, config_file);
     }
     
+    // Allocate histories and rolling statistics windows
+    if (analytics_configure_storage(ctx) != 0) {
+        LOG_ERROR("Failed to allocate analytics storage");
+        analytics_cleanup(ctx);
+        return NULL;
+    }
+    
     LOG_INFO("Analytics initialized successfully");
     return ctx;
 }
@@ -117,6 +670,15 @@ analytics_context_t* analytics_init(const char* config_file) {
 void analytics_cleanup(analytics_context_t* ctx) {
     if (ctx) {
         LOG_INFO("Cleaning up analytics context");
+        for (int i = 0; i < METRIC_COUNT; i++) {
+            analytics_history_free(&ctx->history[i]);
+        }
+        series_store_destroy(ctx->series);
+        free(ctx->batch_series);
+        free(ctx->batch_index);
+        free(ctx->batch_slot);
+        free(ctx->batch_values);
+        free(ctx->batch_timestamps);
         free(ctx);
     }
 }
@@ -135,6 +697,23 @@ int analytics_load_config(analytics_context_t* ctx, const char* config_file) {
     
     LOG_INFO("Loading analytics configuration from %s", config_file);
     
+    // Parse analysis windows
+    utils_json_get_int(config_obj, "window_size", &ctx->config.window_size);
+    utils_json_get_int(config_obj, "trend_window", &ctx->config.trend_window);
+    utils_json_get_bool(config_obj, "trend_use_timestamps", &ctx->config.trend_use_timestamps);
+    utils_json_get_double(config_obj, "outlier_threshold", &ctx->config.outlier_threshold);
+    
+    char detection_mode[32];
+    if (utils_json_get_string(config_obj, "detection_mode", detection_mode, sizeof(detection_mode))) {
+        ctx->config.detection_mode = (strcmp(detection_mode, "sample") == 0) ?
+                                     ANALYTICS_DETECT_PER_SAMPLE : ANALYTICS_DETECT_PER_BATCH;
+    }
+    
+    int budget_mb = 0;
+    if (utils_json_get_int(config_obj, "series_memory_budget_mb", &budget_mb) && budget_mb > 0) {
+        ctx->config.series_memory_budget = (size_t)budget_mb * 1024 * 1024;
+    }
+    
     // Parse thresholds
     json_object* thresholds_obj;
     if (json_object_object_get_ex(config_obj, "thresholds", &thresholds_obj)) {
@@ -155,10 +734,61 @@ int analytics_load_config(analytics_context_t* ctx, const char* config_file) {
     
     json_object_put(config_obj);
     
+    // Resize storage that was already allocated
+    if (ctx->history[0].values && analytics_configure_storage(ctx) != 0) {
+        LOG_ERROR("Failed to resize analytics storage");
+        return -1;
+    }
+    
     LOG_INFO("Analytics configuration loaded successfully");
     return 0;
 }
 
+// Publish anomalies and recommendations to an event log as they are found
+void analytics_set_event_log(analytics_context_t* ctx, analytics_event_log_t* events) {
+    if (ctx) {
+        ctx->events = events;
+    }
+}
+
+// Change the memory budget of the per-entity series store
+int analytics_set_series_budget(analytics_context_t* ctx, size_t memory_budget) {
+    if (!ctx) {
+        return -1;
+    }
+    
+    ctx->config.series_memory_budget = memory_budget;
+    if (ctx->history[0].values && analytics_configure_storage(ctx) != 0) {
+        LOG_ERROR("Failed to resize analytics series store");
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Run detection for a sample and keep any anomaly and recommendation it raises
+static void analytics_detect_and_record(analytics_context_t* ctx, const metric_data_t* metric) {
+    anomaly_result_t anomaly = analytics_detect_anomaly(ctx, metric);
+    if (anomaly.severity == ANOMALY_NONE) {
+        return;
+    }
+    
+    // Store anomaly
+    ctx->recent_anomalies[ctx->anomaly_count % 100] = anomaly;
+    ctx->anomaly_count++;
+    ctx->detected_anomalies++;
+    analytics_event_log_append_anomaly(ctx->events, &anomaly, metric->node_id, metric->cell_id);
+    
+    // Generate recommendation based on anomaly
+    recommendation_result_t recommendation = analytics_generate_recommendation(ctx, metric, &anomaly);
+    if (recommendation.type != RECOMMENDATION_NONE) {
+        ctx->recent_recommendations[ctx->recommendation_count % 100] = recommendation;
+        ctx->recommendation_count++;
+        ctx->generated_recommendations++;
+        analytics_event_log_append_recommendation(ctx->events, &recommendation);
+    }
+}
+
 // Add a metric to the analytics system
 int analytics_add_metric(analytics_context_t* ctx, metric_type_t type, double value, uint32_t node_id, uint32_t cell_id) {
     if (!ctx || type >= METRIC_COUNT) {
@@ -184,46 +814,420 @@ int analytics_process_metric(analytics_context_t* ctx, const metric_data_t* metr
     
     ctx->processed_metrics++;
     
-    // Add to history
-    metric_history_t* history = &ctx->history[metric->type];
-    
-    // Store in circular buffer
-    history->data[history->head] = *metric;
-    history->head = (history->head + 1) % 1000;
+    // Fleet-wide view of the metric type
+    metric_history_t* type_history = &ctx->history[metric->type];
+    analytics_history_append(type_history, metric);
+    if (type_history->count >= 10) {
+        analytics_update_history_stats(ctx, type_history);
+    }
     
-    if (history->count < 1000) {
-        history->count++;
-    } else {
-        history->tail = (history->tail + 1) % 1000;
+    // History of the (node, cell) entity the sample belongs to
+    metric_history_t* history = series_store_get_or_create(ctx->series, metric->type,
+                                                           metric->node_id, metric->cell_id);
+    if (!history) {
+        return -1;
     }
+    analytics_history_append(history, metric);
     
     // Perform analytics if we have enough data
     if (history->count >= 10) {
-        // Calculate statistics
-        history->last_stats = analytics_calculate_stats(history->data, history->count);
+        analytics_update_history_stats(ctx, history);
+        analytics_detect_and_record(ctx, metric);
+    }
+    
+    return 0;
+}
+
+// Make room for a batch of `count` samples in the batch scratch
+static int analytics_reserve_batch(analytics_context_t* ctx, int count) {
+    if (count <= ctx->batch_capacity) {
+        return 0;
+    }
+    
+    int capacity = 64;
+    while (capacity < count) {
+        capacity <<= 1;
+    }
+    
+    // Series set is kept at or below 50% load
+    analytics_batch_series_t* series = realloc(ctx->batch_series, capacity * sizeof(analytics_batch_series_t));
+    if (!series) {
+        return -1;
+    }
+    ctx->batch_series = series;
+    
+    int32_t* index = realloc(ctx->batch_index, 2 * capacity * sizeof(int32_t));
+    if (!index) {
+        return -1;
+    }
+    ctx->batch_index = index;
+    
+    int32_t* slot = realloc(ctx->batch_slot, capacity * sizeof(int32_t));
+    if (!slot) {
+        return -1;
+    }
+    ctx->batch_slot = slot;
+    
+    double* values = realloc(ctx->batch_values, capacity * sizeof(double));
+    if (!values) {
+        return -1;
+    }
+    ctx->batch_values = values;
+    
+    time_t* timestamps = realloc(ctx->batch_timestamps, capacity * sizeof(time_t));
+    if (!timestamps) {
+        return -1;
+    }
+    ctx->batch_timestamps = timestamps;
+    ctx->batch_capacity = capacity;
+    
+    return 0;
+}
+
+static inline bool analytics_same_series(const metric_data_t* a, const metric_data_t* b) {
+    return a->type == b->type && a->node_id == b->node_id && a->cell_id == b->cell_id;
+}
+
+// Append a batch to the histories. Samples are grouped into one run per
+// metric type and one per series, in arrival order within each run, and
+// every run is appended in bulk; analytics_reserve_batch must have
+// succeeded for `count`.
+static int analytics_append_batch(analytics_context_t* ctx, const metric_data_t* metrics, int count,
+                                  int* series_out, uint32_t* types_out) {
+    // Series set sized for this batch, never larger than the reserved 2 * capacity
+    uint32_t index_size = 2;
+    while (index_size < 2u * (uint32_t)count) {
+        index_size <<= 1;
+    }
+    const uint32_t index_mask = index_size - 1;
+    memset(ctx->batch_index, 0xFF, index_size * sizeof(int32_t));
+    
+    int series_count = 0;
+    int type_counts[METRIC_COUNT] = {0};
+    uint32_t types_touched = 0;
+    int result = 0;
+    
+    // Find the series of every sample and count the runs
+    for (int i = 0; i < count; i++) {
+        const metric_data_t* metric = &metrics[i];
+        ctx->batch_slot[i] = -1;
+        if (metric->type >= METRIC_COUNT) {
+            result = -1;
+            continue;
+        }
+        
+        ctx->processed_metrics++;
+        type_counts[metric->type]++;
+        types_touched |= 1u << metric->type;
         
-        // Calculate trends if we have enough data
-        if (history->count >= ctx->config.trend_window) {
-            history->last_trend = analytics_calculate_trend(history->data, 
-                                                           MIN(history->count, ctx->config.trend_window));
+        metric_history_t* history = series_store_get_or_create(ctx->series, metric->type,
+                                                               metric->node_id, metric->cell_id);
+        if (!history) {
+            result = -1;
+            continue;
         }
         
-        // Detect anomalies
-        anomaly_result_t anomaly = analytics_detect_anomaly(ctx, metric);
-        if (anomaly.severity > ANOMALY_NONE) {
-            // Store anomaly
-            ctx->recent_anomalies[ctx->anomaly_count % 100] = anomaly;
-            ctx->anomaly_count++;
-            ctx->detected_anomalies++;
-            
-            // Generate recommendation based on anomaly
-            recommendation_result_t recommendation = analytics_generate_recommendation(ctx, metric, &anomaly);
-            if (recommendation.type != RECOMMENDATION_NONE) {
-                ctx->recent_recommendations[ctx->recommendation_count % 100] = recommendation;
-                ctx->recommendation_count++;
-                ctx->generated_recommendations++;
+        uint32_t pos = (uint32_t)(((uintptr_t)history >> 4) * 0x9E3779B1u) & index_mask;
+        while (ctx->batch_index[pos] >= 0 && ctx->batch_series[ctx->batch_index[pos]].history != history) {
+            pos = (pos + 1) & index_mask;
+        }
+        
+        analytics_batch_series_t* entry = NULL;
+        if (ctx->batch_index[pos] >= 0) {
+            entry = &ctx->batch_series[ctx->batch_index[pos]];
+            if (!analytics_same_series(&metrics[entry->high], metric)) {
+                // The series was evicted and its storage reused earlier in
+                // this batch; its pending samples go with it
+                entry->history = NULL;
+                entry = NULL;
+            }
+        }
+        
+        if (!entry) {
+            ctx->batch_index[pos] = series_count;
+            entry = &ctx->batch_series[series_count++];
+            *entry = (analytics_batch_series_t){ history, i, i, 0, 0 };
+        } else if (metric->value < metrics[entry->low].value) {
+            entry->low = i;
+        } else if (metric->value > metrics[entry->high].value) {
+            entry->high = i;
+        }
+        
+        ctx->batch_slot[i] = (int32_t)(entry - ctx->batch_series);
+        entry->count++;
+    }
+    
+    // Fleet-wide histories: one run per metric type
+    int type_offsets[METRIC_COUNT];
+    int offset = 0;
+    for (int type = 0; type < METRIC_COUNT; type++) {
+        type_offsets[type] = offset;
+        offset += type_counts[type];
+    }
+    for (int i = 0; i < count; i++) {
+        if (metrics[i].type >= METRIC_COUNT) continue;
+        
+        int at = type_offsets[metrics[i].type]++;
+        ctx->batch_values[at] = metrics[i].value;
+        ctx->batch_timestamps[at] = metrics[i].timestamp;
+    }
+    for (int type = 0; type < METRIC_COUNT; type++) {
+        if (type_counts[type] > 0) {
+            int first = type_offsets[type] - type_counts[type];
+            analytics_history_append_bulk(&ctx->history[type], &ctx->batch_values[first],
+                                          &ctx->batch_timestamps[first], type_counts[type]);
+        }
+    }
+    
+    // Per-entity histories: one run per series
+    offset = 0;
+    for (int s = 0; s < series_count; s++) {
+        ctx->batch_series[s].offset = offset;
+        offset += ctx->batch_series[s].count;
+        ctx->batch_series[s].count = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (ctx->batch_slot[i] < 0) continue;
+        
+        analytics_batch_series_t* entry = &ctx->batch_series[ctx->batch_slot[i]];
+        int at = entry->offset + entry->count++;
+        ctx->batch_values[at] = metrics[i].value;
+        ctx->batch_timestamps[at] = metrics[i].timestamp;
+    }
+    for (int s = 0; s < series_count; s++) {
+        analytics_batch_series_t* entry = &ctx->batch_series[s];
+        if (entry->history) {
+            analytics_history_append_bulk(entry->history, &ctx->batch_values[entry->offset],
+                                          &ctx->batch_timestamps[entry->offset], entry->count);
+        }
+    }
+    
+    *series_out = series_count;
+    *types_out = types_touched;
+    return result;
+}
+
+// Process a batch of metrics, running statistics and detection once per series
+int analytics_process_metrics_batch(analytics_context_t* ctx, const metric_data_t* metrics, int count) {
+    if (!ctx || count < 0 || (!metrics && count > 0)) {
+        return -1;
+    }
+    
+    int result = 0;
+    
+    if (ctx->config.detection_mode == ANALYTICS_DETECT_PER_SAMPLE || analytics_reserve_batch(ctx, count) != 0) {
+        for (int i = 0; i < count; i++) {
+            if (analytics_process_metric(ctx, &metrics[i]) != 0) {
+                result = -1;
+            }
+        }
+        return result;
+    }
+    
+    int series_count = 0;
+    uint32_t types_touched = 0;
+    if (analytics_append_batch(ctx, metrics, count, &series_count, &types_touched) != 0) {
+        result = -1;
+    }
+    
+    // Fleet-wide statistics once per metric type
+    for (int type = 0; type < METRIC_COUNT; type++) {
+        if ((types_touched & (1u << type)) && ctx->history[type].count >= 10) {
+            analytics_update_history_stats(ctx, &ctx->history[type]);
+        }
+    }
+    
+    // Statistics and detection once per series, on its most extreme sample
+    for (int s = 0; s < series_count; s++) {
+        analytics_batch_series_t* entry = &ctx->batch_series[s];
+        metric_history_t* history = entry->history;
+        
+        if (!history || history->count < 10) {
+            continue;
+        }
+        
+        analytics_update_history_stats(ctx, history);
+        
+        const metric_data_t* low = &metrics[entry->low];
+        const metric_data_t* high = &metrics[entry->high];
+        double mean = history->last_stats.mean;
+        analytics_detect_and_record(ctx, (mean - low->value > high->value - mean) ? low : high);
+    }
+    
+    return result;
+}
+
+// Initialize a history ring of `capacity` samples with a rolling window
+int analytics_history_init(metric_history_t* history, int capacity, int window_size) {
+    if (!history || capacity <= 0) {
+        return -1;
+    }
+    
+    memset(history, 0, sizeof(metric_history_t));
+    history->values = malloc(capacity * sizeof(double));
+    history->timestamps = malloc(capacity * sizeof(time_t));
+    if (!history->values || !history->timestamps ||
+        sliding_window_init(&history->window, window_size) != 0) {
+        LOG_ERROR("Failed to allocate metric history of %d samples", capacity);
+        SAFE_FREE(history->values);
+        SAFE_FREE(history->timestamps);
+        return -1;
+    }
+    
+    history->capacity = capacity;
+    return 0;
+}
+
+// Release history storage
+void analytics_history_free(metric_history_t* history) {
+    if (!history) return;
+    
+    SAFE_FREE(history->values);
+    SAFE_FREE(history->timestamps);
+    sliding_window_free(&history->window);
+    history->capacity = 0;
+    history->count = 0;
+}
+
+// Drop all samples but keep the storage
+void analytics_history_reset(metric_history_t* history) {
+    if (!history) return;
+    
+    history->head = 0;
+    history->tail = 0;
+    history->count = 0;
+    sliding_window_reset(&history->window);
+    
+    history->regression.next_index = 0;
+    analytics_regression_resync(history);
+    memset(&history->model, 0, sizeof(ar_model_t));
+    
+    memset(&history->last_stats, 0, sizeof(stats_result_t));
+    memset(&history->last_trend, 0, sizeof(trend_result_t));
+}
+
+// Configure the trend regression and rebuild it from the samples in the ring
+void analytics_history_set_trend(metric_history_t* history, int trend_window, bool use_timestamps) {
+    if (!history || history->capacity <= 0) return;
+    
+    history->regression.window = CLAMP(trend_window, 2, history->capacity);
+    history->regression.use_timestamps = use_timestamps;
+    if (history->regression.next_index < (uint64_t)history->count) {
+        history->regression.next_index = history->count;
+    }
+    analytics_regression_resync(history);
+}
+
+// Append a sample to the ring, the trend regression and the forecast
+// model, everything but the rolling window
+static void analytics_history_record(metric_history_t* history, double value, time_t timestamp) {
+    analytics_regression_push(history, value, timestamp);
+    
+    history->values[history->head] = value;
+    history->timestamps[history->head] = timestamp;
+    history->head = (history->head + 1) % history->capacity;
+    
+    if (history->count < history->capacity) {
+        history->count++;
+    } else {
+        history->tail = (history->tail + 1) % history->capacity;
+    }
+    
+    analytics_ar_push(&history->model, value);
+    
+    if (history->regression.window > 0 && history->regression.resync_countdown <= 0) {
+        analytics_regression_resync(history);
+    }
+}
+
+// Append a sample to the ring, the rolling window and the trend regression
+void analytics_history_append(metric_history_t* history, const metric_data_t* metric) {
+    analytics_history_record(history, metric->value, metric->timestamp);
+    
+    // Update rolling statistics in constant time
+    sliding_window_push(&history->window, metric->value);
+}
+
+// Append a run of samples, oldest first. The rolling window takes the run
+// in one bulk push, which rebuilds its order statistics once.
+void analytics_history_append_bulk(metric_history_t* history, const double* values, const time_t* timestamps, int count) {
+    for (int i = 0; i < count; i++) {
+        analytics_history_record(history, values[i], timestamps[i]);
+    }
+    sliding_window_push_bulk(&history->window, values, count);
+}
+
+// Copy the newest max_count samples of a history, oldest first
+int analytics_history_copy(const metric_history_t* history, double* values, time_t* timestamps, int max_count) {
+    if (!history || !values || !timestamps || max_count <= 0) {
+        return 0;
+    }
+    
+    int count = MIN(history->count, max_count);
+    int slot = (history->head - count + history->capacity) % history->capacity;
+    for (int i = 0; i < count; i++) {
+        values[i] = history->values[slot];
+        timestamps[i] = history->timestamps[slot];
+        slot = (slot + 1) % history->capacity;
+    }
+    
+    return count;
+}
+
+// Build a fleet-wide history from runs of samples copied out of several
+// histories, each oldest first. The newest ANALYTICS_HISTORY_SIZE samples
+// of all runs are taken from their ends back in timestamp order and
+// appended to `merged`, which gets ctx's windows and statistics. Free it
+// with analytics_history_free.
+int analytics_history_merge(const analytics_context_t* ctx, metric_history_t* merged, const double* values,
+                            const time_t* timestamps, const int* run_counts, int run_count) {
+    if (!ctx || !merged || !run_counts || run_count <= 0) {
+        return -1;
+    }
+    
+    int* ends = malloc(run_count * sizeof(int));
+    int* starts = malloc(run_count * sizeof(int));
+    if (!ends || !starts) {
+        LOG_ERROR("Failed to allocate merge cursors for %d histories", run_count);
+        free(ends);
+        free(starts);
+        return -1;
+    }
+    
+    int total = 0;
+    for (int r = 0; r < run_count; r++) {
+        starts[r] = total;
+        total += run_counts[r];
+        ends[r] = total;
+    }
+    
+    double merged_values[ANALYTICS_HISTORY_SIZE];
+    time_t merged_timestamps[ANALYTICS_HISTORY_SIZE];
+    int count = MIN(total, ANALYTICS_HISTORY_SIZE);
+    
+    // Newest remaining sample of any run goes last
+    for (int out = count - 1; out >= 0; out--) {
+        int newest = -1;
+        for (int r = 0; r < run_count; r++) {
+            if (ends[r] > starts[r] &&
+                (newest < 0 || timestamps[ends[r] - 1] > timestamps[ends[newest] - 1])) {
+                newest = r;
             }
         }
+        int at = --ends[newest];
+        merged_values[out] = values[at];
+        merged_timestamps[out] = timestamps[at];
+    }
+    free(ends);
+    free(starts);
+    
+    if (analytics_history_init(merged, ANALYTICS_HISTORY_SIZE, analytics_window_length(&ctx->config)) != 0) {
+        return -1;
+    }
+    analytics_history_set_trend(merged, analytics_trend_length(&ctx->config), ctx->config.trend_use_timestamps);
+    analytics_history_append_bulk(merged, merged_values, merged_timestamps, count);
+    if (merged->count >= 10) {
+        analytics_update_history_stats(ctx, merged);
     }
     
     return 0;
@@ -237,58 +1241,53 @@ stats_result_t analytics_calculate_stats(const metric_data_t* data, int count) {
         return stats;
     }
     
-    // Calculate mean
-    double sum = 0.0;
-    for (int i = 0; i < count; i++) {
-        sum += data[i].value;
+    // Gather the values once, the kernels and selection work on the copy
+    double stack_values[ANALYTICS_HISTORY_SIZE];
+    double* values = stack_values;
+    if (count > ANALYTICS_HISTORY_SIZE) {
+        values = malloc(count * sizeof(double));
+        if (!values) {
+            LOG_ERROR("Failed to allocate %d values for statistics", count);
+            return stats;
+        }
     }
-    stats.mean = sum / count;
-    
-    // Calculate variance and standard deviation
-    double variance_sum = 0.0;
-    stats.min = data[0].value;
-    stats.max = data[0].value;
     
     for (int i = 0; i < count; i++) {
-        double diff = data[i].value - stats.mean;
-        variance_sum += diff * diff;
-        
-        if (data[i].value < stats.min) stats.min = data[i].value;
-        if (data[i].value > stats.max) stats.max = data[i].value;
+        values[i] = data[i].value;
     }
     
-    stats.variance = variance_sum / count;
-    stats.std_dev = sqrt(stats.variance);
+    stats = analytics_stats_inplace(values, count);
     
-    // Calculate median (simplified - sort and take middle)
-    double* sorted_values = malloc(count * sizeof(double));
-    for (int i = 0; i < count; i++) {
-        sorted_values[i] = data[i].value;
+    if (values != stack_values) {
+        free(values);
     }
     
-    // Simple bubble sort for median calculation
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (sorted_values[j] > sorted_values[j + 1]) {
-                double temp = sorted_values[j];
-                sorted_values[j] = sorted_values[j + 1];
-                sorted_values[j + 1] = temp;
-            }
-        }
+    return stats;
+}
+
+// Calculate statistical analysis over a column of values
+stats_result_t analytics_calculate_stats_values(const double* values, int count) {
+    stats_result_t stats = {0};
+    
+    if (!values || count <= 0) {
+        return stats;
     }
     
-    if (count % 2 == 0) {
-        stats.median = (sorted_values[count/2 - 1] + sorted_values[count/2]) / 2.0;
-    } else {
-        stats.median = sorted_values[count/2];
+    double stack_values[ANALYTICS_HISTORY_SIZE];
+    double* scratch = stack_values;
+    if (count > ANALYTICS_HISTORY_SIZE) {
+        scratch = malloc(count * sizeof(double));
+        if (!scratch) {
+            LOG_ERROR("Failed to allocate %d values for statistics", count);
+            return stats;
+        }
     }
     
-    free(sorted_values);
+    memcpy(scratch, values, count * sizeof(double));
+    stats = analytics_stats_inplace(scratch, count);
     
-    // Calculate z-score for last value
-    if (count > 0) {
-        stats.z_score = analytics_calculate_z_score(data[count-1].value, stats.mean, stats.std_dev);
-        stats.is_outlier = analytics_is_outlier(stats.z_score, 2.0);
+    if (scratch != stack_values) {
+        free(scratch);
     }
     
     return stats;
@@ -302,49 +1301,38 @@ trend_result_t analytics_calculate_trend(const metric_data_t* data, int count) {
         return trend;
     }
     
-    // Simple linear regression
-    double sum_x = 0.0, sum_y = 0.0, sum_xy = 0.0, sum_x2 = 0.0;
+    double stack_values[ANALYTICS_HISTORY_SIZE];
+    double* values = stack_values;
+    if (count > ANALYTICS_HISTORY_SIZE) {
+        values = malloc(count * sizeof(double));
+        if (!values) {
+            LOG_ERROR("Failed to allocate %d values for trend", count);
+            return trend;
+        }
+    }
     
     for (int i = 0; i < count; i++) {
-        double x = (double)i;
-        double y = data[i].value;
-        
-        sum_x += x;
-        sum_y += y;
-        sum_xy += x * y;
-        sum_x2 += x * x;
+        values[i] = data[i].value;
     }
     
-    double n = (double)count;
-    trend.slope = (n * sum_xy - sum_x * sum_y) / (n * sum_x2 - sum_x * sum_x);
-    trend.intercept = (sum_y - trend.slope * sum_x) / n;
-    
-    // Calculate correlation coefficient
-    double mean_x = sum_x / n;
-    double mean_y = sum_y / n;
-    
-    double sum_x_dev = 0.0, sum_y_dev = 0.0, sum_xy_dev = 0.0;
+    trend = analytics_trend_from_values(values, count);
     
-    for (int i = 0; i < count; i++) {
-        double x_dev = (double)i - mean_x;
-        double y_dev = data[i].value - mean_y;
-        
-        sum_x_dev += x_dev * x_dev;
-        sum_y_dev += y_dev * y_dev;
-        sum_xy_dev += x_dev * y_dev;
+    if (values != stack_values) {
+        free(values);
     }
     
-    if (sum_x_dev > 0 && sum_y_dev > 0) {
-        trend.correlation = sum_xy_dev / sqrt(sum_x_dev * sum_y_dev);
-    }
+    return trend;
+}
+
+// Calculate trend analysis over a column of values
+trend_result_t analytics_calculate_trend_values(const double* values, int count) {
+    trend_result_t trend = {0};
     
-    // Determine trend direction
-    const double slope_threshold = 0.1;
-    trend.is_increasing = (trend.slope > slope_threshold);
-    trend.is_decreasing = (trend.slope < -slope_threshold);
-    trend.is_stable = (fabs(trend.slope) <= slope_threshold);
+    if (!values || count <= 1) {
+        return trend;
+    }
     
-    return trend;
+    return analytics_trend_from_values(values, count);
 }
 
 // Calculate Z-score
@@ -443,7 +1431,7 @@ anomaly_result_t analytics_statistical_detection(analytics_context_t* ctx, const
     anomaly.actual_value = metric->value;
     anomaly.detected_at = time(NULL);
     
-    metric_history_t* history = &ctx->history[metric->type];
+    metric_history_t* history = analytics_detection_history(ctx, metric);
     
     if (history->count < 10) {
         return anomaly;  // Not enough data
@@ -451,14 +1439,17 @@ anomaly_result_t analytics_statistical_detection(analytics_context_t* ctx, const
     
     const stats_result_t* stats = &history->last_stats;
     
+    // Score the metric itself, which is not always the newest sample in a batch
+    double z_score = analytics_calculate_z_score(metric->value, stats->mean, stats->std_dev);
+    
     // Check for statistical outliers
-    if (stats->is_outlier) {
-        anomaly.severity = (fabs(stats->z_score) > 3.0) ? ANOMALY_CRITICAL : ANOMALY_WARNING;
-        anomaly.threshold_value = stats->mean + (stats->z_score > 0 ? 1 : -1) * 2.0 * stats->std_dev;
-        anomaly.confidence = MIN(fabs(stats->z_score) / 3.0, 1.0);
+    if (analytics_is_outlier(z_score, ctx->config.outlier_threshold)) {
+        anomaly.severity = (fabs(z_score) > 3.0) ? ANOMALY_CRITICAL : ANOMALY_WARNING;
+        anomaly.threshold_value = stats->mean + (z_score > 0 ? 1 : -1) * 2.0 * stats->std_dev;
+        anomaly.confidence = MIN(fabs(z_score) / 3.0, 1.0);
         snprintf(anomaly.description, sizeof(anomaly.description),
                 "Statistical outlier detected: %.2f (z-score: %.2f) (%s)",
-                metric->value, stats->z_score,
+                metric->value, z_score,
                 analytics_metric_type_to_string(metric->type));
     }
     
@@ -472,18 +1463,26 @@ anomaly_result_t analytics_ml_detection(analytics_context_t* ctx, const metric_d
     anomaly.actual_value = metric->value;
     anomaly.detected_at = time(NULL);
     
-    // Simple ML model prediction
-    double prediction = analytics_predict_ml(ctx, metric);
-    double error = fabs(metric->value - prediction);
+    metric_history_t* history = analytics_detection_history(ctx, metric);
     
-    metric_history_t* history = &ctx->history[metric->type];
-    
-    if (history->count < 20) {
+    if (history->count < 20 || !analytics_history_model_ready(history)) {
         return anomaly;  // Not enough data for ML
     }
     
-    // Calculate error threshold based on historical data
-    double error_threshold = history->last_stats.std_dev * 2.0;
+    // Score the newest sample against the forecast made before it arrived;
+    // an older sample of a batch is scored against the current forecast
+    const ar_model_t* model = &history->model;
+    int newest = (history->head - 1 + history->capacity) % history->capacity;
+    bool is_newest = history->values[newest] == metric->value &&
+                     history->timestamps[newest] == metric->timestamp;
+    
+    double prediction = is_newest ? metric->value - model->last_error : model->forecast;
+    double scale = is_newest ? model->last_scale : sqrt(model->residual_var);
+    double error = fabs(metric->value - prediction);
+    
+    // Threshold on the forecast residual rather than the series spread, so
+    // predictable series are held to their own accuracy
+    double error_threshold = MAX(scale, 1e-6 * (1.0 + fabs(model->level))) * 2.0;
     
     if (error > error_threshold) {
         anomaly.severity = (error > error_threshold * 1.5) ? ANOMALY_CRITICAL : ANOMALY_WARNING;
@@ -575,26 +1574,74 @@ recommendation_result_t analytics_generate_recommendation(analytics_context_t* c
 
 // Simple ML prediction
 double analytics_predict_ml(analytics_context_t* ctx, const metric_data_t* metric) {
-    if (!ctx->ml_model.initialized) {
+    if (!ctx || !metric || metric->type >= METRIC_COUNT) {
+        return metric ? metric->value : 0.0;
+    }
+    
+    metric_history_t* history = analytics_detection_history(ctx, metric);
+    if (!analytics_history_model_ready(history)) {
         return metric->value;  // No prediction available
     }
     
-    // Simple feature vector (last 10 values)
-    metric_history_t* history = &ctx->history[metric->type];
+    return history->model.forecast;
+}
+
+// Warm up models from training samples: the samples are appended to their
+// histories without detection, then every series they touch is fitted in one
+// pass over its history
+int analytics_train_ml_model(analytics_context_t* ctx, const metric_data_t* training_data, int count) {
+    if (!ctx || count <= 0 || !training_data) {
+        return -1;
+    }
+    
+    if (analytics_reserve_batch(ctx, count) != 0) {
+        LOG_ERROR("Failed to allocate training scratch for %d samples", count);
+        return -1;
+    }
     
-    if (history->count < 10) {
-        return metric->value;
+    int series_count = 0;
+    uint32_t types_touched = 0;
+    int result = analytics_append_batch(ctx, training_data, count, &series_count, &types_touched);
+    
+    for (int type = 0; type < METRIC_COUNT; type++) {
+        if (types_touched & (1u << type)) {
+            analytics_history_fit_model(&ctx->history[type]);
+        }
     }
     
-    double prediction = ctx->ml_model.bias;
+    int fitted = 0;
+    for (int s = 0; s < series_count; s++) {
+        metric_history_t* history = ctx->batch_series[s].history;
+        if (!history) {
+            continue;
+        }
+        if (history->count >= 10) {
+            analytics_update_history_stats(ctx, history);
+        }
+        if (analytics_history_fit_model(history) == 0) {
+            fitted++;
+        }
+    }
     
-    // Use last 10 values as features
-    for (int i = 0; i < 10 && i < history->count; i++) {
-        int idx = (history->head - 1 - i + 1000) % 1000;
-        prediction += ctx->ml_model.weights[i] * history->data[idx].value;
+    LOG_DEBUG("Trained %d of %d series models on %d samples", fitted, series_count, count);
+    return result;
+}
+
+// One supervised step: move the forecast of the metric's series towards target
+int analytics_update_ml_model(analytics_context_t* ctx, const metric_data_t* metric, double target) {
+    if (!ctx || !metric || metric->type >= METRIC_COUNT) {
+        return -1;
     }
     
-    return prediction;
+    metric_history_t* history = analytics_detection_history(ctx, metric);
+    ar_model_t* model = &history->model;
+    if (model->lag_count < ANALYTICS_AR_ORDER) {
+        return -1;
+    }
+    
+    analytics_ar_adapt(model, target - model->forecast);
+    analytics_ar_forecast(model);
+    return 0;
 }
 
 // Get analytics history
@@ -605,6 +1652,19 @@ metric_history_t* analytics_get_history(analytics_context_t* ctx, metric_type_t
     return &ctx->history[type];
 }
 
+// Get the history of one (node, cell) entity
+metric_history_t* analytics_get_series_history(analytics_context_t* ctx, metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    if (!ctx || type >= METRIC_COUNT) {
+        return NULL;
+    }
+    return series_store_find(ctx->series, type, node_id, cell_id);
+}
+
+// Get the number of tracked series
+int analytics_get_series_count(const analytics_context_t* ctx) {
+    return ctx ? series_store_count(ctx->series) : 0;
+}
+
 // Get recent anomalies
 anomaly_result_t* analytics_get_recent_anomalies(analytics_context_t* ctx, int* count) {
     if (!ctx || !count) {
@@ -629,8 +1689,8 @@ recommendation_result_t* analytics_get_recent_recommendations(analytics_context_
 void analytics_print_stats(const stats_result_t* stats) {
     if (!stats) return;
     
-    printf("Statistics: mean=%.2f, std_dev=%.2f, min=%.2f, max=%.2f, median=%.2f, z_score=%.2f\n",
-           stats->mean, stats->std_dev, stats->min, stats->max, stats->median, stats->z_score);
+    printf("Statistics: mean=%.2f, std_dev=%.2f, min=%.2f, max=%.2f, median=%.2f, p95=%.2f, p99=%.2f, z_score=%.2f\n",
+           stats->mean, stats->std_dev, stats->min, stats->max, stats->median, stats->p95, stats->p99, stats->z_score);
 }
 
 // Print trend analysis
@@ -672,6 +1732,8 @@ void analytics_print_performance(const analytics_context_t* ctx) {
     LOG_INFO("  Processed Metrics: %llu", (unsigned long long)ctx->processed_metrics);
     LOG_INFO("  Detected Anomalies: %llu", (unsigned long long)ctx->detected_anomalies);
     LOG_INFO("  Generated Recommendations: %llu", (unsigned long long)ctx->generated_recommendations);
+    LOG_INFO("  Tracked Series: %d (%.1f MB)", series_store_count(ctx->series),
+             (double)series_store_memory_usage(ctx->series) / (1024 * 1024));
     
     if (ctx->processed_metrics > 0) {
         LOG_INFO("  Anomaly Rate: %.2f%%", 
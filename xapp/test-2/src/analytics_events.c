@@ -0,0 +1,200 @@
+/*
+ * Analytics Event Log for Smart Monitor xApp
+ *
+ * Sequence-numbered stream of anomalies and recommendations:
+ * - Bounded ring keeping the newest events
+ * - Per-consumer cursors, so each consumer sees each event once
+ * - Condition variable wakeup as soon as an event is appended
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "analytics_events.h"
+#include "utils.h"
+#include <errno.h>
+
+// Create a log keeping at least `capacity` events
+analytics_event_log_t* analytics_event_log_create(size_t capacity) {
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    analytics_event_log_t* log = utils_malloc_zero(sizeof(analytics_event_log_t));
+    if (!log) {
+        LOG_ERROR("Failed to allocate analytics event log");
+        return NULL;
+    }
+
+    log->capacity = 1;
+    while (log->capacity < capacity) {
+        log->capacity <<= 1;
+    }
+    log->mask = log->capacity - 1;
+    log->next_sequence = 1;
+
+    log->events = malloc(log->capacity * sizeof(analytics_event_t));
+    if (!log->events) {
+        LOG_ERROR("Failed to allocate %zu analytics events", log->capacity);
+        free(log);
+        return NULL;
+    }
+
+    // Waits use CLOCK_MONOTONIC so wall clock changes do not stretch them
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&log->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&log->lock, NULL);
+
+    return log;
+}
+
+// Destroy the log; no thread may still use it
+void analytics_event_log_destroy(analytics_event_log_t* log) {
+    if (!log) return;
+
+    pthread_cond_destroy(&log->cond);
+    pthread_mutex_destroy(&log->lock);
+    free(log->events);
+    free(log);
+}
+
+// Stop accepting events and release waiting consumers
+void analytics_event_log_close(analytics_event_log_t* log) {
+    if (!log) return;
+
+    pthread_mutex_lock(&log->lock);
+    log->closed = true;
+    pthread_cond_broadcast(&log->cond);
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Append one event; the caller fills in everything but the sequence
+static uint64_t analytics_event_log_append(analytics_event_log_t* log, const analytics_event_t* event) {
+    pthread_mutex_lock(&log->lock);
+
+    if (log->closed) {
+        pthread_mutex_unlock(&log->lock);
+        return 0;
+    }
+
+    uint64_t sequence = log->next_sequence++;
+    analytics_event_t* slot = &log->events[sequence & log->mask];
+    *slot = *event;
+    slot->sequence = sequence;
+
+    if (log->waiters > 0) {
+        pthread_cond_broadcast(&log->cond);
+    }
+
+    pthread_mutex_unlock(&log->lock);
+    return sequence;
+}
+
+// Append an anomaly, returns its sequence number or 0 if the log is closed
+uint64_t analytics_event_log_append_anomaly(analytics_event_log_t* log, const anomaly_result_t* anomaly,
+                                            uint32_t node_id, uint32_t cell_id) {
+    if (!log || !anomaly) {
+        return 0;
+    }
+
+    analytics_event_t event = {
+        .kind = ANALYTICS_EVENT_ANOMALY,
+        .node_id = node_id,
+        .cell_id = cell_id,
+        .anomaly = *anomaly
+    };
+
+    return analytics_event_log_append(log, &event);
+}
+
+// Append a recommendation, returns its sequence number or 0 if the log is closed
+uint64_t analytics_event_log_append_recommendation(analytics_event_log_t* log, const recommendation_result_t* recommendation) {
+    if (!log || !recommendation) {
+        return 0;
+    }
+
+    analytics_event_t event = {
+        .kind = ANALYTICS_EVENT_RECOMMENDATION,
+        .node_id = recommendation->node_id,
+        .cell_id = recommendation->cell_id,
+        .recommendation = *recommendation
+    };
+
+    return analytics_event_log_append(log, &event);
+}
+
+// Oldest sequence still held by the log; caller holds the lock
+static uint64_t analytics_event_log_oldest(const analytics_event_log_t* log) {
+    return log->next_sequence > log->capacity ? log->next_sequence - log->capacity : 1;
+}
+
+// Position a cursor at the tail or at the oldest retained event
+void analytics_event_cursor_init(analytics_event_log_t* log, analytics_event_cursor_t* cursor, bool from_oldest) {
+    if (!log || !cursor) return;
+
+    pthread_mutex_lock(&log->lock);
+    cursor->next_sequence = from_oldest ? analytics_event_log_oldest(log) : log->next_sequence;
+    cursor->missed = 0;
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Copy the events after the cursor, waiting up to timeout_ms for the first one
+int analytics_event_log_read(analytics_event_log_t* log, analytics_event_cursor_t* cursor,
+                             analytics_event_t* events, int max_count, int timeout_ms) {
+    if (!log || !cursor || !events || max_count <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&log->lock);
+
+    if (cursor->next_sequence >= log->next_sequence && !log->closed && timeout_ms > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        log->waiters++;
+        while (cursor->next_sequence >= log->next_sequence && !log->closed) {
+            if (pthread_cond_timedwait(&log->cond, &log->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        log->waiters--;
+    }
+
+    // Skip events that were overwritten before this consumer got to them
+    uint64_t oldest = analytics_event_log_oldest(log);
+    if (cursor->next_sequence < oldest) {
+        cursor->missed += oldest - cursor->next_sequence;
+        cursor->next_sequence = oldest;
+    }
+
+    int count = 0;
+    while (count < max_count && cursor->next_sequence < log->next_sequence) {
+        events[count++] = log->events[cursor->next_sequence & log->mask];
+        cursor->next_sequence++;
+    }
+
+    bool finished = log->closed && count == 0;
+    pthread_mutex_unlock(&log->lock);
+
+    return finished ? -1 : count;
+}
+
+// Sequence number of the newest event, 0 if none was appended
+uint64_t analytics_event_log_last_sequence(analytics_event_log_t* log) {
+    if (!log) return 0;
+
+    pthread_mutex_lock(&log->lock);
+    uint64_t sequence = log->next_sequence - 1;
+    pthread_mutex_unlock(&log->lock);
+
+    return sequence;
+}
@@ -0,0 +1,462 @@
+/*
+ * Sharded Analytics for Smart Monitor xApp
+ *
+ * Spreads analytics over several worker threads:
+ * - One private analytics context and metric queue per shard
+ * - Metrics routed by a hash of (node_id, cell_id)
+ * - Anomalies, recommendations and counters merged across shards on read
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "analytics_shards.h"
+#include "series_store.h"
+
+#define SHARD_SUBMIT_CHUNK 256
+#define SHARD_RECENT_RESULTS 100
+
+// 32-bit mix of a cell identity (splitmix64 finalizer)
+static uint32_t shard_hash(uint32_t node_id, uint32_t cell_id) {
+    uint64_t x = ((uint64_t)node_id << 32) | cell_id;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uint32_t)x;
+}
+
+// Worker: drain the shard queue in batches until stopped, then drain the rest
+static void* shard_thread_func(void* arg) {
+    analytics_shard_t* shard = (analytics_shard_t*)arg;
+    analytics_shards_t* shards = shard->owner;
+
+    metric_data_t* batch = malloc((size_t)shards->batch_size * sizeof(metric_data_t));
+    if (!batch) {
+        LOG_ERROR("Failed to allocate batch for analytics shard %d", shard->index);
+        return NULL;
+    }
+
+    LOG_DEBUG("Analytics shard %d started", shard->index);
+
+    for (;;) {
+        bool running = atomic_load_explicit(&shards->running, memory_order_acquire);
+        size_t count = utils_circular_buffer_pop_bulk(shard->queue, batch, (size_t)shards->batch_size);
+
+        if (count > 0) {
+            pthread_mutex_lock(&shard->lock);
+            analytics_process_metrics_batch(shard->ctx, batch, (int)count);
+            pthread_mutex_unlock(&shard->lock);
+            atomic_fetch_add_explicit(&shard->completed, count, memory_order_release);
+            continue;
+        }
+
+        // Queue was empty after the stop flag was seen, nothing left to do
+        if (!running) {
+            break;
+        }
+
+        utils_sleep_ms(1);
+    }
+
+    free(batch);
+    LOG_DEBUG("Analytics shard %d stopped", shard->index);
+    return NULL;
+}
+
+// Create shards, each with its own context and queue
+analytics_shards_t* analytics_shards_create(const char* config_file, int shard_count,
+                                            size_t queue_capacity, int batch_size) {
+    if (shard_count <= 0 || queue_capacity == 0 || batch_size <= 0) {
+        return NULL;
+    }
+    shard_count = MIN(shard_count, ANALYTICS_MAX_SHARDS);
+
+    analytics_shards_t* shards = utils_malloc_zero(sizeof(analytics_shards_t));
+    if (!shards) {
+        LOG_ERROR("Failed to allocate analytics shards");
+        return NULL;
+    }
+
+    shards->shards = calloc(shard_count, sizeof(analytics_shard_t));
+    if (!shards->shards) {
+        LOG_ERROR("Failed to allocate %d analytics shards", shard_count);
+        free(shards);
+        return NULL;
+    }
+
+    shards->batch_size = batch_size;
+    atomic_init(&shards->running, false);
+
+    shards->events = analytics_event_log_create(ANALYTICS_EVENT_LOG_CAPACITY);
+    if (!shards->events) {
+        free(shards->shards);
+        free(shards);
+        return NULL;
+    }
+
+    for (int i = 0; i < shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+
+        shard->index = i;
+        shard->owner = shards;
+        atomic_init(&shard->accepted, 0);
+        atomic_init(&shard->completed, 0);
+        pthread_mutex_init(&shard->lock, NULL);
+        shards->shard_count++;
+
+        shard->ctx = analytics_init(config_file);
+        shard->queue = utils_circular_buffer_create(queue_capacity, sizeof(metric_data_t));
+        if (!shard->ctx || !shard->queue) {
+            LOG_ERROR("Failed to initialize analytics shard %d", i);
+            analytics_shards_destroy(shards);
+            return NULL;
+        }
+        analytics_set_event_log(shard->ctx, shards->events);
+
+        // Shards split the series memory budget between them
+        if (shard_count > 1 &&
+            analytics_set_series_budget(shard->ctx, shard->ctx->config.series_memory_budget / shard_count) != 0) {
+            analytics_shards_destroy(shards);
+            return NULL;
+        }
+    }
+
+    LOG_INFO("Analytics sharded %d ways", shard_count);
+    return shards;
+}
+
+// Start one worker per shard
+int analytics_shards_start(analytics_shards_t* shards) {
+    if (!shards) {
+        return -1;
+    }
+
+    atomic_store_explicit(&shards->running, true, memory_order_release);
+
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        if (shard->thread_started) {
+            continue;
+        }
+
+        if (pthread_create(&shard->thread, NULL, shard_thread_func, shard) != 0) {
+            LOG_ERROR("Failed to start analytics shard %d", i);
+            analytics_shards_stop(shards);
+            return -1;
+        }
+        shard->thread_started = true;
+    }
+
+    return 0;
+}
+
+// Stop the workers once their queues are drained
+void analytics_shards_stop(analytics_shards_t* shards) {
+    if (!shards) return;
+
+    atomic_store_explicit(&shards->running, false, memory_order_release);
+
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        if (shard->thread_started) {
+            pthread_join(shard->thread, NULL);
+            shard->thread_started = false;
+        }
+    }
+}
+
+// Stop the workers and free every shard
+void analytics_shards_destroy(analytics_shards_t* shards) {
+    if (!shards) return;
+
+    analytics_shards_stop(shards);
+
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        analytics_cleanup(shard->ctx);
+        utils_circular_buffer_destroy(shard->queue);
+        pthread_mutex_destroy(&shard->lock);
+    }
+
+    analytics_event_log_destroy(shards->events);
+    free(shards->shards);
+    free(shards);
+}
+
+// Shard owning a cell
+int analytics_shards_route(const analytics_shards_t* shards, uint32_t node_id, uint32_t cell_id) {
+    if (!shards) return -1;
+
+    // Multiply-shift maps the hash onto [0, shard_count) without a division
+    return (int)(((uint64_t)shard_hash(node_id, cell_id) * (uint64_t)shards->shard_count) >> 32);
+}
+
+// Route metrics to their shards. Metrics of one chunk are grouped per shard
+// with a counting sort so each shard queue sees one bulk push.
+size_t analytics_shards_submit(analytics_shards_t* shards, const metric_data_t* metrics, size_t count) {
+    if (!shards || !metrics) {
+        return 0;
+    }
+
+    metric_data_t grouped[SHARD_SUBMIT_CHUNK];
+    uint8_t route[SHARD_SUBMIT_CHUNK];
+    size_t offsets[ANALYTICS_MAX_SHARDS + 1];
+    size_t queued = 0;
+
+    for (size_t start = 0; start < count; start += SHARD_SUBMIT_CHUNK) {
+        size_t chunk = MIN(count - start, (size_t)SHARD_SUBMIT_CHUNK);
+        const metric_data_t* in = &metrics[start];
+
+        if (shards->shard_count == 1) {
+            size_t pushed = utils_circular_buffer_push_bulk(shards->shards[0].queue, in, chunk);
+            atomic_fetch_add_explicit(&shards->shards[0].accepted, pushed, memory_order_relaxed);
+            queued += pushed;
+            continue;
+        }
+
+        memset(offsets, 0, sizeof(offsets));
+        for (size_t i = 0; i < chunk; i++) {
+            route[i] = (uint8_t)analytics_shards_route(shards, in[i].node_id, in[i].cell_id);
+            offsets[route[i] + 1]++;
+        }
+        for (int s = 0; s < shards->shard_count; s++) {
+            offsets[s + 1] += offsets[s];
+        }
+
+        // Stable placement keeps per-cell order
+        size_t fill[ANALYTICS_MAX_SHARDS];
+        memcpy(fill, offsets, sizeof(size_t) * shards->shard_count);
+        for (size_t i = 0; i < chunk; i++) {
+            grouped[fill[route[i]]++] = in[i];
+        }
+
+        for (int s = 0; s < shards->shard_count; s++) {
+            size_t n = offsets[s + 1] - offsets[s];
+            if (n == 0) {
+                continue;
+            }
+
+            analytics_shard_t* shard = &shards->shards[s];
+            size_t pushed = utils_circular_buffer_push_bulk(shard->queue, &grouped[offsets[s]], n);
+            atomic_fetch_add_explicit(&shard->accepted, pushed, memory_order_relaxed);
+            queued += pushed;
+        }
+    }
+
+    return queued;
+}
+
+// Wait until every metric submitted before the call has been processed
+void analytics_shards_flush(analytics_shards_t* shards) {
+    if (!shards) return;
+
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        uint64_t target = atomic_load_explicit(&shard->accepted, memory_order_relaxed);
+
+        while (atomic_load_explicit(&shard->completed, memory_order_acquire) < target) {
+            if (!shard->thread_started) {
+                LOG_WARN("Flushing analytics shard %d without a worker", i);
+                break;
+            }
+            utils_sleep_ms(1);
+        }
+    }
+}
+
+static int compare_anomalies_newest_first(const void* a, const void* b) {
+    time_t ta = ((const anomaly_result_t*)a)->detected_at;
+    time_t tb = ((const anomaly_result_t*)b)->detected_at;
+    return (ta < tb) - (ta > tb);
+}
+
+static int compare_recommendations_newest_first(const void* a, const void* b) {
+    time_t ta = ((const recommendation_result_t*)a)->generated_at;
+    time_t tb = ((const recommendation_result_t*)b)->generated_at;
+    return (ta < tb) - (ta > tb);
+}
+
+// Copy recent anomalies of all shards, newest first
+int analytics_shards_get_recent_anomalies(analytics_shards_t* shards, anomaly_result_t* anomalies, int max_count) {
+    if (!shards || !anomalies || max_count <= 0) {
+        return 0;
+    }
+
+    anomaly_result_t* merged = malloc((size_t)shards->shard_count * SHARD_RECENT_RESULTS * sizeof(anomaly_result_t));
+    if (!merged) {
+        LOG_ERROR("Failed to allocate anomaly merge buffer");
+        return 0;
+    }
+
+    int total = 0;
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        int count = 0;
+
+        pthread_mutex_lock(&shard->lock);
+        anomaly_result_t* recent = analytics_get_recent_anomalies(shard->ctx, &count);
+        if (recent && count > 0) {
+            memcpy(&merged[total], recent, (size_t)count * sizeof(anomaly_result_t));
+            total += count;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    qsort(merged, total, sizeof(anomaly_result_t), compare_anomalies_newest_first);
+
+    int count = MIN(total, max_count);
+    memcpy(anomalies, merged, (size_t)count * sizeof(anomaly_result_t));
+    free(merged);
+    return count;
+}
+
+// Copy recent recommendations of all shards, newest first
+int analytics_shards_get_recent_recommendations(analytics_shards_t* shards, recommendation_result_t* recommendations, int max_count) {
+    if (!shards || !recommendations || max_count <= 0) {
+        return 0;
+    }
+
+    recommendation_result_t* merged = malloc((size_t)shards->shard_count * SHARD_RECENT_RESULTS * sizeof(recommendation_result_t));
+    if (!merged) {
+        LOG_ERROR("Failed to allocate recommendation merge buffer");
+        return 0;
+    }
+
+    int total = 0;
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+        int count = 0;
+
+        pthread_mutex_lock(&shard->lock);
+        recommendation_result_t* recent = analytics_get_recent_recommendations(shard->ctx, &count);
+        if (recent && count > 0) {
+            memcpy(&merged[total], recent, (size_t)count * sizeof(recommendation_result_t));
+            total += count;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    qsort(merged, total, sizeof(recommendation_result_t), compare_recommendations_newest_first);
+
+    int count = MIN(total, max_count);
+    memcpy(recommendations, merged, (size_t)count * sizeof(recommendation_result_t));
+    free(merged);
+    return count;
+}
+
+// Latest statistics and trend of one series, read from the shard owning it
+bool analytics_shards_get_series_stats(analytics_shards_t* shards, metric_type_t type, uint32_t node_id, uint32_t cell_id,
+                                       stats_result_t* stats, trend_result_t* trend) {
+    if (!shards) {
+        return false;
+    }
+
+    analytics_shard_t* shard = &shards->shards[analytics_shards_route(shards, node_id, cell_id)];
+
+    pthread_mutex_lock(&shard->lock);
+    metric_history_t* history = analytics_get_series_history(shard->ctx, type, node_id, cell_id);
+    if (history) {
+        if (stats) *stats = history->last_stats;
+        if (trend) *trend = history->last_trend;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return history != NULL;
+}
+
+// Latest fleet-wide statistics and trend of one metric type across all
+// shards. Each shard keeps the fleet-wide history of its own cells; their
+// newest samples are copied out under each shard's lock in turn and merged
+// by timestamp here, so workers never share a lock.
+bool analytics_shards_get_fleet_stats(analytics_shards_t* shards, metric_type_t type,
+                                      stats_result_t* stats, trend_result_t* trend, int* count) {
+    if (!shards || type >= METRIC_COUNT) {
+        return false;
+    }
+
+    size_t capacity = (size_t)shards->shard_count * ANALYTICS_HISTORY_SIZE;
+    double* values = malloc(capacity * sizeof(double));
+    time_t* timestamps = malloc(capacity * sizeof(time_t));
+    if (!values || !timestamps) {
+        LOG_ERROR("Failed to allocate fleet merge buffer");
+        free(values);
+        free(timestamps);
+        return false;
+    }
+
+    int run_counts[ANALYTICS_MAX_SHARDS];
+    int total = 0;
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+        run_counts[i] = analytics_history_copy(&shard->ctx->history[type], &values[total],
+                                               &timestamps[total], ANALYTICS_HISTORY_SIZE);
+        pthread_mutex_unlock(&shard->lock);
+        total += run_counts[i];
+    }
+
+    // Shard contexts share one configuration, so any of them sizes the merge
+    metric_history_t merged;
+    bool merged_ok = analytics_history_merge(shards->shards[0].ctx, &merged, values, timestamps,
+                                             run_counts, shards->shard_count) == 0;
+    free(values);
+    free(timestamps);
+    if (!merged_ok) {
+        return false;
+    }
+
+    if (stats) *stats = merged.last_stats;
+    if (trend) *trend = merged.last_trend;
+    if (count) *count = merged.count;
+    analytics_history_free(&merged);
+
+    return true;
+}
+
+// Sum the counters of all shards
+void analytics_shards_get_totals(analytics_shards_t* shards, analytics_shards_totals_t* totals) {
+    if (!totals) return;
+
+    memset(totals, 0, sizeof(analytics_shards_totals_t));
+    if (!shards) return;
+
+    for (int i = 0; i < shards->shard_count; i++) {
+        analytics_shard_t* shard = &shards->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+        totals->processed_metrics += shard->ctx->processed_metrics;
+        totals->detected_anomalies += shard->ctx->detected_anomalies;
+        totals->generated_recommendations += shard->ctx->generated_recommendations;
+        totals->series_count += series_store_count(shard->ctx->series);
+        totals->series_memory += series_store_memory_usage(shard->ctx->series);
+        pthread_mutex_unlock(&shard->lock);
+
+        totals->queued_metrics += utils_circular_buffer_size(shard->queue);
+    }
+}
+
+// Print merged counters
+void analytics_shards_print_performance(analytics_shards_t* shards) {
+    if (!shards) return;
+
+    analytics_shards_totals_t totals;
+    analytics_shards_get_totals(shards, &totals);
+
+    LOG_INFO("Analytics Performance (%d shards):", shards->shard_count);
+    LOG_INFO("  Processed Metrics: %llu", (unsigned long long)totals.processed_metrics);
+    LOG_INFO("  Detected Anomalies: %llu", (unsigned long long)totals.detected_anomalies);
+    LOG_INFO("  Generated Recommendations: %llu", (unsigned long long)totals.generated_recommendations);
+    LOG_INFO("  Queued Metrics: %llu", (unsigned long long)totals.queued_metrics);
+    LOG_INFO("  Tracked Series: %d (%.1f MB)", totals.series_count,
+             (double)totals.series_memory / (1024 * 1024));
+
+    if (totals.processed_metrics > 0) {
+        LOG_INFO("  Anomaly Rate: %.2f%%",
+                (double)totals.detected_anomalies / totals.processed_metrics * 100.0);
+        LOG_INFO("  Recommendation Rate: %.2f%%",
+                (double)totals.generated_recommendations / totals.processed_metrics * 100.0);
+    }
+}
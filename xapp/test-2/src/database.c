@@ -6,26 +6,38 @@
  * - Metric storage and retrieval
  * - Anomaly and recommendation logging
  * - Event logging and querying
+ * - In-memory counters summarizing high-frequency events
+ * - Write-behind writer with group commits
+ * - Day-partitioned metrics and events with background retention
+ * - Streaming cursor queries
+ * - Read-only connection pool with per-connection statement caches
+ * - Multi-resolution rollups for range statistics
+ * - Optional compressed per-series metric blocks
+ * - Exactly-once compaction of segment log segments
+ * - Online backup in a background thread and atomic restore
  * - Performance monitoring
  * 
  * Author: xApp Template Generator
  * Version: 1.0.0
  */
 
+#define _GNU_SOURCE   // SCHED_IDLE
+
 #include "database.h"
 #include "utils.h"
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+
+// Records the writer takes off the record queue per pass
+#define DATABASE_RECORD_BATCH 64
 
-// Database schema SQL
+// Retention check interval once nothing is left to sweep
+#define DATABASE_RETENTION_IDLE_MS 60000
+
+// Database schema SQL. Metrics and events live in day partitions created on
+// first write and listed in the partitions table.
 const char* DATABASE_SCHEMA_SQL = 
-    "CREATE TABLE IF NOT EXISTS metrics ("
-    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
-    "  metric_type INTEGER NOT NULL,"
-    "  value REAL NOT NULL,"
-    "  node_id INTEGER NOT NULL,"
-    "  cell_id INTEGER NOT NULL,"
-    "  timestamp INTEGER NOT NULL"
-    ");"
-    
     "CREATE TABLE IF NOT EXISTS anomalies ("
     "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
     "  metric_type INTEGER NOT NULL,"
@@ -49,14 +61,29 @@ const char* DATABASE_SCHEMA_SQL =
     "  parameters TEXT NOT NULL"
     ");"
     
-    "CREATE TABLE IF NOT EXISTS events ("
-    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
-    "  event_type INTEGER NOT NULL,"
+    "CREATE TABLE IF NOT EXISTS partitions ("
+    "  name TEXT PRIMARY KEY,"
+    "  kind INTEGER NOT NULL,"
+    "  day INTEGER NOT NULL"
+    ");"
+    
+    "CREATE TABLE IF NOT EXISTS metric_blocks ("
+    "  block_id INTEGER PRIMARY KEY,"
+    "  metric_type INTEGER NOT NULL,"
     "  node_id INTEGER NOT NULL,"
-    "  subscription_id INTEGER NOT NULL,"
-    "  timestamp INTEGER NOT NULL,"
-    "  message TEXT NOT NULL,"
-    "  details TEXT NOT NULL"
+    "  cell_id INTEGER NOT NULL,"
+    "  start_time INTEGER NOT NULL,"
+    "  end_time INTEGER NOT NULL,"
+    "  sample_count INTEGER NOT NULL,"
+    "  min_value REAL NOT NULL,"
+    "  max_value REAL NOT NULL,"
+    "  data BLOB NOT NULL"
+    ");"
+    
+    "CREATE TABLE IF NOT EXISTS compacted_segments ("
+    "  sequence INTEGER PRIMARY KEY,"
+    "  records INTEGER NOT NULL,"
+    "  compacted_at INTEGER NOT NULL"
     ");"
     
     "CREATE TABLE IF NOT EXISTS schema_version ("
@@ -65,28 +92,135 @@ const char* DATABASE_SCHEMA_SQL =
 
 // Database indexes SQL
 const char* DATABASE_INDEXES_SQL = 
-    "CREATE INDEX IF NOT EXISTS idx_metrics_timestamp ON metrics(timestamp);"
-    "CREATE INDEX IF NOT EXISTS idx_metrics_type_node ON metrics(metric_type, node_id);"
     "CREATE INDEX IF NOT EXISTS idx_anomalies_timestamp ON anomalies(detected_at);"
     "CREATE INDEX IF NOT EXISTS idx_anomalies_severity ON anomalies(severity);"
     "CREATE INDEX IF NOT EXISTS idx_recommendations_timestamp ON recommendations(generated_at);"
     "CREATE INDEX IF NOT EXISTS idx_recommendations_type ON recommendations(type);"
-    "CREATE INDEX IF NOT EXISTS idx_events_timestamp ON events(timestamp);"
-    "CREATE INDEX IF NOT EXISTS idx_events_type ON events(event_type);";
-
-// Database triggers SQL (for cleanup)
-const char* DATABASE_TRIGGERS_SQL = 
-    "CREATE TRIGGER IF NOT EXISTS cleanup_old_metrics "
-    "AFTER INSERT ON metrics "
-    "BEGIN "
-    "  DELETE FROM metrics WHERE timestamp < (NEW.timestamp - 86400 * 7); "
-    "END;"
-    
-    "CREATE TRIGGER IF NOT EXISTS cleanup_old_events "
-    "AFTER INSERT ON events "
-    "BEGIN "
-    "  DELETE FROM events WHERE timestamp < (NEW.timestamp - 86400 * 30); "
-    "END;";
+    "CREATE INDEX IF NOT EXISTS idx_partitions_kind_day ON partitions(kind, day);"
+    "CREATE INDEX IF NOT EXISTS idx_metric_blocks_end ON metric_blocks(end_time);";
+
+// Schema 1 deleted old rows from a trigger after every insert
+const char* DATABASE_DROP_TRIGGERS_SQL = 
+    "DROP TRIGGER IF EXISTS cleanup_old_metrics;"
+    "DROP TRIGGER IF EXISTS cleanup_old_events;";
+
+// Day partition SQL; %1$s is the table name, %2$d the kind, %3$lld the day
+const char* DATABASE_METRIC_PARTITION_SQL = 
+    "CREATE TABLE IF NOT EXISTS %1$s ("
+    "  id INTEGER PRIMARY KEY,"
+    "  metric_type INTEGER NOT NULL,"
+    "  value REAL NOT NULL,"
+    "  node_id INTEGER NOT NULL,"
+    "  cell_id INTEGER NOT NULL,"
+    "  timestamp INTEGER NOT NULL"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_%1$s_timestamp ON %1$s(timestamp);"
+    "CREATE INDEX IF NOT EXISTS idx_%1$s_type_node ON %1$s(metric_type, node_id);"
+    "INSERT OR IGNORE INTO partitions (name, kind, day) VALUES ('%1$s', %2$d, %3$lld);";
+
+const char* DATABASE_EVENT_PARTITION_SQL = 
+    "CREATE TABLE IF NOT EXISTS %1$s ("
+    "  id INTEGER PRIMARY KEY,"
+    "  event_type INTEGER NOT NULL,"
+    "  node_id INTEGER NOT NULL,"
+    "  subscription_id INTEGER NOT NULL,"
+    "  timestamp INTEGER NOT NULL,"
+    "  count INTEGER NOT NULL DEFAULT 1,"
+    "  message TEXT NOT NULL,"
+    "  details TEXT NOT NULL"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_%1$s_timestamp ON %1$s(timestamp);"
+    "CREATE INDEX IF NOT EXISTS idx_%1$s_type ON %1$s(event_type);"
+    "INSERT OR IGNORE INTO partitions (name, kind, day) VALUES ('%1$s', %2$d, %3$lld);";
+
+// Columns every cursor statement binds: ?1 start, ?2 end, ?3 type, ?4 node
+// or minimum severity, ?5 limit. Unary + keeps the planner on the time index,
+// which already yields rows in order, so no statement needs a sort.
+static const char* DATABASE_SELECT_METRICS_SQL =
+    "SELECT metric_type, value, node_id, cell_id, timestamp FROM %s "
+    "WHERE timestamp BETWEEN ?1 AND ?2 AND (?3 < 0 OR +metric_type = ?3) AND (?4 = 0 OR +node_id = ?4) "
+    "ORDER BY timestamp DESC LIMIT ?5;";
+
+static const char* DATABASE_SELECT_EVENTS_SQL =
+    "SELECT event_type, node_id, subscription_id, timestamp, message, details, count FROM %s "
+    "WHERE timestamp BETWEEN ?1 AND ?2 AND (?3 < 0 OR +event_type = ?3) "
+    "ORDER BY timestamp DESC LIMIT ?5;";
+
+static const char* DATABASE_SELECT_ANOMALIES_SQL =
+    "SELECT metric_type, severity, threshold_value, actual_value, confidence, detected_at, description FROM anomalies "
+    "WHERE detected_at BETWEEN ?1 AND ?2 AND +severity >= ?4 "
+    "ORDER BY detected_at DESC LIMIT ?5;";
+
+static const char* DATABASE_SELECT_RECOMMENDATIONS_SQL =
+    "SELECT type, node_id, cell_id, confidence, expected_improvement, generated_at, description, parameters FROM recommendations "
+    "WHERE generated_at BETWEEN ?1 AND ?2 AND (?3 < 0 OR +type = ?3) "
+    "ORDER BY generated_at DESC LIMIT ?5;";
+
+// Blocks overlapping [?1, ?2], newest end first. A block spans less than
+// DATABASE_BLOCK_SPAN_SECONDS, so ?5 = ?2 + span bounds the index range.
+static const char* DATABASE_SELECT_BLOCKS_SQL =
+    "SELECT metric_type, node_id, cell_id, sample_count, end_time, data FROM metric_blocks "
+    "WHERE end_time BETWEEN ?1 AND ?5 AND start_time <= ?2 AND (?3 < 0 OR +metric_type = ?3) AND (?4 = 0 OR +node_id = ?4) "
+    "ORDER BY end_time DESC;";
+
+// Rollup tables, one per resolution. Keyed so one series' buckets are
+// contiguous; the bucket index serves any-node queries and retention.
+static const char* DATABASE_ROLLUP_TABLES[DATABASE_ROLLUP_COUNT] = { "rollup_1s", "rollup_1m", "rollup_1h" };
+static const int64_t DATABASE_ROLLUP_WIDTHS[DATABASE_ROLLUP_COUNT] = { 1, 60, 3600 };
+
+static const char* DATABASE_ROLLUP_TABLE_SQL =
+    "CREATE TABLE IF NOT EXISTS %1$s ("
+    "  metric_type INTEGER NOT NULL,"
+    "  node_id INTEGER NOT NULL,"
+    "  bucket INTEGER NOT NULL,"
+    "  cell_id INTEGER NOT NULL,"
+    "  count INTEGER NOT NULL,"
+    "  sum REAL NOT NULL,"
+    "  m2 REAL NOT NULL,"
+    "  min REAL NOT NULL,"
+    "  max REAL NOT NULL,"
+    "  PRIMARY KEY (metric_type, node_id, bucket, cell_id)"
+    ") WITHOUT ROWID;"
+    "CREATE INDEX IF NOT EXISTS idx_%1$s_bucket ON %1$s(bucket);";
+
+// Merge a bucket into its row. m2 is the sum of squared deviations from the
+// bucket mean; two buckets combine with Chan's formula, which adds the
+// squared difference of their means weighted by na * nb / (na + nb).
+#define DATABASE_ROLLUP_UPSERT_SQL \
+    " ON CONFLICT (metric_type, node_id, bucket, cell_id) DO UPDATE SET" \
+    " count = count + excluded.count, sum = sum + excluded.sum," \
+    " m2 = m2 + excluded.m2 + (excluded.sum / excluded.count - sum / count) * (excluded.sum / excluded.count - sum / count)" \
+    " * count * excluded.count / (count + excluded.count)," \
+    " min = MIN(min, excluded.min), max = MAX(max, excluded.max);"
+
+static const char* DATABASE_ROLLUP_INSERT_SQL =
+    "INSERT INTO %s (metric_type, node_id, bucket, cell_id, count, sum, m2, min, max) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)" DATABASE_ROLLUP_UPSERT_SQL;
+
+// Rebuild rollups from raw rows; %1$s rollup table, %2$s metric table, %3$lld width.
+// Deviations are taken from each bucket's own mean.
+static const char* DATABASE_ROLLUP_BACKFILL_SQL =
+    "INSERT INTO %1$s (metric_type, node_id, bucket, cell_id, count, sum, m2, min, max) "
+    "SELECT metric_type, node_id, bucket, cell_id, "
+    "COUNT(*), SUM(value), SUM((value - mean) * (value - mean)), MIN(value), MAX(value) FROM ("
+    "  SELECT metric_type, node_id, cell_id, value, bucket,"
+    "  AVG(value) OVER (PARTITION BY metric_type, node_id, cell_id, bucket) AS mean FROM ("
+    "    SELECT metric_type, node_id, cell_id, value,"
+    "    timestamp - ((timestamp %% %3$lld) + %3$lld) %% %3$lld AS bucket FROM %2$s)"
+    ") WHERE 1 GROUP BY 1, 2, 3, 4"
+    DATABASE_ROLLUP_UPSERT_SQL;
+
+// Totals of a bucket range; m2 of the range adds each bucket's squared
+// distance from the range mean to the buckets' own m2
+#define DATABASE_ROLLUP_SELECT(where) \
+    "WITH r AS (SELECT count, sum, m2, min, max FROM %s WHERE " where ") " \
+    "SELECT SUM(r.count), SUM(r.sum), SUM(r.m2 + r.count * (r.sum / r.count - t.mean) * (r.sum / r.count - t.mean)), " \
+    "MIN(r.min), MAX(r.max) FROM r, (SELECT SUM(sum) / SUM(count) AS mean FROM r) t;"
+
+static const char* DATABASE_ROLLUP_SELECT_SQL[2] = {
+    DATABASE_ROLLUP_SELECT("bucket >= ?2 AND bucket < ?3 AND +metric_type = ?1"),
+    DATABASE_ROLLUP_SELECT("metric_type = ?1 AND node_id = ?4 AND bucket >= ?2 AND bucket < ?3")
+};
 
 // String conversion functions
 const char* database_event_type_to_string(event_type_t type) {
@@ -106,6 +240,247 @@ const char* database_event_type_to_string(event_type_t type) {
     }
 }
 
+// Open the read connection pool. Readers only run beside the writer under
+// WAL, so in-memory and rollback journal databases keep reading on db.
+static int database_open_readers(database_context_t* ctx) {
+    if (ctx->config.read_connections <= 0) {
+        return 0;
+    }
+    
+    bool wal = false;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(ctx->db, "PRAGMA journal_mode;", -1, &stmt, NULL) == SQLITE_OK) {
+        wal = sqlite3_step(stmt) == SQLITE_ROW &&
+              sqlite3_stricmp((const char*)sqlite3_column_text(stmt, 0), "wal") == 0;
+        sqlite3_finalize(stmt);
+    }
+    if (!wal) {
+        LOG_INFO("Database is not in WAL mode, queries read on the main connection");
+        return 0;
+    }
+    
+    int count = ctx->config.read_connections;
+    ctx->readers = calloc((size_t)count, sizeof(database_reader_t));
+    ctx->idle_readers = calloc((size_t)count, sizeof(database_reader_t*));
+    if (!ctx->readers || !ctx->idle_readers) {
+        LOG_ERROR("Failed to allocate read connections");
+        free(ctx->readers);
+        free(ctx->idle_readers);
+        ctx->readers = NULL;
+        ctx->idle_readers = NULL;
+        return -1;
+    }
+    
+    // Each reader is used by one thread at a time, so it needs no mutex
+    for (int i = 0; i < count; i++) {
+        database_reader_t* reader = &ctx->readers[i];
+        int rc = sqlite3_open_v2(ctx->config.database_path, &reader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("Failed to open read connection: %s", sqlite3_errmsg(reader->db));
+            sqlite3_close(reader->db);
+            reader->db = NULL;
+            break;
+        }
+        sqlite3_busy_timeout(reader->db, ctx->config.busy_timeout);
+        ctx->idle_readers[ctx->reader_count++] = reader;
+    }
+    ctx->idle_reader_count = ctx->reader_count;
+    
+    pthread_mutex_init(&ctx->reader_lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->reader_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    
+    LOG_DEBUG("Opened %d read connections", ctx->reader_count);
+    return 0;
+}
+
+// Close the read connections and their cached statements
+static void database_close_readers(database_context_t* ctx) {
+    if (!ctx->readers) return;
+    
+    for (int i = 0; i < ctx->reader_count; i++) {
+        database_reader_t* reader = &ctx->readers[i];
+        for (int j = 0; j < DATABASE_READER_STMT_CACHE; j++) {
+            sqlite3_finalize(reader->stmts[j].stmt);
+            free(reader->stmts[j].sql);
+        }
+        sqlite3_close(reader->db);
+    }
+    
+    pthread_cond_destroy(&ctx->reader_cond);
+    pthread_mutex_destroy(&ctx->reader_lock);
+    free(ctx->readers);
+    free(ctx->idle_readers);
+    ctx->readers = NULL;
+    ctx->idle_readers = NULL;
+    ctx->reader_count = 0;
+    ctx->idle_reader_count = 0;
+}
+
+// Borrow an idle read connection, waiting up to busy_timeout for one
+database_reader_t* database_acquire_reader(database_context_t* ctx) {
+    if (!ctx || ctx->reader_count == 0) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&ctx->reader_lock);
+    if (ctx->idle_reader_count == 0) {
+        atomic_fetch_add(&ctx->reader_waits, 1);
+        
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += ctx->config.busy_timeout / 1000;
+        deadline.tv_nsec += (long)(ctx->config.busy_timeout % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        
+        while (ctx->idle_reader_count == 0 &&
+               pthread_cond_timedwait(&ctx->reader_cond, &ctx->reader_lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    
+    database_reader_t* reader = (ctx->idle_reader_count > 0) ? ctx->idle_readers[--ctx->idle_reader_count] : NULL;
+    pthread_mutex_unlock(&ctx->reader_lock);
+    return reader;
+}
+
+// Hand a read connection back, ending the snapshot its borrower read
+void database_release_reader(database_context_t* ctx, database_reader_t* reader) {
+    if (!ctx || !reader) return;
+    
+    for (int i = 0; i < DATABASE_READER_STMT_CACHE; i++) {
+        if (reader->stmts[i].stmt) {
+            sqlite3_reset(reader->stmts[i].stmt);
+        }
+    }
+    if (!sqlite3_get_autocommit(reader->db)) {
+        sqlite3_exec(reader->db, "COMMIT;", NULL, NULL, NULL);
+    }
+    
+    pthread_mutex_lock(&ctx->reader_lock);
+    ctx->idle_readers[ctx->idle_reader_count++] = reader;
+    pthread_cond_signal(&ctx->reader_cond);
+    pthread_mutex_unlock(&ctx->reader_lock);
+}
+
+// Cached statement of a reader, preparing it on first use in place of the
+// least recently used one
+sqlite3_stmt* database_reader_prepare(database_context_t* ctx, database_reader_t* reader, const char* sql) {
+    if (!ctx || !reader || !sql) {
+        return NULL;
+    }
+    
+    reader->clock++;
+    database_cached_stmt_t* victim = &reader->stmts[0];
+    
+    for (int i = 0; i < DATABASE_READER_STMT_CACHE; i++) {
+        database_cached_stmt_t* entry = &reader->stmts[i];
+        if (entry->stmt && strcmp(entry->sql, sql) == 0) {
+            entry->last_used = reader->clock;
+            sqlite3_reset(entry->stmt);
+            sqlite3_clear_bindings(entry->stmt);
+            atomic_fetch_add(&ctx->stmt_cache_hits, 1);
+            return entry->stmt;
+        }
+        if (victim->stmt && (!entry->stmt || entry->last_used < victim->last_used)) {
+            victim = entry;
+        }
+    }
+    
+    atomic_fetch_add(&ctx->stmt_cache_misses, 1);
+    sqlite3_finalize(victim->stmt);
+    free(victim->sql);
+    victim->stmt = NULL;
+    victim->sql = strdup(sql);
+    
+    if (!victim->sql ||
+        sqlite3_prepare_v3(reader->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &victim->stmt, NULL) != SQLITE_OK) {
+        sqlite3_finalize(victim->stmt);
+        free(victim->sql);
+        victim->stmt = NULL;
+        victim->sql = NULL;
+        return NULL;
+    }
+    
+    victim->last_used = reader->clock;
+    return victim->stmt;
+}
+
+// Prepare a read statement: cached on the reader, or a new one on db without one
+static sqlite3_stmt* database_read_prepare(database_context_t* ctx, database_reader_t* reader, const char* sql) {
+    if (reader) {
+        return database_reader_prepare(ctx, reader, sql);
+    }
+    
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    return stmt;
+}
+
+// Done with a read statement: reset a cached one, finalize one of db
+static void database_read_finish(database_reader_t* reader, sqlite3_stmt* stmt) {
+    if (reader) {
+        sqlite3_reset(stmt);
+    } else {
+        sqlite3_finalize(stmt);
+    }
+}
+
+// Borrow a connection for a read, leaving *reader NULL to read on db. db is
+// only read while the writer thread is stopped: the writer keeps its group
+// commit open there, so a read would share the connection and see rows that
+// may still roll back.
+static int database_read_connection(database_context_t* ctx, database_reader_t** reader) {
+    *reader = database_acquire_reader(ctx);
+    if (*reader) {
+        return 0;
+    }
+    
+    if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire)) {
+        atomic_fetch_add(&ctx->reader_timeouts, 1);
+        LOG_ERROR("%s", ctx->reader_count > 0 ? "Every read connection is busy, query refused"
+                                              : "Queries need WAL read connections while the writer runs");
+        return -1;
+    }
+    if (ctx->reader_count > 0) {
+        atomic_fetch_add(&ctx->reader_fallbacks, 1);
+        LOG_WARN("Every read connection is busy, reading on the main connection");
+    }
+    return 0;
+}
+
+// Start a snapshot on a reader; every statement until release reads it
+static void database_read_begin(database_context_t* ctx, database_reader_t* reader) {
+    sqlite3_stmt* stmt = reader ? database_reader_prepare(ctx, reader, "BEGIN;") : NULL;
+    if (stmt) {
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+}
+
+// Drop every open block without writing it back
+static void database_forget_open_blocks(database_context_t* ctx) {
+    for (size_t i = 0; i < ctx->open_block_slots; i++) {
+        if (ctx->open_blocks[i]) {
+            metric_block_free(&ctx->open_blocks[i]->block);
+            metric_block_free(&ctx->open_blocks[i]->sealed);
+            free(ctx->open_blocks[i]);
+            ctx->open_blocks[i] = NULL;
+        }
+    }
+    ctx->open_block_count = 0;
+    ctx->dirty_block_count = 0;
+    ctx->marked_block_count = 0;
+}
+
 // Initialize database context
 database_context_t* database_init(const char* database_path) {
     database_context_t* ctx = malloc(sizeof(database_context_t));
@@ -128,10 +503,50 @@ database_context_t* database_init(const char* database_path) {
     ctx->config.enable_wal = true;
     ctx->config.enable_foreign_keys = true;
     ctx->config.cache_size = 10000;
+    ctx->config.group_commit_ms = DATABASE_GROUP_COMMIT_MS;
+    ctx->config.group_commit_rows = DATABASE_GROUP_COMMIT_ROWS;
+    ctx->config.write_queue_capacity = DATABASE_WRITE_QUEUE_CAPACITY;
+    ctx->config.metric_retention_days = DATABASE_METRIC_RETENTION_DAYS;
+    ctx->config.event_retention_days = DATABASE_EVENT_RETENTION_DAYS;
+    ctx->config.retention_chunk_rows = DATABASE_RETENTION_CHUNK_ROWS;
+    ctx->config.retention_interval_ms = DATABASE_RETENTION_INTERVAL_MS;
+    ctx->config.metric_storage = DATABASE_METRIC_STORAGE_ROWS;
+    ctx->config.block_samples = DATABASE_BLOCK_SAMPLES;
+    ctx->config.block_flush_samples = DATABASE_BLOCK_FLUSH_SAMPLES;
+    ctx->config.read_connections = DATABASE_READ_CONNECTIONS;
+    ctx->config.event_summary_ms = DATABASE_EVENT_SUMMARY_MS;
+    ctx->config.backup_step_pages = DATABASE_BACKUP_STEP_PAGES;
+    ctx->config.backup_step_ms = DATABASE_BACKUP_STEP_MS;
+    
+    // Indications arrive with every report; everything else is rare
+    for (int type = 0; type < EVENT_TYPE_COUNT; type++) {
+        ctx->config.event_policy[type] = DATABASE_EVENT_LOG;
+    }
+    ctx->config.event_policy[EVENT_INDICATION_RECEIVED] = DATABASE_EVENT_COUNT;
+    
+    ctx->rollups = calloc(DATABASE_ROLLUP_SLOTS, sizeof(database_rollup_t));
+    ctx->event_counters = calloc(DATABASE_EVENT_COUNTER_SLOTS, sizeof(database_event_counter_t));
+    ctx->spare_event_counters = calloc(DATABASE_EVENT_COUNTER_SLOTS, sizeof(database_event_counter_t));
+    if (!ctx->rollups || !ctx->event_counters || !ctx->spare_event_counters) {
+        LOG_ERROR("Failed to allocate rollup and event counter tables");
+        free(ctx->rollups);
+        free(ctx->event_counters);
+        free(ctx->spare_event_counters);
+        free(ctx);
+        return NULL;
+    }
+    pthread_mutex_init(&ctx->event_counter_lock, NULL);
+    pthread_mutex_init(&ctx->event_flush_lock, NULL);
+    ctx->next_event_summary_us = utils_get_timestamp_us() + (uint64_t)ctx->config.event_summary_ms * 1000;
     
     // Connect to database
     if (database_connect(ctx) != 0) {
         LOG_ERROR("Failed to connect to database");
+        pthread_mutex_destroy(&ctx->event_counter_lock);
+        pthread_mutex_destroy(&ctx->event_flush_lock);
+        free(ctx->rollups);
+        free(ctx->event_counters);
+        free(ctx->spare_event_counters);
         free(ctx);
         return NULL;
     }
@@ -150,6 +565,13 @@ database_context_t* database_init(const char* database_path) {
         return NULL;
     }
     
+    // Open read connections once the schema exists
+    if (database_open_readers(ctx) != 0) {
+        LOG_ERROR("Failed to open read connections");
+        database_cleanup(ctx);
+        return NULL;
+    }
+    
     ctx->initialized = true;
     
     LOG_INFO("Database initialized successfully: %s", ctx->config.database_path);
@@ -162,12 +584,35 @@ void database_cleanup(database_context_t* ctx) {
     
     LOG_INFO("Cleaning up database context");
     
+    // A backup in progress is abandoned
+    database_cancel_backup(ctx);
+    
+    // Summarize counted events, then commit whatever is still queued
+    database_flush_event_counters(ctx);
+    database_stop_writer(ctx);
+    
+    // Write back the samples open blocks still hold
+    if (ctx->db) {
+        database_sync_blocks(ctx);
+    }
+    
+    // Close read connections; every cursor must be closed by now
+    database_close_readers(ctx);
+    
     // Finalize prepared statements
     database_finalize_statements(ctx);
     
     // Close database connection
     database_disconnect(ctx);
     
+    database_forget_open_blocks(ctx);
+    free(ctx->open_blocks);
+    free(ctx->dirty_blocks);
+    free(ctx->rollups);
+    free(ctx->event_counters);
+    free(ctx->spare_event_counters);
+    pthread_mutex_destroy(&ctx->event_counter_lock);
+    pthread_mutex_destroy(&ctx->event_flush_lock);
     free(ctx);
 }
 
@@ -212,6 +657,81 @@ void database_disconnect(database_context_t* ctx) {
     LOG_DEBUG("Database disconnected");
 }
 
+// Build rollups from the metrics already stored, in one transaction
+static int database_backfill_rollups(database_context_t* ctx) {
+    int64_t days[1024];
+    int day_count = database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 1024);
+    if (day_count <= 0 && !ctx->legacy_metrics) {
+        return 0;
+    }
+    
+    LOG_INFO("Building metric rollups from %d partitions", MAX(day_count, 0));
+    
+    char* err_msg = NULL;
+    int rc = sqlite3_exec(ctx->db, "BEGIN;", NULL, NULL, &err_msg);
+    
+    for (int i = -1; rc == SQLITE_OK && i < day_count; i++) {
+        char table[64];
+        if (i < 0) {
+            if (!ctx->legacy_metrics) continue;
+            snprintf(table, sizeof(table), "metrics");
+        } else {
+            database_partition_name(DATABASE_PARTITION_METRICS, days[i], table, sizeof(table));
+        }
+        
+        for (int res = 0; rc == SQLITE_OK && res < DATABASE_ROLLUP_COUNT; res++) {
+            char sql[1024];
+            snprintf(sql, sizeof(sql), DATABASE_ROLLUP_BACKFILL_SQL, DATABASE_ROLLUP_TABLES[res], table,
+                     (long long)DATABASE_ROLLUP_WIDTHS[res]);
+            rc = sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg);
+        }
+    }
+    
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(ctx->db, "COMMIT;", NULL, NULL, &err_msg);
+    }
+    
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Failed to build rollups: %s", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(ctx->db, "ROLLBACK;", NULL, NULL, NULL);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Add the count column to event tables created before it existed
+static int database_add_event_counts(database_context_t* ctx) {
+    int64_t days[1024];
+    int day_count = database_list_partitions(ctx, DATABASE_PARTITION_EVENTS, days, 1024);
+    
+    for (int i = -1; i < day_count; i++) {
+        char table[64];
+        if (i < 0) {
+            if (!ctx->legacy_events) continue;
+            snprintf(table, sizeof(table), "events");
+        } else {
+            database_partition_name(DATABASE_PARTITION_EVENTS, days[i], table, sizeof(table));
+        }
+        
+        if (sqlite3_table_column_metadata(ctx->db, NULL, table, "count", NULL, NULL, NULL, NULL, NULL) == SQLITE_OK) {
+            continue;
+        }
+        
+        char sql[256];
+        char* err_msg = NULL;
+        snprintf(sql, sizeof(sql), "ALTER TABLE %s ADD COLUMN count INTEGER NOT NULL DEFAULT 1;", table);
+        if (sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+            LOG_ERROR("Failed to add event counts to %s: %s", table, err_msg);
+            sqlite3_free(err_msg);
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
 // Create database schema
 int database_create_schema(database_context_t* ctx) {
     if (!ctx || !ctx->db) return -1;
@@ -234,16 +754,47 @@ int database_create_schema(database_context_t* ctx) {
         return -1;
     }
     
-    // Create triggers
-    rc = sqlite3_exec(ctx->db, DATABASE_TRIGGERS_SQL, NULL, NULL, &err_msg);
+    // Retention is a background sweep now, not a trigger per insert
+    rc = sqlite3_exec(ctx->db, DATABASE_DROP_TRIGGERS_SQL, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
-        LOG_ERROR("Failed to create triggers: %s", err_msg);
+        LOG_ERROR("Failed to drop cleanup triggers: %s", err_msg);
         sqlite3_free(err_msg);
         return -1;
     }
     
+    // Rows of the schema 1 tables are left to the retention sweep
+    ctx->legacy_metrics = sqlite3_table_column_metadata(ctx->db, NULL, "metrics", "timestamp",
+                                                        NULL, NULL, NULL, NULL, NULL) == SQLITE_OK;
+    ctx->legacy_events = sqlite3_table_column_metadata(ctx->db, NULL, "events", "timestamp",
+                                                       NULL, NULL, NULL, NULL, NULL) == SQLITE_OK;
+    
+    // Event tables of schema 5 and before lack the summary count
+    if (database_add_event_counts(ctx) != 0) {
+        return -1;
+    }
+    
+    // Create rollup tables, filling them from existing metrics the first time.
+    // Schema 6 rollups kept sums of squares and are rebuilt.
+    bool backfill = sqlite3_table_column_metadata(ctx->db, NULL, DATABASE_ROLLUP_TABLES[DATABASE_ROLLUP_HOUR],
+                                                  "m2", NULL, NULL, NULL, NULL, NULL) != SQLITE_OK;
+    for (int res = 0; res < DATABASE_ROLLUP_COUNT; res++) {
+        char sql[1024];
+        int length = backfill ? snprintf(sql, sizeof(sql), "DROP TABLE IF EXISTS %s;", DATABASE_ROLLUP_TABLES[res]) : 0;
+        snprintf(sql + length, sizeof(sql) - length, DATABASE_ROLLUP_TABLE_SQL, DATABASE_ROLLUP_TABLES[res]);
+        rc = sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("Failed to create rollup table: %s", err_msg);
+            sqlite3_free(err_msg);
+            return -1;
+        }
+    }
+    
+    if (backfill && database_backfill_rollups(ctx) != 0) {
+        return -1;
+    }
+    
     // Insert schema version
-    const char* version_sql = "INSERT OR REPLACE INTO schema_version (version) VALUES (1);";
+    const char* version_sql = "INSERT OR REPLACE INTO schema_version (version) VALUES (7);";
     rc = sqlite3_exec(ctx->db, version_sql, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         LOG_ERROR("Failed to set schema version: %s", err_msg);
@@ -259,23 +810,14 @@ int database_create_schema(database_context_t* ctx) {
 int database_prepare_statements(database_context_t* ctx) {
     if (!ctx || !ctx->db) return -1;
     
-    // Prepare insert metric statement
-    const char* insert_metric_sql = 
-        "INSERT INTO metrics (metric_type, value, node_id, cell_id, timestamp) "
-        "VALUES (?, ?, ?, ?, ?);";
-    
-    int rc = sqlite3_prepare_v2(ctx->db, insert_metric_sql, -1, &ctx->insert_metric_stmt, NULL);
-    if (rc != SQLITE_OK) {
-        LOG_ERROR("Failed to prepare insert metric statement: %s", sqlite3_errmsg(ctx->db));
-        return -1;
-    }
+    // Metric and event inserts are prepared per day partition on first use
     
     // Prepare insert anomaly statement
     const char* insert_anomaly_sql = 
         "INSERT INTO anomalies (metric_type, severity, threshold_value, actual_value, confidence, detected_at, description) "
         "VALUES (?, ?, ?, ?, ?, ?, ?);";
     
-    rc = sqlite3_prepare_v2(ctx->db, insert_anomaly_sql, -1, &ctx->insert_anomaly_stmt, NULL);
+    int rc = sqlite3_prepare_v2(ctx->db, insert_anomaly_sql, -1, &ctx->insert_anomaly_stmt, NULL);
     if (rc != SQLITE_OK) {
         LOG_ERROR("Failed to prepare insert anomaly statement: %s", sqlite3_errmsg(ctx->db));
         return -1;
@@ -292,30 +834,54 @@ int database_prepare_statements(database_context_t* ctx) {
         return -1;
     }
     
-    // Prepare insert event statement
-    const char* insert_event_sql = 
-        "INSERT INTO events (event_type, node_id, subscription_id, timestamp, message, details) "
-        "VALUES (?, ?, ?, ?, ?, ?);";
+    // Prepare rollup statements
+    for (int res = 0; res < DATABASE_ROLLUP_COUNT; res++) {
+        char sql[1024];
+        snprintf(sql, sizeof(sql), DATABASE_ROLLUP_INSERT_SQL, DATABASE_ROLLUP_TABLES[res]);
+        rc = sqlite3_prepare_v2(ctx->db, sql, -1, &ctx->upsert_rollup_stmts[res], NULL);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("Failed to prepare rollup statements: %s", sqlite3_errmsg(ctx->db));
+            return -1;
+        }
+    }
     
-    rc = sqlite3_prepare_v2(ctx->db, insert_event_sql, -1, &ctx->insert_event_stmt, NULL);
+    // Prepare compressed block statements
+    const char* insert_block_sql =
+        "INSERT INTO metric_blocks (metric_type, node_id, cell_id, start_time, end_time, sample_count, min_value, max_value, data) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9);";
+    const char* update_block_sql =
+        "UPDATE metric_blocks SET end_time = ?5, sample_count = ?6, min_value = ?7, max_value = ?8, data = ?9 "
+        "WHERE block_id = ?10;";
+    
+    rc = sqlite3_prepare_v2(ctx->db, insert_block_sql, -1, &ctx->insert_block_stmt, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(ctx->db, update_block_sql, -1, &ctx->update_block_stmt, NULL);
+    }
     if (rc != SQLITE_OK) {
-        LOG_ERROR("Failed to prepare insert event statement: %s", sqlite3_errmsg(ctx->db));
+        LOG_ERROR("Failed to prepare metric block statements: %s", sqlite3_errmsg(ctx->db));
         return -1;
     }
     
+    // Select statements are cached on the read connections
+    
     LOG_DEBUG("Database statements prepared successfully");
     return 0;
 }
 
+// Finalize the cached partition insert statements
+static void database_forget_partitions(database_context_t* ctx) {
+    for (int kind = 0; kind < DATABASE_PARTITION_KIND_COUNT; kind++) {
+        for (int i = 0; i < DATABASE_PARTITION_CACHE; i++) {
+            sqlite3_finalize(ctx->partition_stmts[kind][i].stmt);
+            ctx->partition_stmts[kind][i].stmt = NULL;
+        }
+    }
+}
+
 // Finalize statements
 void database_finalize_statements(database_context_t* ctx) {
     if (!ctx) return;
     
-    if (ctx->insert_metric_stmt) {
-        sqlite3_finalize(ctx->insert_metric_stmt);
-        ctx->insert_metric_stmt = NULL;
-    }
-    
     if (ctx->insert_anomaly_stmt) {
         sqlite3_finalize(ctx->insert_anomaly_stmt);
         ctx->insert_anomaly_stmt = NULL;
@@ -326,157 +892,2153 @@ void database_finalize_statements(database_context_t* ctx) {
         ctx->insert_recommendation_stmt = NULL;
     }
     
-    if (ctx->insert_event_stmt) {
-        sqlite3_finalize(ctx->insert_event_stmt);
-        ctx->insert_event_stmt = NULL;
+    sqlite3_finalize(ctx->insert_block_stmt);
+    ctx->insert_block_stmt = NULL;
+    sqlite3_finalize(ctx->update_block_stmt);
+    ctx->update_block_stmt = NULL;
+    
+    for (int res = 0; res < DATABASE_ROLLUP_COUNT; res++) {
+        sqlite3_finalize(ctx->upsert_rollup_stmts[res]);
+        ctx->upsert_rollup_stmts[res] = NULL;
     }
     
+    database_forget_partitions(ctx);
+    
     LOG_DEBUG("Database statements finalized");
 }
 
-// Insert metric
-int database_insert_metric(database_context_t* ctx, const metric_data_t* metric) {
-    if (!ctx || !ctx->db || !ctx->insert_metric_stmt || !metric) {
-        return -1;
+// Day of a timestamp, rounding toward the past
+static int64_t database_day(int64_t timestamp) {
+    int64_t day = timestamp / DATABASE_SECONDS_PER_DAY;
+    return (timestamp % DATABASE_SECONDS_PER_DAY < 0) ? day - 1 : day;
+}
+
+// Table name of a day partition, e.g. metrics_20240131
+void database_partition_name(database_partition_kind_t kind, int64_t day, char* name, size_t name_size) {
+    time_t start = (time_t)(day * DATABASE_SECONDS_PER_DAY);
+    struct tm tm;
+    gmtime_r(&start, &tm);
+    snprintf(name, name_size, "%s_%04d%02d%02d", kind == DATABASE_PARTITION_METRICS ? "metrics" : "events",
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+// Insert statement for the partition holding timestamp, creating the
+// partition on first use
+static sqlite3_stmt* database_partition_stmt(database_context_t* ctx, database_partition_kind_t kind, int64_t timestamp) {
+    int64_t day = database_day(timestamp);
+    database_partition_stmt_t* cache = ctx->partition_stmts[kind];
+    
+    for (int i = 0; i < DATABASE_PARTITION_CACHE; i++) {
+        if (cache[i].stmt && cache[i].day == day) {
+            return cache[i].stmt;
+        }
     }
     
-    // Bind parameters
-    sqlite3_bind_int(ctx->insert_metric_stmt, 1, metric->type);
-    sqlite3_bind_double(ctx->insert_metric_stmt, 2, metric->value);
-    sqlite3_bind_int(ctx->insert_metric_stmt, 3, metric->node_id);
-    sqlite3_bind_int(ctx->insert_metric_stmt, 4, metric->cell_id);
-    sqlite3_bind_int64(ctx->insert_metric_stmt, 5, metric->timestamp);
+    char name[64];
+    database_partition_name(kind, day, name, sizeof(name));
     
-    // Execute statement
-    int rc = sqlite3_step(ctx->insert_metric_stmt);
+    char sql[1024];
+    snprintf(sql, sizeof(sql),
+             kind == DATABASE_PARTITION_METRICS ? DATABASE_METRIC_PARTITION_SQL : DATABASE_EVENT_PARTITION_SQL,
+             name, (int)kind, (long long)day);
     
-    // Reset statement
-    sqlite3_reset(ctx->insert_metric_stmt);
+    char* err_msg = NULL;
+    if (sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        LOG_ERROR("Failed to create partition %s: %s", name, err_msg);
+        sqlite3_free(err_msg);
+        return NULL;
+    }
     
-    if (rc != SQLITE_DONE) {
-        LOG_ERROR("Failed to insert metric: %s", sqlite3_errmsg(ctx->db));
-        ctx->total_errors++;
-        return -1;
+    if (kind == DATABASE_PARTITION_METRICS) {
+        snprintf(sql, sizeof(sql),
+                 "INSERT INTO %s (metric_type, value, node_id, cell_id, timestamp) VALUES (?, ?, ?, ?, ?);", name);
+    } else {
+        snprintf(sql, sizeof(sql),
+                 "INSERT INTO %s (event_type, node_id, subscription_id, timestamp, message, details, count) VALUES (?, ?, ?, ?, ?, ?, ?);", name);
     }
     
-    ctx->total_inserts++;
-    return 0;
+    // Replace the cache entries round robin; writes cluster on the newest days
+    database_partition_stmt_t* slot = &cache[ctx->partition_victim[kind]];
+    ctx->partition_victim[kind] = (ctx->partition_victim[kind] + 1) % DATABASE_PARTITION_CACHE;
+    sqlite3_finalize(slot->stmt);
+    slot->stmt = NULL;
+    
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, &slot->stmt, NULL) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare insert statement for %s: %s", name, sqlite3_errmsg(ctx->db));
+        slot->stmt = NULL;
+        return NULL;
+    }
+    
+    slot->day = day;
+    return slot->stmt;
 }
 
-// Insert anomaly
-int database_insert_anomaly(database_context_t* ctx, const anomaly_result_t* anomaly) {
-    if (!ctx || !ctx->db || !ctx->insert_anomaly_stmt || !anomaly) {
+// Forget the cached insert statement of a dropped partition
+static void database_forget_partition(database_context_t* ctx, database_partition_kind_t kind, int64_t day) {
+    database_partition_stmt_t* cache = ctx->partition_stmts[kind];
+    
+    for (int i = 0; i < DATABASE_PARTITION_CACHE; i++) {
+        if (cache[i].stmt && cache[i].day == day) {
+            sqlite3_finalize(cache[i].stmt);
+            cache[i].stmt = NULL;
+        }
+    }
+}
+
+// List the partitions of a kind, oldest first
+int database_list_partitions(database_context_t* ctx, database_partition_kind_t kind, int64_t* days, int max_count) {
+    if (!ctx || !ctx->db || !days || max_count <= 0) {
         return -1;
     }
     
-    // Bind parameters
-    sqlite3_bind_int(ctx->insert_anomaly_stmt, 1, anomaly->metric_type);
-    sqlite3_bind_int(ctx->insert_anomaly_stmt, 2, anomaly->severity);
-    sqlite3_bind_double(ctx->insert_anomaly_stmt, 3, anomaly->threshold_value);
-    sqlite3_bind_double(ctx->insert_anomaly_stmt, 4, anomaly->actual_value);
-    sqlite3_bind_double(ctx->insert_anomaly_stmt, 5, anomaly->confidence);
-    sqlite3_bind_int64(ctx->insert_anomaly_stmt, 6, anomaly->detected_at);
-    sqlite3_bind_text(ctx->insert_anomaly_stmt, 7, anomaly->description, -1, SQLITE_STATIC);
-    
-    // Execute statement
-    int rc = sqlite3_step(ctx->insert_anomaly_stmt);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(ctx->db, "SELECT day FROM partitions WHERE kind = ? ORDER BY day LIMIT ?;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERROR("Failed to list partitions: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
     
-    // Reset statement
-    sqlite3_reset(ctx->insert_anomaly_stmt);
+    sqlite3_bind_int(stmt, 1, kind);
+    sqlite3_bind_int(stmt, 2, max_count);
     
-    if (rc != SQLITE_DONE) {
-        LOG_ERROR("Failed to insert anomaly: %s", sqlite3_errmsg(ctx->db));
-        ctx->total_errors++;
-        return -1;
+    int count = 0;
+    while (count < max_count && sqlite3_step(stmt) == SQLITE_ROW) {
+        days[count++] = sqlite3_column_int64(stmt, 0);
     }
     
-    ctx->total_inserts++;
-    return 0;
+    sqlite3_finalize(stmt);
+    return count;
 }
 
-// Insert recommendation
-int database_insert_recommendation(database_context_t* ctx, const recommendation_result_t* recommendation) {
-    if (!ctx || !ctx->db || !ctx->insert_recommendation_stmt || !recommendation) {
-        return -1;
+// Start of the bucket holding timestamp
+static int64_t database_rollup_bucket(int64_t timestamp, int resolution) {
+    int64_t width = DATABASE_ROLLUP_WIDTHS[resolution];
+    return timestamp - ((timestamp % width) + width) % width;
+}
+
+// Write every pending rollup bucket back and empty the table
+static int database_flush_rollups(database_context_t* ctx) {
+    int result = 0;
+    
+    for (int i = 0; ctx->rollup_count > 0 && i < DATABASE_ROLLUP_SLOTS; i++) {
+        database_rollup_t* rollup = &ctx->rollups[i];
+        if (!rollup->used) continue;
+        
+        sqlite3_stmt* stmt = ctx->upsert_rollup_stmts[rollup->resolution];
+        sqlite3_bind_int(stmt, 1, rollup->metric_type);
+        sqlite3_bind_int64(stmt, 2, rollup->node_id);
+        sqlite3_bind_int64(stmt, 3, rollup->bucket);
+        sqlite3_bind_int64(stmt, 4, rollup->cell_id);
+        sqlite3_bind_int64(stmt, 5, rollup->count);
+        sqlite3_bind_double(stmt, 6, rollup->shift * rollup->count + rollup->sum);
+        sqlite3_bind_double(stmt, 7, MAX(0.0, rollup->sum_sq - rollup->sum * rollup->sum / rollup->count));
+        sqlite3_bind_double(stmt, 8, rollup->min);
+        sqlite3_bind_double(stmt, 9, rollup->max);
+        
+        int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("Failed to write rollup: %s", sqlite3_errmsg(ctx->db));
+            result = -1;
+        } else {
+            ctx->rollup_writes++;
+        }
+        
+        rollup->used = false;
+        ctx->rollup_count--;
+    }
+    
+    return result;
+}
+
+// Drop pending rollups of a transaction that is rolled back
+static void database_discard_rollups(database_context_t* ctx) {
+    if (ctx->rollup_count == 0) return;
+    
+    for (int i = 0; i < DATABASE_ROLLUP_SLOTS; i++) {
+        ctx->rollups[i].used = false;
+    }
+    ctx->rollup_count = 0;
+}
+
+// Fold a metric into its second, minute and hour buckets
+static int database_add_rollups(database_context_t* ctx, const metric_data_t* metric) {
+    // Keep probe chains short; flushing early only costs extra upserts
+    if (ctx->rollup_count + DATABASE_ROLLUP_COUNT > DATABASE_ROLLUP_SLOTS * 3 / 4 &&
+        database_flush_rollups(ctx) != 0) {
+        return -1;
+    }
+    
+    for (int res = 0; res < DATABASE_ROLLUP_COUNT; res++) {
+        int64_t bucket = database_rollup_bucket(metric->timestamp, res);
+        
+        uint64_t key = ((uint64_t)metric->node_id << 32 | metric->cell_id) * 0x9E3779B97F4A7C15ULL;
+        key ^= ((uint64_t)bucket * 31 + (uint64_t)metric->type * 7 + (uint64_t)res) * 0xC2B2AE3D27D4EB4FULL;
+        size_t index = (size_t)(key >> 32) & (DATABASE_ROLLUP_SLOTS - 1);
+        
+        database_rollup_t* rollup = &ctx->rollups[index];
+        while (rollup->used && !(rollup->bucket == bucket && rollup->resolution == res &&
+                                 rollup->metric_type == (int)metric->type && rollup->node_id == metric->node_id &&
+                                 rollup->cell_id == metric->cell_id)) {
+            index = (index + 1) & (DATABASE_ROLLUP_SLOTS - 1);
+            rollup = &ctx->rollups[index];
+        }
+        
+        if (!rollup->used) {
+            *rollup = (database_rollup_t){
+                .used = true,
+                .resolution = res,
+                .metric_type = metric->type,
+                .node_id = metric->node_id,
+                .cell_id = metric->cell_id,
+                .bucket = bucket,
+                .shift = metric->value,
+                .min = metric->value,
+                .max = metric->value
+            };
+            ctx->rollup_count++;
+        }
+        
+        double deviation = metric->value - rollup->shift;
+        rollup->count++;
+        rollup->sum += deviation;
+        rollup->sum_sq += deviation * deviation;
+        rollup->min = MIN(rollup->min, metric->value);
+        rollup->max = MAX(rollup->max, metric->value);
+    }
+    
+    return 0;
+}
+
+// Hash of a series key
+static size_t database_series_hash(int metric_type, uint32_t node_id, uint32_t cell_id) {
+    uint64_t key = ((uint64_t)node_id << 32 | cell_id) * 0x9E3779B97F4A7C15ULL;
+    key ^= (uint64_t)metric_type * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(key >> 32);
+}
+
+// Double the open block table, rehashing every block
+static int database_grow_open_blocks(database_context_t* ctx) {
+    size_t slots = ctx->open_block_slots ? ctx->open_block_slots * 2 : DATABASE_OPEN_BLOCK_SLOTS;
+    database_open_block_t** table = calloc(slots, sizeof(database_open_block_t*));
+    if (!table) {
+        LOG_ERROR("Failed to allocate %zu open block slots", slots);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < ctx->open_block_slots; i++) {
+        database_open_block_t* open = ctx->open_blocks[i];
+        if (!open) continue;
+        
+        size_t index = database_series_hash(open->metric_type, open->node_id, open->cell_id) & (slots - 1);
+        while (table[index]) {
+            index = (index + 1) & (slots - 1);
+        }
+        table[index] = open;
+    }
+    
+    free(ctx->open_blocks);
+    ctx->open_blocks = table;
+    ctx->open_block_slots = slots;
+    return 0;
+}
+
+// Open block of the metric's series, created on first use
+static database_open_block_t* database_find_open_block(database_context_t* ctx, const metric_data_t* metric) {
+    if ((ctx->open_block_count + 1) * 2 > ctx->open_block_slots && database_grow_open_blocks(ctx) != 0) {
+        return NULL;
+    }
+    
+    size_t mask = ctx->open_block_slots - 1;
+    size_t index = database_series_hash(metric->type, metric->node_id, metric->cell_id) & mask;
+    
+    database_open_block_t* open;
+    while ((open = ctx->open_blocks[index])) {
+        if (open->metric_type == (int)metric->type && open->node_id == metric->node_id &&
+            open->cell_id == metric->cell_id) {
+            return open;
+        }
+        index = (index + 1) & mask;
+    }
+    
+    open = utils_malloc_zero(sizeof(database_open_block_t));
+    if (!open) {
+        LOG_ERROR("Failed to allocate open metric block");
+        return NULL;
+    }
+    
+    open->metric_type = metric->type;
+    open->node_id = metric->node_id;
+    open->cell_id = metric->cell_id;
+    metric_block_init(&open->block);
+    
+    ctx->open_blocks[index] = open;
+    ctx->open_block_count++;
+    return open;
+}
+
+// Remember the state of a block before the open transaction changes it
+static void database_mark_block(database_context_t* ctx, database_open_block_t* open) {
+    if (open->marked) return;
+    
+    open->marked = true;
+    open->mark = open->block;
+    open->mark_block_id = open->block_id;
+    open->mark_unwritten = open->unwritten;
+    ctx->marked_block_count++;
+}
+
+// List a block holding unwritten samples
+static int database_list_dirty_block(database_context_t* ctx, database_open_block_t* open) {
+    if (open->dirty) return 0;
+    
+    if (ctx->dirty_block_count == ctx->dirty_block_capacity) {
+        size_t capacity = ctx->dirty_block_capacity ? ctx->dirty_block_capacity * 2 : DATABASE_OPEN_BLOCK_SLOTS;
+        database_open_block_t** dirty = realloc(ctx->dirty_blocks, capacity * sizeof(database_open_block_t*));
+        if (!dirty) {
+            LOG_ERROR("Failed to grow dirty block list");
+            return -1;
+        }
+        ctx->dirty_blocks = dirty;
+        ctx->dirty_block_capacity = capacity;
+    }
+    ctx->dirty_blocks[ctx->dirty_block_count++] = open;
+    open->dirty = true;
+    return 0;
+}
+
+// Write a block back to its row, inserting the row on first write
+static int database_store_block(database_context_t* ctx, database_open_block_t* open) {
+    const metric_block_t* block = &open->block;
+    database_mark_block(ctx, open);
+    sqlite3_stmt* stmt = open->block_id ? ctx->update_block_stmt : ctx->insert_block_stmt;
+    
+    sqlite3_bind_int(stmt, 1, open->metric_type);
+    sqlite3_bind_int64(stmt, 2, open->node_id);
+    sqlite3_bind_int64(stmt, 3, open->cell_id);
+    sqlite3_bind_int64(stmt, 4, block->first_time);
+    sqlite3_bind_int64(stmt, 5, block->last_time);
+    sqlite3_bind_int(stmt, 6, block->count);
+    sqlite3_bind_double(stmt, 7, block->min);
+    sqlite3_bind_double(stmt, 8, block->max);
+    sqlite3_bind_blob(stmt, 9, block->data, (int)metric_block_size(block), SQLITE_STATIC);
+    if (open->block_id) {
+        sqlite3_bind_int64(stmt, 10, open->block_id);
+    }
+    
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to write metric block: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    if (!open->block_id) {
+        open->block_id = sqlite3_last_insert_rowid(ctx->db);
+    } else if (sqlite3_changes(ctx->db) == 0) {
+        // Retention removed the row while the series was idle
+        open->block_id = 0;
+        return database_store_block(ctx, open);
+    }
+    
+    open->unwritten = 0;
+    ctx->block_writes++;
+    return 0;
+}
+
+// Unwritten samples that make a commit write an open block back
+static int database_block_flush_threshold(const database_context_t* ctx) {
+    return ctx->config.block_flush_samples > 0 ? ctx->config.block_flush_samples : INT_MAX;
+}
+
+// Write back the listed blocks holding at least min_unwritten unwritten
+// samples. The others stay listed and in memory: rewriting the whole block
+// on every commit would cost O(n^2) bytes over a block of n samples.
+static int database_flush_blocks(database_context_t* ctx, int min_unwritten) {
+    int result = 0;
+    size_t kept = 0;
+    
+    for (size_t i = 0; i < ctx->dirty_block_count; i++) {
+        database_open_block_t* open = ctx->dirty_blocks[i];
+        if (open->unwritten >= min_unwritten && database_store_block(ctx, open) != 0) {
+            result = -1;
+        }
+        
+        if (open->unwritten > 0) {
+            ctx->dirty_blocks[kept++] = open;
+        } else {
+            open->dirty = false;
+        }
+    }
+    
+    ctx->dirty_block_count = kept;
+    return result;
+}
+
+// The open transaction committed: drop what a rollback would have needed
+static void database_settle_blocks(database_context_t* ctx) {
+    for (size_t i = 0; ctx->marked_block_count > 0 && i < ctx->open_block_slots; i++) {
+        database_open_block_t* open = ctx->open_blocks[i];
+        if (!open || !open->marked) continue;
+        
+        metric_block_free(&open->sealed);
+        open->marked = false;
+        ctx->marked_block_count--;
+    }
+}
+
+// Undo the samples and writes of a rolled back transaction. Rows it wrote
+// are gone, so every block it touched returns to its state before, including
+// samples committed earlier that are still unwritten.
+static void database_discard_blocks(database_context_t* ctx) {
+    for (size_t i = 0; ctx->marked_block_count > 0 && i < ctx->open_block_slots; i++) {
+        database_open_block_t* open = ctx->open_blocks[i];
+        if (!open || !open->marked) continue;
+        
+        if (open->sealed.data) {
+            metric_block_free(&open->block);
+            open->block = open->sealed;
+            metric_block_init(&open->sealed);
+        }
+        metric_block_rewind(&open->block, &open->mark);
+        open->block_id = open->mark_block_id;
+        open->unwritten = open->mark_unwritten;
+        open->marked = false;
+        ctx->marked_block_count--;
+        
+        if (open->unwritten > 0) {
+            database_list_dirty_block(ctx, open);
+        }
+    }
+}
+
+// Append a metric to the open block of its series, sealing the block first
+// when it is full, too long, or the sample is older than its last one
+static int database_append_block(database_context_t* ctx, const metric_data_t* metric) {
+    database_open_block_t* open = database_find_open_block(ctx, metric);
+    if (!open) {
+        return -1;
+    }
+    
+    database_mark_block(ctx, open);
+    
+    metric_block_t* block = &open->block;
+    if (block->count > 0 &&
+        (block->count >= ctx->config.block_samples || metric->timestamp < block->last_time ||
+         metric->timestamp - block->first_time >= DATABASE_BLOCK_SPAN_SECONDS)) {
+        if (open->unwritten > 0 && database_store_block(ctx, open) != 0) {
+            return -1;
+        }
+        
+        // A rollback needs the samples the block held before the transaction
+        if (open->mark.count > 0 && !open->sealed.data) {
+            open->sealed = *block;
+            metric_block_init(block);
+        } else {
+            metric_block_reset(block);
+        }
+        open->block_id = 0;
+        ctx->sealed_blocks++;
+    }
+    
+    if (metric_block_append(block, metric->timestamp, metric->value) != 0) {
+        LOG_ERROR("Failed to grow metric block");
+        return -1;
+    }
+    open->unwritten++;
+    
+    return database_list_dirty_block(ctx, open);
+}
+
+// Bind and execute the insert statement of the metric's day partition
+static int database_step_metric(database_context_t* ctx, const metric_data_t* metric) {
+    if (ctx->config.metric_storage == DATABASE_METRIC_STORAGE_BLOCKS) {
+        return database_append_block(ctx, metric) == 0 ? database_add_rollups(ctx, metric) : -1;
+    }
+    
+    sqlite3_stmt* stmt = database_partition_stmt(ctx, DATABASE_PARTITION_METRICS, metric->timestamp);
+    if (!stmt) {
+        return -1;
+    }
+    
+    // Bind parameters
+    sqlite3_bind_int(stmt, 1, metric->type);
+    sqlite3_bind_double(stmt, 2, metric->value);
+    sqlite3_bind_int64(stmt, 3, metric->node_id);
+    sqlite3_bind_int64(stmt, 4, metric->cell_id);
+    sqlite3_bind_int64(stmt, 5, metric->timestamp);
+    
+    // Execute statement
+    int rc = sqlite3_step(stmt);
+    
+    // Reset statement
+    sqlite3_reset(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to insert metric: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    return database_add_rollups(ctx, metric);
+}
+
+// Queue rows for the writer; returns false if the queue is full
+static bool database_enqueue(database_context_t* ctx, circular_buffer_t* queue, const void* rows, size_t count) {
+    size_t queued = utils_circular_buffer_push_bulk(queue, rows, count);
+    
+    atomic_fetch_add_explicit(&ctx->queued_writes, queued, memory_order_relaxed);
+    if (queued < count) {
+        atomic_fetch_add_explicit(&ctx->dropped_writes, count - queued, memory_order_relaxed);
+        return false;
+    }
+    
+    return true;
+}
+
+// Retention cutoff of a partition kind: the configured retention, or a
+// pending database_cleanup_old_data request if that reaches further
+static int64_t database_retention_cutoff(const database_context_t* ctx, database_partition_kind_t kind,
+                                         int64_t now, int64_t requested) {
+    int days = (kind == DATABASE_PARTITION_METRICS) ? ctx->config.metric_retention_days
+                                                    : ctx->config.event_retention_days;
+    int64_t cutoff = (days > 0) ? now - (int64_t)days * DATABASE_SECONDS_PER_DAY : 0;
+    return MAX(cutoff, requested);
+}
+
+// Retention cutoff of a rollup resolution, 0 when kept forever. Rollups keep
+// their own retention, longer at coarser resolutions, and outlive cleanup
+// requests for raw data.
+static int64_t database_rollup_cutoff(const database_context_t* ctx, int resolution, int64_t now) {
+    const int rollup_retention_days[DATABASE_ROLLUP_COUNT] = {
+        ctx->config.metric_retention_days, DATABASE_MINUTE_ROLLUP_RETENTION_DAYS, DATABASE_HOUR_ROLLUP_RETENTION_DAYS
+    };
+    int days = rollup_retention_days[resolution];
+    return (days > 0) ? now - (int64_t)days * DATABASE_SECONDS_PER_DAY : 0;
+}
+
+// Drop the oldest partition if it lies entirely before cutoff
+static int database_drop_expired_partition(database_context_t* ctx, database_partition_kind_t kind, int64_t cutoff) {
+    int64_t day;
+    if (database_list_partitions(ctx, kind, &day, 1) != 1 || (day + 1) * DATABASE_SECONDS_PER_DAY > cutoff) {
+        return 0;
+    }
+    
+    char name[64];
+    database_partition_name(kind, day, name, sizeof(name));
+    
+    // A savepoint, so a failed drop undoes only itself
+    char sql[256];
+    snprintf(sql, sizeof(sql), "SAVEPOINT drop_partition; DROP TABLE IF EXISTS %s; "
+             "DELETE FROM partitions WHERE name = '%s'; RELEASE drop_partition;", name, name);
+    
+    char* err_msg = NULL;
+    if (sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        LOG_ERROR("Failed to drop partition %s: %s", name, err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(ctx->db, "ROLLBACK TO drop_partition; RELEASE drop_partition;", NULL, NULL, NULL);
+        return -1;
+    }
+    
+    database_forget_partition(ctx, kind, day);
+    ctx->dropped_partitions++;
+    LOG_INFO("Dropped expired partition %s", name);
+    return 1;
+}
+
+// Delete up to retention_chunk_rows rows older than cutoff, returns the count.
+// key names the columns identifying a row.
+static int database_sweep_chunk(database_context_t* ctx, const char* table, const char* key, const char* column, int64_t cutoff) {
+    char sql[512];
+    snprintf(sql, sizeof(sql), "DELETE FROM %s WHERE (%s) IN (SELECT %s FROM %s WHERE %s < ? LIMIT ?);",
+             table, key, key, table, column);
+    
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare retention sweep of %s: %s", table, sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, cutoff);
+    sqlite3_bind_int(stmt, 2, ctx->config.retention_chunk_rows);
+    
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to sweep %s: %s", table, sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    int deleted = sqlite3_changes(ctx->db);
+    ctx->swept_rows += deleted;
+    return deleted;
+}
+
+// One bounded unit of retention work: drop one expired partition or delete
+// one chunk of rows. Returns > 0 while there may be more to do.
+static int database_retention_step(database_context_t* ctx) {
+    int64_t now = time(NULL);
+    int64_t requested = atomic_load(&ctx->cleanup_cutoff);
+    int64_t cutoffs[DATABASE_PARTITION_KIND_COUNT];
+    
+    for (int kind = 0; kind < DATABASE_PARTITION_KIND_COUNT; kind++) {
+        cutoffs[kind] = database_retention_cutoff(ctx, kind, now, requested);
+        
+        int dropped = database_drop_expired_partition(ctx, kind, cutoffs[kind]);
+        if (dropped != 0) {
+            return dropped;
+        }
+    }
+    
+    // Only the partition straddling each cutoff is left to trim
+    for (int kind = 0; kind < DATABASE_PARTITION_KIND_COUNT; kind++) {
+        int64_t day;
+        if (database_list_partitions(ctx, kind, &day, 1) == 1 && day * DATABASE_SECONDS_PER_DAY < cutoffs[kind]) {
+            char name[64];
+            database_partition_name(kind, day, name, sizeof(name));
+            
+            int deleted = database_sweep_chunk(ctx, name, "rowid", "timestamp", cutoffs[kind]);
+            if (deleted != 0) {
+                return deleted;
+            }
+        }
+    }
+    
+    int deleted = 0;
+    if (ctx->legacy_metrics) {
+        deleted = database_sweep_chunk(ctx, "metrics", "rowid", "timestamp", cutoffs[DATABASE_PARTITION_METRICS]);
+    }
+    if (deleted == 0 && ctx->legacy_events) {
+        deleted = database_sweep_chunk(ctx, "events", "rowid", "timestamp", cutoffs[DATABASE_PARTITION_EVENTS]);
+    }
+    
+    // Compressed blocks go whole once their newest sample has expired
+    if (deleted == 0) {
+        deleted = database_sweep_chunk(ctx, "metric_blocks", "rowid", "end_time", cutoffs[DATABASE_PARTITION_METRICS]);
+    }
+    if (deleted == 0) {
+        deleted = database_sweep_chunk(ctx, "compacted_segments", "rowid", "compacted_at", cutoffs[DATABASE_PARTITION_METRICS]);
+    }
+    
+    for (int res = 0; deleted == 0 && res < DATABASE_ROLLUP_COUNT; res++) {
+        int64_t cutoff = database_rollup_cutoff(ctx, res, now);
+        if (cutoff <= 0) continue;
+        
+        deleted = database_sweep_chunk(ctx, DATABASE_ROLLUP_TABLES[res], "metric_type, node_id, bucket, cell_id",
+                                       "bucket", cutoff);
+    }
+    
+    // Anomalies and recommendations are only removed on request
+    if (deleted == 0 && requested > 0) {
+        deleted = database_sweep_chunk(ctx, "anomalies", "rowid", "detected_at", requested);
+    }
+    if (deleted == 0 && requested > 0) {
+        deleted = database_sweep_chunk(ctx, "recommendations", "rowid", "generated_at", requested);
+    }
+    
+    return deleted;
+}
+
+// Run a retention step when one is due. Only the thread that writes calls
+// this, and never inside a transaction: not a group, and not one the caller
+// opened, whose rows a sweep must not be mixed into.
+static void database_maybe_retain(database_context_t* ctx) {
+    uint64_t now = utils_get_timestamp_us();
+    
+    if (!sqlite3_get_autocommit(ctx->db)) {
+        return;
+    }
+    
+    if (now < ctx->next_retention_us && !atomic_load_explicit(&ctx->retention_wakeup, memory_order_relaxed)) {
+        return;
+    }
+    atomic_store(&ctx->retention_wakeup, false);
+    
+    int64_t requested = atomic_load(&ctx->cleanup_cutoff);
+    if (database_retention_step(ctx) > 0) {
+        ctx->next_retention_us = now + (uint64_t)ctx->config.retention_interval_ms * 1000;
+        return;
+    }
+    
+    ctx->next_retention_us = now + (uint64_t)DATABASE_RETENTION_IDLE_MS * 1000;
+    if (requested != 0 && atomic_compare_exchange_strong(&ctx->cleanup_cutoff, &requested, 0)) {
+        LOG_INFO("Old data cleanup completed");
+    }
+}
+
+// Insert metric
+int database_insert_metric(database_context_t* ctx, const metric_data_t* metric) {
+    return database_insert_metrics_batch(ctx, metric, 1);
+}
+
+// Insert metrics in one transaction, or queue them for the writer
+int database_insert_metrics_batch(database_context_t* ctx, const metric_data_t* metrics, int count) {
+    if (!ctx || !ctx->db || !metrics || count < 0) {
+        return -1;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire)) {
+        return database_enqueue(ctx, ctx->metric_queue, metrics, (size_t)count) ? 0 : -1;
+    }
+    
+    // Join a transaction the caller opened, otherwise run our own so the
+    // rows and their rollups commit together
+    bool own_transaction = sqlite3_get_autocommit(ctx->db);
+    if (own_transaction && database_begin_transaction(ctx) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    int rc = 0;
+    for (int i = 0; i < count && rc == 0; i++) {
+        rc = database_step_metric(ctx, &metrics[i]);
+    }
+    
+    if (rc == 0) {
+        rc = database_flush_blocks(ctx, database_block_flush_threshold(ctx));
+    }
+    
+    if (rc == 0) {
+        rc = database_flush_rollups(ctx);
+    }
+    
+    if (rc == 0 && own_transaction) {
+        rc = database_commit_transaction(ctx);
+    }
+    
+    // In a caller's transaction the samples appended so far stay, like rows
+    if (rc != 0) {
+        database_discard_rollups(ctx);
+        if (own_transaction) {
+            database_rollback_transaction(ctx);
+        }
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    ctx->total_inserts += count;
+    
+    // Retention commits on its own, so never inside the caller's transaction
+    if (own_transaction) {
+        database_maybe_retain(ctx);
+    }
+    return 0;
+}
+
+// Write back every open block holding unwritten samples
+int database_sync_blocks(database_context_t* ctx) {
+    if (!ctx || !ctx->db) {
+        return -1;
+    }
+    
+    if (ctx->dirty_block_count == 0) {
+        return 0;
+    }
+    
+    bool own_transaction = sqlite3_get_autocommit(ctx->db);
+    if (own_transaction && database_begin_transaction(ctx) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    int rc = database_flush_blocks(ctx, 1);
+    if (rc == 0 && own_transaction) {
+        rc = database_commit_transaction(ctx);
+    }
+    
+    if (rc != 0) {
+        if (own_transaction) {
+            database_rollback_transaction(ctx);
+        }
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Store the metrics of one segment log segment in one transaction, together
+// with its sequence, so a segment compacted again after a crash is skipped
+int database_compact_segment(database_context_t* ctx, uint64_t sequence, const metric_data_t* metrics, int count) {
+    if (!ctx || !ctx->db || count < 0 || (count > 0 && !metrics)) {
+        return -1;
+    }
+    
+    if (atomic_load(&ctx->writer_running)) {
+        LOG_ERROR("Segment compaction needs a database context without a writer");
+        return -1;
+    }
+    
+    if (database_begin_transaction(ctx) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(ctx->db, "SELECT 1 FROM compacted_segments WHERE sequence = ?;", -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)sequence);
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    
+    if (rc == SQLITE_ROW) {
+        database_rollback_transaction(ctx);
+        LOG_INFO("Segment %llu was already compacted", (unsigned long long)sequence);
+        return 0;
+    }
+    
+    // The segment only counts as compacted once its samples are in block rows
+    if (rc == SQLITE_DONE && database_insert_metrics_batch(ctx, metrics, count) == 0 &&
+        database_sync_blocks(ctx) == 0) {
+        rc = sqlite3_prepare_v2(ctx->db, "INSERT INTO compacted_segments (sequence, records, compacted_at) VALUES (?, ?, ?);",
+                                -1, &stmt, NULL);
+        if (rc == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)sequence);
+            sqlite3_bind_int(stmt, 2, count);
+            sqlite3_bind_int64(stmt, 3, time(NULL));
+            rc = sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+        
+        if (rc == SQLITE_DONE && database_commit_transaction(ctx) == 0) {
+            database_maybe_retain(ctx);
+            return 1;
+        }
+    }
+    
+    LOG_ERROR("Failed to compact segment %llu: %s", (unsigned long long)sequence, sqlite3_errmsg(ctx->db));
+    database_rollback_transaction(ctx);
+    ctx->total_errors++;
+    return -1;
+}
+
+// Bind and execute the insert anomaly statement
+static int database_step_anomaly(database_context_t* ctx, const anomaly_result_t* anomaly) {
+    // Bind parameters
+    sqlite3_bind_int(ctx->insert_anomaly_stmt, 1, anomaly->metric_type);
+    sqlite3_bind_int(ctx->insert_anomaly_stmt, 2, anomaly->severity);
+    sqlite3_bind_double(ctx->insert_anomaly_stmt, 3, anomaly->threshold_value);
+    sqlite3_bind_double(ctx->insert_anomaly_stmt, 4, anomaly->actual_value);
+    sqlite3_bind_double(ctx->insert_anomaly_stmt, 5, anomaly->confidence);
+    sqlite3_bind_int64(ctx->insert_anomaly_stmt, 6, anomaly->detected_at);
+    sqlite3_bind_text(ctx->insert_anomaly_stmt, 7, anomaly->description, -1, SQLITE_STATIC);
+    
+    // Execute statement
+    int rc = sqlite3_step(ctx->insert_anomaly_stmt);
+    
+    // Reset statement
+    sqlite3_reset(ctx->insert_anomaly_stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to insert anomaly: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Insert anomaly
+int database_insert_anomaly(database_context_t* ctx, const anomaly_result_t* anomaly) {
+    if (!ctx || !ctx->db || !ctx->insert_anomaly_stmt || !anomaly) {
+        return -1;
+    }
+    
+    if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire)) {
+        database_write_t record = { .kind = DATABASE_WRITE_ANOMALY, .anomaly = *anomaly };
+        return database_enqueue(ctx, ctx->record_queue, &record, 1) ? 0 : -1;
+    }
+    
+    if (database_step_anomaly(ctx, anomaly) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    ctx->total_inserts++;
+    return 0;
+}
+
+// Bind and execute the insert recommendation statement
+static int database_step_recommendation(database_context_t* ctx, const recommendation_result_t* recommendation) {
+    // Bind parameters
+    sqlite3_bind_int(ctx->insert_recommendation_stmt, 1, recommendation->type);
+    sqlite3_bind_int64(ctx->insert_recommendation_stmt, 2, recommendation->node_id);
+    sqlite3_bind_int64(ctx->insert_recommendation_stmt, 3, recommendation->cell_id);
+    sqlite3_bind_double(ctx->insert_recommendation_stmt, 4, recommendation->confidence);
+    sqlite3_bind_double(ctx->insert_recommendation_stmt, 5, recommendation->expected_improvement);
+    sqlite3_bind_int64(ctx->insert_recommendation_stmt, 6, recommendation->generated_at);
+    sqlite3_bind_text(ctx->insert_recommendation_stmt, 7, recommendation->description, -1, SQLITE_STATIC);
+    sqlite3_bind_text(ctx->insert_recommendation_stmt, 8, recommendation->parameters, -1, SQLITE_STATIC);
+    
+    // Execute statement
+    int rc = sqlite3_step(ctx->insert_recommendation_stmt);
+    
+    // Reset statement
+    sqlite3_reset(ctx->insert_recommendation_stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to insert recommendation: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Insert recommendation
+int database_insert_recommendation(database_context_t* ctx, const recommendation_result_t* recommendation) {
+    if (!ctx || !ctx->db || !ctx->insert_recommendation_stmt || !recommendation) {
+        return -1;
+    }
+    
+    if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire)) {
+        database_write_t record = { .kind = DATABASE_WRITE_RECOMMENDATION, .recommendation = *recommendation };
+        return database_enqueue(ctx, ctx->record_queue, &record, 1) ? 0 : -1;
+    }
+    
+    if (database_step_recommendation(ctx, recommendation) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    ctx->total_inserts++;
+    return 0;
+}
+
+// Bind and execute the insert statement of the event's day partition
+static int database_step_event(database_context_t* ctx, const event_data_t* event) {
+    sqlite3_stmt* stmt = database_partition_stmt(ctx, DATABASE_PARTITION_EVENTS, event->timestamp);
+    if (!stmt) {
+        return -1;
+    }
+    
+    // Bind parameters
+    sqlite3_bind_int(stmt, 1, event->type);
+    sqlite3_bind_int64(stmt, 2, event->node_id);
+    sqlite3_bind_int64(stmt, 3, event->subscription_id);
+    sqlite3_bind_int64(stmt, 4, event->timestamp);
+    sqlite3_bind_text(stmt, 5, event->message, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 6, event->details, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 7, MAX(event->count, 1u));
+    
+    // Execute statement
+    int rc = sqlite3_step(stmt);
+    
+    // Reset statement
+    sqlite3_reset(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to insert event: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Insert event
+int database_insert_event(database_context_t* ctx, const event_data_t* event) {
+    if (!ctx || !ctx->db || !event) {
+        return -1;
+    }
+    
+    if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire)) {
+        database_write_t record = { .kind = DATABASE_WRITE_EVENT, .event = *event };
+        return database_enqueue(ctx, ctx->record_queue, &record, 1) ? 0 : -1;
+    }
+    
+    if (database_step_event(ctx, event) != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    ctx->total_inserts++;
+    database_maybe_retain(ctx);
+    return 0;
+}
+
+// Write one summary row per counter and swap in the spare table, so callers
+// keep counting while the rows are written
+int database_flush_event_counters(database_context_t* ctx) {
+    if (!ctx || !ctx->event_counters) return -1;
+    
+    pthread_mutex_lock(&ctx->event_flush_lock);
+    
+    pthread_mutex_lock(&ctx->event_counter_lock);
+    database_event_counter_t* counters = ctx->event_counters;
+    int count = ctx->event_counter_count;
+    ctx->event_counters = ctx->spare_event_counters;
+    ctx->spare_event_counters = counters;
+    ctx->event_counter_count = 0;
+    atomic_store(&ctx->next_event_summary_us, utils_get_timestamp_us() + (uint64_t)ctx->config.event_summary_ms * 1000);
+    pthread_mutex_unlock(&ctx->event_counter_lock);
+    
+    int failed = 0;
+    for (int i = 0; count > 0 && i < DATABASE_EVENT_COUNTER_SLOTS; i++) {
+        database_event_counter_t* counter = &counters[i];
+        if (!counter->used) continue;
+        
+        event_data_t summary = {
+            .type = counter->type,
+            .node_id = counter->node_id,
+            .subscription_id = counter->subscription_id,
+            .timestamp = counter->last_seen,
+            .count = counter->count
+        };
+        memcpy(summary.message, counter->message, sizeof(counter->message));
+        snprintf(summary.details, sizeof(summary.details), "{\"first_seen\": %lld}", (long long)counter->first_seen);
+        
+        if (database_insert_event(ctx, &summary) != 0) {
+            failed++;
+        } else {
+            ctx->summary_rows++;
+        }
+        counter->used = false;
+        count--;
+    }
+    
+    pthread_mutex_unlock(&ctx->event_flush_lock);
+    return failed ? -1 : 0;
+}
+
+// Count one occurrence of an event; flushes when the table fills up, and
+// when the summary is due unless the writer thread takes care of it
+static int database_count_event(database_context_t* ctx, event_type_t type, uint32_t node_id,
+                                uint32_t subscription_id, const char* message) {
+    int64_t now = time(NULL);
+    
+    pthread_mutex_lock(&ctx->event_counter_lock);
+    
+    size_t mask = DATABASE_EVENT_COUNTER_SLOTS - 1;
+    size_t slot = database_series_hash(type, node_id, subscription_id) & mask;
+    database_event_counter_t* counter = &ctx->event_counters[slot];
+    while (counter->used && (counter->type != (int)type || counter->node_id != node_id ||
+                             counter->subscription_id != subscription_id)) {
+        slot = (slot + 1) & mask;
+        counter = &ctx->event_counters[slot];
+    }
+    
+    if (!counter->used) {
+        counter->used = true;
+        counter->type = type;
+        counter->node_id = node_id;
+        counter->subscription_id = subscription_id;
+        counter->count = 0;
+        counter->first_seen = now;
+        snprintf(counter->message, sizeof(counter->message), "%s", message ? message : "");
+        ctx->event_counter_count++;
+    }
+    counter->count++;
+    counter->last_seen = now;
+    bool full = ctx->event_counter_count >= DATABASE_EVENT_COUNTER_SLOTS * 3 / 4;
+    
+    pthread_mutex_unlock(&ctx->event_counter_lock);
+    atomic_fetch_add_explicit(&ctx->counted_events, 1, memory_order_relaxed);
+    
+    if (full || (!atomic_load_explicit(&ctx->writer_running, memory_order_acquire) &&
+                 utils_get_timestamp_us() >= atomic_load(&ctx->next_event_summary_us))) {
+        return database_flush_event_counters(ctx);
+    }
+    return 0;
+}
+
+// Log event
+int database_log_event(database_context_t* ctx, event_type_t type, uint32_t node_id, uint32_t subscription_id, const char* message, const char* details) {
+    if (!ctx || !ctx->db) {
+        return -1;
+    }
+    
+    if (type >= 0 && type < EVENT_TYPE_COUNT && ctx->config.event_policy[type] == DATABASE_EVENT_COUNT) {
+        return database_count_event(ctx, type, node_id, subscription_id, message);
+    }
+    
+    event_data_t event = {
+        .type = type,
+        .node_id = node_id,
+        .subscription_id = subscription_id,
+        .timestamp = time(NULL)
+    };
+    
+    // Copy message and details
+    if (message) {
+        strncpy(event.message, message, sizeof(event.message) - 1);
+    }
+    if (details) {
+        strncpy(event.details, details, sizeof(event.details) - 1);
+    }
+    
+    return database_insert_event(ctx, &event);
+}
+
+// Copy a text column into a fixed buffer
+static void database_column_text(sqlite3_stmt* stmt, int column, char* buffer, size_t buffer_size) {
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    snprintf(buffer, buffer_size, "%s", text ? (const char*)text : "");
+}
+
+// Decode the current row into slot `index` of the chunk
+static void database_cursor_decode(database_cursor_t* cursor, int index) {
+    sqlite3_stmt* stmt = cursor->stmt;
+    
+    switch (cursor->kind) {
+        case DATABASE_CURSOR_METRICS: {
+            metric_data_t* metric = &cursor->metrics[index];
+            metric->type = sqlite3_column_int(stmt, 0);
+            metric->value = sqlite3_column_double(stmt, 1);
+            metric->node_id = (uint32_t)sqlite3_column_int64(stmt, 2);
+            metric->cell_id = (uint32_t)sqlite3_column_int64(stmt, 3);
+            metric->timestamp = sqlite3_column_int64(stmt, 4);
+            break;
+        }
+        case DATABASE_CURSOR_ANOMALIES: {
+            anomaly_result_t* anomaly = &cursor->anomalies[index];
+            anomaly->metric_type = sqlite3_column_int(stmt, 0);
+            anomaly->severity = sqlite3_column_int(stmt, 1);
+            anomaly->threshold_value = sqlite3_column_double(stmt, 2);
+            anomaly->actual_value = sqlite3_column_double(stmt, 3);
+            anomaly->confidence = sqlite3_column_double(stmt, 4);
+            anomaly->detected_at = sqlite3_column_int64(stmt, 5);
+            database_column_text(stmt, 6, anomaly->description, sizeof(anomaly->description));
+            break;
+        }
+        case DATABASE_CURSOR_RECOMMENDATIONS: {
+            recommendation_result_t* recommendation = &cursor->recommendations[index];
+            recommendation->type = sqlite3_column_int(stmt, 0);
+            recommendation->node_id = (uint32_t)sqlite3_column_int64(stmt, 1);
+            recommendation->cell_id = (uint32_t)sqlite3_column_int64(stmt, 2);
+            recommendation->confidence = sqlite3_column_double(stmt, 3);
+            recommendation->expected_improvement = sqlite3_column_double(stmt, 4);
+            recommendation->generated_at = sqlite3_column_int64(stmt, 5);
+            database_column_text(stmt, 6, recommendation->description, sizeof(recommendation->description));
+            database_column_text(stmt, 7, recommendation->parameters, sizeof(recommendation->parameters));
+            break;
+        }
+        case DATABASE_CURSOR_EVENTS: {
+            event_data_t* event = &cursor->events[index];
+            event->type = sqlite3_column_int(stmt, 0);
+            event->node_id = (uint32_t)sqlite3_column_int64(stmt, 1);
+            event->subscription_id = (uint32_t)sqlite3_column_int64(stmt, 2);
+            event->timestamp = sqlite3_column_int64(stmt, 3);
+            database_column_text(stmt, 4, event->message, sizeof(event->message));
+            database_column_text(stmt, 5, event->details, sizeof(event->details));
+            event->count = (uint32_t)sqlite3_column_int64(stmt, 6);
+            break;
+        }
+    }
+}
+
+// Finish with the current statement
+static void database_cursor_release(database_cursor_t* cursor) {
+    if (!cursor->stmt) return;
+    
+    database_read_finish(cursor->reader, cursor->stmt);
+    cursor->stmt = NULL;
+}
+
+// Open the statement of the next table to read, or mark the cursor finished
+static int database_cursor_open_table(database_cursor_t* cursor) {
+    if (cursor->kind == DATABASE_CURSOR_ANOMALIES || cursor->kind == DATABASE_CURSOR_RECOMMENDATIONS) {
+        if (!cursor->base_table_pending) {
+            cursor->finished = true;
+            return 0;
+        }
+        cursor->base_table_pending = false;
+        
+        const char* sql = (cursor->kind == DATABASE_CURSOR_ANOMALIES) ? DATABASE_SELECT_ANOMALIES_SQL
+                                                                      : DATABASE_SELECT_RECOMMENDATIONS_SQL;
+        cursor->stmt = database_read_prepare(cursor->ctx, cursor->reader, sql);
+        if (!cursor->stmt) {
+            LOG_ERROR("Failed to prepare cursor statement: %s", sqlite3_errmsg(cursor->db));
+            return -1;
+        }
+    } else {
+        database_partition_kind_t kind = (cursor->kind == DATABASE_CURSOR_METRICS) ? DATABASE_PARTITION_METRICS
+                                                                                   : DATABASE_PARTITION_EVENTS;
+        char name[64];
+        if (cursor->day_index < cursor->day_count) {
+            database_partition_name(kind, cursor->days[cursor->day_index++], name, sizeof(name));
+        } else if (cursor->base_table_pending) {
+            cursor->base_table_pending = false;
+            snprintf(name, sizeof(name), "%s", kind == DATABASE_PARTITION_METRICS ? "metrics" : "events");
+        } else {
+            cursor->finished = true;
+            return 0;
+        }
+        
+        char sql[512];
+        snprintf(sql, sizeof(sql), kind == DATABASE_PARTITION_METRICS ? DATABASE_SELECT_METRICS_SQL
+                                                                      : DATABASE_SELECT_EVENTS_SQL, name);
+        cursor->stmt = database_read_prepare(cursor->ctx, cursor->reader, sql);
+        if (!cursor->stmt) {
+            LOG_ERROR("Failed to prepare cursor statement for %s: %s", name, sqlite3_errmsg(cursor->db));
+            return -1;
+        }
+    }
+    
+    sqlite3_bind_int64(cursor->stmt, 1, cursor->start_time);
+    sqlite3_bind_int64(cursor->stmt, 2, cursor->end_time);
+    sqlite3_bind_int(cursor->stmt, 3, cursor->type);
+    sqlite3_bind_int64(cursor->stmt, 4, cursor->kind == DATABASE_CURSOR_ANOMALIES ? cursor->min_severity
+                                                                                 : (int64_t)cursor->node_id);
+    sqlite3_bind_int64(cursor->stmt, 5, cursor->remaining);
+    return 0;
+}
+
+// Collect the day partitions overlapping the cursor range, newest first
+static int database_cursor_find_partitions(database_cursor_t* cursor, database_partition_kind_t kind) {
+    sqlite3_stmt* stmt = database_read_prepare(cursor->ctx, cursor->reader,
+                                               "SELECT day FROM partitions WHERE kind = ? AND day BETWEEN ? AND ? ORDER BY day DESC;");
+    if (!stmt) {
+        LOG_ERROR("Failed to list partitions: %s", sqlite3_errmsg(cursor->db));
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, kind);
+    sqlite3_bind_int64(stmt, 2, database_day(cursor->start_time));
+    sqlite3_bind_int64(stmt, 3, database_day(cursor->end_time));
+    
+    int capacity = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (cursor->day_count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            int64_t* days = realloc(cursor->days, capacity * sizeof(int64_t));
+            if (!days) {
+                database_read_finish(cursor->reader, stmt);
+                return -1;
+            }
+            cursor->days = days;
+        }
+        cursor->days[cursor->day_count++] = sqlite3_column_int64(stmt, 0);
+    }
+    
+    database_read_finish(cursor->reader, stmt);
+    return 0;
+}
+
+// Next sample time of a run
+static inline int64_t database_run_time(const database_block_run_t* run) {
+    return run->times[run->position];
+}
+
+// Restore the heap below `index` after its run moved to an older sample
+static void database_runs_sift_down(database_cursor_t* cursor, int index) {
+    database_block_run_t* runs = cursor->runs;
+    
+    for (;;) {
+        int largest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        
+        if (left < cursor->run_count && database_run_time(&runs[left]) > database_run_time(&runs[largest])) largest = left;
+        if (right < cursor->run_count && database_run_time(&runs[right]) > database_run_time(&runs[largest])) largest = right;
+        if (largest == index) return;
+        
+        database_block_run_t run = runs[index];
+        runs[index] = runs[largest];
+        runs[largest] = run;
+        index = largest;
+    }
+}
+
+// Decode the block the statement is on into a run, then step to the next block
+static int database_cursor_load_block(database_cursor_t* cursor) {
+    sqlite3_stmt* stmt = cursor->stmt;
+    int count = sqlite3_column_int(stmt, 3);
+    
+    // Runs past run_count keep their buffers for reuse
+    if (cursor->run_count == cursor->run_capacity) {
+        int capacity = cursor->run_capacity ? cursor->run_capacity * 2 : 16;
+        database_block_run_t* runs = realloc(cursor->runs, (size_t)capacity * sizeof(database_block_run_t));
+        if (!runs) return -1;
+        memset(runs + cursor->run_capacity, 0, (size_t)(capacity - cursor->run_capacity) * sizeof(database_block_run_t));
+        cursor->runs = runs;
+        cursor->run_capacity = capacity;
+    }
+    
+    database_block_run_t* run = &cursor->runs[cursor->run_count];
+    if (count > run->capacity) {
+        int64_t* times = realloc(run->times, (size_t)count * sizeof(int64_t));
+        if (times) run->times = times;
+        double* values = realloc(run->values, (size_t)count * sizeof(double));
+        if (values) run->values = values;
+        if (!times || !values) return -1;
+        run->capacity = count;
+    }
+    
+    run->metric_type = sqlite3_column_int(stmt, 0);
+    run->node_id = (uint32_t)sqlite3_column_int64(stmt, 1);
+    run->cell_id = (uint32_t)sqlite3_column_int64(stmt, 2);
+    
+    metric_block_reader_t reader;
+    metric_block_reader_init(&reader, sqlite3_column_blob(stmt, 5), (size_t)sqlite3_column_bytes(stmt, 5), count);
+    
+    int decoded = 0;
+    while (decoded < count && metric_block_read(&reader, &run->times[decoded], &run->values[decoded])) {
+        decoded++;
+    }
+    if (decoded < count) {
+        LOG_WARN("Metric block of series %d/%u/%u is truncated", run->metric_type, run->node_id, run->cell_id);
+    }
+    
+    // Samples ascend within a block; start at the newest one in range
+    run->position = decoded - 1;
+    while (run->position >= 0 && run->times[run->position] > cursor->end_time) {
+        run->position--;
+    }
+    
+    if (run->position >= 0 && database_run_time(run) >= cursor->start_time) {
+        int index = cursor->run_count++;
+        while (index > 0 && database_run_time(&cursor->runs[(index - 1) / 2]) < database_run_time(&cursor->runs[index])) {
+            database_block_run_t parent = cursor->runs[(index - 1) / 2];
+            cursor->runs[(index - 1) / 2] = cursor->runs[index];
+            cursor->runs[index] = parent;
+            index = (index - 1) / 2;
+        }
+    }
+    
+    int rc = sqlite3_step(stmt);
+    cursor->block_row_pending = (rc == SQLITE_ROW);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to read metric blocks: %s", sqlite3_errmsg(cursor->db));
+        return -1;
+    }
+    return 0;
+}
+
+// Start listing the blocks overlapping the cursor range
+static int database_cursor_open_blocks(database_cursor_t* cursor) {
+    cursor->stmt = database_read_prepare(cursor->ctx, cursor->reader, DATABASE_SELECT_BLOCKS_SQL);
+    if (!cursor->stmt) {
+        LOG_ERROR("Failed to prepare metric block cursor: %s", sqlite3_errmsg(cursor->db));
+        return -1;
+    }
+    
+    int64_t last_end = MIN(cursor->end_time, INT64_MAX - DATABASE_BLOCK_SPAN_SECONDS) + DATABASE_BLOCK_SPAN_SECONDS;
+    sqlite3_bind_int64(cursor->stmt, 1, cursor->start_time);
+    sqlite3_bind_int64(cursor->stmt, 2, cursor->end_time);
+    sqlite3_bind_int(cursor->stmt, 3, cursor->type);
+    sqlite3_bind_int64(cursor->stmt, 4, cursor->node_id);
+    sqlite3_bind_int64(cursor->stmt, 5, last_end);
+    
+    int rc = sqlite3_step(cursor->stmt);
+    cursor->from_blocks = true;
+    cursor->block_row_pending = (rc == SQLITE_ROW);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to read metric blocks: %s", sqlite3_errmsg(cursor->db));
+        return -1;
+    }
+    return 0;
+}
+
+// Merge the next chunk of samples out of the block runs, newest first
+static int database_cursor_next_blocks(database_cursor_t* cursor) {
+    cursor->count = 0;
+    
+    while (cursor->count < cursor->chunk_rows && !cursor->finished) {
+        // Blocks come newest end first: decode every one that may still hold
+        // a sample newer than the heap top
+        if (cursor->block_row_pending &&
+            (cursor->run_count == 0 || sqlite3_column_int64(cursor->stmt, 4) >= database_run_time(&cursor->runs[0]))) {
+            if (database_cursor_load_block(cursor) != 0) {
+                cursor->ctx->total_errors++;
+                return -1;
+            }
+            continue;
+        }
+        
+        if (cursor->run_count == 0) {
+            cursor->finished = true;
+            break;
+        }
+        
+        database_block_run_t* run = &cursor->runs[0];
+        metric_data_t* metric = &cursor->metrics[cursor->count++];
+        metric->type = run->metric_type;
+        metric->node_id = run->node_id;
+        metric->cell_id = run->cell_id;
+        metric->timestamp = run->times[run->position];
+        metric->value = run->values[run->position];
+        
+        if (--run->position < 0 || database_run_time(run) < cursor->start_time) {
+            // Park the spent run past the heap, keeping its buffers
+            database_block_run_t spent = *run;
+            cursor->runs[0] = cursor->runs[--cursor->run_count];
+            cursor->runs[cursor->run_count] = spent;
+        }
+        database_runs_sift_down(cursor, 0);
+        
+        if (cursor->remaining > 0 && --cursor->remaining == 0) {
+            cursor->finished = true;
+        }
+    }
+    
+    if (cursor->finished) {
+        database_cursor_release(cursor);
+    }
+    return cursor->count;
+}
+
+// Allocate a cursor and its chunk buffer
+static database_cursor_t* database_cursor_create(database_context_t* ctx, database_cursor_kind_t kind, size_t row_size,
+                                                 int64_t start_time, int64_t end_time, int limit) {
+    if (!ctx || !ctx->db) {
+        return NULL;
+    }
+    
+    database_cursor_t* cursor = utils_malloc_zero(sizeof(database_cursor_t));
+    if (!cursor) {
+        LOG_ERROR("Failed to allocate database cursor");
+        return NULL;
+    }
+    
+    cursor->ctx = ctx;
+    cursor->kind = kind;
+    cursor->type = DATABASE_ANY;
+    cursor->start_time = start_time;
+    cursor->end_time = end_time;
+    cursor->remaining = (limit < 0) ? -1 : limit;
+    cursor->finished = (limit == 0);
+    cursor->chunk_rows = MAX(1, (int)(DATABASE_CURSOR_CHUNK_BYTES / row_size));
+    cursor->rows = malloc((size_t)cursor->chunk_rows * row_size);
+    if (!cursor->rows) {
+        LOG_ERROR("Failed to allocate database cursor chunk");
+        free(cursor);
+        return NULL;
+    }
+    
+    // Read one snapshot on a connection of its own, so the scan neither
+    // waits for the writer nor sees rows committed while it runs
+    if (database_read_connection(ctx, &cursor->reader) != 0) {
+        ctx->total_errors++;
+        free(cursor->rows);
+        free(cursor);
+        return NULL;
+    }
+    cursor->db = cursor->reader ? cursor->reader->db : ctx->db;
+    database_read_begin(ctx, cursor->reader);
+    
+    ctx->total_queries++;
+    return cursor;
+}
+
+// Open a cursor over metrics of a type and node
+database_cursor_t* database_open_metric_cursor(database_context_t* ctx, int type, uint32_t node_id,
+                                               time_t start_time, time_t end_time, int limit) {
+    database_cursor_t* cursor = database_cursor_create(ctx, DATABASE_CURSOR_METRICS, sizeof(metric_data_t),
+                                                       start_time, end_time, limit);
+    if (!cursor) return NULL;
+    
+    cursor->type = type;
+    cursor->node_id = node_id;
+    
+    // Each backend reads only the samples it stored
+    if (ctx->config.metric_storage == DATABASE_METRIC_STORAGE_BLOCKS) {
+        if (database_cursor_open_blocks(cursor) != 0) {
+            database_cursor_close(cursor);
+            return NULL;
+        }
+        return cursor;
+    }
+    
+    cursor->base_table_pending = ctx->legacy_metrics;
+    
+    if (database_cursor_find_partitions(cursor, DATABASE_PARTITION_METRICS) != 0) {
+        database_cursor_close(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+// Open a cursor over anomalies of at least min_severity
+database_cursor_t* database_open_anomaly_cursor(database_context_t* ctx, anomaly_severity_t min_severity,
+                                                time_t start_time, time_t end_time, int limit) {
+    database_cursor_t* cursor = database_cursor_create(ctx, DATABASE_CURSOR_ANOMALIES, sizeof(anomaly_result_t),
+                                                       start_time, end_time, limit);
+    if (!cursor) return NULL;
+    
+    cursor->min_severity = min_severity;
+    cursor->base_table_pending = true;
+    return cursor;
+}
+
+// Open a cursor over recommendations of a type
+database_cursor_t* database_open_recommendation_cursor(database_context_t* ctx, int type,
+                                                       time_t start_time, time_t end_time, int limit) {
+    database_cursor_t* cursor = database_cursor_create(ctx, DATABASE_CURSOR_RECOMMENDATIONS, sizeof(recommendation_result_t),
+                                                       start_time, end_time, limit);
+    if (!cursor) return NULL;
+    
+    cursor->type = type;
+    cursor->base_table_pending = true;
+    return cursor;
+}
+
+// Open a cursor over events of a type
+database_cursor_t* database_open_event_cursor(database_context_t* ctx, int type,
+                                              time_t start_time, time_t end_time, int limit) {
+    database_cursor_t* cursor = database_cursor_create(ctx, DATABASE_CURSOR_EVENTS, sizeof(event_data_t),
+                                                       start_time, end_time, limit);
+    if (!cursor) return NULL;
+    
+    cursor->type = type;
+    cursor->base_table_pending = ctx->legacy_events;
+    
+    if (database_cursor_find_partitions(cursor, DATABASE_PARTITION_EVENTS) != 0) {
+        database_cursor_close(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+// Decode the next chunk of rows
+int database_cursor_next(database_cursor_t* cursor) {
+    if (!cursor) return -1;
+    
+    if (cursor->from_blocks) {
+        return database_cursor_next_blocks(cursor);
+    }
+    
+    cursor->count = 0;
+    while (cursor->count < cursor->chunk_rows && !cursor->finished) {
+        if (!cursor->stmt) {
+            if (database_cursor_open_table(cursor) != 0) {
+                cursor->ctx->total_errors++;
+                return -1;
+            }
+            continue;
+        }
+        
+        int rc = sqlite3_step(cursor->stmt);
+        if (rc == SQLITE_ROW) {
+            database_cursor_decode(cursor, cursor->count++);
+            if (cursor->remaining > 0 && --cursor->remaining == 0) {
+                cursor->finished = true;
+            }
+        } else if (rc == SQLITE_DONE) {
+            database_cursor_release(cursor);
+        } else {
+            LOG_ERROR("Failed to read cursor row: %s", sqlite3_errmsg(cursor->db));
+            cursor->ctx->total_errors++;
+            return -1;
+        }
+    }
+    
+    if (cursor->finished) {
+        database_cursor_release(cursor);
+    }
+    return cursor->count;
+}
+
+// Run a callback on every chunk, returns the number of rows read
+int64_t database_cursor_scan(database_cursor_t* cursor, database_chunk_callback_t callback, void* user_data) {
+    if (!cursor) return -1;
+    
+    int64_t total = 0;
+    int count;
+    while ((count = database_cursor_next(cursor)) > 0) {
+        total += count;
+        if (callback && callback(cursor, user_data) != 0) {
+            break;
+        }
+    }
+    
+    return (count < 0) ? -1 : total;
+}
+
+// Close a cursor
+void database_cursor_close(database_cursor_t* cursor) {
+    if (!cursor) return;
+    
+    database_cursor_release(cursor);
+    database_release_reader(cursor->ctx, cursor->reader);
+    for (int i = 0; i < cursor->run_capacity; i++) {
+        free(cursor->runs[i].times);
+        free(cursor->runs[i].values);
+    }
+    free(cursor->runs);
+    free(cursor->days);
+    free(cursor->rows);
+    free(cursor);
+}
+
+// Copy every row of a cursor into a growing array, then close the cursor
+static int database_collect(database_cursor_t* cursor, size_t row_size, void** rows, int* count, int* capacity) {
+    *rows = NULL;
+    *count = 0;
+    *capacity = 0;
+    if (!cursor) return -1;
+    
+    int chunk;
+    while ((chunk = database_cursor_next(cursor)) > 0) {
+        if (*count + chunk > *capacity) {
+            int new_capacity = MAX(*capacity * 2, *count + chunk);
+            void* grown = realloc(*rows, (size_t)new_capacity * row_size);
+            if (!grown) {
+                chunk = -1;
+                break;
+            }
+            *rows = grown;
+            *capacity = new_capacity;
+        }
+        memcpy((char*)*rows + (size_t)*count * row_size, cursor->rows, (size_t)chunk * row_size);
+        *count += chunk;
+    }
+    
+    database_cursor_close(cursor);
+    
+    if (chunk < 0) {
+        free(*rows);
+        *rows = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Collect a metric cursor into a result
+static metric_query_result_t* database_collect_metrics(database_cursor_t* cursor) {
+    metric_query_result_t* result = utils_malloc_zero(sizeof(metric_query_result_t));
+    void* rows;
+    
+    if (!result || database_collect(cursor, sizeof(metric_data_t), &rows, &result->count, &result->capacity) != 0) {
+        if (!result) database_cursor_close(cursor);
+        free(result);
+        return NULL;
+    }
+    
+    result->metrics = rows;
+    return result;
+}
+
+// Query metrics by type and node
+metric_query_result_t* database_query_metrics(database_context_t* ctx, metric_type_t type, uint32_t node_id, time_t start_time, time_t end_time) {
+    return database_collect_metrics(database_open_metric_cursor(ctx, type, node_id, start_time, end_time, -1));
+}
+
+// Query the newest metrics of a type
+metric_query_result_t* database_query_recent_metrics(database_context_t* ctx, metric_type_t type, int limit) {
+    return database_collect_metrics(database_open_metric_cursor(ctx, type, DATABASE_ANY_NODE, 0, INT64_MAX, limit));
+}
+
+// Collect an anomaly cursor into a result
+static anomaly_query_result_t* database_collect_anomalies(database_cursor_t* cursor) {
+    anomaly_query_result_t* result = utils_malloc_zero(sizeof(anomaly_query_result_t));
+    void* rows;
+    
+    if (!result || database_collect(cursor, sizeof(anomaly_result_t), &rows, &result->count, &result->capacity) != 0) {
+        if (!result) database_cursor_close(cursor);
+        free(result);
+        return NULL;
+    }
+    
+    result->anomalies = rows;
+    return result;
+}
+
+// Query anomalies of at least a severity
+anomaly_query_result_t* database_query_anomalies(database_context_t* ctx, anomaly_severity_t severity, time_t start_time, time_t end_time) {
+    return database_collect_anomalies(database_open_anomaly_cursor(ctx, severity, start_time, end_time, -1));
+}
+
+// Query the newest anomalies
+anomaly_query_result_t* database_query_recent_anomalies(database_context_t* ctx, int limit) {
+    return database_collect_anomalies(database_open_anomaly_cursor(ctx, ANOMALY_NONE, 0, INT64_MAX, limit));
+}
+
+// Collect a recommendation cursor into a result
+static recommendation_query_result_t* database_collect_recommendations(database_cursor_t* cursor) {
+    recommendation_query_result_t* result = utils_malloc_zero(sizeof(recommendation_query_result_t));
+    void* rows;
+    
+    if (!result || database_collect(cursor, sizeof(recommendation_result_t), &rows, &result->count, &result->capacity) != 0) {
+        if (!result) database_cursor_close(cursor);
+        free(result);
+        return NULL;
+    }
+    
+    result->recommendations = rows;
+    return result;
+}
+
+// Query recommendations of a type
+recommendation_query_result_t* database_query_recommendations(database_context_t* ctx, recommendation_type_t type, time_t start_time, time_t end_time) {
+    return database_collect_recommendations(database_open_recommendation_cursor(ctx, type, start_time, end_time, -1));
+}
+
+// Query the newest recommendations
+recommendation_query_result_t* database_query_recent_recommendations(database_context_t* ctx, int limit) {
+    return database_collect_recommendations(database_open_recommendation_cursor(ctx, DATABASE_ANY, 0, INT64_MAX, limit));
+}
+
+// Collect an event cursor into a result
+static event_query_result_t* database_collect_events(database_cursor_t* cursor) {
+    event_query_result_t* result = utils_malloc_zero(sizeof(event_query_result_t));
+    void* rows;
+    
+    if (!result || database_collect(cursor, sizeof(event_data_t), &rows, &result->count, &result->capacity) != 0) {
+        if (!result) database_cursor_close(cursor);
+        free(result);
+        return NULL;
+    }
+    
+    result->events = rows;
+    return result;
+}
+
+// Query events of a type
+event_query_result_t* database_query_events(database_context_t* ctx, event_type_t type, time_t start_time, time_t end_time) {
+    return database_collect_events(database_open_event_cursor(ctx, type, start_time, end_time, -1));
+}
+
+// Query the newest events
+event_query_result_t* database_query_recent_events(database_context_t* ctx, int limit) {
+    return database_collect_events(database_open_event_cursor(ctx, DATABASE_ANY, 0, INT64_MAX, limit));
+}
+
+// Free query results
+void database_free_metric_result(metric_query_result_t* result) {
+    if (!result) return;
+    free(result->metrics);
+    free(result);
+}
+
+void database_free_anomaly_result(anomaly_query_result_t* result) {
+    if (!result) return;
+    free(result->anomalies);
+    free(result);
+}
+
+void database_free_recommendation_result(recommendation_query_result_t* result) {
+    if (!result) return;
+    free(result->recommendations);
+    free(result);
+}
+
+void database_free_event_result(event_query_result_t* result) {
+    if (!result) return;
+    free(result->events);
+    free(result);
+}
+
+// Rollup totals of one bucket range
+typedef struct {
+    int64_t count;
+    double sum;
+    double m2;                    // Sum of squared deviations from the mean
+    double min;
+    double max;
+} database_rollup_totals_t;
+
+// Add the buckets in [from, to) of one resolution to totals
+static int database_read_rollups(database_context_t* ctx, database_reader_t* reader, int resolution, metric_type_t type,
+                                 uint32_t node_id, int64_t from, int64_t to, database_rollup_totals_t* totals) {
+    if (from >= to) return 0;
+    
+    char sql[512];
+    snprintf(sql, sizeof(sql), DATABASE_ROLLUP_SELECT_SQL[node_id != DATABASE_ANY_NODE], DATABASE_ROLLUP_TABLES[resolution]);
+    sqlite3* db = reader ? reader->db : ctx->db;
+    
+    sqlite3_stmt* stmt = database_read_prepare(ctx, reader, sql);
+    if (!stmt) {
+        LOG_ERROR("Failed to prepare rollup query: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, type);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, to);
+    sqlite3_bind_int64(stmt, 4, node_id);
+    
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        int64_t count = sqlite3_column_int64(stmt, 0);
+        double sum = sqlite3_column_double(stmt, 1);
+        double m2 = sqlite3_column_double(stmt, 2);
+        double min = sqlite3_column_double(stmt, 3);
+        double max = sqlite3_column_double(stmt, 4);
+        
+        if (totals->count > 0) {
+            // Chan's formula, as in the rollup upsert
+            double delta = sum / count - totals->sum / totals->count;
+            totals->m2 += m2 + delta * delta * ((double)totals->count * count / (totals->count + count));
+            totals->min = MIN(totals->min, min);
+            totals->max = MAX(totals->max, max);
+        } else {
+            totals->m2 = m2;
+            totals->min = min;
+            totals->max = max;
+        }
+        totals->count += count;
+        totals->sum += sum;
+    }
+    
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        LOG_ERROR("Failed to read rollups: %s", sqlite3_errmsg(db));
+        database_read_finish(reader, stmt);
+        return -1;
+    }
+    database_read_finish(reader, stmt);
+    return 0;
+}
+
+// Cover [from, to) with whole buckets of `resolution` and finer ones at the edges
+static int database_cover_range(database_context_t* ctx, database_reader_t* reader, int resolution, metric_type_t type,
+                                uint32_t node_id, int64_t from, int64_t to, database_rollup_totals_t* totals) {
+    if (from >= to) return 0;
+    
+    // Buckets this fine have expired there: round the edge out to the
+    // enclosing coarser buckets rather than lose its samples
+    if (resolution < DATABASE_ROLLUP_HOUR && from < database_rollup_cutoff(ctx, resolution, time(NULL))) {
+        int64_t width = DATABASE_ROLLUP_WIDTHS[resolution + 1];
+        int64_t first = database_rollup_bucket(from, resolution + 1);
+        int64_t last = database_rollup_bucket(to - 1, resolution + 1) + width;
+        return database_cover_range(ctx, reader, resolution + 1, type, node_id, first, last, totals);
+    }
+    
+    if (resolution == DATABASE_ROLLUP_SECOND) {
+        return database_read_rollups(ctx, reader, resolution, type, node_id, from, to, totals);
     }
     
-    // Bind parameters
-    sqlite3_bind_int(ctx->insert_recommendation_stmt, 1, recommendation->type);
-    sqlite3_bind_int(ctx->insert_recommendation_stmt, 2, recommendation->node_id);
-    sqlite3_bind_int(ctx->insert_recommendation_stmt, 3, recommendation->cell_id);
-    sqlite3_bind_double(ctx->insert_recommendation_stmt, 4, recommendation->confidence);
-    sqlite3_bind_double(ctx->insert_recommendation_stmt, 5, recommendation->expected_improvement);
-    sqlite3_bind_int64(ctx->insert_recommendation_stmt, 6, recommendation->generated_at);
-    sqlite3_bind_text(ctx->insert_recommendation_stmt, 7, recommendation->description, -1, SQLITE_STATIC);
-    sqlite3_bind_text(ctx->insert_recommendation_stmt, 8, recommendation->parameters, -1, SQLITE_STATIC);
+    int64_t width = DATABASE_ROLLUP_WIDTHS[resolution];
+    int64_t first = database_rollup_bucket(from, resolution);
+    if (first < from) first += width;
+    int64_t last = database_rollup_bucket(to, resolution);
     
-    // Execute statement
-    int rc = sqlite3_step(ctx->insert_recommendation_stmt);
+    if (first >= last) {
+        return database_cover_range(ctx, reader, resolution - 1, type, node_id, from, to, totals);
+    }
     
-    // Reset statement
-    sqlite3_reset(ctx->insert_recommendation_stmt);
+    if (database_read_rollups(ctx, reader, resolution, type, node_id, first, last, totals) != 0 ||
+        database_cover_range(ctx, reader, resolution - 1, type, node_id, from, first, totals) != 0 ||
+        database_cover_range(ctx, reader, resolution - 1, type, node_id, last, to, totals) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Statistics of a metric over [start_time, end_time]
+int database_get_metric_stats(database_context_t* ctx, metric_type_t type, uint32_t node_id, time_t start_time, time_t end_time, stats_result_t* stats) {
+    if (!ctx || !ctx->db || !stats || end_time < start_time) {
+        return -1;
+    }
     
-    if (rc != SQLITE_DONE) {
-        LOG_ERROR("Failed to insert recommendation: %s", sqlite3_errmsg(ctx->db));
+    memset(stats, 0, sizeof(stats_result_t));
+    ctx->total_queries++;
+    
+    // The pieces of the range are read from one snapshot
+    database_reader_t* reader;
+    if (database_read_connection(ctx, &reader) != 0) {
         ctx->total_errors++;
         return -1;
     }
+    database_read_begin(ctx, reader);
     
-    ctx->total_inserts++;
+    // Exclusive end, clamped so bucket arithmetic cannot overflow
+    int64_t end = MIN((int64_t)end_time, INT64_MAX - DATABASE_ROLLUP_WIDTHS[DATABASE_ROLLUP_HOUR]) + 1;
+    
+    database_rollup_totals_t totals = {0};
+    int rc = database_cover_range(ctx, reader, DATABASE_ROLLUP_HOUR, type, node_id, start_time, end, &totals);
+    database_release_reader(ctx, reader);
+    
+    if (rc != 0) {
+        ctx->total_errors++;
+        return -1;
+    }
+    
+    if (totals.count == 0) {
+        return -1;
+    }
+    
+    stats->mean = totals.sum / totals.count;
+    stats->variance = MAX(0.0, totals.m2 / totals.count);
+    stats->std_dev = sqrt(stats->variance);
+    stats->min = totals.min;
+    stats->max = totals.max;
     return 0;
 }
 
-// Log event
-int database_log_event(database_context_t* ctx, event_type_t type, uint32_t node_id, uint32_t subscription_id, const char* message, const char* details) {
-    if (!ctx || !ctx->db || !ctx->insert_event_stmt) {
+// Run a transaction control statement
+static int database_exec_transaction(database_context_t* ctx, const char* sql) {
+    if (!ctx || !ctx->db) return -1;
+    
+    char* err_msg = NULL;
+    int rc = sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg);
+    
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Failed to run %s %s", sql, err_msg ? err_msg : sqlite3_errmsg(ctx->db));
+        sqlite3_free(err_msg);
         return -1;
     }
     
-    event_data_t event = {
-        .type = type,
-        .node_id = node_id,
-        .subscription_id = subscription_id,
-        .timestamp = time(NULL)
-    };
+    return 0;
+}
+
+// Begin transaction
+int database_begin_transaction(database_context_t* ctx) {
+    return database_exec_transaction(ctx, "BEGIN;");
+}
+
+// Commit transaction
+int database_commit_transaction(database_context_t* ctx) {
+    if (database_exec_transaction(ctx, "COMMIT;") != 0) {
+        return -1;
+    }
+    database_settle_blocks(ctx);
+    return 0;
+}
+
+// Rollback transaction
+int database_rollback_transaction(database_context_t* ctx) {
+    if (!ctx || !ctx->db || sqlite3_get_autocommit(ctx->db)) {
+        return 0;
+    }
     
-    // Copy message and details
-    if (message) {
-        strncpy(event.message, message, sizeof(event.message) - 1);
+    // Partitions and blocks created in the transaction disappear with it
+    database_forget_partitions(ctx);
+    database_discard_blocks(ctx);
+    database_discard_rollups(ctx);
+    return database_exec_transaction(ctx, "ROLLBACK;");
+}
+
+// Execute one queued record
+static int database_step_record(database_context_t* ctx, const database_write_t* record) {
+    switch (record->kind) {
+        case DATABASE_WRITE_ANOMALY:
+            return database_step_anomaly(ctx, &record->anomaly);
+        case DATABASE_WRITE_RECOMMENDATION:
+            return database_step_recommendation(ctx, &record->recommendation);
+        case DATABASE_WRITE_EVENT:
+            return database_step_event(ctx, &record->event);
+        default:
+            return -1;
     }
-    if (details) {
-        strncpy(event.details, details, sizeof(event.details) - 1);
+}
+
+// Drain the queues into one transaction, bounded by group_commit_rows rows
+// and group_commit_ms milliseconds. Returns the number of rows taken.
+static size_t database_write_group(database_context_t* ctx) {
+    metric_data_t* metrics = ctx->metric_batch;
+    database_write_t* records = ctx->record_batch;
+    size_t row_limit = (size_t)ctx->config.group_commit_rows;
+    uint64_t deadline = utils_get_timestamp_us() + (uint64_t)ctx->config.group_commit_ms * 1000;
+    size_t rows = 0;
+    size_t written = 0;
+    bool open = false;
+    
+    while (rows < row_limit) {
+        size_t metric_count = utils_circular_buffer_pop_bulk(ctx->metric_queue, metrics, row_limit - rows);
+        size_t record_count = utils_circular_buffer_pop_bulk(ctx->record_queue, records,
+                                                             MIN(DATABASE_RECORD_BATCH, row_limit - rows - metric_count));
+        if (metric_count + record_count == 0) {
+            break;
+        }
+        
+        if (!open) {
+            // Without a transaction the rows still land, one commit each
+            open = database_begin_transaction(ctx) == 0;
+        }
+        
+        for (size_t i = 0; i < metric_count; i++) {
+            if (database_step_metric(ctx, &metrics[i]) == 0) written++;
+        }
+        for (size_t i = 0; i < record_count; i++) {
+            if (database_step_record(ctx, &records[i]) == 0) written++;
+        }
+        rows += metric_count + record_count;
+        
+        if (utils_get_timestamp_us() >= deadline) {
+            break;
+        }
     }
     
-    return database_insert_event(ctx, &event);
+    if (rows == 0) {
+        return 0;
+    }
+    
+    if (database_flush_blocks(ctx, database_block_flush_threshold(ctx)) != 0) {
+        LOG_WARN("Metric blocks of a group are incomplete");
+    }
+    
+    if (database_flush_rollups(ctx) != 0) {
+        LOG_WARN("Rollups of a group are incomplete");
+    }
+    
+    if (open && database_commit_transaction(ctx) != 0) {
+        database_rollback_transaction(ctx);
+        written = 0;
+    } else if (!open) {
+        database_settle_blocks(ctx);
+    }
+    
+    pthread_mutex_lock(&ctx->writer_lock);
+    ctx->total_inserts += written;
+    ctx->total_errors += rows - written;
+    ctx->group_commits++;
+    atomic_fetch_add_explicit(&ctx->written_rows, rows, memory_order_release);
+    pthread_cond_broadcast(&ctx->flush_cond);
+    pthread_mutex_unlock(&ctx->writer_lock);
+    
+    return rows;
 }
 
-// Insert event
-int database_insert_event(database_context_t* ctx, const event_data_t* event) {
-    if (!ctx || !ctx->db || !ctx->insert_event_stmt || !event) {
-        return -1;
+// Writer thread: commit queued rows in groups until stopped and drained
+static void* database_writer_thread(void* arg) {
+    database_context_t* ctx = (database_context_t*)arg;
+    
+    for (;;) {
+        // Read the flag before draining so rows queued before stop are written
+        bool running = atomic_load_explicit(&ctx->writer_running, memory_order_acquire);
+        
+        size_t rows = database_write_group(ctx);
+        
+        // A flush waits for the samples it covers to be in block rows
+        uint64_t sync_rows = atomic_load(&ctx->block_sync_rows);
+        uint64_t written_rows = atomic_load(&ctx->written_rows);
+        if (sync_rows > atomic_load(&ctx->block_synced_rows) && written_rows >= sync_rows) {
+            database_sync_blocks(ctx);
+            pthread_mutex_lock(&ctx->writer_lock);
+            atomic_store(&ctx->block_synced_rows, written_rows);
+            pthread_cond_broadcast(&ctx->flush_cond);
+            pthread_mutex_unlock(&ctx->writer_lock);
+        }
+        
+        database_maybe_retain(ctx);
+        if (running && utils_get_timestamp_us() >= atomic_load(&ctx->next_event_summary_us)) {
+            database_flush_event_counters(ctx);
+        }
+        if (rows > 0) {
+            continue;
+        }
+        
+        if (!running) {
+            break;
+        }
+        
+        // Idle: look again after one commit interval, or sooner on flush or stop
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)ctx->config.group_commit_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        
+        pthread_mutex_lock(&ctx->writer_lock);
+        if (atomic_load_explicit(&ctx->writer_running, memory_order_acquire) &&
+            !atomic_load(&ctx->retention_wakeup) &&
+            atomic_load(&ctx->block_sync_rows) <= atomic_load(&ctx->block_synced_rows) &&
+            utils_circular_buffer_is_empty(ctx->metric_queue) &&
+            utils_circular_buffer_is_empty(ctx->record_queue)) {
+            pthread_cond_timedwait(&ctx->writer_cond, &ctx->writer_lock, &deadline);
+        }
+        pthread_mutex_unlock(&ctx->writer_lock);
     }
     
-    // Bind parameters
-    sqlite3_bind_int(ctx->insert_event_stmt, 1, event->type);
-    sqlite3_bind_int(ctx->insert_event_stmt, 2, event->node_id);
-    sqlite3_bind_int(ctx->insert_event_stmt, 3, event->subscription_id);
-    sqlite3_bind_int64(ctx->insert_event_stmt, 4, event->timestamp);
-    sqlite3_bind_text(ctx->insert_event_stmt, 5, event->message, -1, SQLITE_STATIC);
-    sqlite3_bind_text(ctx->insert_event_stmt, 6, event->details, -1, SQLITE_STATIC);
+    return NULL;
+}
+
+// Free the writer queues and batch buffers
+static void database_free_write_queues(database_context_t* ctx) {
+    utils_circular_buffer_destroy(ctx->metric_queue);
+    utils_circular_buffer_destroy(ctx->record_queue);
+    free(ctx->metric_batch);
+    free(ctx->record_batch);
+    ctx->metric_queue = NULL;
+    ctx->record_queue = NULL;
+    ctx->metric_batch = NULL;
+    ctx->record_batch = NULL;
+}
+
+// Start the write-behind writer
+int database_start_writer(database_context_t* ctx) {
+    if (!ctx || !ctx->db || atomic_load(&ctx->writer_running)) {
+        return -1;
+    }
     
-    // Execute statement
-    int rc = sqlite3_step(ctx->insert_event_stmt);
+    if (ctx->config.group_commit_rows <= 0 || ctx->config.group_commit_ms <= 0 ||
+        ctx->config.write_queue_capacity <= 0) {
+        LOG_ERROR("Invalid group commit configuration");
+        return -1;
+    }
     
-    // Reset statement
-    sqlite3_reset(ctx->insert_event_stmt);
+    ctx->metric_queue = utils_circular_buffer_create((size_t)ctx->config.write_queue_capacity, sizeof(metric_data_t));
+    ctx->record_queue = utils_circular_buffer_create(DATABASE_RECORD_QUEUE_CAPACITY, sizeof(database_write_t));
+    ctx->metric_batch = malloc((size_t)ctx->config.group_commit_rows * sizeof(metric_data_t));
+    ctx->record_batch = malloc(DATABASE_RECORD_BATCH * sizeof(database_write_t));
+    if (!ctx->metric_queue || !ctx->record_queue || !ctx->metric_batch || !ctx->record_batch) {
+        LOG_ERROR("Failed to allocate database write queues");
+        database_free_write_queues(ctx);
+        return -1;
+    }
     
-    if (rc != SQLITE_DONE) {
-        LOG_ERROR("Failed to insert event: %s", sqlite3_errmsg(ctx->db));
-        ctx->total_errors++;
+    pthread_mutex_init(&ctx->writer_lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->writer_cond, &attr);
+    pthread_cond_init(&ctx->flush_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    
+    atomic_store(&ctx->writer_running, true);
+    int ret = pthread_create(&ctx->writer_thread, NULL, database_writer_thread, ctx);
+    if (ret != 0) {
+        LOG_ERROR("Failed to create database writer thread: %d", ret);
+        atomic_store(&ctx->writer_running, false);
+        pthread_cond_destroy(&ctx->writer_cond);
+        pthread_cond_destroy(&ctx->flush_cond);
+        pthread_mutex_destroy(&ctx->writer_lock);
+        database_free_write_queues(ctx);
         return -1;
     }
     
-    ctx->total_inserts++;
+    LOG_INFO("Database writer started (group commit %d ms / %d rows)",
+             ctx->config.group_commit_ms, ctx->config.group_commit_rows);
+    return 0;
+}
+
+// Stop the writer after it has committed everything queued
+void database_stop_writer(database_context_t* ctx) {
+    if (!ctx || !atomic_load(&ctx->writer_running)) return;
+    
+    pthread_mutex_lock(&ctx->writer_lock);
+    atomic_store(&ctx->writer_running, false);
+    pthread_cond_broadcast(&ctx->writer_cond);
+    pthread_mutex_unlock(&ctx->writer_lock);
+    
+    pthread_join(ctx->writer_thread, NULL);
+    
+    pthread_cond_destroy(&ctx->writer_cond);
+    pthread_cond_destroy(&ctx->flush_cond);
+    pthread_mutex_destroy(&ctx->writer_lock);
+    database_free_write_queues(ctx);
+    
+    LOG_INFO("Database writer stopped (%llu rows in %llu group commits, %llu dropped)",
+             (unsigned long long)atomic_load(&ctx->written_rows),
+             (unsigned long long)ctx->group_commits,
+             (unsigned long long)atomic_load(&ctx->dropped_writes));
+}
+
+// Wait until every row queued before the call is committed
+int database_flush(database_context_t* ctx) {
+    if (!ctx) return -1;
+    if (!atomic_load(&ctx->writer_running)) return 0;
+    
+    uint64_t target = atomic_load(&ctx->queued_writes);
+    bool blocks = ctx->config.metric_storage == DATABASE_METRIC_STORAGE_BLOCKS;
+    
+    pthread_mutex_lock(&ctx->writer_lock);
+    if (blocks && atomic_load(&ctx->block_sync_rows) < target) {
+        atomic_store(&ctx->block_sync_rows, target);
+    }
+    pthread_cond_signal(&ctx->writer_cond);
+    while ((atomic_load_explicit(&ctx->written_rows, memory_order_acquire) < target ||
+            (blocks && atomic_load(&ctx->block_synced_rows) < target)) &&
+           atomic_load(&ctx->writer_running)) {
+        pthread_cond_wait(&ctx->flush_cond, &ctx->writer_lock);
+    }
+    pthread_mutex_unlock(&ctx->writer_lock);
+    
     return 0;
 }
 
@@ -502,8 +3064,27 @@ void database_print_performance(const database_context_t* ctx) {
     
     LOG_INFO("Database Performance:");
     LOG_INFO("  Total Inserts: %llu", (unsigned long long)ctx->total_inserts);
-    LOG_INFO("  Total Queries: %llu", (unsigned long long)ctx->total_queries);
-    LOG_INFO("  Total Errors: %llu", (unsigned long long)ctx->total_errors);
+    LOG_INFO("  Total Queries: %llu", (unsigned long long)atomic_load(&ctx->total_queries));
+    LOG_INFO("  Total Errors: %llu", (unsigned long long)atomic_load(&ctx->total_errors));
+    LOG_INFO("  Queued Writes: %llu (dropped %llu)",
+             (unsigned long long)atomic_load(&ctx->queued_writes),
+             (unsigned long long)atomic_load(&ctx->dropped_writes));
+    LOG_INFO("  Group Commits: %llu", (unsigned long long)ctx->group_commits);
+    LOG_INFO("  Counted Events: %llu in %llu summary rows",
+             (unsigned long long)atomic_load(&ctx->counted_events), (unsigned long long)ctx->summary_rows);
+    LOG_INFO("  Completed Backups: %llu", (unsigned long long)atomic_load(&ctx->completed_backups));
+    LOG_INFO("  Read Connections: %d (waits %llu, fallbacks %llu, timeouts %llu)", ctx->reader_count,
+             (unsigned long long)atomic_load(&ctx->reader_waits),
+             (unsigned long long)atomic_load(&ctx->reader_fallbacks),
+             (unsigned long long)atomic_load(&ctx->reader_timeouts));
+    LOG_INFO("  Statement Cache: %llu hits, %llu misses",
+             (unsigned long long)atomic_load(&ctx->stmt_cache_hits),
+             (unsigned long long)atomic_load(&ctx->stmt_cache_misses));
+    LOG_INFO("  Rollup Writes: %llu", (unsigned long long)ctx->rollup_writes);
+    LOG_INFO("  Block Writes: %llu (sealed %llu)",
+             (unsigned long long)ctx->block_writes, (unsigned long long)ctx->sealed_blocks);
+    LOG_INFO("  Dropped Partitions: %llu, Swept Rows: %llu",
+             (unsigned long long)ctx->dropped_partitions, (unsigned long long)ctx->swept_rows);
     LOG_INFO("  Database Path: %s", ctx->config.database_path);
     
     // Check database size
@@ -562,29 +3143,361 @@ int database_analyze(database_context_t* ctx) {
 
 // Cleanup old data
 int database_cleanup_old_data(database_context_t* ctx, int retention_days) {
-    if (!ctx || !ctx->db) return -1;
+    if (!ctx || !ctx->db || retention_days < 0) return -1;
+    
+    atomic_store(&ctx->cleanup_cutoff, (int64_t)time(NULL) - (int64_t)retention_days * DATABASE_SECONDS_PER_DAY);
+    
+    // The writer owns the connection's writes; let it sweep between groups
+    if (atomic_load(&ctx->writer_running)) {
+        LOG_INFO("Scheduled cleanup of data older than %d days", retention_days);
+        pthread_mutex_lock(&ctx->writer_lock);
+        atomic_store(&ctx->retention_wakeup, true);
+        pthread_cond_signal(&ctx->writer_cond);
+        pthread_mutex_unlock(&ctx->writer_lock);
+        return 0;
+    }
     
     LOG_INFO("Cleaning up data older than %d days", retention_days);
     
-    time_t cutoff_time = time(NULL) - (retention_days * 24 * 60 * 60);
+    // Every partition drop and chunk commits on its own, so other
+    // connections are never locked out for the whole sweep
+    int work;
+    while ((work = database_retention_step(ctx)) > 0) {
+    }
+    atomic_store(&ctx->cleanup_cutoff, 0);
     
-    char sql[512];
-    snprintf(sql, sizeof(sql), 
-            "DELETE FROM metrics WHERE timestamp < %ld;"
-            "DELETE FROM anomalies WHERE detected_at < %ld;"
-            "DELETE FROM recommendations WHERE generated_at < %ld;"
-            "DELETE FROM events WHERE timestamp < %ld;",
-            cutoff_time, cutoff_time, cutoff_time, cutoff_time);
+    if (work < 0) {
+        LOG_ERROR("Failed to cleanup old data");
+        return -1;
+    }
     
-    char* err_msg = NULL;
-    int rc = sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg);
+    LOG_INFO("Old data cleanup completed");
+    return 0;
+}
+
+// Temporary file an online backup is written to
+static void database_backup_temp_path(const char* backup_path, char* path, size_t path_size) {
+    snprintf(path, path_size, "%s.tmp", backup_path);
+}
+
+// Close the backup connections; keep the copy only if it completed
+static int database_finish_backup(database_context_t* ctx, bool complete) {
+    int rc = sqlite3_backup_finish(ctx->backup);
+    ctx->backup = NULL;
+    
+    if (ctx->backup_snapshot) {
+        sqlite3_exec(ctx->backup_source, "COMMIT;", NULL, NULL, NULL);
+    }
+    sqlite3_close(ctx->backup_source);
+    ctx->backup_source = NULL;
+    
+    if (sqlite3_close(ctx->backup_dest) != SQLITE_OK) {
+        rc = SQLITE_ERROR;
+    }
+    ctx->backup_dest = NULL;
+    
+    char temp_path[sizeof(ctx->backup_path) + 8];
+    database_backup_temp_path(ctx->backup_path, temp_path, sizeof(temp_path));
+    
+    // Readers of backup_path see the previous backup or the complete new one
+    if (complete && rc == SQLITE_OK && rename(temp_path, ctx->backup_path) == 0) {
+        return 0;
+    }
+    
+    unlink(temp_path);
+    return -1;
+}
+
+// Backup thread: copy a few pages, then let the writer run
+static void* database_backup_thread(void* arg) {
+    database_context_t* ctx = (database_context_t*)arg;
+    
+#ifdef SCHED_IDLE
+    struct sched_param param = { .sched_priority = 0 };
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        LOG_DEBUG("Backup thread keeps the default scheduling policy");
+    }
+#endif
+    
+    int rc = SQLITE_OK;
+    while (!atomic_load(&ctx->backup_cancel)) {
+        rc = sqlite3_backup_step(ctx->backup, MAX(ctx->config.backup_step_pages, 1));
+        atomic_store(&ctx->backup_total_pages, sqlite3_backup_pagecount(ctx->backup));
+        atomic_store(&ctx->backup_remaining_pages, sqlite3_backup_remaining(ctx->backup));
+        
+        if (rc == SQLITE_DONE || (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED)) {
+            break;
+        }
+        usleep((useconds_t)ctx->config.backup_step_ms * 1000);
+    }
+    
+    if (rc != SQLITE_DONE && !atomic_load(&ctx->backup_cancel)) {
+        LOG_ERROR("Backup to %s failed: %s", ctx->backup_path, sqlite3_errstr(rc));
+    }
+    
+    int result = database_finish_backup(ctx, rc == SQLITE_DONE);
+    uint64_t finished = utils_get_timestamp_us();
+    atomic_store(&ctx->backup_finished_us, finished);
+    
+    if (result == 0) {
+        atomic_fetch_add(&ctx->completed_backups, 1);
+        LOG_INFO("Backup to %s completed: %d pages in %llu ms", ctx->backup_path,
+                 atomic_load(&ctx->backup_total_pages),
+                 (unsigned long long)(finished - atomic_load(&ctx->backup_started_us)) / 1000);
+    }
+    atomic_store(&ctx->backup_result, result);
+    return NULL;
+}
+
+// Start an online backup
+int database_start_backup(database_context_t* ctx, const char* backup_path) {
+    if (!ctx || !ctx->db || !backup_path || !backup_path[0]) return -1;
+    
+    if (ctx->backup_started) {
+        if (atomic_load(&ctx->backup_result) > 0) {
+            LOG_WARN("Backup to %s is still running", ctx->backup_path);
+            return -1;
+        }
+        database_wait_backup(ctx);
+    }
+    
+    // The copy reads through its own connection, so memory databases have none
+    if (strcmp(ctx->config.database_path, ":memory:") == 0 || strlen(backup_path) >= sizeof(ctx->backup_path)) {
+        LOG_ERROR("Cannot back up %s to %s", ctx->config.database_path, backup_path);
+        return -1;
+    }
+    
+    strncpy(ctx->backup_path, backup_path, sizeof(ctx->backup_path) - 1);
+    ctx->backup_path[sizeof(ctx->backup_path) - 1] = '\0';
+    
+    char temp_path[sizeof(ctx->backup_path) + 8];
+    database_backup_temp_path(ctx->backup_path, temp_path, sizeof(temp_path));
+    unlink(temp_path);
+    
+    int rc = sqlite3_open_v2(ctx->config.database_path, &ctx->backup_source, SQLITE_OPEN_READONLY, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_busy_timeout(ctx->backup_source, ctx->config.busy_timeout);
+        rc = sqlite3_open_v2(temp_path, &ctx->backup_dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    }
+    
+    // Under WAL one read transaction pins a snapshot for the whole copy
+    // without blocking writers; otherwise each step locks the database
+    // briefly and the copy restarts when another connection writes.
+    ctx->backup_snapshot = false;
+    if (rc == SQLITE_OK) {
+        sqlite3_stmt* stmt;
+        rc = sqlite3_prepare_v2(ctx->backup_source, "PRAGMA journal_mode;", -1, &stmt, NULL);
+        if (rc == SQLITE_OK) {
+            ctx->backup_snapshot = sqlite3_step(stmt) == SQLITE_ROW &&
+                                   sqlite3_stricmp((const char*)sqlite3_column_text(stmt, 0), "wal") == 0;
+            sqlite3_finalize(stmt);
+        }
+    }
+    if (rc == SQLITE_OK && ctx->backup_snapshot) {
+        rc = sqlite3_exec(ctx->backup_source, "BEGIN; SELECT count(*) FROM sqlite_master;", NULL, NULL, NULL);
+    }
+    
+    // The temporary file needs no journal; it is discarded unless complete
+    if (rc == SQLITE_OK) {
+        sqlite3_exec(ctx->backup_dest, "PRAGMA journal_mode=OFF;", NULL, NULL, NULL);
+        ctx->backup = sqlite3_backup_init(ctx->backup_dest, "main", ctx->backup_source, "main");
+        if (!ctx->backup) {
+            rc = sqlite3_errcode(ctx->backup_dest);
+        }
+    }
     
     if (rc != SQLITE_OK) {
-        LOG_ERROR("Failed to cleanup old data: %s", err_msg);
-        sqlite3_free(err_msg);
+        LOG_ERROR("Failed to start backup to %s: %s", ctx->backup_path,
+                  ctx->backup_dest ? sqlite3_errmsg(ctx->backup_dest) : sqlite3_errstr(rc));
+        database_finish_backup(ctx, false);
         return -1;
     }
     
-    LOG_INFO("Old data cleanup completed");
+    atomic_store(&ctx->backup_cancel, false);
+    atomic_store(&ctx->backup_result, 1);
+    atomic_store(&ctx->backup_total_pages, 0);
+    atomic_store(&ctx->backup_remaining_pages, 0);
+    atomic_store(&ctx->backup_started_us, utils_get_timestamp_us());
+    atomic_store(&ctx->backup_finished_us, 0);
+    
+    int ret = pthread_create(&ctx->backup_thread, NULL, database_backup_thread, ctx);
+    if (ret != 0) {
+        LOG_ERROR("Failed to create backup thread: %d", ret);
+        database_finish_backup(ctx, false);
+        atomic_store(&ctx->backup_result, -1);
+        return -1;
+    }
+    ctx->backup_started = true;
+    
+    LOG_INFO("Backup to %s started", ctx->backup_path);
+    return 0;
+}
+
+// Wait for the backup to finish and return its result
+int database_wait_backup(database_context_t* ctx) {
+    if (!ctx || !ctx->backup_started) return -1;
+    
+    pthread_join(ctx->backup_thread, NULL);
+    ctx->backup_started = false;
+    return atomic_load(&ctx->backup_result);
+}
+
+// Abandon the backup in progress, leaving the previous backup file in place
+void database_cancel_backup(database_context_t* ctx) {
+    if (!ctx || !ctx->backup_started) return;
+    
+    atomic_store(&ctx->backup_cancel, true);
+    if (database_wait_backup(ctx) != 0) {
+        LOG_INFO("Backup to %s cancelled", ctx->backup_path);
+    }
+}
+
+// Progress of the latest backup
+void database_get_backup_progress(database_context_t* ctx, database_backup_progress_t* progress) {
+    if (!ctx || !progress) return;
+    
+    memset(progress, 0, sizeof(database_backup_progress_t));
+    uint64_t started = atomic_load(&ctx->backup_started_us);
+    if (started == 0) {
+        progress->result = -1;
+        return;
+    }
+    
+    uint64_t finished = atomic_load(&ctx->backup_finished_us);
+    progress->result = atomic_load(&ctx->backup_result);
+    progress->running = progress->result > 0;
+    progress->total_pages = atomic_load(&ctx->backup_total_pages);
+    progress->remaining_pages = atomic_load(&ctx->backup_remaining_pages);
+    progress->elapsed_us = (finished ? finished : utils_get_timestamp_us()) - started;
+}
+
+// Back up the database and wait for the copy
+int database_backup(database_context_t* ctx, const char* backup_path) {
+    if (database_start_backup(ctx, backup_path) != 0) {
+        return -1;
+    }
+    return database_wait_backup(ctx);
+}
+
+// Check that a file is an intact database of this module
+static bool database_backup_valid(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    bool valid = false;
+    
+    if (sqlite3_prepare_v2(db, "PRAGMA quick_check;", -1, &stmt, NULL) == SQLITE_OK) {
+        valid = sqlite3_step(stmt) == SQLITE_ROW &&
+                strcmp((const char*)sqlite3_column_text(stmt, 0), "ok") == 0;
+        sqlite3_finalize(stmt);
+    }
+    
+    return valid && sqlite3_table_column_metadata(db, NULL, "schema_version", "version",
+                                                  NULL, NULL, NULL, NULL, NULL) == SQLITE_OK;
+}
+
+// Restore the database from a backup
+int database_restore(database_context_t* ctx, const char* backup_path) {
+    if (!ctx || !ctx->db || !backup_path) return -1;
+    
+    if (atomic_load(&ctx->writer_running) || ctx->backup_started ||
+        ctx->idle_reader_count != ctx->reader_count || !sqlite3_get_autocommit(ctx->db)) {
+        LOG_ERROR("Cannot restore while the database is in use");
+        return -1;
+    }
+    
+    sqlite3* source;
+    if (sqlite3_open_v2(backup_path, &source, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        !database_backup_valid(source)) {
+        LOG_ERROR("Backup %s is not a valid database: %s", backup_path, sqlite3_errmsg(source));
+        sqlite3_close(source);
+        return -1;
+    }
+    
+    LOG_INFO("Restoring database from %s", backup_path);
+    
+    // Statements, cached partitions and open blocks describe the old contents
+    database_close_readers(ctx);
+    database_finalize_statements(ctx);
+    database_forget_open_blocks(ctx);
+    
+    // The whole copy is one transaction on the destination
+    int rc = SQLITE_ERROR;
+    sqlite3_backup* backup = sqlite3_backup_init(ctx->db, "main", source, "main");
+    if (backup) {
+        rc = sqlite3_backup_step(backup, -1);
+        int finish_rc = sqlite3_backup_finish(backup);
+        if (rc == SQLITE_DONE) {
+            rc = finish_rc;
+        }
+    }
+    
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Failed to restore from %s: %s", backup_path, sqlite3_errmsg(ctx->db));
+    }
+    sqlite3_close(source);
+    
+    // Older backups are migrated like any other database
+    if (database_create_schema(ctx) != 0 || database_prepare_statements(ctx) != 0 ||
+        database_open_readers(ctx) != 0) {
+        LOG_ERROR("Failed to reopen the restored database");
+        return -1;
+    }
+    
+    if (rc != SQLITE_OK) {
+        return -1;
+    }
+    
+    LOG_INFO("Database restored from %s", backup_path);
     return 0;
-}
\ No newline at end of file
+}
+
+// Switch the journal and synchronous modes
+int database_set_journal_mode(database_context_t* ctx, const char* journal_mode, const char* synchronous) {
+    if (!ctx || !ctx->db) return -1;
+    if ((journal_mode && strlen(journal_mode) > 16) || (synchronous && strlen(synchronous) > 16)) return -1;
+    
+    if (atomic_load(&ctx->writer_running) || ctx->idle_reader_count != ctx->reader_count) {
+        LOG_ERROR("Cannot change the journal mode while the database is in use");
+        return -1;
+    }
+    
+    // Leaving WAL needs the only connection to the database
+    database_close_readers(ctx);
+    
+    int ret = 0;
+    char sql[64];
+    if (journal_mode) {
+        snprintf(sql, sizeof(sql), "PRAGMA journal_mode=%s;", journal_mode);
+        
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+            ret = -1;
+        } else {
+            // The pragma answers with the mode in effect
+            if (sqlite3_step(stmt) != SQLITE_ROW ||
+                sqlite3_stricmp((const char*)sqlite3_column_text(stmt, 0), journal_mode) != 0) {
+                ret = -1;
+            }
+            sqlite3_finalize(stmt);
+        }
+        
+        if (ret != 0) {
+            LOG_ERROR("Journal mode %s was not applied", journal_mode);
+        } else {
+            ctx->config.enable_wal = sqlite3_stricmp(journal_mode, "wal") == 0;
+        }
+    }
+    
+    if (ret == 0 && synchronous) {
+        snprintf(sql, sizeof(sql), "PRAGMA synchronous=%s;", synchronous);
+        if (sqlite3_exec(ctx->db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+            LOG_ERROR("Failed to set synchronous mode %s: %s", synchronous, sqlite3_errmsg(ctx->db));
+            ret = -1;
+        }
+    }
+    
+    if (database_open_readers(ctx) != 0) {
+        return -1;
+    }
+    
+    return ret;
+}
@@ -0,0 +1,302 @@
+/*
+ * KPM Decoder for Smart Monitor xApp
+ *
+ * E2SM-KPM indication payloads to metric batches:
+ * - Measurement ID to metric type mapping with unit scales
+ * - Whole-message validation before the first metric is emitted
+ * - In-place decoding into caller-provided metric batches
+ * - Payload writer for simulators, tests and benchmarks
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <endian.h>
+#include <math.h>
+
+#include "kpm_decoder.h"
+#include "utils.h"
+
+// Standard measurements (3GPP TS 28.552) the xApp collects
+typedef struct {
+    const char* name;
+    metric_type_t metric;
+    double scale;
+} kpm_measurement_t;
+
+static const kpm_measurement_t KPM_MEASUREMENTS[] = {
+    { "DRB.UEThpDl", METRIC_THROUGHPUT, 0.001 },         // kbit/s to Mbit/s
+    { "DRB.RlcSduDelayDl", METRIC_LATENCY, 0.1 },        // 0.1 ms steps to ms
+    { "DRB.PacketLossRateUl", METRIC_PACKET_LOSS, 1.0 },
+    { "RRU.PrbTotDl", METRIC_PRB_USAGE, 1.0 },
+    { "L1M.SS-RSRP", METRIC_RSRP, 1.0 },
+    { "L1M.SS-RSRQ", METRIC_RSRQ, 1.0 },
+    { "L1M.SS-SINR", METRIC_SINR, 1.0 }
+};
+
+#define KPM_MEASUREMENT_COUNT (int)(sizeof(KPM_MEASUREMENTS) / sizeof(KPM_MEASUREMENTS[0]))
+
+static uint16_t kpm_load_u16(const uint8_t* p) {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return le16toh(value);
+}
+
+static uint32_t kpm_load_u32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return le32toh(value);
+}
+
+static uint64_t kpm_load_u64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return le64toh(value);
+}
+
+static void kpm_store_u16(uint8_t* p, uint16_t value) {
+    value = htole16(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+static void kpm_store_u32(uint8_t* p, uint32_t value) {
+    value = htole32(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+static void kpm_store_u64(uint8_t* p, uint64_t value) {
+    value = htole64(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+// Map the standard measurements to IDs 1, 2, ...
+void kpm_decoder_init(kpm_decoder_t* decoder) {
+    if (!decoder) return;
+
+    memset(decoder->metrics, -1, sizeof(decoder->metrics));
+    for (int i = 0; i < KPM_MAX_MEAS_ID; i++) {
+        decoder->scales[i] = 1.0;
+    }
+    for (int i = 0; i < KPM_MEASUREMENT_COUNT; i++) {
+        kpm_decoder_map(decoder, (uint16_t)(i + 1), KPM_MEASUREMENTS[i].name);
+    }
+}
+
+// Assign a measurement ID to a standard measurement name
+int kpm_decoder_map(kpm_decoder_t* decoder, uint16_t meas_id, const char* meas_name) {
+    if (!decoder || !meas_name || meas_id >= KPM_MAX_MEAS_ID) return -1;
+
+    for (int i = 0; i < KPM_MEASUREMENT_COUNT; i++) {
+        if (strcmp(KPM_MEASUREMENTS[i].name, meas_name) == 0) {
+            decoder->metrics[meas_id] = (int8_t)KPM_MEASUREMENTS[i].metric;
+            decoder->scales[meas_id] = KPM_MEASUREMENTS[i].scale;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* kpm_measurement_name(int index) {
+    return index >= 0 && index < KPM_MEASUREMENT_COUNT ? KPM_MEASUREMENTS[index].name : NULL;
+}
+
+// Make the cell at reader->position current
+static void kpm_reader_enter_cell(kpm_reader_t* reader) {
+    const uint8_t* cell = reader->data + reader->position;
+
+    reader->cell_id = kpm_load_u32(cell);
+    reader->meas_count = kpm_load_u16(cell + 4);
+    reader->period_count = kpm_load_u16(cell + 6);
+    reader->meas_types = cell + KPM_CELL_HEADER_SIZE;
+    reader->records = reader->meas_types + (size_t)reader->meas_count * KPM_MEAS_TYPE_SIZE;
+    reader->period = 0;
+    reader->meas = 0;
+    reader->position += KPM_CELL_HEADER_SIZE + (size_t)reader->meas_count * KPM_MEAS_TYPE_SIZE +
+                        (size_t)reader->period_count * reader->meas_count * KPM_RECORD_SIZE;
+}
+
+// Validate a payload and position the reader at its first record
+int kpm_reader_init(kpm_reader_t* reader, const kpm_decoder_t* decoder, const void* payload, size_t size,
+                    uint32_t node_id) {
+    if (!reader || !decoder) return -1;
+
+    memset(reader, 0, sizeof(kpm_reader_t));
+    const uint8_t* data = payload;
+    if (!data || size < KPM_HEADER_SIZE || kpm_load_u32(data) != KPM_MAGIC ||
+        data[4] != KPM_VERSION || data[5] != KPM_FORMAT_MULTI_CELL) {
+        return -1;
+    }
+
+    // Walk every cell once, so decoding never meets a truncated record
+    uint16_t cell_count = kpm_load_u16(data + 6);
+    size_t position = KPM_HEADER_SIZE;
+    size_t total_records = 0;
+
+    for (uint16_t cell = 0; cell < cell_count; cell++) {
+        if (size - position < KPM_CELL_HEADER_SIZE) return -1;
+
+        size_t meas_count = kpm_load_u16(data + position + 4);
+        size_t period_count = kpm_load_u16(data + position + 6);
+        if (meas_count > KPM_MAX_MEASUREMENTS) return -1;
+
+        size_t types_size = meas_count * KPM_MEAS_TYPE_SIZE;
+        size_t records_size = period_count * meas_count * KPM_RECORD_SIZE;
+        position += KPM_CELL_HEADER_SIZE;
+        if (size - position < types_size + records_size) return -1;
+
+        for (size_t meas = 0; meas < meas_count; meas++) {
+            if (data[position + meas * KPM_MEAS_TYPE_SIZE + 2] > KPM_RECORD_REAL) return -1;
+        }
+
+        position += types_size + records_size;
+        total_records += period_count * meas_count;
+    }
+
+    if (position != size) return -1;
+
+    reader->decoder = decoder;
+    reader->data = data;
+    reader->node_id = node_id;
+    reader->start_ms = (int64_t)kpm_load_u64(data + 8);
+    reader->granularity_ms = kpm_load_u32(data + 16);
+    reader->total_records = total_records;
+    reader->position = KPM_HEADER_SIZE;
+
+    if (cell_count > 0) {
+        reader->cells_left = cell_count - 1;
+        kpm_reader_enter_cell(reader);
+    }
+    return 0;
+}
+
+// Decode the next records into metrics
+size_t kpm_reader_next(kpm_reader_t* reader, metric_data_t* metrics, size_t max_count) {
+    if (!reader || !reader->data || !metrics) return 0;
+
+    const kpm_decoder_t* decoder = reader->decoder;
+    size_t count = 0;
+
+    while (count < max_count) {
+        // Next cell once every period of this one is read
+        if (reader->period >= reader->period_count) {
+            if (reader->cells_left == 0) break;
+            reader->cells_left--;
+            kpm_reader_enter_cell(reader);
+            continue;
+        }
+
+        time_t timestamp = (time_t)((reader->start_ms + (int64_t)reader->period * reader->granularity_ms) / 1000);
+        const uint8_t* record = reader->records + ((size_t)reader->period * reader->meas_count + reader->meas) * KPM_RECORD_SIZE;
+
+        while (reader->meas < reader->meas_count && count < max_count) {
+            const uint8_t* type = reader->meas_types + (size_t)reader->meas * KPM_MEAS_TYPE_SIZE;
+            uint16_t meas_id = kpm_load_u16(type);
+            uint64_t bits = kpm_load_u64(record);
+            int metric = meas_id < KPM_MAX_MEAS_ID ? decoder->metrics[meas_id] : -1;
+
+            double value;
+            bool present;
+            if (type[2] == KPM_RECORD_INTEGER) {
+                present = (int64_t)bits != INT64_MIN;
+                value = (double)(int64_t)bits;
+            } else {
+                memcpy(&value, &bits, sizeof(value));
+                present = !isnan(value);
+            }
+
+            if (metric >= 0 && present) {
+                metrics[count++] = (metric_data_t){
+                    .type = (metric_type_t)metric, .value = value * decoder->scales[meas_id],
+                    .node_id = reader->node_id, .cell_id = reader->cell_id, .timestamp = timestamp
+                };
+            } else {
+                reader->skipped++;
+            }
+
+            reader->meas++;
+            record += KPM_RECORD_SIZE;
+        }
+
+        if (reader->meas == reader->meas_count) {
+            reader->meas = 0;
+            reader->period++;
+        }
+    }
+
+    return count;
+}
+
+// Start a payload in buffer
+void kpm_writer_init(kpm_writer_t* writer, void* buffer, size_t capacity, int64_t start_ms, uint32_t granularity_ms) {
+    if (!writer) return;
+
+    memset(writer, 0, sizeof(kpm_writer_t));
+    writer->data = buffer;
+    writer->capacity = capacity;
+
+    if (!buffer || capacity < KPM_HEADER_SIZE) {
+        writer->overflow = true;
+        return;
+    }
+
+    memset(writer->data, 0, KPM_HEADER_SIZE);
+    kpm_store_u32(writer->data, KPM_MAGIC);
+    writer->data[4] = KPM_VERSION;
+    writer->data[5] = KPM_FORMAT_MULTI_CELL;
+    kpm_store_u64(writer->data + 8, (uint64_t)start_ms);
+    kpm_store_u32(writer->data + 16, granularity_ms);
+    writer->size = KPM_HEADER_SIZE;
+}
+
+// Append one cell report
+int kpm_writer_add_cell(kpm_writer_t* writer, uint32_t cell_id, const uint16_t* meas_ids, const uint8_t* kinds,
+                        uint16_t meas_count, uint16_t period_count, const double* values) {
+    if (!writer || writer->overflow || meas_count > KPM_MAX_MEASUREMENTS || writer->cell_count == UINT16_MAX ||
+        (meas_count > 0 && (!meas_ids || !kinds)) || (meas_count > 0 && period_count > 0 && !values)) {
+        return -1;
+    }
+
+    size_t records = (size_t)period_count * meas_count;
+    size_t needed = KPM_CELL_HEADER_SIZE + (size_t)meas_count * KPM_MEAS_TYPE_SIZE + records * KPM_RECORD_SIZE;
+    if (writer->capacity - writer->size < needed) {
+        writer->overflow = true;
+        return -1;
+    }
+
+    uint8_t* p = writer->data + writer->size;
+    kpm_store_u32(p, cell_id);
+    kpm_store_u16(p + 4, meas_count);
+    kpm_store_u16(p + 6, period_count);
+    p += KPM_CELL_HEADER_SIZE;
+
+    for (uint16_t meas = 0; meas < meas_count; meas++) {
+        kpm_store_u16(p, meas_ids[meas]);
+        p[2] = kinds[meas] == KPM_RECORD_REAL ? KPM_RECORD_REAL : KPM_RECORD_INTEGER;
+        p[3] = 0;
+        p += KPM_MEAS_TYPE_SIZE;
+    }
+
+    for (size_t i = 0; i < records; i++) {
+        double value = values[i];
+        uint64_t bits;
+        if (kinds[i % meas_count] == KPM_RECORD_REAL) {
+            memcpy(&bits, &value, sizeof(bits));
+        } else {
+            bits = (uint64_t)(isnan(value) ? INT64_MIN : llround(value));
+        }
+        kpm_store_u64(p, bits);
+        p += KPM_RECORD_SIZE;
+    }
+
+    writer->size += needed;
+    writer->cell_count++;
+    return 0;
+}
+
+// Write the cell count and return the payload size
+size_t kpm_writer_finish(kpm_writer_t* writer) {
+    if (!writer || writer->overflow) return 0;
+
+    kpm_store_u16(writer->data + 6, writer->cell_count);
+    return writer->size;
+}
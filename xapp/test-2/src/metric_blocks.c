@@ -0,0 +1,316 @@
+/*
+ * Metric Blocks for Smart Monitor xApp
+ *
+ * Gorilla-style compression of one metric series:
+ * - Delta-of-delta timestamps with variable-length buckets
+ * - XOR-compressed float values reusing the previous bit window
+ * - Growable bit buffer and a sequential reader
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "metric_blocks.h"
+#include "utils.h"
+
+#define METRIC_BLOCK_INITIAL_BYTES 64
+
+// Delta-of-delta buckets: prefix, prefix length, payload bits, smallest value
+typedef struct {
+    uint64_t prefix;
+    int prefix_bits;
+    int value_bits;
+    int64_t low;
+} metric_block_bucket_t;
+
+static const metric_block_bucket_t METRIC_BLOCK_BUCKETS[] = {
+    { 0x2, 2, 7, -63 },
+    { 0x6, 3, 9, -255 },
+    { 0xE, 4, 12, -2047 }
+};
+
+#define METRIC_BLOCK_BUCKET_COUNT (int)(sizeof(METRIC_BLOCK_BUCKETS) / sizeof(METRIC_BLOCK_BUCKETS[0]))
+
+static uint64_t metric_block_value_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Append the low `count` bits of value, most significant first
+static void metric_block_put(metric_block_t* block, uint64_t value, int count) {
+    while (count > 0) {
+        int free_bits = 8 - (int)(block->bits & 7);
+        int take = MIN(count, free_bits);
+        uint8_t chunk = (uint8_t)((value >> (count - take)) & ((1u << take) - 1));
+
+        block->data[block->bits >> 3] |= (uint8_t)(chunk << (free_bits - take));
+        block->bits += take;
+        count -= take;
+    }
+}
+
+// Make room for one more sample
+static int metric_block_reserve(metric_block_t* block) {
+    size_t needed = (block->bits + METRIC_BLOCK_MAX_SAMPLE_BITS + 7) / 8;
+    if (needed <= block->capacity) {
+        return 0;
+    }
+
+    size_t capacity = MAX(block->capacity * 2, MAX(needed, (size_t)METRIC_BLOCK_INITIAL_BYTES));
+    uint8_t* data = realloc(block->data, capacity);
+    if (!data) {
+        return -1;
+    }
+
+    memset(data + block->capacity, 0, capacity - block->capacity);
+    block->data = data;
+    block->capacity = capacity;
+    return 0;
+}
+
+// Initialize an empty block
+void metric_block_init(metric_block_t* block) {
+    if (!block) return;
+
+    memset(block, 0, sizeof(metric_block_t));
+    block->leading = -1;
+}
+
+// Release the block's buffer
+void metric_block_free(metric_block_t* block) {
+    if (!block) return;
+
+    free(block->data);
+    metric_block_init(block);
+}
+
+// Empty the block, keeping its buffer
+void metric_block_reset(metric_block_t* block) {
+    if (!block) return;
+
+    if (block->data) {
+        memset(block->data, 0, (block->bits + 7) / 8);
+    }
+
+    uint8_t* data = block->data;
+    size_t capacity = block->capacity;
+    metric_block_init(block);
+    block->data = data;
+    block->capacity = capacity;
+}
+
+// Truncate the block back to the state it had when mark was copied
+void metric_block_rewind(metric_block_t* block, const metric_block_t* mark) {
+    if (!block || !mark || mark->bits > block->bits) return;
+
+    // Keep the buffer zeroed past the written bits
+    if (block->data) {
+        size_t first = mark->bits >> 3;
+        if (mark->bits & 7) {
+            block->data[first++] &= (uint8_t)(0xFF << (8 - (mark->bits & 7)));
+        }
+        memset(block->data + first, 0, (block->bits + 7) / 8 - first);
+    }
+
+    uint8_t* data = block->data;
+    size_t capacity = block->capacity;
+    *block = *mark;
+    block->data = data;
+    block->capacity = capacity;
+}
+
+// Encode one sample
+int metric_block_append(metric_block_t* block, int64_t timestamp, double value) {
+    if (!block || metric_block_reserve(block) != 0) {
+        return -1;
+    }
+
+    uint64_t value_bits = metric_block_value_bits(value);
+
+    if (block->count == 0) {
+        metric_block_put(block, (uint64_t)timestamp, 64);
+        metric_block_put(block, value_bits, 64);
+
+        block->first_time = timestamp;
+        block->last_time = timestamp;
+        block->last_value = value_bits;
+        block->min = value;
+        block->max = value;
+        block->count = 1;
+        return 0;
+    }
+
+    // Timestamp: the change of the interval, in the smallest bucket that holds it
+    int64_t delta = (int64_t)((uint64_t)timestamp - (uint64_t)block->last_time);
+    int64_t delta_of_delta = (int64_t)((uint64_t)delta - (uint64_t)block->last_delta);
+
+    if (delta_of_delta == 0) {
+        metric_block_put(block, 0, 1);
+    } else {
+        int bucket = 0;
+        while (bucket < METRIC_BLOCK_BUCKET_COUNT &&
+               (delta_of_delta < METRIC_BLOCK_BUCKETS[bucket].low ||
+                delta_of_delta - METRIC_BLOCK_BUCKETS[bucket].low >= (1LL << METRIC_BLOCK_BUCKETS[bucket].value_bits))) {
+            bucket++;
+        }
+
+        if (bucket < METRIC_BLOCK_BUCKET_COUNT) {
+            const metric_block_bucket_t* b = &METRIC_BLOCK_BUCKETS[bucket];
+            metric_block_put(block, b->prefix, b->prefix_bits);
+            metric_block_put(block, (uint64_t)(delta_of_delta - b->low), b->value_bits);
+        } else {
+            metric_block_put(block, 0xF, 4);
+            metric_block_put(block, (uint64_t)delta_of_delta, 64);
+        }
+    }
+
+    // Value: XOR with the previous one, inside the previous window if it fits
+    uint64_t xor = value_bits ^ block->last_value;
+
+    if (xor == 0) {
+        metric_block_put(block, 0, 1);
+    } else {
+        int leading = MIN(__builtin_clzll(xor), 31);
+        int trailing = __builtin_ctzll(xor);
+
+        if (block->leading >= 0 && leading >= block->leading && trailing >= block->trailing) {
+            metric_block_put(block, 0x2, 2);
+            metric_block_put(block, xor >> block->trailing, 64 - block->leading - block->trailing);
+        } else {
+            int meaningful = 64 - leading - trailing;
+            metric_block_put(block, 0x3, 2);
+            metric_block_put(block, (uint64_t)leading, 5);
+            metric_block_put(block, (uint64_t)(meaningful & 63), 6);
+            metric_block_put(block, xor >> trailing, meaningful);
+
+            block->leading = leading;
+            block->trailing = trailing;
+        }
+    }
+
+    block->last_time = timestamp;
+    block->last_delta = delta;
+    block->last_value = value_bits;
+    block->min = MIN(block->min, value);
+    block->max = MAX(block->max, value);
+    block->count++;
+    return 0;
+}
+
+// Bytes of encoded data
+size_t metric_block_size(const metric_block_t* block) {
+    return block ? (block->bits + 7) / 8 : 0;
+}
+
+// Position a reader at the first sample of encoded data
+void metric_block_reader_init(metric_block_reader_t* reader, const void* data, size_t size, int count) {
+    if (!reader) return;
+
+    memset(reader, 0, sizeof(metric_block_reader_t));
+    reader->data = data;
+    reader->size = data ? size : 0;
+    reader->remaining = count;
+    reader->leading = -1;
+}
+
+// Take the next `count` bits, false if the data ends first
+static bool metric_block_get(metric_block_reader_t* reader, int count, uint64_t* value) {
+    if (reader->position + (size_t)count > reader->size * 8) {
+        return false;
+    }
+
+    uint64_t result = 0;
+    while (count > 0) {
+        int available = 8 - (int)(reader->position & 7);
+        int take = MIN(count, available);
+        uint8_t byte = reader->data[reader->position >> 3];
+
+        result = (result << take) | ((byte >> (available - take)) & ((1u << take) - 1));
+        reader->position += take;
+        count -= take;
+    }
+
+    *value = result;
+    return true;
+}
+
+// Read the leading one bits of a prefix, at most `limit`
+static bool metric_block_get_prefix(metric_block_reader_t* reader, int limit, int* ones) {
+    *ones = 0;
+    while (*ones < limit) {
+        uint64_t bit;
+        if (!metric_block_get(reader, 1, &bit)) return false;
+        if (bit == 0) break;
+        (*ones)++;
+    }
+    return true;
+}
+
+// Decode the next sample
+bool metric_block_read(metric_block_reader_t* reader, int64_t* timestamp, double* value) {
+    if (!reader || reader->remaining <= 0) {
+        return false;
+    }
+
+    uint64_t bits;
+
+    if (!reader->started) {
+        uint64_t time_bits;
+        if (!metric_block_get(reader, 64, &time_bits) || !metric_block_get(reader, 64, &reader->value)) {
+            return false;
+        }
+        reader->time = (int64_t)time_bits;
+        reader->started = true;
+    } else {
+        // Timestamp bucket: 0, 10, 110, 1110 or 1111
+        int ones;
+        if (!metric_block_get_prefix(reader, METRIC_BLOCK_BUCKET_COUNT + 1, &ones)) {
+            return false;
+        }
+
+        int64_t delta_of_delta = 0;
+        if (ones > 0 && ones <= METRIC_BLOCK_BUCKET_COUNT) {
+            const metric_block_bucket_t* b = &METRIC_BLOCK_BUCKETS[ones - 1];
+            if (!metric_block_get(reader, b->value_bits, &bits)) return false;
+            delta_of_delta = (int64_t)bits + b->low;
+        } else if (ones > METRIC_BLOCK_BUCKET_COUNT) {
+            if (!metric_block_get(reader, 64, &bits)) return false;
+            delta_of_delta = (int64_t)bits;
+        }
+
+        reader->delta = (int64_t)((uint64_t)reader->delta + (uint64_t)delta_of_delta);
+        reader->time = (int64_t)((uint64_t)reader->time + (uint64_t)reader->delta);
+
+        // Value: 0 repeats, 10 reuses the window, 11 opens a new one
+        if (!metric_block_get_prefix(reader, 2, &ones)) {
+            return false;
+        }
+
+        if (ones == 2) {
+            uint64_t leading, meaningful;
+            if (!metric_block_get(reader, 5, &leading) || !metric_block_get(reader, 6, &meaningful)) {
+                return false;
+            }
+            if (meaningful == 0) meaningful = 64;
+            if (leading + meaningful > 64) return false;
+
+            reader->leading = (int)leading;
+            reader->trailing = 64 - (int)leading - (int)meaningful;
+        }
+
+        if (ones > 0) {
+            if (reader->leading < 0) return false;
+
+            if (!metric_block_get(reader, 64 - reader->leading - reader->trailing, &bits)) {
+                return false;
+            }
+            reader->value ^= bits << reader->trailing;
+        }
+    }
+
+    reader->remaining--;
+    *timestamp = reader->time;
+    memcpy(value, &reader->value, sizeof(double));
+    return true;
+}
@@ -0,0 +1,348 @@
+/*
+ * Registry for Smart Monitor xApp
+ *
+ * Growable maps read without locks:
+ * - Open-addressing tables of entry pointers keyed by a uint32_t
+ * - Lock-free lookups and iteration inside epoch read sections
+ * - Writers serialized by a mutex, tables grown by copy and publish
+ * - Epoch-based reclamation of removed entries and replaced tables
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include <sched.h>
+
+#include "registry.h"
+#include "utils.h"
+
+// Marks a removed entry, so probes for later keys continue past it
+static char registry_tombstone;
+#define REGISTRY_TOMBSTONE ((void*)&registry_tombstone)
+
+// Reader slot this thread tried first last time, plus one
+static _Thread_local uint32_t registry_reader_hint;
+static _Atomic uint32_t registry_next_hint;
+
+static uint32_t registry_hash(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x85EBCA6Bu;
+    key ^= key >> 13;
+    key *= 0xC2B2AE35u;
+    key ^= key >> 16;
+    return key;
+}
+
+static uint32_t registry_key(const void* entry) {
+    return *(const uint32_t*)entry;
+}
+
+// Smallest power of two holding n slots
+static uint32_t registry_round_up(size_t n) {
+    uint32_t slots = 2;
+    while (slots < n && slots < (1u << 31)) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+static registry_table_t* registry_table_create(uint32_t capacity) {
+    registry_table_t* table = malloc(sizeof(registry_table_t) + capacity * sizeof(_Atomic(void*)));
+    if (!table) return NULL;
+
+    table->mask = capacity - 1;
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(&table->slots[i], NULL);
+    }
+    return table;
+}
+
+registry_t* registry_create(void) {
+    registry_t* registry = aligned_alloc(_Alignof(registry_t), sizeof(registry_t));
+    if (!registry) {
+        LOG_ERROR("Failed to allocate registry");
+        return NULL;
+    }
+
+    memset(registry, 0, sizeof(registry_t));
+    for (int i = 0; i < REGISTRY_MAX_READERS; i++) {
+        atomic_init(&registry->readers[i].epoch, 0);
+    }
+    atomic_init(&registry->epoch, 1);
+    atomic_init(&registry->reclaimed, 0);
+    atomic_init(&registry->resizes, 0);
+    pthread_mutex_init(&registry->lock, NULL);
+    return registry;
+}
+
+void registry_destroy(registry_t* registry) {
+    if (!registry) return;
+
+    // No reader is left, so everything retired can go
+    registry_retired_t* retired = registry->retired;
+    while (retired) {
+        registry_retired_t* next = retired->next;
+        free(retired->object);
+        free(retired);
+        retired = next;
+    }
+
+    pthread_mutex_destroy(&registry->lock);
+    free(registry);
+}
+
+registry_map_t* registry_map_create(uint32_t capacity) {
+    registry_map_t* map = malloc(sizeof(registry_map_t));
+    if (!map) return NULL;
+
+    registry_table_t* table = registry_table_create(registry_round_up(capacity));
+    if (!table) {
+        free(map);
+        return NULL;
+    }
+
+    atomic_init(&map->table, table);
+    map->used = 0;
+    atomic_init(&map->count, 0);
+    return map;
+}
+
+void registry_map_destroy(registry_map_t* map) {
+    if (!map) return;
+
+    registry_table_t* table = atomic_load(&map->table);
+    for (uint32_t i = 0; i <= table->mask; i++) {
+        void* entry = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (entry && entry != REGISTRY_TOMBSTONE) {
+            free(entry);
+        }
+    }
+
+    free(table);
+    free(map);
+}
+
+// Claim a reader slot and announce the current epoch. The claim is a
+// sequentially consistent exchange, so a writer that later finds the slot
+// free has also published every unlink this section could miss.
+int registry_read_lock(registry_t* registry) {
+    if (registry_reader_hint == 0) {
+        registry_reader_hint = atomic_fetch_add(&registry_next_hint, 1) % REGISTRY_MAX_READERS + 1;
+    }
+
+    uint64_t epoch = atomic_load(&registry->epoch);
+    for (uint32_t attempt = 0;; attempt++) {
+        uint32_t slot = (registry_reader_hint - 1 + attempt) & (REGISTRY_MAX_READERS - 1);
+        uint64_t idle = 0;
+
+        if (atomic_compare_exchange_strong(&registry->readers[slot].epoch, &idle, epoch)) {
+            registry_reader_hint = slot + 1;
+            return (int)slot;
+        }
+        if ((attempt + 1) % REGISTRY_MAX_READERS == 0) {
+            sched_yield();
+            epoch = atomic_load(&registry->epoch);
+        }
+    }
+}
+
+void registry_read_unlock(registry_t* registry, int slot) {
+    atomic_store_explicit(&registry->readers[slot].epoch, 0, memory_order_release);
+}
+
+// Look up an entry by key
+void* registry_map_find(const registry_map_t* map, uint32_t key) {
+    registry_table_t* table = atomic_load_explicit(&((registry_map_t*)map)->table, memory_order_acquire);
+    uint32_t slot = registry_hash(key) & table->mask;
+
+    for (;;) {
+        void* entry = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+        if (!entry) return NULL;
+        if (entry != REGISTRY_TOMBSTONE && registry_key(entry) == key) return entry;
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+uint32_t registry_map_count(const registry_map_t* map) {
+    return atomic_load_explicit(&((registry_map_t*)map)->count, memory_order_relaxed);
+}
+
+void registry_iter_init(registry_iter_t* iter, const registry_map_t* map) {
+    iter->table = atomic_load_explicit(&((registry_map_t*)map)->table, memory_order_acquire);
+    iter->slot = 0;
+}
+
+void* registry_iter_next(registry_iter_t* iter) {
+    while (iter->slot <= iter->table->mask) {
+        void* entry = atomic_load_explicit(&iter->table->slots[iter->slot++], memory_order_acquire);
+        if (entry && entry != REGISTRY_TOMBSTONE) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Move to the next epoch if every open read section has seen this one
+static bool registry_try_advance(registry_t* registry) {
+    uint64_t epoch = atomic_load(&registry->epoch);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    for (int i = 0; i < REGISTRY_MAX_READERS; i++) {
+        uint64_t announced = atomic_load(&registry->readers[i].epoch);
+        if (announced != 0 && announced != epoch) {
+            return false;
+        }
+    }
+
+    atomic_store(&registry->epoch, epoch + 1);
+    return true;
+}
+
+// Free retired objects two epochs old. Called with lock held.
+static size_t registry_reclaim_locked(registry_t* registry) {
+    if (!registry->retired) return 0;
+
+    // Twice, so nothing waits for the next write when no reader is open
+    if (registry_try_advance(registry)) {
+        registry_try_advance(registry);
+    }
+
+    uint64_t epoch = atomic_load(&registry->epoch);
+    registry_retired_t** link = &registry->retired;
+    while (*link && (*link)->epoch + 2 > epoch) {
+        link = &(*link)->next;
+    }
+
+    // The list is newest first, so everything from here on is old enough
+    size_t freed = 0;
+    registry_retired_t* retired = *link;
+    *link = NULL;
+    while (retired) {
+        registry_retired_t* next = retired->next;
+        free(retired->object);
+        free(retired);
+        retired = next;
+        freed++;
+    }
+
+    registry->retired_count -= freed;
+    atomic_fetch_add_explicit(&registry->reclaimed, freed, memory_order_relaxed);
+    return freed;
+}
+
+void registry_write_lock(registry_t* registry) {
+    pthread_mutex_lock(&registry->lock);
+}
+
+void registry_write_unlock(registry_t* registry) {
+    registry_reclaim_locked(registry);
+    pthread_mutex_unlock(&registry->lock);
+}
+
+// Hand an unlinked object over to reclamation. Called with lock held.
+void registry_retire(registry_t* registry, void* object) {
+    if (!object) return;
+
+    registry_retired_t* retired = malloc(sizeof(registry_retired_t));
+    if (!retired) {
+        // Readers may still hold it; leaking is the only safe choice
+        LOG_ERROR("Failed to retire registry object, leaking it");
+        return;
+    }
+
+    retired->object = object;
+    retired->epoch = atomic_load(&registry->epoch);
+    retired->next = registry->retired;
+    registry->retired = retired;
+    registry->retired_count++;
+}
+
+// Publish a copy of the table with room for the live entries twice over,
+// dropping removed slots. Called with lock held.
+static int registry_map_grow(registry_t* registry, registry_map_t* map) {
+    registry_table_t* old_table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    uint32_t count = atomic_load_explicit(&map->count, memory_order_relaxed);
+    uint32_t capacity = registry_round_up(MAX((size_t)(count + 1) * 2, (size_t)old_table->mask + 1));
+
+    // A table full of removed slots is compacted at the same size
+    if ((size_t)(count + 1) * 4 <= (size_t)old_table->mask + 1) {
+        capacity = old_table->mask + 1;
+    }
+
+    registry_table_t* table = registry_table_create(capacity);
+    if (!table) {
+        LOG_ERROR("Failed to grow registry map to %u slots", capacity);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i <= old_table->mask; i++) {
+        void* entry = atomic_load_explicit(&old_table->slots[i], memory_order_relaxed);
+        if (!entry || entry == REGISTRY_TOMBSTONE) continue;
+
+        uint32_t slot = registry_hash(registry_key(entry)) & table->mask;
+        while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed)) {
+            slot = (slot + 1) & table->mask;
+        }
+        atomic_store_explicit(&table->slots[slot], entry, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&map->table, table, memory_order_release);
+    map->used = count;
+    registry_retire(registry, old_table);
+    atomic_fetch_add_explicit(&registry->resizes, 1, memory_order_relaxed);
+    return 0;
+}
+
+// Add an entry. Called with lock held.
+int registry_map_insert(registry_t* registry, registry_map_t* map, void* entry) {
+    if (!entry || registry_map_find(map, registry_key(entry))) return -1;
+
+    // Keep at least a quarter of the slots empty so probes stay short
+    registry_table_t* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    if ((size_t)(map->used + 1) * 4 > (size_t)(table->mask + 1) * 3) {
+        if (registry_map_grow(registry, map) != 0) return -1;
+        table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    }
+
+    uint32_t slot = registry_hash(registry_key(entry)) & table->mask;
+    void* current;
+    while ((current = atomic_load_explicit(&table->slots[slot], memory_order_relaxed)) && current != REGISTRY_TOMBSTONE) {
+        slot = (slot + 1) & table->mask;
+    }
+
+    atomic_store_explicit(&table->slots[slot], entry, memory_order_release);
+    if (!current) map->used++;
+    atomic_fetch_add_explicit(&map->count, 1, memory_order_relaxed);
+    return 0;
+}
+
+// Unlink an entry. Called with lock held.
+void* registry_map_remove(registry_map_t* map, uint32_t key) {
+    registry_table_t* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    uint32_t slot = registry_hash(key) & table->mask;
+
+    for (;;) {
+        void* entry = atomic_load_explicit(&table->slots[slot], memory_order_relaxed);
+        if (!entry) return NULL;
+        if (entry != REGISTRY_TOMBSTONE && registry_key(entry) == key) {
+            atomic_store(&table->slots[slot], REGISTRY_TOMBSTONE);
+            atomic_fetch_sub_explicit(&map->count, 1, memory_order_relaxed);
+            return entry;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+size_t registry_reclaim(registry_t* registry) {
+    pthread_mutex_lock(&registry->lock);
+    size_t freed = registry_reclaim_locked(registry);
+    pthread_mutex_unlock(&registry->lock);
+    return freed;
+}
+
+size_t registry_pending(registry_t* registry) {
+    pthread_mutex_lock(&registry->lock);
+    size_t pending = registry->retired_count;
+    pthread_mutex_unlock(&registry->lock);
+    return pending;
+}
@@ -0,0 +1,801 @@
+/*
+ * Segment Log for Smart Monitor xApp
+ *
+ * Crash-safe capture of raw metrics ahead of the database:
+ * - Memory-mapped, append-only segments of fixed-size records
+ * - CRC-32 checksummed headers and records
+ * - Lock-free appends into ranges reserved with an atomic add
+ * - Rollover to a segment created ahead by a maintainer thread
+ * - Recovery that scans forward to the last valid record
+ * - Background compactor folding sealed segments into storage
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "segment_log.h"
+#include "utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(segment_header_t) == 64, "segment header must stay 64 bytes");
+_Static_assert(sizeof(segment_record_t) == 32, "segment record must stay 32 bytes");
+
+// Checksummed prefix of a record
+#define SEGMENT_RECORD_BODY offsetof(segment_record_t, checksum)
+
+static uint32_t segment_crc_table[256];
+static pthread_once_t segment_crc_once = PTHREAD_ONCE_INIT;
+
+// CRC-32 (IEEE 802.3) lookup table
+static void segment_crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        segment_crc_table[i] = crc;
+    }
+}
+
+// Continue a CRC-32 over data; start with 0
+static uint32_t segment_crc(uint32_t crc, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = segment_crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t segment_header_checksum(const segment_header_t* header) {
+    return segment_crc(0, header, offsetof(segment_header_t, checksum));
+}
+
+static uint32_t segment_record_checksum(const segment_record_t* record, uint64_t sequence, uint64_t index) {
+    uint64_t position[2] = { sequence, index };
+    uint32_t crc = segment_crc(0, position, sizeof(position));
+    return segment_crc(crc, record, SEGMENT_RECORD_BODY);
+}
+
+static size_t segment_file_size(size_t capacity) {
+    return sizeof(segment_header_t) + capacity * sizeof(segment_record_t);
+}
+
+// Path of a segment file
+void segment_log_segment_path(const segment_log_t* log, uint64_t sequence, char* path, size_t path_size) {
+    if (!log || !path) return;
+    snprintf(path, path_size, "%s/segment_%020llu.log", log->directory, (unsigned long long)sequence);
+}
+
+// Valid records of a mapped segment: the prefix up to the first record
+// whose checksum does not match. Returns -1 if the header is invalid.
+static ssize_t segment_valid_records(const uint8_t* map, size_t map_size, uint64_t sequence,
+                                     metric_data_t* metrics, size_t max_count) {
+    if (map_size < sizeof(segment_header_t)) {
+        return -1;
+    }
+
+    const segment_header_t* header = (const segment_header_t*)map;
+    if (header->magic != SEGMENT_LOG_MAGIC || header->version != SEGMENT_LOG_VERSION ||
+        header->record_size != sizeof(segment_record_t) || header->sequence != sequence ||
+        header->checksum != segment_header_checksum(header)) {
+        return -1;
+    }
+
+    size_t capacity = MIN(header->capacity, (map_size - sizeof(segment_header_t)) / sizeof(segment_record_t));
+    const segment_record_t* records = (const segment_record_t*)(map + sizeof(segment_header_t));
+
+    size_t count = 0;
+    while (count < capacity && records[count].checksum == segment_record_checksum(&records[count], sequence, count)) {
+        if (metrics && count < max_count) {
+            metrics[count] = (metric_data_t){
+                .type = (metric_type_t)records[count].metric_type,
+                .value = records[count].value,
+                .node_id = records[count].node_id,
+                .cell_id = records[count].cell_id,
+                .timestamp = (time_t)records[count].timestamp
+            };
+        }
+        count++;
+    }
+
+    return (ssize_t)count;
+}
+
+// Map a sealed segment read-only; returns NULL if it cannot be opened
+static uint8_t* segment_map_readonly(const char* path, size_t* map_size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    uint8_t* map = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            map = NULL;
+        } else {
+            *map_size = (size_t)st.st_size;
+        }
+    }
+
+    close(fd);
+    return map;
+}
+
+// Create and map a segment file into a slot
+static int segment_file_map(segment_log_t* log, segment_file_t* file, uint64_t sequence) {
+    char path[640];
+    segment_log_segment_path(log, sequence, path, sizeof(path));
+
+    size_t size = segment_file_size(log->segment_records);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create segment %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        LOG_ERROR("Failed to size segment %s: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    uint8_t* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Failed to map segment %s: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    segment_header_t* header = (segment_header_t*)map;
+    *header = (segment_header_t){
+        .magic = SEGMENT_LOG_MAGIC,
+        .version = SEGMENT_LOG_VERSION,
+        .record_size = sizeof(segment_record_t),
+        .sequence = sequence,
+        .capacity = log->segment_records,
+        .created_at = time(NULL)
+    };
+    header->checksum = segment_header_checksum(header);
+
+    file->sequence = sequence;
+    file->fd = fd;
+    file->map = map;
+    file->map_size = size;
+    file->records = (segment_record_t*)(map + sizeof(segment_header_t));
+    file->capacity = log->segment_records;
+    file->count = 0;
+    atomic_store(&file->reserved, 0);
+    atomic_store(&file->synced, 0);
+    return 0;
+}
+
+// Hand the first records of a segment to msync: from the last sync on with
+// MS_ASYNC, all of them with MS_SYNC, since records still being copied at the
+// last sync may sit on earlier pages
+static int segment_file_sync(segment_file_t* file, size_t records, int flags) {
+    size_t synced = (flags & MS_SYNC) ? 0 : atomic_load(&file->synced);
+    if (!file->map || synced >= records) {
+        return 0;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t from = (sizeof(segment_header_t) + synced * sizeof(segment_record_t)) & ~(page - 1);
+    size_t to = sizeof(segment_header_t) + records * sizeof(segment_record_t);
+
+    if (msync(file->map + from, to - from, flags) != 0) {
+        LOG_WARN("Failed to sync segment %llu: %s", (unsigned long long)file->sequence, strerror(errno));
+        return -1;
+    }
+    atomic_store(&file->synced, records);
+    return 0;
+}
+
+// Unmap a segment holding records; an empty one is deleted. Caller holds the
+// lock and no writer uses the mapping anymore.
+static void segment_file_release(segment_log_t* log, segment_file_t* file, size_t records, int sync_flags) {
+    if (file->map) {
+        segment_file_sync(file, records, sync_flags);
+        munmap(file->map, file->map_size);
+        close(file->fd);
+
+        if (records == 0) {
+            char path[640];
+            segment_log_segment_path(log, file->sequence, path, sizeof(path));
+            unlink(path);
+        }
+    }
+
+    file->map = NULL;
+    file->records = NULL;
+    file->fd = -1;
+    file->capacity = 0;
+    file->state = SEGMENT_FILE_FREE;
+}
+
+// Unmap every sealed segment once the appenders still copying into it are
+// done; caller holds the lock. Appenders never take the lock while they count
+// as writers, so the wait is short.
+static void segment_retire_files(segment_log_t* log, int sync_flags) {
+    for (int i = 0; i < SEGMENT_LOG_FILES; i++) {
+        segment_file_t* file = &log->files[i];
+        if (file->state != SEGMENT_FILE_RETIRING) continue;
+
+        while (atomic_load(&file->writers) > 0) {
+            sched_yield();
+        }
+        segment_file_release(log, file, file->count, sync_flags);
+    }
+}
+
+// Create the next segment ahead of time; caller holds the lock
+static segment_file_t* segment_prepare(segment_log_t* log) {
+    if (log->spare) {
+        return log->spare;
+    }
+
+    segment_file_t* file = NULL;
+    for (int pass = 0; pass < 2 && !file; pass++) {
+        if (pass == 1) {
+            segment_retire_files(log, MS_ASYNC);
+        }
+        for (int i = 0; i < SEGMENT_LOG_FILES && !file; i++) {
+            if (log->files[i].state == SEGMENT_FILE_FREE) {
+                file = &log->files[i];
+            }
+        }
+    }
+
+    if (!file || segment_file_map(log, file, log->next_sequence) != 0) {
+        return NULL;
+    }
+
+    log->next_sequence++;
+    file->state = SEGMENT_FILE_SPARE;
+    log->spare = file;
+    return file;
+}
+
+// Queue a sealed segment for the compactor; caller holds the lock
+static void segment_queue_sealed(segment_log_t* log, uint64_t sequence) {
+    if (log->sealed_count == log->sealed_capacity) {
+        size_t capacity = log->sealed_capacity ? log->sealed_capacity * 2 : 16;
+        uint64_t* sealed = realloc(log->sealed, capacity * sizeof(uint64_t));
+        if (!sealed) {
+            // The file stays on disk and is found again on the next open
+            LOG_ERROR("Failed to queue segment %llu for compaction", (unsigned long long)sequence);
+            return;
+        }
+        log->sealed = sealed;
+        log->sealed_capacity = capacity;
+    }
+
+    log->sealed[log->sealed_count++] = sequence;
+    pthread_cond_signal(&log->compact_cond);
+}
+
+// Seal file if it is still the active segment and make the spare active, or
+// create an active segment if there is none (file NULL). The maintainer
+// unmaps the sealed segment and prepares the next spare. Caller holds the lock.
+static void segment_swap(segment_log_t* log, segment_file_t* file) {
+    if (atomic_load(&log->active) != file) {
+        return;
+    }
+
+    if (file) {
+        // Close the segment to further reservations; every range handed out
+        // before is copied by a writer that the retirement waits for
+        size_t reserved = atomic_fetch_add(&file->reserved, file->capacity + 1);
+        file->count = MIN(reserved, file->capacity);
+        file->state = SEGMENT_FILE_RETIRING;
+        if (file->count > 0) {
+            segment_queue_sealed(log, file->sequence);
+        }
+
+        // Unpublish it before it can be retired: an appender that enters
+        // afterwards sees no active segment and waits here for the next one
+        atomic_store(&log->active, NULL);
+    }
+
+    if (file && !log->spare) {
+        atomic_fetch_add(&log->stalled_rollovers, 1);
+    }
+
+    segment_file_t* next = segment_prepare(log);
+    if (next) {
+        next->state = SEGMENT_FILE_ACTIVE;
+        log->spare = NULL;
+        log->sequence = next->sequence;
+    }
+    atomic_store(&log->active, next);
+    pthread_cond_signal(&log->maintain_cond);
+}
+
+// The active segment, counted as a writer so it stays mapped; NULL if there is none
+static segment_file_t* segment_enter(segment_log_t* log) {
+    for (;;) {
+        segment_file_t* file = atomic_load(&log->active);
+        if (!file) {
+            return NULL;
+        }
+
+        atomic_fetch_add(&file->writers, 1);
+        if (atomic_load(&log->active) == file) {
+            return file;
+        }
+        atomic_fetch_sub(&file->writers, 1);
+    }
+}
+
+// Maintainer thread: retire sealed segments, keep a spare ready and sync the
+// active segment every sync interval, until stopped
+static void* segment_maintainer_thread(void* arg) {
+    segment_log_t* log = (segment_log_t*)arg;
+    int interval_ms = log->sync_interval_ms > 0 ? log->sync_interval_ms : SEGMENT_LOG_SYNC_MS;
+
+    pthread_mutex_lock(&log->lock);
+    while (atomic_load(&log->maintainer_running)) {
+        segment_retire_files(log, MS_ASYNC);
+        if (atomic_load(&log->active) && !segment_prepare(log)) {
+            LOG_WARN("Failed to create the next segment, will retry");
+        }
+        pthread_mutex_unlock(&log->lock);
+
+        segment_file_t* file = segment_enter(log);
+        if (file) {
+            segment_file_sync(file, MIN(atomic_load(&file->reserved), file->capacity), MS_ASYNC);
+            atomic_fetch_sub(&file->writers, 1);
+        }
+
+        pthread_mutex_lock(&log->lock);
+        if (atomic_load(&log->maintainer_running)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += interval_ms / 1000;
+            deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log->maintain_cond, &log->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+static int segment_compare_sequence(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Find the segments left in the directory, queue them as sealed, and count
+// the valid records of the newest one
+static int segment_recover(segment_log_t* log, uint64_t* newest) {
+    DIR* dir = opendir(log->directory);
+    if (!dir) {
+        LOG_ERROR("Failed to open segment directory %s: %s", log->directory, strerror(errno));
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long long sequence;
+        int length = 0;
+        if (sscanf(entry->d_name, "segment_%20llu.log%n", &sequence, &length) == 1 &&
+            entry->d_name[length] == '\0') {
+            segment_queue_sealed(log, sequence);
+        }
+    }
+    closedir(dir);
+
+    *newest = 0;
+    if (log->sealed_count > 0) {
+        qsort(log->sealed, log->sealed_count, sizeof(uint64_t), segment_compare_sequence);
+        *newest = log->sealed[log->sealed_count - 1];
+    }
+
+    // The last segment written to; the spare created ahead of it is empty
+    for (size_t i = log->sealed_count; i-- > 0;) {
+        uint64_t sequence = log->sealed[i];
+        char path[640];
+        segment_log_segment_path(log, sequence, path, sizeof(path));
+
+        size_t map_size = 0;
+        uint8_t* map = segment_map_readonly(path, &map_size);
+        ssize_t valid = map ? segment_valid_records(map, map_size, sequence, NULL, 0) : -1;
+        if (map) munmap(map, map_size);
+
+        if (valid == 0 && i > 0) {
+            continue;
+        }
+        if (valid >= 0) {
+            log->recovered_records = (uint64_t)valid;
+            LOG_INFO("Recovered %zd records from segment %llu, %zu segments to compact",
+                     valid, (unsigned long long)sequence, log->sealed_count);
+        } else {
+            LOG_WARN("Newest segment %llu has an invalid header", (unsigned long long)sequence);
+        }
+        break;
+    }
+
+    return 0;
+}
+
+// Open a segment log, recovering what a previous run left behind
+segment_log_t* segment_log_open(const char* directory, size_t segment_records, int sync_interval_ms) {
+    if (!directory || segment_records == 0) {
+        return NULL;
+    }
+
+    pthread_once(&segment_crc_once, segment_crc_init);
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Failed to create segment directory %s: %s", directory, strerror(errno));
+        return NULL;
+    }
+
+    segment_log_t* log = utils_malloc_zero(sizeof(segment_log_t));
+    if (!log) {
+        LOG_ERROR("Failed to allocate segment log");
+        return NULL;
+    }
+
+    snprintf(log->directory, sizeof(log->directory), "%s", directory);
+    log->segment_records = segment_records;
+    log->sync_interval_ms = sync_interval_ms;
+    for (int i = 0; i < SEGMENT_LOG_FILES; i++) {
+        log->files[i].fd = -1;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&log->compact_cond, &attr);
+    pthread_cond_init(&log->maintain_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&log->lock, NULL);
+
+    // Sequences start at the clock in microseconds, so they keep growing
+    // across restarts even after every segment was compacted and deleted
+    uint64_t newest = 0;
+    if (segment_recover(log, &newest) != 0) {
+        segment_log_close(log);
+        return NULL;
+    }
+    log->next_sequence = MAX(newest + 1, (uint64_t)utils_get_timestamp_us());
+
+    // The first segment and its spare are created here, later spares by the maintainer
+    pthread_mutex_lock(&log->lock);
+    segment_swap(log, NULL);
+    bool created = atomic_load(&log->active) && segment_prepare(log);
+    pthread_mutex_unlock(&log->lock);
+
+    atomic_store(&log->maintainer_running, true);
+    if (!created || pthread_create(&log->maintainer_thread, NULL, segment_maintainer_thread, log) != 0) {
+        LOG_ERROR("Failed to start segment log in %s", directory);
+        atomic_store(&log->maintainer_running, false);
+        segment_log_close(log);
+        return NULL;
+    }
+    log->maintainer_started = true;
+
+    LOG_INFO("Segment log opened in %s (segment %llu)", directory, (unsigned long long)log->sequence);
+    return log;
+}
+
+// Close the log; the active segment is synced and recovered on the next open
+void segment_log_close(segment_log_t* log) {
+    if (!log) return;
+
+    segment_log_stop_compactor(log);
+
+    if (log->maintainer_started) {
+        pthread_mutex_lock(&log->lock);
+        atomic_store(&log->maintainer_running, false);
+        pthread_cond_signal(&log->maintain_cond);
+        pthread_mutex_unlock(&log->lock);
+        pthread_join(log->maintainer_thread, NULL);
+        log->maintainer_started = false;
+    }
+
+    pthread_mutex_lock(&log->lock);
+    segment_retire_files(log, MS_SYNC);
+    segment_file_t* active = atomic_load(&log->active);
+    if (active) {
+        segment_file_release(log, active, MIN(atomic_load(&active->reserved), active->capacity), MS_SYNC);
+        atomic_store(&log->active, NULL);
+    }
+    if (log->spare) {
+        segment_file_release(log, log->spare, 0, MS_ASYNC);
+        log->spare = NULL;
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    pthread_cond_destroy(&log->maintain_cond);
+    pthread_cond_destroy(&log->compact_cond);
+    pthread_mutex_destroy(&log->lock);
+    free(log->sealed);
+    free(log->compact_buffer);
+    free(log);
+}
+
+// Append metrics to the active segment, rolling over as segments fill up.
+// The lock is only taken by the appender whose range crosses the end of a
+// segment, to swap in the spare.
+size_t segment_log_append(segment_log_t* log, const metric_data_t* metrics, size_t count) {
+    if (!log || !metrics) {
+        return 0;
+    }
+
+    size_t appended = 0;
+    while (appended < count) {
+        segment_file_t* file = segment_enter(log);
+        if (!file) {
+            // A rollover failed to create a segment; try again
+            pthread_mutex_lock(&log->lock);
+            segment_swap(log, NULL);
+            bool created = atomic_load(&log->active) != NULL;
+            pthread_mutex_unlock(&log->lock);
+            if (!created) {
+                break;
+            }
+            continue;
+        }
+
+        // The slot may be retired and reused once this appender leaves it
+        size_t capacity = file->capacity;
+        size_t wanted = count - appended;
+        size_t start = atomic_fetch_add(&file->reserved, wanted);
+        size_t batch = (start < capacity) ? MIN(wanted, capacity - start) : 0;
+        for (size_t i = 0; i < batch; i++) {
+            const metric_data_t* metric = &metrics[appended + i];
+            segment_record_t* record = &file->records[start + i];
+
+            record->timestamp = metric->timestamp;
+            record->value = metric->value;
+            record->node_id = metric->node_id;
+            record->cell_id = metric->cell_id;
+            record->metric_type = (uint32_t)metric->type;
+            record->checksum = segment_record_checksum(record, file->sequence, start + i);
+        }
+        atomic_fetch_sub(&file->writers, 1);
+        appended += batch;
+
+        if (start + wanted <= capacity) {
+            continue;
+        }
+        if (start <= capacity) {
+            // This range holds the first record past the end: seal the segment
+            pthread_mutex_lock(&log->lock);
+            segment_swap(log, file);
+            pthread_mutex_unlock(&log->lock);
+        } else {
+            // Another appender is sealing it; retry on the next segment
+            sched_yield();
+        }
+    }
+
+    atomic_fetch_add_explicit(&log->appended_records, appended, memory_order_relaxed);
+    atomic_fetch_add_explicit(&log->failed_records, count - appended, memory_order_relaxed);
+    return appended;
+}
+
+// Write the active segment to disk and wait for it
+int segment_log_sync(segment_log_t* log) {
+    if (!log) return -1;
+
+    pthread_mutex_lock(&log->lock);
+    segment_retire_files(log, MS_SYNC);
+    pthread_mutex_unlock(&log->lock);
+
+    int result = 0;
+    segment_file_t* file = segment_enter(log);
+    if (file) {
+        result = segment_file_sync(file, MIN(atomic_load(&file->reserved), file->capacity), MS_SYNC);
+        atomic_fetch_sub(&file->writers, 1);
+    }
+
+    return result;
+}
+
+// Seal the active segment now, even if it is not full
+int segment_log_rollover(segment_log_t* log) {
+    if (!log) return -1;
+
+    pthread_mutex_lock(&log->lock);
+    segment_swap(log, atomic_load(&log->active));
+    int result = atomic_load(&log->active) ? 0 : -1;
+    pthread_mutex_unlock(&log->lock);
+
+    return result;
+}
+
+// Fold one sealed segment, then delete it
+static int segment_compact_one(segment_log_t* log, uint64_t sequence, segment_compact_fn compact, void* user_data) {
+    char path[640];
+    segment_log_segment_path(log, sequence, path, sizeof(path));
+
+    size_t map_size = 0;
+    uint8_t* map = segment_map_readonly(path, &map_size);
+    if (!map) {
+        LOG_WARN("Sealed segment %s is gone: %s", path, strerror(errno));
+        return 0;
+    }
+
+    // Size the buffer for the segment as written, whatever the current setting
+    size_t capacity = (map_size - MIN(map_size, sizeof(segment_header_t))) / sizeof(segment_record_t);
+    if (capacity > log->compact_capacity) {
+        metric_data_t* buffer = realloc(log->compact_buffer, capacity * sizeof(metric_data_t));
+        if (!buffer) {
+            munmap(map, map_size);
+            LOG_ERROR("Failed to allocate compaction buffer of %zu records", capacity);
+            return -1;
+        }
+        log->compact_buffer = buffer;
+        log->compact_capacity = capacity;
+    }
+
+    ssize_t count = segment_valid_records(map, map_size, sequence, log->compact_buffer, log->compact_capacity);
+    munmap(map, map_size);
+
+    if (count < 0) {
+        // Keep what cannot be read for inspection, out of the way of recovery
+        char corrupt_path[660];
+        snprintf(corrupt_path, sizeof(corrupt_path), "%s.corrupt", path);
+        rename(path, corrupt_path);
+        LOG_ERROR("Segment %s has an invalid header, moved aside", path);
+        return 0;
+    }
+
+    if (compact(sequence, log->compact_buffer, (size_t)count, user_data) != 0) {
+        LOG_WARN("Failed to compact segment %llu, will retry", (unsigned long long)sequence);
+        return -1;
+    }
+
+    if (unlink(path) != 0) {
+        LOG_WARN("Failed to delete compacted segment %s: %s", path, strerror(errno));
+    }
+
+    pthread_mutex_lock(&log->lock);
+    log->compacted_segments++;
+    log->compacted_records += (uint64_t)count;
+    pthread_mutex_unlock(&log->lock);
+    return 0;
+}
+
+// Fold every sealed segment, oldest first
+int segment_log_compact_pending(segment_log_t* log, segment_compact_fn compact, void* user_data) {
+    if (!log || !compact) return -1;
+
+    int compacted = 0;
+    for (;;) {
+        pthread_mutex_lock(&log->lock);
+        if (log->sealed_count == 0) {
+            pthread_mutex_unlock(&log->lock);
+            break;
+        }
+        // Appenders may still be copying into a segment sealed just now
+        segment_retire_files(log, MS_ASYNC);
+        uint64_t sequence = log->sealed[0];
+        pthread_mutex_unlock(&log->lock);
+
+        if (segment_compact_one(log, sequence, compact, user_data) != 0) {
+            return compacted > 0 ? compacted : -1;
+        }
+
+        pthread_mutex_lock(&log->lock);
+        log->sealed_count--;
+        memmove(log->sealed, log->sealed + 1, log->sealed_count * sizeof(uint64_t));
+        pthread_mutex_unlock(&log->lock);
+        compacted++;
+    }
+
+    return compacted;
+}
+
+// Compactor thread: fold segments as they are sealed until stopped and drained
+static void* segment_compactor_thread(void* arg) {
+    segment_log_t* log = (segment_log_t*)arg;
+
+    for (;;) {
+        // Read the flag before compacting so segments sealed before stop are folded
+        bool running = atomic_load(&log->compactor_running);
+        int compacted = segment_log_compact_pending(log, log->compact, log->compact_data);
+        if (!running) {
+            break;
+        }
+
+        pthread_mutex_lock(&log->lock);
+        if ((log->sealed_count == 0 || compacted < 0) && atomic_load(&log->compactor_running)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += SEGMENT_LOG_COMPACT_MS / 1000;
+            deadline.tv_nsec += (long)(SEGMENT_LOG_COMPACT_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log->compact_cond, &log->lock, &deadline);
+        }
+        pthread_mutex_unlock(&log->lock);
+    }
+
+    return NULL;
+}
+
+// Start the compactor thread
+int segment_log_start_compactor(segment_log_t* log, segment_compact_fn compact, void* user_data) {
+    if (!log || !compact || log->compactor_started) {
+        return -1;
+    }
+
+    log->compact = compact;
+    log->compact_data = user_data;
+    atomic_store(&log->compactor_running, true);
+
+    if (pthread_create(&log->compactor_thread, NULL, segment_compactor_thread, log) != 0) {
+        LOG_ERROR("Failed to create segment compactor thread");
+        atomic_store(&log->compactor_running, false);
+        return -1;
+    }
+
+    log->compactor_started = true;
+    return 0;
+}
+
+// Stop the compactor after it folded every sealed segment
+void segment_log_stop_compactor(segment_log_t* log) {
+    if (!log || !log->compactor_started) return;
+
+    pthread_mutex_lock(&log->lock);
+    atomic_store(&log->compactor_running, false);
+    pthread_cond_signal(&log->compact_cond);
+    pthread_mutex_unlock(&log->lock);
+
+    pthread_join(log->compactor_thread, NULL);
+    log->compactor_started = false;
+}
+
+// Sealed segments not compacted yet
+size_t segment_log_pending_segments(segment_log_t* log) {
+    if (!log) return 0;
+
+    pthread_mutex_lock(&log->lock);
+    size_t count = log->sealed_count;
+    pthread_mutex_unlock(&log->lock);
+
+    return count;
+}
+
+// Print segment log statistics
+void segment_log_print_performance(segment_log_t* log) {
+    if (!log) return;
+
+    pthread_mutex_lock(&log->lock);
+    LOG_INFO("Segment Log Performance:");
+    LOG_INFO("  Appended Records: %llu (failed %llu)",
+             (unsigned long long)atomic_load(&log->appended_records),
+             (unsigned long long)atomic_load(&log->failed_records));
+    LOG_INFO("  Stalled Rollovers: %llu", (unsigned long long)atomic_load(&log->stalled_rollovers));
+    LOG_INFO("  Recovered Records: %llu", (unsigned long long)log->recovered_records);
+    LOG_INFO("  Compacted: %llu segments, %llu records, %zu pending",
+             (unsigned long long)log->compacted_segments, (unsigned long long)log->compacted_records,
+             log->sealed_count);
+    segment_file_t* active = atomic_load(&log->active);
+    if (active) {
+        LOG_INFO("  Active Segment: %llu (%zu/%zu records)", (unsigned long long)active->sequence,
+                 MIN(atomic_load(&active->reserved), active->capacity), active->capacity);
+    }
+    pthread_mutex_unlock(&log->lock);
+}
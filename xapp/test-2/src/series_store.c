@@ -0,0 +1,270 @@
+/*
+ * Series Store for Smart Monitor xApp
+ *
+ * Keeps one metric history per (metric_type, node_id, cell_id):
+ * - Open-addressing hash index with linear probing
+ * - Fixed-capacity history rings per series
+ * - Bounded memory budget with least-recently-updated eviction
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "series_store.h"
+#include "utils.h"
+#include <stddef.h>
+
+#define SERIES_NIL (-1)
+#define SERIES_MIN_COUNT 16
+
+// 32-bit mix of the series key (splitmix64 finalizer)
+static uint32_t series_hash(metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    uint64_t x = ((uint64_t)node_id << 32) ^ cell_id ^ ((uint64_t)type << 59) ^ ((uint64_t)type * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uint32_t)x;
+}
+
+static inline bool series_key_equals(const series_key_t* key, metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    return key->node_id == node_id && key->cell_id == cell_id && key->type == type;
+}
+
+// Approximate bytes held by one series, including its share of the index
+static size_t series_footprint(int history_size, int window_size) {
+    return sizeof(series_entry_t) +
+           (size_t)history_size * (sizeof(double) + sizeof(time_t)) +
+           (size_t)window_size * (sizeof(double) + 2 * sizeof(uint64_t) + sizeof(sliding_window_node_t)) +
+           2 * sizeof(series_index_entry_t) + sizeof(series_entry_t*);
+}
+
+// Index slot holding `slot`, or the empty slot where `hash` would go
+static uint32_t series_index_probe(const series_store_t* store, uint32_t hash,
+                                   metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    uint32_t pos = hash & store->index_mask;
+
+    while (store->index[pos].slot != SERIES_NIL) {
+        const series_index_entry_t* entry = &store->index[pos];
+        if (entry->hash == hash &&
+            series_key_equals(&store->series[entry->slot]->key, type, node_id, cell_id)) {
+            break;
+        }
+        pos = (pos + 1) & store->index_mask;
+    }
+
+    return pos;
+}
+
+// Remove an index slot, shifting back later entries of the probe chain
+static void series_index_remove(series_store_t* store, uint32_t pos) {
+    uint32_t hole = pos;
+    uint32_t next = (pos + 1) & store->index_mask;
+
+    while (store->index[next].slot != SERIES_NIL) {
+        uint32_t home = store->index[next].hash & store->index_mask;
+
+        // Move the entry if the hole lies between its home and its position
+        if (((next - home) & store->index_mask) >= ((next - hole) & store->index_mask)) {
+            store->index[hole] = store->index[next];
+            hole = next;
+        }
+        next = (next + 1) & store->index_mask;
+    }
+
+    store->index[hole].slot = SERIES_NIL;
+}
+
+// LRU list maintenance
+static void series_lru_unlink(series_store_t* store, int32_t slot) {
+    series_entry_t* entry = store->series[slot];
+
+    if (entry->lru_prev != SERIES_NIL) {
+        store->series[entry->lru_prev]->lru_next = entry->lru_next;
+    } else {
+        store->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next != SERIES_NIL) {
+        store->series[entry->lru_next]->lru_prev = entry->lru_prev;
+    } else {
+        store->lru_tail = entry->lru_prev;
+    }
+}
+
+static void series_lru_push_front(series_store_t* store, int32_t slot) {
+    series_entry_t* entry = store->series[slot];
+
+    entry->lru_prev = SERIES_NIL;
+    entry->lru_next = store->lru_head;
+    if (store->lru_head != SERIES_NIL) {
+        store->series[store->lru_head]->lru_prev = slot;
+    }
+    store->lru_head = slot;
+    if (store->lru_tail == SERIES_NIL) {
+        store->lru_tail = slot;
+    }
+}
+
+static void series_lru_touch(series_store_t* store, int32_t slot) {
+    if (store->lru_head == slot) {
+        return;
+    }
+    series_lru_unlink(store, slot);
+    series_lru_push_front(store, slot);
+}
+
+// Create a store bounded by `memory_budget` bytes
+series_store_t* series_store_create(size_t memory_budget, int history_size, int window_size,
+                                    int trend_window, bool trend_timestamps) {
+    if (history_size <= 0 || window_size <= 0) {
+        return NULL;
+    }
+
+    series_store_t* store = utils_malloc_zero(sizeof(series_store_t));
+    if (!store) {
+        LOG_ERROR("Failed to allocate series store");
+        return NULL;
+    }
+
+    store->history_size = history_size;
+    store->window_size = window_size;
+    store->trend_window = trend_window;
+    store->trend_timestamps = trend_timestamps;
+    store->memory_budget = memory_budget;
+    store->series_bytes = series_footprint(history_size, window_size);
+    store->max_series = (int32_t)MIN(memory_budget / store->series_bytes, (size_t)(INT32_MAX / 4));
+    if (store->max_series < SERIES_MIN_COUNT) {
+        store->max_series = SERIES_MIN_COUNT;
+    }
+
+    // Keep the index at or below 50% load
+    uint32_t index_size = 1;
+    while (index_size < (uint32_t)store->max_series * 2) {
+        index_size <<= 1;
+    }
+    store->index_mask = index_size - 1;
+
+    store->series = calloc(store->max_series, sizeof(series_entry_t*));
+    store->index = malloc(index_size * sizeof(series_index_entry_t));
+    if (!store->series || !store->index) {
+        LOG_ERROR("Failed to allocate series index for %d series", store->max_series);
+        series_store_destroy(store);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < index_size; i++) {
+        store->index[i].slot = SERIES_NIL;
+    }
+
+    store->lru_head = SERIES_NIL;
+    store->lru_tail = SERIES_NIL;
+
+    LOG_DEBUG("Series store created: up to %d series, %zu bytes each",
+              store->max_series, store->series_bytes);
+    return store;
+}
+
+// Destroy the store and every series in it
+void series_store_destroy(series_store_t* store) {
+    if (!store) return;
+
+    if (store->series) {
+        for (int32_t i = 0; i < store->series_count; i++) {
+            analytics_history_free(&store->series[i]->history);
+            free(store->series[i]);
+        }
+        free(store->series);
+    }
+
+    free(store->index);
+    free(store);
+}
+
+// Find an existing series
+metric_history_t* series_store_find(series_store_t* store, metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    if (!store) return NULL;
+
+    uint32_t hash = series_hash(type, node_id, cell_id);
+    uint32_t pos = series_index_probe(store, hash, type, node_id, cell_id);
+    int32_t slot = store->index[pos].slot;
+
+    return slot == SERIES_NIL ? NULL : &store->series[slot]->history;
+}
+
+// Find a series, creating it (and evicting the stalest one if needed)
+metric_history_t* series_store_get_or_create(series_store_t* store, metric_type_t type, uint32_t node_id, uint32_t cell_id) {
+    if (!store) return NULL;
+
+    uint32_t hash = series_hash(type, node_id, cell_id);
+    uint32_t pos = series_index_probe(store, hash, type, node_id, cell_id);
+    int32_t slot = store->index[pos].slot;
+
+    if (slot != SERIES_NIL) {
+        series_lru_touch(store, slot);
+        return &store->series[slot]->history;
+    }
+
+    series_entry_t* entry;
+    if (store->series_count < store->max_series) {
+        // Grow the slab
+        entry = utils_malloc_zero(sizeof(series_entry_t));
+        if (!entry || analytics_history_init(&entry->history, store->history_size, store->window_size) != 0) {
+            LOG_ERROR("Failed to allocate series (%d, %u, %u)", type, node_id, cell_id);
+            free(entry);
+            return NULL;
+        }
+        analytics_history_set_trend(&entry->history, store->trend_window, store->trend_timestamps);
+        slot = store->series_count++;
+        store->series[slot] = entry;
+    } else {
+        // Reuse the least recently updated series
+        slot = store->lru_tail;
+        entry = store->series[slot];
+
+        uint32_t old_pos = series_index_probe(store, entry->hash, entry->key.type,
+                                              entry->key.node_id, entry->key.cell_id);
+        series_index_remove(store, old_pos);
+        series_lru_unlink(store, slot);
+        analytics_history_reset(&entry->history);
+        store->evictions++;
+
+        // The removal may have shifted the empty slot we found earlier
+        pos = series_index_probe(store, hash, type, node_id, cell_id);
+    }
+
+    entry->key.type = type;
+    entry->key.node_id = node_id;
+    entry->key.cell_id = cell_id;
+    entry->hash = hash;
+
+    store->index[pos].hash = hash;
+    store->index[pos].slot = slot;
+    series_lru_push_front(store, slot);
+
+    return &entry->history;
+}
+
+// Key of a history that belongs to a series in a store
+const series_key_t* series_store_key_of(const metric_history_t* history) {
+    if (!history) return NULL;
+
+    const series_entry_t* entry = (const series_entry_t*)((const char*)history - offsetof(series_entry_t, history));
+    return &entry->key;
+}
+
+// Number of live series
+int series_store_count(const series_store_t* store) {
+    return store ? store->series_count : 0;
+}
+
+// Approximate memory held by the store
+size_t series_store_memory_usage(const series_store_t* store) {
+    if (!store) return 0;
+
+    return sizeof(series_store_t) +
+           (size_t)(store->index_mask + 1) * sizeof(series_index_entry_t) +
+           (size_t)store->max_series * sizeof(series_entry_t*) +
+           (size_t)store->series_count * store->series_bytes;
+}
@@ -0,0 +1,548 @@
+/*
+ * Sliding Window Statistics for Smart Monitor xApp
+ *
+ * Rolling statistics over the newest N samples of a series:
+ * - Mean and variance (sliding Welford update)
+ * - Minimum and maximum (monotonic deques)
+ * - Median and tail quantiles (order statistics treap)
+ * - Bulk pushes that rebuild the treap once instead of once per sample
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "sliding_window.h"
+#include "stats_kernels.h"
+#include "utils.h"
+
+// Deque helpers (rings of sequence numbers)
+static inline uint64_t deque_front(const uint64_t* deque, int head) {
+    return deque[head];
+}
+
+static inline uint64_t deque_back(const uint64_t* deque, int head, int len, int capacity) {
+    int pos = head + len - 1;
+    return deque[pos >= capacity ? pos - capacity : pos];
+}
+
+static inline void deque_push_back(uint64_t* deque, int head, int* len, int capacity, uint64_t seq) {
+    int pos = head + *len;
+    deque[pos >= capacity ? pos - capacity : pos] = seq;
+    (*len)++;
+}
+
+// Bulk pushes of at least this many samples rebuild the order statistics;
+// shorter ones move each sample through the treap
+#define SLIDING_WINDOW_REBUILD_MIN 4
+
+// Windows up to this size rebuild with scratch on the stack
+#define SLIDING_WINDOW_STACK_SLOTS 1024
+
+// Order statistics helpers. Nodes are ordered by (value, slot) so equal
+// samples still have a strict order and a slot can always be located.
+#define TREE_NIL (-1)
+
+static inline int32_t tree_size(const sliding_window_t* window, int32_t node) {
+    return node == TREE_NIL ? 0 : window->nodes[node].size;
+}
+
+static inline void tree_update(sliding_window_t* window, int32_t node) {
+    sliding_window_node_t* n = &window->nodes[node];
+    n->size = 1 + tree_size(window, n->left) + tree_size(window, n->right);
+}
+
+static inline bool tree_less(const sliding_window_t* window, int32_t a, int32_t b) {
+    double va = window->values[a];
+    double vb = window->values[b];
+    return va < vb || (va == vb && a < b);
+}
+
+static inline uint32_t tree_next_priority(sliding_window_t* window) {
+    // xorshift32
+    uint32_t x = window->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    window->rng_state = x;
+    return x;
+}
+
+// Split a subtree into nodes ordered before `key` and the rest
+static void tree_split(sliding_window_t* window, int32_t node, int32_t key, int32_t* before, int32_t* after) {
+    if (node == TREE_NIL) {
+        *before = *after = TREE_NIL;
+        return;
+    }
+
+    sliding_window_node_t* n = &window->nodes[node];
+    if (tree_less(window, node, key)) {
+        tree_split(window, n->right, key, &n->right, after);
+        *before = node;
+    } else {
+        tree_split(window, n->left, key, before, &n->left);
+        *after = node;
+    }
+    tree_update(window, node);
+}
+
+// Merge two subtrees where every node of `a` orders before every node of `b`
+static int32_t tree_merge(sliding_window_t* window, int32_t a, int32_t b) {
+    if (a == TREE_NIL) return b;
+    if (b == TREE_NIL) return a;
+
+    if (window->nodes[a].priority > window->nodes[b].priority) {
+        window->nodes[a].right = tree_merge(window, window->nodes[a].right, b);
+        tree_update(window, a);
+        return a;
+    }
+
+    window->nodes[b].left = tree_merge(window, a, window->nodes[b].left);
+    tree_update(window, b);
+    return b;
+}
+
+static int32_t tree_insert(sliding_window_t* window, int32_t node, int32_t slot) {
+    if (node == TREE_NIL) {
+        return slot;
+    }
+
+    sliding_window_node_t* n = &window->nodes[node];
+    if (window->nodes[slot].priority > n->priority) {
+        tree_split(window, node, slot, &window->nodes[slot].left, &window->nodes[slot].right);
+        tree_update(window, slot);
+        return slot;
+    }
+
+    if (tree_less(window, slot, node)) {
+        n->left = tree_insert(window, n->left, slot);
+    } else {
+        n->right = tree_insert(window, n->right, slot);
+    }
+    tree_update(window, node);
+    return node;
+}
+
+static int32_t tree_erase(sliding_window_t* window, int32_t node, int32_t slot) {
+    if (node == TREE_NIL) {
+        return TREE_NIL;
+    }
+
+    sliding_window_node_t* n = &window->nodes[node];
+    if (node == slot) {
+        return tree_merge(window, n->left, n->right);
+    }
+
+    if (tree_less(window, slot, node)) {
+        n->left = tree_erase(window, n->left, slot);
+    } else {
+        n->right = tree_erase(window, n->right, slot);
+    }
+    tree_update(window, node);
+    return node;
+}
+
+// Re-derive mean and M2 from the stored samples
+static void sliding_window_resync(sliding_window_t* window) {
+    const stats_kernels_t* kernels = stats_kernels_get();
+    double mean = kernels->sum(window->values, window->count) / window->count;
+
+    window->mean = mean;
+    window->m2 = kernels->sum_sq_dev(window->values, window->count, mean);
+    window->resync_countdown = window->capacity;
+}
+
+// Initialize a window holding the newest `capacity` samples
+int sliding_window_init(sliding_window_t* window, int capacity) {
+    if (!window || capacity <= 0) {
+        return -1;
+    }
+
+    memset(window, 0, sizeof(sliding_window_t));
+    window->capacity = capacity;
+    window->values = malloc(capacity * sizeof(double));
+    window->max_deque = malloc(capacity * sizeof(uint64_t));
+    window->min_deque = malloc(capacity * sizeof(uint64_t));
+    window->nodes = malloc(capacity * sizeof(sliding_window_node_t));
+
+    if (!window->values || !window->max_deque || !window->min_deque || !window->nodes) {
+        LOG_ERROR("Failed to allocate sliding window of %d samples", capacity);
+        sliding_window_free(window);
+        return -1;
+    }
+
+    window->resync_countdown = capacity;
+    window->root = TREE_NIL;
+    window->rng_state = 0x9E3779B9u ^ (uint32_t)capacity;
+    return 0;
+}
+
+// Release window storage
+void sliding_window_free(sliding_window_t* window) {
+    if (!window) return;
+
+    SAFE_FREE(window->values);
+    SAFE_FREE(window->max_deque);
+    SAFE_FREE(window->min_deque);
+    SAFE_FREE(window->nodes);
+    window->capacity = 0;
+    window->count = 0;
+}
+
+// Drop all samples but keep the storage
+void sliding_window_reset(sliding_window_t* window) {
+    if (!window) return;
+
+    window->count = 0;
+    window->seq = 0;
+    window->mean = 0.0;
+    window->m2 = 0.0;
+    window->resync_countdown = window->capacity;
+    window->max_head = window->max_len = 0;
+    window->min_head = window->min_len = 0;
+    window->root = TREE_NIL;
+}
+
+// Slot of a sequence number still in the window, from the slot of seq
+// without a division
+static inline int window_slot_of(int capacity, uint64_t seq, int slot, uint64_t other) {
+    int back = (int)(seq - other);
+    return slot >= back ? slot - back : slot - back + capacity;
+}
+
+// Move the deques and running moments over a new sample and store it,
+// returning its slot. The slot must already be out of the order statistics.
+static int sliding_window_advance(sliding_window_t* window, double value, int slot) {
+    const int capacity = window->capacity;
+    const uint64_t seq = window->seq;
+
+    // Expire deque entries that fall out of the window with this push
+    if (seq >= (uint64_t)capacity) {
+        uint64_t oldest_kept = seq - capacity + 1;
+        if (window->max_len > 0 && deque_front(window->max_deque, window->max_head) < oldest_kept) {
+            if (++window->max_head == capacity) window->max_head = 0;
+            window->max_len--;
+        }
+        if (window->min_len > 0 && deque_front(window->min_deque, window->min_head) < oldest_kept) {
+            if (++window->min_head == capacity) window->min_head = 0;
+            window->min_len--;
+        }
+    }
+
+    // Keep the deques monotonic
+    while (window->max_len > 0 &&
+           window->values[window_slot_of(capacity, seq, slot,
+                                         deque_back(window->max_deque, window->max_head, window->max_len, capacity))] <= value) {
+        window->max_len--;
+    }
+    while (window->min_len > 0 &&
+           window->values[window_slot_of(capacity, seq, slot,
+                                         deque_back(window->min_deque, window->min_head, window->min_len, capacity))] >= value) {
+        window->min_len--;
+    }
+
+    // Update the running moments
+    if (window->count < capacity) {
+        window->count++;
+        double delta = value - window->mean;
+        window->mean += delta / window->count;
+        window->m2 += delta * (value - window->mean);
+    } else {
+        double evicted = window->values[slot];
+        double old_mean = window->mean;
+        window->mean += (value - evicted) / capacity;
+        window->m2 += (value - evicted) * (value - window->mean + evicted - old_mean);
+        if (window->m2 < 0.0) {
+            window->m2 = 0.0;
+        }
+        window->resync_countdown--;
+    }
+
+    window->values[slot] = value;
+
+    deque_push_back(window->max_deque, window->max_head, &window->max_len, capacity, seq);
+    deque_push_back(window->min_deque, window->min_head, &window->min_len, capacity, seq);
+    window->seq++;
+
+    if (window->resync_countdown <= 0) {
+        sliding_window_resync(window);
+    }
+    return slot;
+}
+
+// Add a sample, evicting the oldest one once the window is full
+void sliding_window_push(sliding_window_t* window, double value) {
+    // Take the slot out of the order statistics before overwriting it
+    int slot = (int)(window->seq % window->capacity);
+    if (window->count == window->capacity) {
+        window->root = tree_erase(window, window->root, slot);
+    }
+
+    sliding_window_advance(window, value, slot);
+
+    sliding_window_node_t* node = &window->nodes[slot];
+    node->left = node->right = TREE_NIL;
+    node->size = 1;
+    node->priority = tree_next_priority(window);
+    window->root = tree_insert(window, window->root, slot);
+}
+
+// Sort slots by (value, slot), the order of the treap: insertion sort over
+// short runs, then bottom-up merges through tmp
+static void tree_sort_slots(const sliding_window_t* window, int32_t* slots, int32_t* tmp, int n) {
+    const int run = 8;
+
+    for (int start = 0; start < n; start += run) {
+        int end = MIN(start + run, n);
+        for (int i = start + 1; i < end; i++) {
+            int32_t slot = slots[i];
+            int j = i;
+            while (j > start && tree_less(window, slot, slots[j - 1])) {
+                slots[j] = slots[j - 1];
+                j--;
+            }
+            slots[j] = slot;
+        }
+    }
+
+    int32_t* from = slots;
+    int32_t* to = tmp;
+    for (int width = run; width < n; width *= 2) {
+        for (int start = 0; start < n; start += 2 * width) {
+            int mid = MIN(start + width, n);
+            int end = MIN(start + 2 * width, n);
+            int a = start, b = mid, out = start;
+
+            while (a < mid && b < end) {
+                to[out++] = tree_less(window, from[b], from[a]) ? from[b++] : from[a++];
+            }
+            while (a < mid) to[out++] = from[a++];
+            while (b < end) to[out++] = from[b++];
+        }
+
+        int32_t* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != slots) {
+        memcpy(slots, from, n * sizeof(int32_t));
+    }
+}
+
+// Rebuild the treap from slots in order, with fresh priorities. The right
+// spine is kept on a stack; a node's subtree is complete when it leaves it.
+static void tree_build(sliding_window_t* window, const int32_t* sorted, int n, int32_t* stack) {
+    int depth = 0;
+
+    for (int i = 0; i < n; i++) {
+        int32_t slot = sorted[i];
+        sliding_window_node_t* node = &window->nodes[slot];
+        node->priority = tree_next_priority(window);
+        node->right = TREE_NIL;
+
+        int32_t last = TREE_NIL;
+        while (depth > 0 && window->nodes[stack[depth - 1]].priority < node->priority) {
+            last = stack[--depth];
+            tree_update(window, last);
+        }
+        node->left = last;
+        if (depth > 0) {
+            window->nodes[stack[depth - 1]].right = slot;
+        }
+        stack[depth++] = slot;
+    }
+
+    while (depth > 1) {
+        tree_update(window, stack[--depth]);
+    }
+    if (depth == 1) {
+        tree_update(window, stack[0]);
+    }
+    window->root = depth > 0 ? stack[0] : TREE_NIL;
+}
+
+// Add samples in arrival order. Moments and deques advance per sample as
+// in sliding_window_push; the order statistics are rebuilt once, by merging
+// the surviving slots (already in order) with the sorted new ones, which is
+// O(capacity + count log count) instead of count treap updates.
+void sliding_window_push_bulk(sliding_window_t* window, const double* values, int count) {
+    const int capacity = window->capacity;
+
+    int32_t stack_order[3 * SLIDING_WINDOW_STACK_SLOTS];
+    int32_t* order = stack_order;
+    if (count >= SLIDING_WINDOW_REBUILD_MIN && capacity > SLIDING_WINDOW_STACK_SLOTS) {
+        order = malloc(3 * (size_t)capacity * sizeof(int32_t));
+    }
+
+    if (count < SLIDING_WINDOW_REBUILD_MIN || !order) {
+        for (int i = 0; i < count; i++) {
+            sliding_window_push(window, values[i]);
+        }
+        return;
+    }
+
+    int32_t* kept = order;
+    int32_t* added = order + capacity;
+    int32_t* merged = order + 2 * capacity;
+    int kept_count = 0;
+
+    if (count >= capacity) {
+        // Only the newest `capacity` samples stay: start over with them
+        uint64_t seq = window->seq + (uint64_t)(count - capacity);
+        values += count - capacity;
+        count = capacity;
+        sliding_window_reset(window);
+        window->seq = seq;
+    } else {
+        // In-order walk keeping the slots the new samples do not overwrite
+        int32_t* stack = merged;
+        int depth = 0;
+        int32_t node = window->root;
+        int first = (int)(window->seq % capacity);
+
+        while (node != TREE_NIL || depth > 0) {
+            while (node != TREE_NIL) {
+                stack[depth++] = node;
+                node = window->nodes[node].left;
+            }
+            node = stack[--depth];
+            if ((node - first + capacity) % capacity >= count) {
+                kept[kept_count++] = node;
+            }
+            node = window->nodes[node].right;
+        }
+    }
+
+    int slot = (int)(window->seq % capacity);
+    for (int i = 0; i < count; i++) {
+        added[i] = sliding_window_advance(window, values[i], slot);
+        if (++slot == capacity) slot = 0;
+    }
+    tree_sort_slots(window, added, merged, count);
+
+    int a = 0, b = 0, n = 0;
+    while (a < kept_count && b < count) {
+        merged[n++] = tree_less(window, added[b], kept[a]) ? added[b++] : kept[a++];
+    }
+    while (a < kept_count) merged[n++] = kept[a++];
+    while (b < count) merged[n++] = added[b++];
+
+    tree_build(window, merged, n, kept);
+
+    if (order != stack_order) {
+        free(order);
+    }
+}
+
+// Check if the window holds `capacity` samples
+bool sliding_window_is_full(const sliding_window_t* window) {
+    return window->count >= window->capacity;
+}
+
+// Mean of the samples in the window
+double sliding_window_mean(const sliding_window_t* window) {
+    return window->count > 0 ? window->mean : 0.0;
+}
+
+// Population variance of the samples in the window
+double sliding_window_variance(const sliding_window_t* window) {
+    return window->count > 0 ? window->m2 / window->count : 0.0;
+}
+
+// Smallest sample in the window
+double sliding_window_min(const sliding_window_t* window) {
+    if (window->min_len == 0) return 0.0;
+    return window->values[deque_front(window->min_deque, window->min_head) % window->capacity];
+}
+
+// Largest sample in the window
+double sliding_window_max(const sliding_window_t* window) {
+    if (window->max_len == 0) return 0.0;
+    return window->values[deque_front(window->max_deque, window->max_head) % window->capacity];
+}
+
+// Newest sample in the window
+double sliding_window_last(const sliding_window_t* window) {
+    if (window->count == 0) return 0.0;
+    return window->values[(window->seq - 1) % window->capacity];
+}
+
+// Sample at logical position `index` (0 = oldest)
+double sliding_window_at(const sliding_window_t* window, int index) {
+    uint64_t first = window->seq - window->count;
+    return window->values[(first + index) % window->capacity];
+}
+
+// Copy the window in arrival order, returns the number of samples copied
+int sliding_window_copy(const sliding_window_t* window, double* out) {
+    if (!window || !out) return 0;
+
+    int first = (int)((window->seq - window->count) % window->capacity);
+    int tail_len = MIN(window->count, window->capacity - first);
+    memcpy(out, &window->values[first], tail_len * sizeof(double));
+    memcpy(out + tail_len, window->values, (window->count - tail_len) * sizeof(double));
+
+    return window->count;
+}
+
+// Node holding the k-th smallest sample and the node right after it in
+// order (TREE_NIL if none), found in a single descent
+static int32_t tree_kth_node(const sliding_window_t* window, int k, int32_t* next) {
+    int32_t node = window->root;
+    int32_t successor = TREE_NIL;
+
+    while (node != TREE_NIL) {
+        const sliding_window_node_t* n = &window->nodes[node];
+        int32_t left_size = tree_size(window, n->left);
+
+        if (k < left_size) {
+            successor = node;
+            node = n->left;
+        } else if (k == left_size) {
+            if (next) {
+                // Leftmost node of the right subtree, else the last ancestor we went left at
+                int32_t right = n->right;
+                if (right != TREE_NIL) {
+                    while (window->nodes[right].left != TREE_NIL) {
+                        right = window->nodes[right].left;
+                    }
+                    successor = right;
+                }
+                *next = successor;
+            }
+            return node;
+        } else {
+            k -= left_size + 1;
+            node = n->right;
+        }
+    }
+
+    return TREE_NIL;
+}
+
+// k-th smallest sample in the window (0-based)
+double sliding_window_kth(const sliding_window_t* window, int k) {
+    if (!window || k < 0 || k >= window->count) return 0.0;
+
+    int32_t node = tree_kth_node(window, k, NULL);
+    return node == TREE_NIL ? 0.0 : window->values[node];
+}
+
+// Quantile with linear interpolation between closest ranks (q = 0.5 is the median)
+double sliding_window_quantile(const sliding_window_t* window, double q) {
+    if (!window || window->count == 0) return 0.0;
+
+    double position = CLAMP(q, 0.0, 1.0) * (window->count - 1);
+    int lower = (int)position;
+    double fraction = position - lower;
+
+    int32_t next = TREE_NIL;
+    int32_t node = tree_kth_node(window, lower, &next);
+    if (node == TREE_NIL) return 0.0;
+
+    double low_value = window->values[node];
+    if (fraction == 0.0 || next == TREE_NIL) {
+        return low_value;
+    }
+    return low_value + (window->values[next] - low_value) * fraction;
+}
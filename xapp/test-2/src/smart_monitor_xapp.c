@@ -149,23 +149,64 @@ int xapp_init(xapp_context_t* ctx) {
         return -1;
     }
     
-    // Initialize analytics
-    ctx->analytics_ctx = analytics_init(THRESHOLDS_FILE_PATH);
-    if (!ctx->analytics_ctx) {
+    if (strcmp(ctx->config.metric_storage, "blocks") == 0) {
+        ctx->db_ctx->config.metric_storage = DATABASE_METRIC_STORAGE_BLOCKS;
+    }
+    memcpy(ctx->db_ctx->config.event_policy, ctx->config.event_policy, sizeof(ctx->config.event_policy));
+    ctx->db_ctx->config.event_summary_ms = ctx->config.event_summary_ms;
+    
+    // Restore before anything else writes or reads the database
+    if (ctx->config.restore_path[0] && database_restore(ctx->db_ctx, ctx->config.restore_path) != 0) {
+        LOG_ERROR("Failed to restore database from %s", ctx->config.restore_path);
+        return -1;
+    }
+    
+    // Open the segment log; recovers segments a previous run left behind
+    if (ctx->config.segment_log_dir[0]) {
+        ctx->compactor_db = database_init(ctx->config.database_path);
+        if (!ctx->compactor_db) {
+            LOG_ERROR("Failed to initialize compactor database connection");
+            return -1;
+        }
+        ctx->compactor_db->config.metric_storage = ctx->db_ctx->config.metric_storage;
+        
+        ctx->segment_log = segment_log_open(ctx->config.segment_log_dir, SEGMENT_LOG_RECORDS, SEGMENT_LOG_SYNC_MS);
+        if (!ctx->segment_log) {
+            LOG_ERROR("Failed to open segment log");
+            return -1;
+        }
+    }
+    
+    // Initialize analytics shards, one per core unless configured
+    int shard_count = ctx->config.analytics_shards;
+    if (shard_count <= 0) {
+        shard_count = CLAMP(utils_get_cpu_count(), 1, ANALYTICS_MAX_SHARDS);
+    }
+    
+    ctx->analytics = analytics_shards_create(THRESHOLDS_FILE_PATH, shard_count,
+                                             METRIC_QUEUE_CAPACITY, ANALYTICS_BATCH_SIZE);
+    if (!ctx->analytics) {
         LOG_ERROR("Failed to initialize analytics");
         return -1;
     }
+    atomic_store(&ctx->dropped_metrics, 0);
+    kpm_decoder_init(&ctx->kpm_decoder);
     
     // Initialize statistics
     ctx->start_time = time(NULL);
-    ctx->total_indications = 0;
-    ctx->total_errors = 0;
+    atomic_store(&ctx->total_indications, 0);
+    atomic_store(&ctx->total_errors, 0);
     ctx->total_anomalies = 0;
     ctx->total_recommendations = 0;
     
-    // Initialize node and subscription arrays
-    ctx->node_count = 0;
-    ctx->subscription_count = 0;
+    // Initialize node and subscription registry
+    ctx->registry = registry_create();
+    ctx->nodes = registry_map_create(REGISTRY_INITIAL_CAPACITY);
+    ctx->subscriptions = registry_map_create(REGISTRY_INITIAL_CAPACITY * SERVICE_MODEL_COUNT);
+    if (!ctx->registry || !ctx->nodes || !ctx->subscriptions) {
+        LOG_ERROR("Failed to initialize node registry");
+        return -1;
+    }
     
     ctx->state = XAPP_STATE_CONNECTING;
     
@@ -173,6 +214,11 @@ int xapp_init(xapp_context_t* ctx) {
     return 0;
 }
 
+// Compactor callback: store one sealed segment of raw metrics
+static int compact_metric_segment(uint64_t sequence, const metric_data_t* metrics, size_t count, void* user_data) {
+    return database_compact_segment((database_context_t*)user_data, sequence, metrics, (int)count) < 0 ? -1 : 0;
+}
+
 // Start the xApp
 int xapp_start(xapp_context_t* ctx) {
     int ret = 0;
@@ -226,16 +272,25 @@ int xapp_start(xapp_context_t* ctx) {
     ctx->state = XAPP_STATE_CONNECTED;
     
     // Create fake node for demonstration
-    if (ctx->node_count < MAX_NODES) {
-        node_info_t* node = &ctx->nodes[ctx->node_count++];
-        node->node_id = 1;
-        snprintf(node->node_name, sizeof(node->node_name), "Simulated_Node_1");
-        node->connected = true;
-        node->last_update = time(NULL);
-        node->subscription_count = 0;
-    }
+    add_node(ctx, 1, "Simulated_Node_1");
 #endif
     
+    // Start the database writer so inserts never wait for disk
+    ret = database_start_writer(ctx->db_ctx);
+    if (ret != 0) {
+        LOG_ERROR("Failed to start database writer");
+        return ret;
+    }
+    
+    // Fold sealed segments into the database in the background
+    if (ctx->segment_log) {
+        ret = segment_log_start_compactor(ctx->segment_log, compact_metric_segment, ctx->compactor_db);
+        if (ret != 0) {
+            LOG_ERROR("Failed to start segment compactor");
+            return ret;
+        }
+    }
+    
     // Start monitoring thread
     ret = pthread_create(&ctx->monitor_thread, NULL, monitor_thread_func, ctx);
     if (ret != 0) {
@@ -243,7 +298,14 @@ int xapp_start(xapp_context_t* ctx) {
         return ret;
     }
     
-    // Start analytics thread
+    // Start analytics shard workers
+    ret = analytics_shards_start(ctx->analytics);
+    if (ret != 0) {
+        LOG_ERROR("Failed to start analytics shards");
+        return ret;
+    }
+    
+    // Start analytics reporting thread
     ret = pthread_create(&ctx->analytics_thread, NULL, analytics_thread_func, ctx);
     if (ret != 0) {
         LOG_ERROR("Failed to create analytics thread: %d", ret);
@@ -271,6 +333,13 @@ int xapp_stop(xapp_context_t* ctx) {
         pthread_join(ctx->monitor_thread, NULL);
     }
     
+    // Let the shards finish what producers queued, then let the analytics
+    // thread store the last events and exit
+    analytics_shards_stop(ctx->analytics);
+    if (ctx->analytics) {
+        analytics_event_log_close(ctx->analytics->events);
+    }
+    
     if (ctx->analytics_thread) {
         pthread_join(ctx->analytics_thread, NULL);
     }
@@ -299,11 +368,26 @@ void xapp_cleanup(xapp_context_t* ctx) {
     }
     
     // Cleanup analytics
-    if (ctx->analytics_ctx) {
-        analytics_cleanup(ctx->analytics_ctx);
+    analytics_shards_destroy(ctx->analytics);
+    ctx->analytics = NULL;
+    
+    // Free nodes and subscriptions; no callback or monitor reads them anymore
+    registry_map_destroy(ctx->subscriptions);
+    registry_map_destroy(ctx->nodes);
+    registry_destroy(ctx->registry);
+    ctx->subscriptions = NULL;
+    ctx->nodes = NULL;
+    ctx->registry = NULL;
+    
+    // Close the segment log after compacting its sealed segments; the
+    // active one is recovered on the next start
+    segment_log_close(ctx->segment_log);
+    ctx->segment_log = NULL;
+    if (ctx->compactor_db) {
+        database_cleanup(ctx->compactor_db);
     }
     
-    // Cleanup database
+    // Cleanup database; commits rows the writer still holds
     if (ctx->db_ctx) {
         database_cleanup(ctx->db_ctx);
     }
@@ -324,6 +408,8 @@ int load_config(xapp_context_t* ctx) {
     strcpy(ctx->config.version, XAPP_VERSION);
     ctx->config.monitoring_interval = DEFAULT_MONITORING_INTERVAL;
     strcpy(ctx->config.database_path, "/tmp/xapp_data.db");
+    strcpy(ctx->config.metric_storage, "rows");
+    ctx->config.segment_log_dir[0] = '\0';
     strcpy(ctx->config.log_level, "INFO");
     strcpy(ctx->config.ric_ip, DEFAULT_RIC_IP);
     ctx->config.ric_port = DEFAULT_RIC_PORT;
@@ -341,6 +427,19 @@ int load_config(xapp_context_t* ctx) {
     ctx->config.trend_analysis = true;
     ctx->config.recommendations = true;
     ctx->config.alert_threshold = 0.8;
+    ctx->config.analytics_shards = 0;
+    
+    // Count indications, log every other event
+    for (int type = 0; type < EVENT_TYPE_COUNT; type++) {
+        ctx->config.event_policy[type] = DATABASE_EVENT_LOG;
+    }
+    ctx->config.event_policy[EVENT_INDICATION_RECEIVED] = DATABASE_EVENT_COUNT;
+    ctx->config.event_summary_ms = DATABASE_EVENT_SUMMARY_MS;
+    
+    // No backups unless configured
+    ctx->config.backup_path[0] = '\0';
+    ctx->config.backup_interval = DEFAULT_BACKUP_INTERVAL;
+    ctx->config.restore_path[0] = '\0';
     
     // Try to load configuration file
     json_object* config_obj = utils_json_load_file(CONFIG_FILE_PATH);
@@ -352,6 +451,8 @@ int load_config(xapp_context_t* ctx) {
         utils_json_get_string(config_obj, "version", ctx->config.version, sizeof(ctx->config.version));
         utils_json_get_int(config_obj, "monitoring_interval", &ctx->config.monitoring_interval);
         utils_json_get_string(config_obj, "database_path", ctx->config.database_path, sizeof(ctx->config.database_path));
+        utils_json_get_string(config_obj, "metric_storage", ctx->config.metric_storage, sizeof(ctx->config.metric_storage));
+        utils_json_get_string(config_obj, "segment_log_dir", ctx->config.segment_log_dir, sizeof(ctx->config.segment_log_dir));
         utils_json_get_string(config_obj, "log_level", ctx->config.log_level, sizeof(ctx->config.log_level));
         utils_json_get_string(config_obj, "ric_ip", ctx->config.ric_ip, sizeof(ctx->config.ric_ip));
         utils_json_get_int(config_obj, "ric_port", &ctx->config.ric_port);
@@ -374,6 +475,34 @@ int load_config(xapp_context_t* ctx) {
             utils_json_get_bool(analytics_obj, "trend_analysis", &ctx->config.trend_analysis);
             utils_json_get_bool(analytics_obj, "recommendations", &ctx->config.recommendations);
             utils_json_get_double(analytics_obj, "alert_threshold", &ctx->config.alert_threshold);
+            utils_json_get_int(analytics_obj, "shards", &ctx->config.analytics_shards);
+        }
+        
+        // Parse event logging configuration; policies are keyed by event type name
+        json_object* events_obj;
+        if (json_object_object_get_ex(config_obj, "events", &events_obj)) {
+            utils_json_get_int(events_obj, "summary_interval_ms", &ctx->config.event_summary_ms);
+            
+            json_object* policy_obj;
+            if (json_object_object_get_ex(events_obj, "policy", &policy_obj)) {
+                for (int type = 0; type < EVENT_TYPE_COUNT; type++) {
+                    char policy[16] = "";
+                    utils_json_get_string(policy_obj, database_event_type_to_string(type), policy, sizeof(policy));
+                    if (strcmp(policy, "count") == 0) {
+                        ctx->config.event_policy[type] = DATABASE_EVENT_COUNT;
+                    } else if (strcmp(policy, "log") == 0) {
+                        ctx->config.event_policy[type] = DATABASE_EVENT_LOG;
+                    }
+                }
+            }
+        }
+        
+        // Parse backup configuration
+        json_object* backup_obj;
+        if (json_object_object_get_ex(config_obj, "backup", &backup_obj)) {
+            utils_json_get_string(backup_obj, "path", ctx->config.backup_path, sizeof(ctx->config.backup_path));
+            utils_json_get_int(backup_obj, "interval", &ctx->config.backup_interval);
+            utils_json_get_string(backup_obj, "restore_from", ctx->config.restore_path, sizeof(ctx->config.restore_path));
         }
         
         json_object_put(config_obj);
@@ -394,6 +523,8 @@ void print_config(const xapp_config_t* config) {
     LOG_INFO("Version: %s", config->version);
     LOG_INFO("Monitoring Interval: %d ms", config->monitoring_interval);
     LOG_INFO("Database Path: %s", config->database_path);
+    LOG_INFO("Metric Storage: %s", config->metric_storage);
+    LOG_INFO("Segment Log: %s", config->segment_log_dir[0] ? config->segment_log_dir : "disabled");
     LOG_INFO("Log Level: %s", config->log_level);
     LOG_INFO("RIC IP: %s", config->ric_ip);
     LOG_INFO("RIC Port: %d", config->ric_port);
@@ -411,6 +542,29 @@ void print_config(const xapp_config_t* config) {
     LOG_INFO("Trend Analysis: %s", config->trend_analysis ? "Yes" : "No");
     LOG_INFO("Recommendations: %s", config->recommendations ? "Yes" : "No");
     LOG_INFO("Alert Threshold: %.2f", config->alert_threshold);
+    if (config->analytics_shards > 0) {
+        LOG_INFO("Analytics Shards: %d", config->analytics_shards);
+    } else {
+        LOG_INFO("Analytics Shards: one per core");
+    }
+    
+    LOG_INFO("=== Event Configuration ===");
+    for (int type = 0; type < EVENT_TYPE_COUNT; type++) {
+        if (config->event_policy[type] == DATABASE_EVENT_COUNT) {
+            LOG_INFO("Counted Event: %s", database_event_type_to_string(type));
+        }
+    }
+    LOG_INFO("Event Summary Interval: %d ms", config->event_summary_ms);
+    
+    LOG_INFO("=== Backup Configuration ===");
+    if (config->backup_path[0]) {
+        LOG_INFO("Backup: %s every %d s", config->backup_path, config->backup_interval);
+    } else {
+        LOG_INFO("Backup: disabled");
+    }
+    if (config->restore_path[0]) {
+        LOG_INFO("Restore From: %s", config->restore_path);
+    }
     LOG_INFO("=====================");
 }
 
@@ -421,25 +575,30 @@ void print_statistics(const xapp_context_t* ctx) {
     
     LOG_INFO("=== Statistics (Uptime: %.0f seconds) ===", uptime);
     LOG_INFO("State: %s", ctx->state == XAPP_STATE_RUNNING ? "Running" : "Other");
-    LOG_INFO("Connected Nodes: %d", ctx->node_count);
-    LOG_INFO("Active Subscriptions: %d", ctx->subscription_count);
-    LOG_INFO("Total Indications: %llu", (unsigned long long)ctx->total_indications);
-    LOG_INFO("Total Errors: %llu", (unsigned long long)ctx->total_errors);
+    LOG_INFO("Connected Nodes: %u", ctx->nodes ? registry_map_count(ctx->nodes) : 0);
+    LOG_INFO("Active Subscriptions: %u", ctx->subscriptions ? registry_map_count(ctx->subscriptions) : 0);
+    uint64_t total_indications = atomic_load(&((xapp_context_t*)ctx)->total_indications);
+    LOG_INFO("Total Indications: %llu", (unsigned long long)total_indications);
+    LOG_INFO("Total Errors: %llu", (unsigned long long)atomic_load(&((xapp_context_t*)ctx)->total_errors));
     LOG_INFO("Total Anomalies: %llu", (unsigned long long)ctx->total_anomalies);
     LOG_INFO("Total Recommendations: %llu", (unsigned long long)ctx->total_recommendations);
     
     if (uptime > 0) {
-        LOG_INFO("Indications/sec: %.2f", ctx->total_indications / uptime);
+        LOG_INFO("Indications/sec: %.2f", total_indications / uptime);
     }
     
     // Print database statistics
     if (ctx->db_ctx) {
         database_print_performance(ctx->db_ctx);
     }
+    if (ctx->segment_log) {
+        segment_log_print_performance(ctx->segment_log);
+    }
     
-    // Print analytics statistics
-    if (ctx->analytics_ctx) {
-        analytics_print_performance(ctx->analytics_ctx);
+    // Print analytics statistics, merged across shards
+    LOG_INFO("Dropped Metrics: %llu", (unsigned long long)atomic_load(&((xapp_context_t*)ctx)->dropped_metrics));
+    if (ctx->analytics) {
+        analytics_shards_print_performance(ctx->analytics);
     }
     
     LOG_INFO("=====================================");
@@ -454,17 +613,9 @@ void e2ap_connection_callback(e2ap_handle_t handle, uint32_t node_id, bool conne
         LOG_INFO("E2 Node %u connected", node_id);
         
         // Find or create node entry
-        node_info_t* node = find_node(ctx, node_id);
-        if (!node && ctx->node_count < MAX_NODES) {
-            node = &ctx->nodes[ctx->node_count++];
-            node->node_id = node_id;
-            snprintf(node->node_name, sizeof(node->node_name), "Node_%u", node_id);
-            node->subscription_count = 0;
-        }
-        
-        if (node) {
-            node->connected = true;
-            node->last_update = time(NULL);
+        if (!add_node(ctx, node_id, NULL)) {
+            LOG_ERROR("Failed to register E2 Node %u", node_id);
+            atomic_fetch_add_explicit(&ctx->total_errors, 1, memory_order_relaxed);
         }
         
         // Update state if this is the first connection
@@ -481,11 +632,13 @@ void e2ap_connection_callback(e2ap_handle_t handle, uint32_t node_id, bool conne
         LOG_INFO("E2 Node %u disconnected", node_id);
         
         // Update node status
+        int slot = registry_read_lock(ctx->registry);
         node_info_t* node = find_node(ctx, node_id);
         if (node) {
             node->connected = false;
             node->last_update = time(NULL);
         }
+        registry_read_unlock(ctx->registry, slot);
         
         // Log event to database
         if (ctx->db_ctx) {
@@ -503,11 +656,13 @@ void e2ap_subscription_callback(e2ap_handle_t handle, uint32_t subscription_id,
         LOG_INFO("Subscription %u created successfully", subscription_id);
         
         // Update subscription status
+        int slot = registry_read_lock(ctx->registry);
         subscription_info_t* sub = find_subscription(ctx, subscription_id);
         if (sub) {
-            sub->active = true;
             sub->created_at = time(NULL);
+            sub->active = true;
         }
+        registry_read_unlock(ctx->registry, slot);
         
         // Log event to database
         if (ctx->db_ctx) {
@@ -515,7 +670,7 @@ void e2ap_subscription_callback(e2ap_handle_t handle, uint32_t subscription_id,
         }
     } else {
         LOG_ERROR("Subscription %u creation failed", subscription_id);
-        ctx->total_errors++;
+        atomic_fetch_add_explicit(&ctx->total_errors, 1, memory_order_relaxed);
         
         // Log event to database
         if (ctx->db_ctx) {
@@ -529,28 +684,19 @@ void e2ap_indication_callback(e2ap_handle_t handle, uint32_t subscription_id, co
     (void)handle;  // Suppress unused parameter warning
     xapp_context_t* ctx = &g_xapp_ctx;
     
-    ctx->total_indications++;
+    atomic_fetch_add_explicit(&ctx->total_indications, 1, memory_order_relaxed);
     
-    // Update subscription statistics
+    // Update subscription statistics; no lock, the read section only keeps
+    // the subscription from being freed under the handler
+    int slot = registry_read_lock(ctx->registry);
     subscription_info_t* sub = find_subscription(ctx, subscription_id);
     if (sub) {
-        sub->indication_count++;
+        atomic_fetch_add_explicit(&sub->indication_count, 1, memory_order_relaxed);
         
-        // Route to appropriate handler based on service model
-        if (strcmp(sub->sm_name, "KMP") == 0) {
-            handle_kmp_indication(ctx, indication);
-        } else if (strcmp(sub->sm_name, "RC") == 0) {
-            handle_rc_indication(ctx, indication);
-        } else if (strcmp(sub->sm_name, "MAC") == 0) {
-            handle_mac_indication(ctx, indication);
-        } else if (strcmp(sub->sm_name, "RLC") == 0) {
-            handle_rlc_indication(ctx, indication);
-        } else if (strcmp(sub->sm_name, "PDCP") == 0) {
-            handle_pdcp_indication(ctx, indication);
-        } else if (strcmp(sub->sm_name, "GTP") == 0) {
-            handle_gtp_indication(ctx, indication);
-        }
+        // Handler resolved from the service model when the subscription was created
+        sub->handler(ctx, indication);
     }
+    registry_read_unlock(ctx->registry, slot);
     
     // Log event to database
     if (ctx->db_ctx) {
@@ -567,7 +713,7 @@ void e2ap_control_callback(e2ap_handle_t handle, uint32_t request_id, bool succe
         LOG_DEBUG("Control request %u successful", request_id);
     } else {
         LOG_ERROR("Control request %u failed", request_id);
-        ctx->total_errors++;
+        atomic_fetch_add_explicit(&ctx->total_errors, 1, memory_order_relaxed);
     }
     
     // Log event to database
@@ -577,18 +723,40 @@ void e2ap_control_callback(e2ap_handle_t handle, uint32_t request_id, bool succe
     }
 }
 
+// Hand metrics to the analytics shards. Safe from any thread and never
+// blocks; metrics that do not fit in their shard queue are counted and dropped.
+int enqueue_metrics(xapp_context_t* ctx, const metric_data_t* metrics, size_t count) {
+    // Capture the raw samples first; the compactor stores them in the database
+    if (ctx->segment_log) {
+        segment_log_append(ctx->segment_log, metrics, count);
+    }
+    
+    size_t queued = analytics_shards_submit(ctx->analytics, metrics, count);
+    
+    if (queued < count) {
+        atomic_fetch_add_explicit(&ctx->dropped_metrics, count - queued, memory_order_relaxed);
+        return -1;
+    }
+    
+    return 0;
+}
+
 // Service model indication handlers (simplified implementations)
 void handle_kmp_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
-    // Parse KMP indication and extract metrics
-    // This is a simplified implementation - in real scenario, you would parse the actual indication
-    
-    // Example: Extract throughput metric
-    double throughput = 100.0 + (rand() % 900);  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_THROUGHPUT, throughput, indication->node_id, 0);
+    // The payload is validated as a whole, then decoded in place one
+    // stack batch at a time, each batch going to analytics as it is
+    kpm_reader_t reader;
+    if (kpm_reader_init(&reader, &ctx->kpm_decoder, indication->data, indication->data_size, indication->node_id) != 0) {
+        LOG_WARN("Malformed KPM indication from node %u (%zu bytes)", indication->node_id, indication->data_size);
+        atomic_fetch_add_explicit(&ctx->total_errors, 1, memory_order_relaxed);
+        return;
+    }
     
-    // Example: Extract latency metric
-    double latency = 10.0 + (rand() % 50);  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_LATENCY, latency, indication->node_id, 0);
+    metric_data_t metrics[KPM_DECODE_BATCH];
+    size_t count;
+    while ((count = kpm_reader_next(&reader, metrics, KPM_DECODE_BATCH)) > 0) {
+        enqueue_metrics(ctx, metrics, count);
+    }
 }
 
 void handle_rc_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
@@ -597,7 +765,8 @@ void handle_rc_indication(xapp_context_t* ctx, const e2ap_indication_t* indicati
     
     // Example: Extract RSRP metric
     double rsrp = -100.0 + (rand() % 50);  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_RSRP, rsrp, indication->node_id, 0);
+    metric_data_t metric = { .type = METRIC_RSRP, .value = rsrp, .node_id = indication->node_id, .cell_id = 0, .timestamp = time(NULL) };
+    enqueue_metrics(ctx, &metric, 1);
 }
 
 void handle_mac_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
@@ -606,7 +775,8 @@ void handle_mac_indication(xapp_context_t* ctx, const e2ap_indication_t* indicat
     
     // Example: Extract PRB usage
     double prb_usage = rand() % 100;  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_PRB_USAGE, prb_usage, indication->node_id, 0);
+    metric_data_t metric = { .type = METRIC_PRB_USAGE, .value = prb_usage, .node_id = indication->node_id, .cell_id = 0, .timestamp = time(NULL) };
+    enqueue_metrics(ctx, &metric, 1);
 }
 
 void handle_rlc_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
@@ -615,7 +785,8 @@ void handle_rlc_indication(xapp_context_t* ctx, const e2ap_indication_t* indicat
     
     // Example: Extract packet loss
     double packet_loss = (rand() % 100) / 100.0;  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_PACKET_LOSS, packet_loss, indication->node_id, 0);
+    metric_data_t metric = { .type = METRIC_PACKET_LOSS, .value = packet_loss, .node_id = indication->node_id, .cell_id = 0, .timestamp = time(NULL) };
+    enqueue_metrics(ctx, &metric, 1);
 }
 
 void handle_pdcp_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
@@ -624,7 +795,8 @@ void handle_pdcp_indication(xapp_context_t* ctx, const e2ap_indication_t* indica
     
     // Example: Extract CPU utilization
     double cpu_usage = 20.0 + (rand() % 60);  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_CPU_UTILIZATION, cpu_usage, indication->node_id, 0);
+    metric_data_t metric = { .type = METRIC_CPU_UTILIZATION, .value = cpu_usage, .node_id = indication->node_id, .cell_id = 0, .timestamp = time(NULL) };
+    enqueue_metrics(ctx, &metric, 1);
 }
 
 void handle_gtp_indication(xapp_context_t* ctx, const e2ap_indication_t* indication) {
@@ -633,7 +805,80 @@ void handle_gtp_indication(xapp_context_t* ctx, const e2ap_indication_t* indicat
     
     // Example: Extract memory usage
     double memory_usage = 30.0 + (rand() % 50);  // Simulated value
-    analytics_add_metric(ctx->analytics_ctx, METRIC_MEMORY_USAGE, memory_usage, indication->node_id, 0);
+    metric_data_t metric = { .type = METRIC_MEMORY_USAGE, .value = memory_usage, .node_id = indication->node_id, .cell_id = 0, .timestamp = time(NULL) };
+    enqueue_metrics(ctx, &metric, 1);
+}
+
+// Service models: name, RAN function ID and indication handler
+typedef struct {
+    const char* name;
+    uint16_t ran_func_id;
+    indication_handler_t handler;
+} service_model_info_t;
+
+static const service_model_info_t SERVICE_MODELS[SERVICE_MODEL_COUNT] = {
+    [SERVICE_MODEL_KMP]  = { "KMP", 2, handle_kmp_indication },
+    [SERVICE_MODEL_RC]   = { "RC", 3, handle_rc_indication },
+    [SERVICE_MODEL_MAC]  = { "MAC", 142, handle_mac_indication },
+    [SERVICE_MODEL_RLC]  = { "RLC", 143, handle_rlc_indication },
+    [SERVICE_MODEL_PDCP] = { "PDCP", 144, handle_pdcp_indication },
+    [SERVICE_MODEL_GTP]  = { "GTP", 148, handle_gtp_indication }
+};
+
+_Static_assert(offsetof(node_info_t, node_id) == 0, "Registry key must come first");
+_Static_assert(offsetof(subscription_info_t, subscription_id) == 0, "Registry key must come first");
+
+const char* service_model_to_string(service_model_t service_model) {
+    return service_model < SERVICE_MODEL_COUNT ? SERVICE_MODELS[service_model].name : "UNKNOWN";
+}
+
+// Whether the configuration enables a service model
+static bool service_model_enabled(const xapp_config_t* config, service_model_t service_model) {
+    switch (service_model) {
+        case SERVICE_MODEL_KMP: return config->kmp_enabled;
+        case SERVICE_MODEL_RC: return config->rc_enabled;
+        case SERVICE_MODEL_MAC: return config->mac_enabled;
+        case SERVICE_MODEL_RLC: return config->rlc_enabled;
+        case SERVICE_MODEL_PDCP: return config->pdcp_enabled;
+        case SERVICE_MODEL_GTP: return config->gtp_enabled;
+        default: return false;
+    }
+}
+
+// Add a subscription, resolving its service model to a handler once
+subscription_info_t* add_subscription(xapp_context_t* ctx, uint32_t subscription_id, uint32_t node_id,
+                                      service_model_t service_model) {
+    if (service_model >= SERVICE_MODEL_COUNT) {
+        return NULL;
+    }
+    
+    const service_model_info_t* model = &SERVICE_MODELS[service_model];
+    subscription_info_t* sub = calloc(1, sizeof(subscription_info_t));
+    if (!sub) {
+        return NULL;
+    }
+    
+    sub->subscription_id = subscription_id;
+    sub->node_id = node_id;
+    sub->ran_func_id = model->ran_func_id;
+    strcpy(sub->sm_name, model->name);
+    sub->service_model = service_model;
+    sub->handler = model->handler;
+    
+    // Fails for an ID already in use
+    registry_write_lock(ctx->registry);
+    if (registry_map_insert(ctx->registry, ctx->subscriptions, sub) != 0) {
+        free(sub);
+        sub = NULL;
+    } else {
+        node_info_t* node = find_node(ctx, node_id);
+        if (node) {
+            node->subscription_count++;
+        }
+    }
+    registry_write_unlock(ctx->registry);
+    
+    return sub;
 }
 
 // Create subscriptions for all enabled service models
@@ -643,37 +888,43 @@ int create_subscriptions(xapp_context_t* ctx) {
     // This is a simplified implementation
     // In a real scenario, you would create actual E2AP subscriptions
     
-    int subscription_id = 1;
+    uint32_t subscription_id = 1;
     
-    for (int i = 0; i < ctx->node_count; i++) {
-        uint32_t node_id = ctx->nodes[i].node_id;
-        
-        // Create KMP subscription
-        if (ctx->config.kmp_enabled && ctx->subscription_count < MAX_NODES * 6) {
-            subscription_info_t* sub = &ctx->subscriptions[ctx->subscription_count++];
-            sub->subscription_id = subscription_id++;
-            sub->node_id = node_id;
-            sub->ran_func_id = 2;  // KMP RAN function ID
-            strcpy(sub->sm_name, "KMP");
-            sub->active = false;
-            sub->indication_count = 0;
+    // Collect the node IDs first: add_subscription writes the registry,
+    // which must not happen inside a read section
+    uint32_t* node_ids = NULL;
+    uint32_t node_count = 0;
+    
+    int slot = registry_read_lock(ctx->registry);
+    uint32_t capacity = registry_map_count(ctx->nodes);
+    if (capacity > 0) {
+        node_ids = malloc(capacity * sizeof(uint32_t));
+    }
+    if (node_ids) {
+        registry_iter_t iter;
+        node_info_t* node;
+        registry_iter_init(&iter, ctx->nodes);
+        while ((node = registry_iter_next(&iter)) && node_count < capacity) {
+            node_ids[node_count++] = node->node_id;
         }
-        
-        // Create RC subscription
-        if (ctx->config.rc_enabled && ctx->subscription_count < MAX_NODES * 6) {
-            subscription_info_t* sub = &ctx->subscriptions[ctx->subscription_count++];
-            sub->subscription_id = subscription_id++;
-            sub->node_id = node_id;
-            sub->ran_func_id = 3;  // RC RAN function ID
-            strcpy(sub->sm_name, "RC");
-            sub->active = false;
-            sub->indication_count = 0;
+    }
+    registry_read_unlock(ctx->registry, slot);
+    
+    if (capacity > 0 && !node_ids) {
+        LOG_ERROR("Failed to allocate node list for subscriptions");
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < node_count; i++) {
+        for (int sm = 0; sm < SERVICE_MODEL_COUNT; sm++) {
+            if (service_model_enabled(&ctx->config, (service_model_t)sm)) {
+                add_subscription(ctx, subscription_id++, node_ids[i], (service_model_t)sm);
+            }
         }
-        
-        // Similar for other service models...
     }
+    free(node_ids);
     
-    LOG_INFO("Created %d subscriptions", ctx->subscription_count);
+    LOG_INFO("Created %u subscriptions", registry_map_count(ctx->subscriptions));
     return 0;
 }
 
@@ -684,41 +935,114 @@ int remove_subscriptions(xapp_context_t* ctx) {
     // This is a simplified implementation
     // In a real scenario, you would remove actual E2AP subscriptions
     
-    for (int i = 0; i < ctx->subscription_count; i++) {
-        subscription_info_t* sub = &ctx->subscriptions[i];
+    // Events are logged after the write section, which every other writer
+    // waits on; only the IDs are kept since the entries are retired
+    struct { uint32_t node_id; uint32_t subscription_id; }* removed = NULL;
+    uint32_t removed_count = 0;
+    
+    registry_write_lock(ctx->registry);
+    uint32_t count = registry_map_count(ctx->subscriptions);
+    if (ctx->db_ctx && count > 0) {
+        removed = malloc(count * sizeof(*removed));
+        if (!removed) {
+            LOG_WARN("Subscription removals will not be logged");
+        }
+    }
+    
+    registry_iter_t iter;
+    subscription_info_t* sub;
+    registry_iter_init(&iter, ctx->subscriptions);
+    while ((sub = registry_iter_next(&iter))) {
         sub->active = false;
         
-        // Log event to database
-        if (ctx->db_ctx) {
-            database_log_event(ctx->db_ctx, EVENT_SUBSCRIPTION_DELETE, sub->node_id, sub->subscription_id, 
-                              "Subscription removed", "");
+        if (removed && removed_count < count) {
+            removed[removed_count].node_id = sub->node_id;
+            removed[removed_count].subscription_id = sub->subscription_id;
+            removed_count++;
+        }
+        
+        node_info_t* node = find_node(ctx, sub->node_id);
+        if (node) {
+            node->subscription_count--;
         }
+        registry_map_remove(ctx->subscriptions, sub->subscription_id);
+        registry_retire(ctx->registry, sub);
     }
+    registry_write_unlock(ctx->registry);
     
-    ctx->subscription_count = 0;
+    // Log events to database
+    for (uint32_t i = 0; i < removed_count; i++) {
+        database_log_event(ctx->db_ctx, EVENT_SUBSCRIPTION_DELETE, removed[i].node_id, removed[i].subscription_id,
+                           "Subscription removed", "");
+    }
+    free(removed);
     
     LOG_INFO("Removed all subscriptions");
     return 0;
 }
 
-// Find subscription by ID
+// Find subscription by ID: one probe unless IDs collide. Call inside a
+// registry read section.
 subscription_info_t* find_subscription(xapp_context_t* ctx, uint32_t subscription_id) {
-    for (int i = 0; i < ctx->subscription_count; i++) {
-        if (ctx->subscriptions[i].subscription_id == subscription_id) {
-            return &ctx->subscriptions[i];
+    return registry_map_find(ctx->subscriptions, subscription_id);
+}
+
+// Find a node or register a new one, and mark it connected
+node_info_t* add_node(xapp_context_t* ctx, uint32_t node_id, const char* name) {
+    registry_write_lock(ctx->registry);
+    
+    node_info_t* node = find_node(ctx, node_id);
+    if (!node) {
+        node = calloc(1, sizeof(node_info_t));
+        if (node) {
+            node->node_id = node_id;
+            if (name) {
+                snprintf(node->node_name, sizeof(node->node_name), "%s", name);
+            } else {
+                snprintf(node->node_name, sizeof(node->node_name), "Node_%u", node_id);
+            }
+            node->connected = true;
+            node->last_update = time(NULL);
+            
+            if (registry_map_insert(ctx->registry, ctx->nodes, node) != 0) {
+                free(node);
+                node = NULL;
+            }
         }
+    } else {
+        node->connected = true;
+        node->last_update = time(NULL);
     }
-    return NULL;
+    
+    registry_write_unlock(ctx->registry);
+    return node;
 }
 
-// Find node by ID
-node_info_t* find_node(xapp_context_t* ctx, uint32_t node_id) {
-    for (int i = 0; i < ctx->node_count; i++) {
-        if (ctx->nodes[i].node_id == node_id) {
-            return &ctx->nodes[i];
+// Forget a node and its subscriptions
+int remove_node(xapp_context_t* ctx, uint32_t node_id) {
+    registry_write_lock(ctx->registry);
+    
+    node_info_t* node = registry_map_remove(ctx->nodes, node_id);
+    if (node) {
+        registry_iter_t iter;
+        subscription_info_t* sub;
+        registry_iter_init(&iter, ctx->subscriptions);
+        while ((sub = registry_iter_next(&iter))) {
+            if (sub->node_id == node_id) {
+                registry_map_remove(ctx->subscriptions, sub->subscription_id);
+                registry_retire(ctx->registry, sub);
+            }
         }
+        registry_retire(ctx->registry, node);
     }
-    return NULL;
+    
+    registry_write_unlock(ctx->registry);
+    return node ? 0 : -1;
+}
+
+// Find node by ID. Call inside a registry read section.
+node_info_t* find_node(xapp_context_t* ctx, uint32_t node_id) {
+    return registry_map_find(ctx->nodes, node_id);
 }
 
 // Monitor thread function
@@ -727,23 +1051,57 @@ void* monitor_thread_func(void* arg) {
     
     LOG_INFO("Monitor thread started");
     
+    time_t last_backup = time(NULL);
+    
     while (ctx->running) {
         time_t current_time = time(NULL);
         
-        // Monitor node connections
-        for (int i = 0; i < ctx->node_count; i++) {
-            node_info_t* node = &ctx->nodes[i];
+        // Start the periodic backup; it copies in the background
+        if (ctx->config.backup_path[0] && current_time - last_backup >= ctx->config.backup_interval) {
+            database_start_backup(ctx->db_ctx, ctx->config.backup_path);
+            last_backup = current_time;
+        }
+        
+        // Monitor node connections. Expired nodes are removed after the read
+        // section, since removal writes the registry.
+        uint32_t* expired = NULL;
+        uint32_t expired_count = 0;
+        
+        int slot = registry_read_lock(ctx->registry);
+        uint32_t capacity = registry_map_count(ctx->nodes);
+        registry_iter_t iter;
+        node_info_t* node;
+        registry_iter_init(&iter, ctx->nodes);
+        while ((node = registry_iter_next(&iter))) {
+            time_t idle = current_time - node->last_update;
             
-            // Check for stale connections
-            if (node->connected && (current_time - node->last_update) > 60) {
+            // Check for stale connections; forget nodes long gone
+            if (node->connected && idle > 60) {
                 LOG_WARN("Node %u appears to be stale (last update: %ld seconds ago)", 
-                        node->node_id, current_time - node->last_update);
+                        node->node_id, idle);
+            } else if (!node->connected && idle > NODE_EXPIRY_SECONDS) {
+                if (!expired) {
+                    expired = malloc(capacity * sizeof(uint32_t));
+                }
+                if (expired && expired_count < capacity) {
+                    LOG_INFO("Forgetting E2 Node %u (disconnected %ld seconds ago)", node->node_id, idle);
+                    expired[expired_count++] = node->node_id;
+                }
             }
         }
+        registry_read_unlock(ctx->registry, slot);
+        
+        for (uint32_t i = 0; i < expired_count; i++) {
+            remove_node(ctx, expired[i]);
+        }
+        free(expired);
+        
+        // Free nodes and subscriptions no reader holds anymore
+        registry_reclaim(ctx->registry);
         
 #ifdef SIMPLIFIED_BUILD
         // Generate simulated metrics in simplified mode
-        if (ctx->analytics_ctx && ctx->node_count > 0) {
+        if (ctx->analytics && registry_map_count(ctx->nodes) > 0) {
             // Generate some realistic simulated metrics
             double base_throughput = 150.0;
             double base_latency = 25.0;
@@ -753,30 +1111,35 @@ void* monitor_thread_func(void* arg) {
             double time_factor = (double)(current_time % 3600) / 3600.0;  // 0-1 over an hour
             double noise = ((double)rand() / RAND_MAX - 0.5) * 0.2;  // ±10% noise
             
+            metric_data_t metrics[5];
+            int count = 0;
+            
             // Throughput with daily pattern
             double throughput = base_throughput * (0.8 + 0.4 * sin(time_factor * 2 * M_PI)) * (1.0 + noise);
-            analytics_add_metric(ctx->analytics_ctx, METRIC_THROUGHPUT, throughput, 1, 1);
+            metrics[count++] = (metric_data_t){ .type = METRIC_THROUGHPUT, .value = throughput, .node_id = 1, .cell_id = 1, .timestamp = current_time };
             
             // Latency with inverse relationship to throughput
             double latency = base_latency * (1.2 - 0.4 * sin(time_factor * 2 * M_PI)) * (1.0 + noise);
-            analytics_add_metric(ctx->analytics_ctx, METRIC_LATENCY, latency, 1, 1);
+            metrics[count++] = (metric_data_t){ .type = METRIC_LATENCY, .value = latency, .node_id = 1, .cell_id = 1, .timestamp = current_time };
             
             // RSRP with some random walk
             static double rsrp_drift = 0.0;
             rsrp_drift += ((double)rand() / RAND_MAX - 0.5) * 2.0;  // Random walk
             rsrp_drift = fmax(-10.0, fmin(10.0, rsrp_drift));  // Clamp drift
             double rsrp = base_rsrp + rsrp_drift + noise * 5.0;
-            analytics_add_metric(ctx->analytics_ctx, METRIC_RSRP, rsrp, 1, 1);
+            metrics[count++] = (metric_data_t){ .type = METRIC_RSRP, .value = rsrp, .node_id = 1, .cell_id = 1, .timestamp = current_time };
             
             // CPU utilization based on throughput
             double cpu_util = 30.0 + (throughput / base_throughput) * 40.0 + noise * 10.0;
-            analytics_add_metric(ctx->analytics_ctx, METRIC_CPU_UTILIZATION, cpu_util, 1, 1);
+            metrics[count++] = (metric_data_t){ .type = METRIC_CPU_UTILIZATION, .value = cpu_util, .node_id = 1, .cell_id = 1, .timestamp = current_time };
             
             // PRB usage
             double prb_usage = 40.0 + (throughput / base_throughput) * 35.0 + noise * 15.0;
-            analytics_add_metric(ctx->analytics_ctx, METRIC_PRB_USAGE, prb_usage, 1, 1);
+            metrics[count++] = (metric_data_t){ .type = METRIC_PRB_USAGE, .value = prb_usage, .node_id = 1, .cell_id = 1, .timestamp = current_time };
             
-            ctx->total_indications += 5;  // Count simulated indications
+            enqueue_metrics(ctx, metrics, count);
+            
+            atomic_fetch_add_explicit(&ctx->total_indications, 5, memory_order_relaxed);  // Count simulated indications
             
             LOG_DEBUG("Generated simulated metrics: throughput=%.1f, latency=%.1f, rsrp=%.1f, cpu=%.1f, prb=%.1f",
                      throughput, latency, rsrp, cpu_util, prb_usage);
@@ -791,65 +1154,76 @@ void* monitor_thread_func(void* arg) {
     return NULL;
 }
 
-// Analytics thread function
+// Store one anomaly or recommendation from the analytics event stream
+static void handle_analytics_event(xapp_context_t* ctx, const analytics_event_t* event) {
+    if (event->kind == ANALYTICS_EVENT_ANOMALY) {
+        const anomaly_result_t* anomaly = &event->anomaly;
+        
+        if (ctx->config.anomaly_detection && anomaly->severity >= ANOMALY_WARNING) {
+            LOG_WARN("Anomaly detected: %s", anomaly->description);
+            ctx->total_anomalies++;
+            
+            // Store anomaly in database
+            if (ctx->db_ctx) {
+                database_insert_anomaly(ctx->db_ctx, anomaly);
+                database_log_event(ctx->db_ctx, EVENT_ANOMALY_DETECTED, event->node_id, 0, 
+                                  "Anomaly detected", anomaly->description);
+            }
+        }
+    } else if (ctx->config.recommendations) {
+        const recommendation_result_t* rec = &event->recommendation;
+        
+        LOG_INFO("Recommendation: %s", rec->description);
+        ctx->total_recommendations++;
+        
+        // Store recommendation in database
+        if (ctx->db_ctx) {
+            database_insert_recommendation(ctx->db_ctx, rec);
+            database_log_event(ctx->db_ctx, EVENT_RECOMMENDATION_GENERATED, rec->node_id, 0, 
+                              "Recommendation generated", rec->description);
+        }
+    }
+}
+
+// Analytics reporting thread. Metrics are processed by the analytics shard
+// workers; this thread follows their event stream and stores each anomaly
+// and recommendation once, as soon as it is published. It exits when the
+// stream is closed and fully read.
 void* analytics_thread_func(void* arg) {
     xapp_context_t* ctx = (xapp_context_t*)arg;
+    analytics_event_log_t* events = ctx->analytics->events;
     
     LOG_INFO("Analytics thread started");
     
-    while (ctx->running) {
-        // Process analytics if enabled
-        if (ctx->config.anomaly_detection || ctx->config.trend_analysis || ctx->config.recommendations) {
-            
-            // Check for anomalies
-            if (ctx->analytics_ctx) {
-                int anomaly_count = 0;
-                anomaly_result_t* anomalies = analytics_get_recent_anomalies(ctx->analytics_ctx, &anomaly_count);
-                
-                if (anomalies && anomaly_count > 0) {
-                    for (int i = 0; i < anomaly_count; i++) {
-                        const anomaly_result_t* anomaly = &anomalies[i];
-                        
-                        if (anomaly->severity >= ANOMALY_WARNING) {
-                            LOG_WARN("Anomaly detected: %s", anomaly->description);
-                            ctx->total_anomalies++;
-                            
-                            // Store anomaly in database
-                            if (ctx->db_ctx) {
-                                database_insert_anomaly(ctx->db_ctx, anomaly);
-                                database_log_event(ctx->db_ctx, EVENT_ANOMALY_DETECTED, 0, 0, 
-                                                  "Anomaly detected", anomaly->description);
-                            }
-                        }
-                    }
-                }
-                
-                // Check for new recommendations
-                int recommendation_count = 0;
-                recommendation_result_t* recommendations = analytics_get_recent_recommendations(ctx->analytics_ctx, &recommendation_count);
-                
-                if (recommendations && recommendation_count > 0) {
-                    for (int i = 0; i < recommendation_count; i++) {
-                        const recommendation_result_t* rec = &recommendations[i];
-                        
-                        LOG_INFO("Recommendation: %s", rec->description);
-                        ctx->total_recommendations++;
-                        
-                        // Store recommendation in database
-                        if (ctx->db_ctx) {
-                            database_insert_recommendation(ctx->db_ctx, rec);
-                            database_log_event(ctx->db_ctx, EVENT_RECOMMENDATION_GENERATED, rec->node_id, 0, 
-                                              "Recommendation generated", rec->description);
-                        }
-                    }
-                }
-            }
+    analytics_event_t* batch = malloc(ANALYTICS_EVENT_BATCH * sizeof(analytics_event_t));
+    if (!batch) {
+        LOG_ERROR("Failed to allocate analytics event batch");
+        return NULL;
+    }
+    
+    analytics_event_cursor_t cursor;
+    analytics_event_cursor_init(events, &cursor, true);
+    time_t last_performance = time(NULL);
+    
+    int count;
+    while ((count = analytics_event_log_read(events, &cursor, batch, ANALYTICS_EVENT_BATCH, 1000)) >= 0) {
+        for (int i = 0; i < count; i++) {
+            handle_analytics_event(ctx, &batch[i]);
         }
         
-        // Sleep for analytics interval
-        sleep(5);  // Run analytics every 5 seconds
+        time_t now = time(NULL);
+        if (ctx->running && now - last_performance >= ANALYTICS_REPORT_INTERVAL) {
+            analytics_shards_print_performance(ctx->analytics);
+            last_performance = now;
+        }
     }
     
+    if (cursor.missed > 0) {
+        LOG_WARN("Analytics thread fell behind and skipped %llu events", (unsigned long long)cursor.missed);
+    }
+    
+    free(batch);
+    
     LOG_INFO("Analytics thread stopped");
     return NULL;
 }
\ No newline at end of file
@@ -0,0 +1,418 @@
+/*
+ * Statistics Kernels for Smart Monitor xApp
+ *
+ * Vectorized reductions used by the analytics module:
+ * - Sum and sum of squared deviations
+ * - Minimum and maximum
+ * - Linear regression sums
+ * - Dot products
+ *
+ * Author: xApp Template Generator
+ * Version: 1.0.0
+ */
+
+#include "stats_kernels.h"
+#include "utils.h"
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STATS_KERNELS_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define STATS_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Scalar kernels
+static double scalar_sum(const double* values, int count) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+static double scalar_sum_sq_dev(const double* values, int count, double center) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        double diff = values[i] - center;
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void scalar_min_max(const double* values, int count, double* min, double* max) {
+    double lo = values[0];
+    double hi = values[0];
+    for (int i = 1; i < count; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+    }
+    *min = lo;
+    *max = hi;
+}
+
+static void scalar_regression_sums(const double* values, int count, double shift,
+                                   double* sum_y, double* sum_xy, double* sum_yy) {
+    double sy = 0.0, sxy = 0.0, syy = 0.0;
+    for (int i = 0; i < count; i++) {
+        double y = values[i] - shift;
+        sy += y;
+        sxy += (double)i * y;
+        syy += y * y;
+    }
+    *sum_y = sy;
+    *sum_xy = sxy;
+    *sum_yy = syy;
+}
+
+static double scalar_dot(const double* a, const double* b, int count) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static const stats_kernels_t scalar_kernels = {
+    .name = "scalar",
+    .sum = scalar_sum,
+    .sum_sq_dev = scalar_sum_sq_dev,
+    .min_max = scalar_min_max,
+    .regression_sums = scalar_regression_sums,
+    .dot = scalar_dot,
+};
+
+#ifdef STATS_KERNELS_AVX2
+// AVX2 kernels: 4 doubles per vector, several independent accumulators to
+// hide the add latency. The tail is finished with scalar code.
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline double avx2_hsum(__m256d v) {
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+AVX2_TARGET static double avx2_sum(const double* values, int count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(values + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(values + i + 12));
+    }
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+    }
+
+    double sum = avx2_hsum(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+AVX2_TARGET static double avx2_sum_sq_dev(const double* values, int count, double center) {
+    const __m256d c = _mm256_set1_pd(center);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(values + i), c);
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(values + i + 4), c);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(d0, d0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(d1, d1));
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(values + i), c);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(d0, d0));
+    }
+
+    double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for (; i < count; i++) {
+        double diff = values[i] - center;
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+AVX2_TARGET static void avx2_min_max(const double* values, int count, double* min, double* max) {
+    if (count < 8) {
+        scalar_min_max(values, count, min, max);
+        return;
+    }
+
+    __m256d lo0 = _mm256_loadu_pd(values);
+    __m256d lo1 = _mm256_loadu_pd(values + 4);
+    __m256d hi0 = lo0;
+    __m256d hi1 = lo1;
+    int i = 8;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256d v0 = _mm256_loadu_pd(values + i);
+        __m256d v1 = _mm256_loadu_pd(values + i + 4);
+        lo0 = _mm256_min_pd(lo0, v0);
+        lo1 = _mm256_min_pd(lo1, v1);
+        hi0 = _mm256_max_pd(hi0, v0);
+        hi1 = _mm256_max_pd(hi1, v1);
+    }
+
+    double lo_lanes[4], hi_lanes[4];
+    _mm256_storeu_pd(lo_lanes, _mm256_min_pd(lo0, lo1));
+    _mm256_storeu_pd(hi_lanes, _mm256_max_pd(hi0, hi1));
+
+    double lo = lo_lanes[0];
+    double hi = hi_lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        if (lo_lanes[lane] < lo) lo = lo_lanes[lane];
+        if (hi_lanes[lane] > hi) hi = hi_lanes[lane];
+    }
+    for (; i < count; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+    }
+
+    *min = lo;
+    *max = hi;
+}
+
+AVX2_TARGET static void avx2_regression_sums(const double* values, int count, double shift,
+                                             double* sum_y, double* sum_xy, double* sum_yy) {
+    const __m256d s = _mm256_set1_pd(shift);
+    const __m256d step = _mm256_set1_pd(4.0);
+    __m256d x = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    __m256d sy = _mm256_setzero_pd();
+    __m256d sxy = _mm256_setzero_pd();
+    __m256d syy = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256d y = _mm256_sub_pd(_mm256_loadu_pd(values + i), s);
+        sy = _mm256_add_pd(sy, y);
+        sxy = _mm256_add_pd(sxy, _mm256_mul_pd(x, y));
+        syy = _mm256_add_pd(syy, _mm256_mul_pd(y, y));
+        x = _mm256_add_pd(x, step);
+    }
+
+    double total_y = avx2_hsum(sy);
+    double total_xy = avx2_hsum(sxy);
+    double total_yy = avx2_hsum(syy);
+    for (; i < count; i++) {
+        double y = values[i] - shift;
+        total_y += y;
+        total_xy += (double)i * y;
+        total_yy += y * y;
+    }
+
+    *sum_y = total_y;
+    *sum_xy = total_xy;
+    *sum_yy = total_yy;
+}
+
+AVX2_TARGET static double avx2_dot(const double* a, const double* b, int count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+
+    double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static const stats_kernels_t avx2_kernels = {
+    .name = "avx2",
+    .sum = avx2_sum,
+    .sum_sq_dev = avx2_sum_sq_dev,
+    .min_max = avx2_min_max,
+    .regression_sums = avx2_regression_sums,
+    .dot = avx2_dot,
+};
+#endif // STATS_KERNELS_AVX2
+
+#ifdef STATS_KERNELS_NEON
+// NEON kernels: 2 doubles per vector, AdvSIMD is mandatory on AArch64
+static double neon_sum(const double* values, int count) {
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    float64x2_t acc2 = vdupq_n_f64(0.0);
+    float64x2_t acc3 = vdupq_n_f64(0.0);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        acc0 = vaddq_f64(acc0, vld1q_f64(values + i));
+        acc1 = vaddq_f64(acc1, vld1q_f64(values + i + 2));
+        acc2 = vaddq_f64(acc2, vld1q_f64(values + i + 4));
+        acc3 = vaddq_f64(acc3, vld1q_f64(values + i + 6));
+    }
+    for (; i + 2 <= count; i += 2) {
+        acc0 = vaddq_f64(acc0, vld1q_f64(values + i));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+    for (; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+static double neon_sum_sq_dev(const double* values, int count, double center) {
+    const float64x2_t c = vdupq_n_f64(center);
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        float64x2_t d0 = vsubq_f64(vld1q_f64(values + i), c);
+        float64x2_t d1 = vsubq_f64(vld1q_f64(values + i + 2), c);
+        acc0 = vfmaq_f64(acc0, d0, d0);
+        acc1 = vfmaq_f64(acc1, d1, d1);
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+    for (; i < count; i++) {
+        double diff = values[i] - center;
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void neon_min_max(const double* values, int count, double* min, double* max) {
+    if (count < 4) {
+        scalar_min_max(values, count, min, max);
+        return;
+    }
+
+    float64x2_t lo0 = vld1q_f64(values);
+    float64x2_t lo1 = vld1q_f64(values + 2);
+    float64x2_t hi0 = lo0;
+    float64x2_t hi1 = lo1;
+    int i = 4;
+
+    for (; i + 4 <= count; i += 4) {
+        float64x2_t v0 = vld1q_f64(values + i);
+        float64x2_t v1 = vld1q_f64(values + i + 2);
+        lo0 = vminq_f64(lo0, v0);
+        lo1 = vminq_f64(lo1, v1);
+        hi0 = vmaxq_f64(hi0, v0);
+        hi1 = vmaxq_f64(hi1, v1);
+    }
+
+    double lo = vminvq_f64(vminq_f64(lo0, lo1));
+    double hi = vmaxvq_f64(vmaxq_f64(hi0, hi1));
+    for (; i < count; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+    }
+
+    *min = lo;
+    *max = hi;
+}
+
+static void neon_regression_sums(const double* values, int count, double shift,
+                                 double* sum_y, double* sum_xy, double* sum_yy) {
+    const float64x2_t s = vdupq_n_f64(shift);
+    const float64x2_t step = vdupq_n_f64(2.0);
+    const double x_init[2] = {0.0, 1.0};
+    float64x2_t x = vld1q_f64(x_init);
+    float64x2_t sy = vdupq_n_f64(0.0);
+    float64x2_t sxy = vdupq_n_f64(0.0);
+    float64x2_t syy = vdupq_n_f64(0.0);
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        float64x2_t y = vsubq_f64(vld1q_f64(values + i), s);
+        sy = vaddq_f64(sy, y);
+        sxy = vfmaq_f64(sxy, x, y);
+        syy = vfmaq_f64(syy, y, y);
+        x = vaddq_f64(x, step);
+    }
+
+    double total_y = vaddvq_f64(sy);
+    double total_xy = vaddvq_f64(sxy);
+    double total_yy = vaddvq_f64(syy);
+    for (; i < count; i++) {
+        double y = values[i] - shift;
+        total_y += y;
+        total_xy += (double)i * y;
+        total_yy += y * y;
+    }
+
+    *sum_y = total_y;
+    *sum_xy = total_xy;
+    *sum_yy = total_yy;
+}
+
+static double neon_dot(const double* a, const double* b, int count) {
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(a + i), vld1q_f64(b + i));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static const stats_kernels_t neon_kernels = {
+    .name = "neon",
+    .sum = neon_sum,
+    .sum_sq_dev = neon_sum_sq_dev,
+    .min_max = neon_min_max,
+    .regression_sums = neon_regression_sums,
+    .dot = neon_dot,
+};
+#endif // STATS_KERNELS_NEON
+
+// Runtime dispatch
+static const stats_kernels_t* active_kernels = &scalar_kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void stats_kernels_select(void) {
+#ifdef STATS_KERNELS_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        active_kernels = &avx2_kernels;
+    }
+#endif
+#ifdef STATS_KERNELS_NEON
+    active_kernels = &neon_kernels;
+#endif
+    LOG_DEBUG("Statistics kernels: %s", active_kernels->name);
+}
+
+// Best kernels for the running CPU
+const stats_kernels_t* stats_kernels_get(void) {
+    pthread_once(&kernels_once, stats_kernels_select);
+    return active_kernels;
+}
+
+// Portable reference kernels
+const stats_kernels_t* stats_kernels_scalar(void) {
+    return &scalar_kernels;
+}
@@ -532,6 +532,176 @@ char* utils_get_hostname(char* buffer, size_t buffer_size) {
     return NULL;
 }
 
+// Circular buffer functions
+circular_buffer_t* utils_circular_buffer_create(size_t capacity, size_t element_size) {
+    if (capacity == 0 || element_size == 0 || capacity > (SIZE_MAX >> 2)) {
+        return NULL;
+    }
+    
+    // Round up to a power of two so positions map to slots with a mask
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    
+    circular_buffer_t* buffer = aligned_alloc(CIRCULAR_BUFFER_CACHE_LINE, sizeof(circular_buffer_t));
+    if (!buffer) {
+        return NULL;
+    }
+    memset(buffer, 0, sizeof(circular_buffer_t));
+    
+    buffer->data = malloc(slots * element_size);
+    buffer->published = malloc(slots * sizeof(*buffer->published));
+    if (!buffer->data || !buffer->published) {
+        free(buffer->data);
+        free(buffer->published);
+        free(buffer);
+        return NULL;
+    }
+    
+    buffer->element_size = element_size;
+    buffer->capacity = slots;
+    buffer->mask = slots - 1;
+    
+    // A slot is readable at position p when published == p + 1, which no
+    // initial value or leftover from the previous lap can match
+    for (size_t i = 0; i < slots; i++) {
+        atomic_init(&buffer->published[i], 0);
+    }
+    atomic_init(&buffer->tail, 0);
+    atomic_init(&buffer->head, 0);
+    
+    return buffer;
+}
+
+void utils_circular_buffer_destroy(circular_buffer_t* buffer) {
+    if (!buffer) return;
+    
+    free(buffer->data);
+    free(buffer->published);
+    free(buffer);
+}
+
+// Copy `count` elements between a linear array and the ring starting at `position`
+static void circular_buffer_copy_in(circular_buffer_t* buffer, size_t position, const void* elements, size_t count) {
+    size_t slot = position & buffer->mask;
+    size_t first = MIN(count, buffer->capacity - slot);
+    
+    memcpy((char*)buffer->data + slot * buffer->element_size, elements, first * buffer->element_size);
+    memcpy(buffer->data, (const char*)elements + first * buffer->element_size, (count - first) * buffer->element_size);
+}
+
+static void circular_buffer_copy_out(const circular_buffer_t* buffer, size_t position, void* elements, size_t count) {
+    size_t slot = position & buffer->mask;
+    size_t first = MIN(count, buffer->capacity - slot);
+    
+    memcpy(elements, (const char*)buffer->data + slot * buffer->element_size, first * buffer->element_size);
+    memcpy((char*)elements + first * buffer->element_size, buffer->data, (count - first) * buffer->element_size);
+}
+
+size_t utils_circular_buffer_push_bulk(circular_buffer_t* buffer, const void* elements, size_t count) {
+    if (!buffer || !elements || count == 0) {
+        return 0;
+    }
+    
+    // Claim [position, position + claimed) in one CAS
+    size_t position = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    size_t claimed;
+    do {
+        size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        size_t free_slots = buffer->capacity - (position - head);
+        if (free_slots == 0) {
+            return 0;
+        }
+        claimed = MIN(count, free_slots);
+    } while (!atomic_compare_exchange_weak_explicit(&buffer->tail, &position, position + claimed,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    
+    circular_buffer_copy_in(buffer, position, elements, claimed);
+    
+    // Publish in order so the consumer sees the element bytes first
+    for (size_t i = 0; i < claimed; i++) {
+        atomic_store_explicit(&buffer->published[(position + i) & buffer->mask], position + i + 1,
+                              memory_order_release);
+    }
+    
+    return claimed;
+}
+
+bool utils_circular_buffer_push(circular_buffer_t* buffer, const void* element) {
+    return utils_circular_buffer_push_bulk(buffer, element, 1) == 1;
+}
+
+size_t utils_circular_buffer_pop_bulk(circular_buffer_t* buffer, void* elements, size_t max_count) {
+    if (!buffer || !elements || max_count == 0) {
+        return 0;
+    }
+    
+    // Only this thread moves head
+    size_t position = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    
+    // Take the run of published slots; stop at one a producer is still writing
+    size_t count = 0;
+    while (count < max_count &&
+           atomic_load_explicit(&buffer->published[(position + count) & buffer->mask], memory_order_acquire) ==
+           position + count + 1) {
+        count++;
+    }
+    
+    if (count > 0) {
+        circular_buffer_copy_out(buffer, position, elements, count);
+        atomic_store_explicit(&buffer->head, position + count, memory_order_release);
+    }
+    
+    return count;
+}
+
+bool utils_circular_buffer_pop(circular_buffer_t* buffer, void* element) {
+    return utils_circular_buffer_pop_bulk(buffer, element, 1) == 1;
+}
+
+bool utils_circular_buffer_peek(circular_buffer_t* buffer, void* element, size_t index) {
+    if (!buffer || !element) {
+        return false;
+    }
+    
+    size_t position = atomic_load_explicit(&buffer->head, memory_order_relaxed) + index;
+    if (atomic_load_explicit(&buffer->published[position & buffer->mask], memory_order_acquire) != position + 1) {
+        return false;
+    }
+    
+    circular_buffer_copy_out(buffer, position, element, 1);
+    return true;
+}
+
+size_t utils_circular_buffer_size(const circular_buffer_t* buffer) {
+    if (!buffer) return 0;
+    
+    // Claimed slots, including ones still being written
+    size_t head = atomic_load_explicit(&((circular_buffer_t*)buffer)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((circular_buffer_t*)buffer)->tail, memory_order_acquire);
+    return tail - head;
+}
+
+bool utils_circular_buffer_is_full(const circular_buffer_t* buffer) {
+    return buffer && utils_circular_buffer_size(buffer) >= buffer->capacity;
+}
+
+bool utils_circular_buffer_is_empty(const circular_buffer_t* buffer) {
+    return utils_circular_buffer_size(buffer) == 0;
+}
+
+void utils_circular_buffer_clear(circular_buffer_t* buffer) {
+    if (!buffer) return;
+    
+    // Release every published slot; slots still being written stay behind
+    size_t position = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    while (atomic_load_explicit(&buffer->published[position & buffer->mask], memory_order_acquire) == position + 1) {
+        position++;
+    }
+    atomic_store_explicit(&buffer->head, position, memory_order_release);
+}
+
 // Hash functions
 uint32_t utils_hash_string(const char* str) {
     if (!str) return 0;
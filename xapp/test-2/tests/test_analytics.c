@@ -8,7 +8,13 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 #include "../include/analytics.h"
+#include "../include/analytics_events.h"
+#include "../include/analytics_shards.h"
+#include "../include/kpm_decoder.h"
+#include "../include/series_store.h"
+#include "../include/stats_kernels.h"
 #include "../include/utils.h"
 
 #define TEST_ASSERT(condition, message) \
@@ -82,6 +88,178 @@ int test_statistical_analysis() {
     return 1;
 }
 
+// Test per-(node, cell) series
+int test_series_store() {
+    printf("\n🧪 Testing Per-Entity Series Store...\n");
+    
+    analytics_context_t* ctx = analytics_init(NULL);
+    TEST_ASSERT(ctx != NULL, "Analytics context should be created");
+    
+    // Two cells with very different levels must not share statistics
+    for (int i = 0; i < 30; i++) {
+        analytics_add_metric(ctx, METRIC_LATENCY, 10.0, 1, 1);
+        analytics_add_metric(ctx, METRIC_LATENCY, 40.0, 2, 7);
+    }
+    
+    metric_history_t* cell_a = analytics_get_series_history(ctx, METRIC_LATENCY, 1, 1);
+    metric_history_t* cell_b = analytics_get_series_history(ctx, METRIC_LATENCY, 2, 7);
+    TEST_ASSERT(cell_a != NULL && cell_b != NULL, "Each (node, cell) should get its own series");
+    TEST_ASSERT(cell_a->count == 30 && cell_b->count == 30, "Each series should hold its own samples");
+    TEST_ASSERT(cell_a->last_stats.mean == 10.0 && cell_b->last_stats.mean == 40.0, "Series statistics should not mix entities");
+    TEST_ASSERT(analytics_get_history(ctx, METRIC_LATENCY)->count == 60, "Fleet-wide history should see every sample");
+    TEST_ASSERT(analytics_get_series_history(ctx, METRIC_LATENCY, 3, 1) == NULL, "Unknown entity should have no series");
+    TEST_ASSERT(analytics_get_series_count(ctx) == 2, "Two series should be tracked");
+    
+    analytics_cleanup(ctx);
+    
+    // A tiny budget keeps the minimum number of series and evicts the stalest
+    series_store_t* store = series_store_create(1, 32, 16, 16, false);
+    TEST_ASSERT(store != NULL, "Series store should be created");
+    
+    int capacity = store->max_series;
+    for (uint32_t cell = 0; cell < 1000; cell++) {
+        metric_history_t* history = series_store_get_or_create(store, METRIC_PRB_USAGE, cell / 10, cell);
+        TEST_ASSERT(history != NULL, "Series should be created under memory pressure");
+        TEST_ASSERT(history->count == 0, "Reused series should start empty");
+        TEST_ASSERT(series_store_key_of(history)->cell_id == cell, "Series key should match the request");
+    }
+    TEST_ASSERT(series_store_count(store) == capacity, "Series count should stay within the budget");
+    TEST_ASSERT(store->evictions == (uint64_t)(1000 - capacity), "Stalest series should be evicted");
+    
+    bool newest_present = true;
+    for (uint32_t cell = 1000 - capacity; cell < 1000; cell++) {
+        newest_present &= series_store_find(store, METRIC_PRB_USAGE, cell / 10, cell) != NULL;
+    }
+    TEST_ASSERT(newest_present, "Most recently updated series should survive eviction");
+    TEST_ASSERT(series_store_find(store, METRIC_PRB_USAGE, 0, 0) == NULL, "Evicted series should not be found");
+    
+    series_store_destroy(store);
+    return 1;
+}
+
+// Test vectorized statistics kernels against the scalar reference
+int test_stats_kernels() {
+    printf("\n🧪 Testing Statistics Kernels...\n");
+    
+    const stats_kernels_t* kernels = stats_kernels_get();
+    const stats_kernels_t* scalar = stats_kernels_scalar();
+    printf("   Using %s kernels\n", kernels->name);
+    
+    // Odd lengths exercise the vector tails
+    static double values[1003];
+    for (int i = 0; i < 1003; i++) {
+        values[i] = -85.0 + ((i * 7919) % 1009) * 0.037;
+    }
+    
+    const int lengths[] = {1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 100, 1000, 1003};
+    bool sums_match = true, minmax_match = true, regression_match = true, dot_match = true;
+    
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        int n = lengths[l];
+        const double* v = values + (1003 - n);   // Unaligned start
+        
+        sums_match &= fabs(kernels->sum(v, n) - scalar->sum(v, n)) < 1e-9;
+        sums_match &= fabs(kernels->sum_sq_dev(v, n, -70.0) - scalar->sum_sq_dev(v, n, -70.0)) < 1e-7;
+        
+        double min_a, max_a, min_b, max_b;
+        kernels->min_max(v, n, &min_a, &max_a);
+        scalar->min_max(v, n, &min_b, &max_b);
+        minmax_match &= (min_a == min_b && max_a == max_b);
+        
+        double y_a, xy_a, yy_a, y_b, xy_b, yy_b;
+        kernels->regression_sums(v, n, v[0], &y_a, &xy_a, &yy_a);
+        scalar->regression_sums(v, n, v[0], &y_b, &xy_b, &yy_b);
+        regression_match &= fabs(y_a - y_b) < 1e-9 && fabs(xy_a - xy_b) < 1e-6 && fabs(yy_a - yy_b) < 1e-7;
+        
+        dot_match &= fabs(kernels->dot(v, values, n) - scalar->dot(v, values, n)) < 1e-6;
+    }
+    
+    TEST_ASSERT(sums_match, "Sum kernels should match the scalar reference");
+    TEST_ASSERT(minmax_match, "Min/max kernels should match the scalar reference");
+    TEST_ASSERT(regression_match, "Regression kernels should match the scalar reference");
+    TEST_ASSERT(dot_match, "Dot product kernels should match the scalar reference");
+    
+    // Columnar entry points agree with the record-based ones
+    static metric_data_t data[1000];
+    for (int i = 0; i < 1000; i++) {
+        data[i].value = values[i] + i * 0.01;
+    }
+    static double column[1000];
+    for (int i = 0; i < 1000; i++) {
+        column[i] = data[i].value;
+    }
+    
+    stats_result_t stats = analytics_calculate_stats(data, 1000);
+    stats_result_t column_stats = analytics_calculate_stats_values(column, 1000);
+    TEST_ASSERT(stats.mean == column_stats.mean && stats.p99 == column_stats.p99, "Columnar stats should match");
+    TEST_ASSERT(column[999] == data[999].value, "Columnar stats should not reorder the input");
+    
+    trend_result_t trend = analytics_calculate_trend(data, 1000);
+    trend_result_t column_trend = analytics_calculate_trend_values(column, 1000);
+    TEST_ASSERT(trend.slope == column_trend.slope, "Columnar trend should match");
+    TEST_ASSERT(fabs(trend.slope - 0.01) < 0.01, "Trend slope should follow the ramp");
+    
+    return 1;
+}
+
+// Test quantile calculation
+int test_quantiles() {
+    printf("\n🧪 Testing Quantile Calculation...\n");
+    
+    // Values 1-100 in shuffled order
+    metric_data_t data[100];
+    for (int i = 0; i < 100; i++) {
+        data[i].value = (double)((i * 31) % 100 + 1);
+        data[i].timestamp = time(NULL);
+    }
+    
+    stats_result_t stats = analytics_calculate_stats(data, 100);
+    TEST_ASSERT(fabs(stats.median - 50.5) < 1e-9, "Median should be 50.5");
+    TEST_ASSERT(fabs(stats.p95 - 95.05) < 1e-9, "P95 should be 95.05");
+    TEST_ASSERT(fabs(stats.p99 - 99.01) < 1e-9, "P99 should be 99.01");
+    
+    // Sliding window over the same values with duplicates mixed in
+    sliding_window_t window;
+    TEST_ASSERT(sliding_window_init(&window, 100) == 0, "Sliding window should be created");
+    for (int i = 0; i < 100; i++) {
+        sliding_window_push(&window, 7.0);
+    }
+    for (int i = 0; i < 100; i++) {
+        sliding_window_push(&window, data[i].value);
+    }
+    TEST_ASSERT(sliding_window_kth(&window, 0) == 1.0, "Smallest value should be 1");
+    TEST_ASSERT(sliding_window_kth(&window, 99) == 100.0, "Largest value should be 100");
+    TEST_ASSERT(fabs(sliding_window_quantile(&window, 0.5) - 50.5) < 1e-9, "Windowed median should be 50.5");
+    TEST_ASSERT(fabs(sliding_window_quantile(&window, 0.95) - 95.05) < 1e-9, "Windowed p95 should be 95.05");
+    
+    // Bulk pushes of every length leave the same order statistics as single pushes
+    sliding_window_t bulk;
+    TEST_ASSERT(sliding_window_init(&bulk, 100) == 0, "Bulk window should be created");
+    sliding_window_reset(&window);
+    double values[250];
+    for (int i = 0; i < 250; i++) {
+        values[i] = (i % 9 == 0) ? 7.0 : (double)((i * 37) % 101);
+    }
+    bool same_order = true;
+    for (int start = 0, length = 1; start < 250; start += length, length = length * 2 + 1) {
+        int n = MIN(length, 250 - start);
+        sliding_window_push_bulk(&bulk, &values[start], n);
+        for (int i = 0; i < n; i++) {
+            sliding_window_push(&window, values[start + i]);
+        }
+        for (int k = 0; k < window.count; k++) {
+            same_order &= sliding_window_kth(&bulk, k) == sliding_window_kth(&window, k);
+        }
+        same_order &= bulk.count == window.count && sliding_window_max(&bulk) == sliding_window_max(&window);
+        same_order &= fabs(sliding_window_variance(&bulk) - sliding_window_variance(&window)) < 1e-9;
+    }
+    TEST_ASSERT(same_order, "Bulk and single pushes should agree");
+    sliding_window_free(&bulk);
+    sliding_window_free(&window);
+    
+    return 1;
+}
+
 // Test trend analysis
 int test_trend_analysis() {
     printf("\n🧪 Testing Trend Analysis...\n");
@@ -102,6 +280,448 @@ int test_trend_analysis() {
     return 1;
 }
 
+// Test incremental trend over the newest trend_window samples
+int test_trend_tracking() {
+    printf("\n🧪 Testing Incremental Trend Tracking...\n");
+    
+    analytics_context_t* ctx = analytics_init(NULL);
+    TEST_ASSERT(ctx != NULL, "Analytics context should be created");
+    
+    // Wrap the series ring many times, ending with a clean ramp
+    static double values[1200];
+    for (int i = 0; i < 1200; i++) {
+        values[i] = (i < 1150) ? 200.0 - ((i * 53) % 97) : 3.0 + 0.5 * (i - 1150);
+        analytics_add_metric(ctx, METRIC_PRB_USAGE, values[i], 4, 2);
+    }
+    
+    int window = ctx->config.trend_window;
+    const metric_history_t* history = analytics_get_series_history(ctx, METRIC_PRB_USAGE, 4, 2);
+    trend_result_t expected = analytics_calculate_trend_values(&values[1200 - window], window);
+    const trend_result_t* trend = &history->last_trend;
+    
+    TEST_ASSERT(fabs(trend->slope - 0.5) < 1e-9, "Trend should cover only the newest trend_window samples");
+    TEST_ASSERT(fabs(trend->intercept - expected.intercept) < 1e-9, "Intercept should refer to the oldest sample in the window");
+    TEST_ASSERT(fabs(trend->correlation - expected.correlation) < 1e-9, "Correlation should match full recomputation");
+    TEST_ASSERT(trend->is_increasing, "Should detect increasing trend");
+    
+    analytics_cleanup(ctx);
+    
+    // Time-based x: one unit every 2 seconds is a slope of 0.5 per second
+    metric_history_t timed;
+    TEST_ASSERT(analytics_history_init(&timed, 64, 16) == 0, "History should be created");
+    analytics_history_set_trend(&timed, 32, true);
+    
+    for (int i = 0; i < 300; i++) {
+        metric_data_t metric = {
+            .type = METRIC_THROUGHPUT,
+            .value = 100.0 + i,
+            .timestamp = 1700000000 + 2 * i
+        };
+        analytics_history_append(&timed, &metric);
+    }
+    
+    trend_result_t timed_trend = analytics_history_trend(&timed);
+    TEST_ASSERT(timed.regression.count == 32, "Regression should hold trend_window samples");
+    TEST_ASSERT(fabs(timed_trend.slope - 0.5) < 1e-9, "Slope should be per second with timestamps");
+    TEST_ASSERT(fabs(timed_trend.correlation - 1.0) < 1e-9, "Perfect ramp should correlate fully");
+    
+    // Switching to index-based x rebuilds the sums from the ring
+    analytics_history_set_trend(&timed, 32, false);
+    timed_trend = analytics_history_trend(&timed);
+    TEST_ASSERT(fabs(timed_trend.slope - 1.0) < 1e-9, "Slope should be per sample without timestamps");
+    TEST_ASSERT(fabs(timed_trend.intercept - 368.0) < 1e-9, "Intercept should be the oldest sample in the window");
+    
+    analytics_history_free(&timed);
+    return 1;
+}
+
+// Test batch ingestion
+int test_batch_processing() {
+    printf("\n🧪 Testing Batch Metric Processing...\n");
+    
+    analytics_context_t* batched = analytics_init(NULL);
+    analytics_context_t* sampled = analytics_init(NULL);
+    TEST_ASSERT(batched != NULL && sampled != NULL, "Analytics contexts should be created");
+    
+    // Interleaved KPIs of 3 cells x 2 metric types, as one report would carry them
+    static metric_data_t batch[240];
+    for (int i = 0; i < 240; i++) {
+        batch[i].type = (i % 2) ? METRIC_LATENCY : METRIC_RSRP;
+        batch[i].node_id = 1;
+        batch[i].cell_id = (i / 2) % 3;
+        batch[i].value = (i % 2) ? 20.0 + (i % 7) * 0.5 : -90.0 + (i % 5);
+        batch[i].timestamp = 1700000000 + i / 6;
+    }
+    
+    TEST_ASSERT(analytics_process_metrics_batch(batched, batch, 240) == 0, "Batch should be processed");
+    for (int i = 0; i < 240; i++) {
+        analytics_process_metric(sampled, &batch[i]);
+    }
+    
+    TEST_ASSERT(batched->processed_metrics == 240, "Every sample should be counted");
+    TEST_ASSERT(analytics_get_series_count(batched) == 6, "Batch should be grouped into 6 series");
+    
+    bool same_state = true;
+    for (uint32_t cell = 0; cell < 3; cell++) {
+        const metric_history_t* a = analytics_get_series_history(batched, METRIC_LATENCY, 1, cell);
+        const metric_history_t* b = analytics_get_series_history(sampled, METRIC_LATENCY, 1, cell);
+        same_state &= a && b && a->count == 40 && a->count == b->count;
+        same_state &= a && b && fabs(a->last_stats.mean - b->last_stats.mean) < 1e-9;
+        same_state &= a && b && a->last_stats.p95 == b->last_stats.p95;
+    }
+    TEST_ASSERT(same_state, "Batch and per-sample processing should leave the same statistics");
+    TEST_ASSERT(batched->history[METRIC_RSRP].count == 120, "Fleet-wide history should see the whole batch");
+    
+    // A spike in the middle of a batch is still caught by per-batch detection
+    int anomalies_before = batched->anomaly_count;
+    metric_data_t spike[5];
+    for (int i = 0; i < 5; i++) {
+        spike[i] = (metric_data_t){ .type = METRIC_LATENCY, .value = 21.0, .node_id = 1, .cell_id = 0, .timestamp = 1700000100 };
+    }
+    spike[2].value = 45.0;
+    analytics_process_metrics_batch(batched, spike, 5);
+    TEST_ASSERT(batched->anomaly_count == anomalies_before + 1, "Spike should raise one anomaly per batch");
+    TEST_ASSERT(batched->recent_anomalies[anomalies_before % 100].actual_value == 45.0, "Anomaly should refer to the spike");
+    
+    // Sample-level mode runs detection on every sample
+    batched->config.detection_mode = ANALYTICS_DETECT_PER_SAMPLE;
+    anomalies_before = batched->anomaly_count;
+    spike[3].value = 44.0;
+    analytics_process_metrics_batch(batched, spike, 5);
+    TEST_ASSERT(batched->anomaly_count >= anomalies_before + 2, "Per-sample mode should flag each spike");
+    
+    // Invalid samples are rejected without dropping the rest of the batch
+    spike[0].type = METRIC_COUNT;
+    batched->config.detection_mode = ANALYTICS_DETECT_PER_BATCH;
+    uint64_t processed_before = batched->processed_metrics;
+    TEST_ASSERT(analytics_process_metrics_batch(batched, spike, 5) == -1, "Invalid sample should be reported");
+    TEST_ASSERT(batched->processed_metrics == processed_before + 4, "Valid samples should still be processed");
+    
+    analytics_cleanup(batched);
+    analytics_cleanup(sampled);
+    return 1;
+}
+
+// Test sharded analytics workers
+int test_sharded_analytics() {
+    printf("\n🧪 Testing Sharded Analytics...\n");
+    
+    analytics_shards_t* shards = analytics_shards_create(NULL, 4, 4096, 256);
+    TEST_ASSERT(shards != NULL && shards->shard_count == 4, "Four shards should be created");
+    
+    // Routing is stable and covers every shard
+    bool in_range = true, stable = true;
+    int per_shard[4] = {0};
+    for (uint32_t cell = 0; cell < 256; cell++) {
+        int shard = analytics_shards_route(shards, 1, cell);
+        in_range &= shard >= 0 && shard < 4;
+        stable &= shard == analytics_shards_route(shards, 1, cell);
+        if (shard >= 0 && shard < 4) per_shard[shard]++;
+    }
+    TEST_ASSERT(in_range && stable, "Cells should map to one shard in range");
+    TEST_ASSERT(per_shard[0] > 0 && per_shard[1] > 0 && per_shard[2] > 0 && per_shard[3] > 0,
+                "Every shard should own some cells");
+    
+    TEST_ASSERT(analytics_shards_start(shards) == 0, "Shard workers should start");
+    
+    // 64 cells x 50 reports, with one latency spike in cell 7
+    static metric_data_t reports[64 * 50];
+    for (int i = 0; i < 64 * 50; i++) {
+        reports[i] = (metric_data_t){ .type = METRIC_LATENCY, .value = 20.0 + (i % 3) * 0.5,
+                                      .node_id = 1, .cell_id = i % 64, .timestamp = 1700000000 + i / 64 };
+    }
+    reports[49 * 64 + 7].value = 80.0;
+    
+    TEST_ASSERT(analytics_shards_submit(shards, reports, 64 * 50) == 64 * 50, "All metrics should be queued");
+    analytics_shards_flush(shards);
+    
+    analytics_shards_totals_t totals;
+    analytics_shards_get_totals(shards, &totals);
+    TEST_ASSERT(totals.processed_metrics == 64 * 50, "Shards should process every metric once");
+    TEST_ASSERT(totals.series_count == 64, "Each cell should be tracked by exactly one shard");
+    
+    stats_result_t stats;
+    TEST_ASSERT(analytics_shards_get_series_stats(shards, METRIC_LATENCY, 1, 3, &stats, NULL), "Series should be found on its shard");
+    TEST_ASSERT(fabs(stats.mean - 20.5) < 0.1, "Series statistics should be readable across shards");
+    
+    // Fleet statistics merge the newest samples of every shard by timestamp
+    int fleet_count = 0;
+    TEST_ASSERT(analytics_shards_get_fleet_stats(shards, METRIC_LATENCY, &stats, NULL, &fleet_count),
+                "Fleet statistics should be readable");
+    TEST_ASSERT(fleet_count == MIN(64 * 50, ANALYTICS_HISTORY_SIZE), "Fleet history should hold samples of all shards");
+    TEST_ASSERT(fabs(stats.mean - 20.5) < 1.0, "Fleet statistics should cover all shards");
+    TEST_ASSERT(stats.max == 80.0, "Fleet window should end with the newest reports of every shard");
+    
+    anomaly_result_t anomalies[100];
+    int anomaly_count = analytics_shards_get_recent_anomalies(shards, anomalies, 100);
+    bool found_spike = false, newest_first = true;
+    for (int i = 0; i < anomaly_count; i++) {
+        found_spike |= anomalies[i].actual_value == 80.0;
+        if (i > 0) newest_first &= anomalies[i - 1].detected_at >= anomalies[i].detected_at;
+    }
+    TEST_ASSERT(found_spike, "Merged anomalies should include the spike");
+    TEST_ASSERT(newest_first, "Merged anomalies should be newest first");
+    
+    analytics_shards_destroy(shards);
+    return 1;
+}
+
+static void* append_anomaly_later(void* arg) {
+    analytics_event_log_t* log = (analytics_event_log_t*)arg;
+    anomaly_result_t anomaly = { .metric_type = METRIC_LATENCY, .severity = ANOMALY_CRITICAL, .actual_value = 99.0 };
+    
+    utils_sleep_ms(20);
+    analytics_event_log_append_anomaly(log, &anomaly, 1, 2);
+    return NULL;
+}
+
+// Test the analytics event stream
+int test_event_log() {
+    printf("\n🧪 Testing Analytics Event Log...\n");
+    
+    analytics_event_log_t* log = analytics_event_log_create(8);
+    TEST_ASSERT(log != NULL, "Event log should be created");
+    
+    analytics_event_cursor_t first, second;
+    analytics_event_cursor_init(log, &first, true);
+    analytics_event_cursor_init(log, &second, true);
+    
+    anomaly_result_t anomaly = { .metric_type = METRIC_LATENCY, .severity = ANOMALY_WARNING };
+    recommendation_result_t recommendation = { .type = RECOMMENDATION_LOAD_BALANCE, .node_id = 3, .cell_id = 4 };
+    TEST_ASSERT(analytics_event_log_append_anomaly(log, &anomaly, 1, 2) == 1, "First event should get sequence 1");
+    TEST_ASSERT(analytics_event_log_append_recommendation(log, &recommendation) == 2, "Sequence should increase by one");
+    
+    // Every cursor sees every event exactly once
+    analytics_event_t events[16];
+    int count = analytics_event_log_read(log, &first, events, 16, 0);
+    TEST_ASSERT(count == 2 && events[0].sequence == 1 && events[1].sequence == 2, "Cursor should read events in order");
+    TEST_ASSERT(events[0].kind == ANALYTICS_EVENT_ANOMALY && events[0].node_id == 1 && events[0].cell_id == 2,
+                "Anomaly event should carry its cell");
+    TEST_ASSERT(events[1].kind == ANALYTICS_EVENT_RECOMMENDATION && events[1].cell_id == 4,
+                "Recommendation event should carry its cell");
+    TEST_ASSERT(analytics_event_log_read(log, &first, events, 16, 0) == 0, "Events should not be read twice");
+    TEST_ASSERT(analytics_event_log_read(log, &second, events, 16, 0) == 2, "Cursors should be independent");
+    
+    // A lagging cursor skips overwritten events and counts them
+    for (int i = 0; i < 12; i++) {
+        analytics_event_log_append_anomaly(log, &anomaly, 1, 2);
+    }
+    count = analytics_event_log_read(log, &first, events, 16, 0);
+    TEST_ASSERT(count == 8 && first.missed == 4 && events[0].sequence == 7, "Lagging cursor should skip overwritten events");
+    
+    // A waiting reader wakes up when an event is appended
+    pthread_t producer;
+    pthread_create(&producer, NULL, append_anomaly_later, log);
+    uint64_t start = utils_get_timestamp_ms();
+    count = analytics_event_log_read(log, &first, events, 16, 2000);
+    uint64_t waited = utils_get_timestamp_ms() - start;
+    pthread_join(producer, NULL);
+    TEST_ASSERT(count == 1 && events[0].anomaly.actual_value == 99.0, "Waiting reader should get the new event");
+    TEST_ASSERT(waited < 1000, "Waiting reader should wake on append, not on timeout");
+    
+    // Analytics publishes what it detects
+    analytics_context_t* ctx = analytics_init(NULL);
+    analytics_set_event_log(ctx, log);
+    analytics_event_cursor_init(log, &second, false);
+    for (int i = 0; i < 15; i++) {
+        analytics_add_metric(ctx, METRIC_LATENCY, 20.0, 5, 6);
+    }
+    analytics_add_metric(ctx, METRIC_LATENCY, 150.0, 5, 6);
+    count = analytics_event_log_read(log, &second, events, 16, 0);
+    TEST_ASSERT(count >= 1 && events[0].kind == ANALYTICS_EVENT_ANOMALY && events[0].node_id == 5 && events[0].cell_id == 6,
+                "Detected anomalies should be published");
+    
+    // Closing ends the stream once it is drained
+    analytics_event_log_close(log);
+    TEST_ASSERT(analytics_event_log_read(log, &second, events, 16, 1000) == -1, "Closed, drained log should end the stream");
+    
+    analytics_cleanup(ctx);
+    analytics_event_log_destroy(log);
+    return 1;
+}
+
+// Test E2SM-KPM payload decoding
+int test_kpm_decoder() {
+    printf("\n🧪 Testing KPM Indication Decoding...\n");
+    
+    kpm_decoder_t decoder;
+    kpm_decoder_init(&decoder);
+    TEST_ASSERT(kpm_decoder_map(&decoder, 500, "DRB.UEThpDl") == 0, "Standard measurement should be mappable");
+    TEST_ASSERT(kpm_decoder_map(&decoder, 501, "DRB.Unknown") == -1, "Unknown measurement should be rejected");
+    
+    // 2 cells: throughput (kbit/s), PRB usage and an unmapped counter over
+    // 3 periods, one PRB value missing; then 400 real RSRP measurements
+    static uint8_t payload[16384];
+    static double rsrp[400];
+    static uint16_t rsrp_ids[400];
+    static uint8_t rsrp_kinds[400];
+    uint16_t ids[3] = { 500, 4, 900 };
+    uint8_t kinds[3] = { KPM_RECORD_INTEGER, KPM_RECORD_REAL, KPM_RECORD_INTEGER };
+    double values[9] = { 120000, 35.5, 7, 150000, NAN, 8, 90000, 42.0, 9 };
+    for (int i = 0; i < 400; i++) {
+        rsrp_ids[i] = 5;
+        rsrp_kinds[i] = KPM_RECORD_REAL;
+        rsrp[i] = -80.0 - i * 0.05;
+    }
+    
+    kpm_writer_t writer;
+    kpm_writer_init(&writer, payload, sizeof(payload), 1700000000000LL, 500);
+    TEST_ASSERT(kpm_writer_add_cell(&writer, 11, ids, kinds, 3, 3, values) == 0, "First cell should be encoded");
+    TEST_ASSERT(kpm_writer_add_cell(&writer, 12, rsrp_ids, rsrp_kinds, 400, 1, rsrp) == 0, "Second cell should be encoded");
+    size_t size = kpm_writer_finish(&writer);
+    TEST_ASSERT(size == KPM_HEADER_SIZE + 2 * KPM_CELL_HEADER_SIZE + 403 * KPM_MEAS_TYPE_SIZE + 409 * KPM_RECORD_SIZE,
+                "Payload should have the documented layout");
+    
+    // Decode in batches smaller than a cell
+    kpm_reader_t reader;
+    TEST_ASSERT(kpm_reader_init(&reader, &decoder, payload, size, 7) == 0, "Payload should validate");
+    TEST_ASSERT(reader.total_records == 409, "Every record should be counted");
+    
+    metric_data_t metrics[64];
+    metric_data_t decoded[420];
+    size_t total = 0, count;
+    while ((count = kpm_reader_next(&reader, metrics, 64)) > 0 && total + count <= 420) {
+        memcpy(&decoded[total], metrics, count * sizeof(metric_data_t));
+        total += count;
+    }
+    TEST_ASSERT(total == 405 && reader.skipped == 4, "Missing and unmapped records should be skipped");
+    TEST_ASSERT(decoded[0].type == METRIC_THROUGHPUT && fabs(decoded[0].value - 120.0) < 1e-9,
+                "Throughput should be scaled to Mbit/s");
+    TEST_ASSERT(decoded[1].type == METRIC_PRB_USAGE && decoded[1].value == 35.5, "Real record should be decoded");
+    TEST_ASSERT(decoded[0].node_id == 7 && decoded[0].cell_id == 11 && decoded[0].timestamp == 1700000000,
+                "Metric should carry node, cell and period start");
+    TEST_ASSERT(decoded[2].type == METRIC_THROUGHPUT && decoded[3].type == METRIC_THROUGHPUT &&
+                decoded[3].timestamp == 1700000001, "Missing PRB value should not shift later periods");
+    TEST_ASSERT(decoded[5].cell_id == 12 && decoded[5].type == METRIC_RSRP && decoded[404].value == rsrp[399],
+                "Second cell should follow the first");
+    TEST_ASSERT(kpm_reader_next(&reader, metrics, 64) == 0, "Reader should stay at the end");
+    
+    // Malformed payloads are rejected before any metric is emitted
+    TEST_ASSERT(kpm_reader_init(&reader, &decoder, payload, size - 1, 7) == -1, "Truncated payload should be rejected");
+    TEST_ASSERT(kpm_reader_init(&reader, &decoder, payload, KPM_HEADER_SIZE - 1, 7) == -1, "Short header should be rejected");
+    payload[KPM_HEADER_SIZE + KPM_CELL_HEADER_SIZE + 2] = 7;
+    TEST_ASSERT(kpm_reader_init(&reader, &decoder, payload, size, 7) == -1, "Unknown record kind should be rejected");
+    payload[KPM_HEADER_SIZE + KPM_CELL_HEADER_SIZE + 2] = KPM_RECORD_INTEGER;
+    payload[0] ^= 0xFF;
+    TEST_ASSERT(kpm_reader_init(&reader, &decoder, payload, size, 7) == -1, "Bad magic should be rejected");
+    payload[0] ^= 0xFF;
+    
+    kpm_writer_init(&writer, payload, 64, 0, 1000);
+    TEST_ASSERT(kpm_writer_add_cell(&writer, 1, rsrp_ids, rsrp_kinds, 400, 1, rsrp) == -1, "Oversized cell should not fit");
+    TEST_ASSERT(kpm_writer_finish(&writer) == 0, "Overflowed payload should not be finished");
+    
+    // Decoded batches feed analytics as they are
+    analytics_context_t* ctx = analytics_init(NULL);
+    TEST_ASSERT(ctx != NULL, "Analytics context should be created");
+    TEST_ASSERT(analytics_process_metrics_batch(ctx, decoded, (int)total) == 0, "Decoded batch should be processed");
+    TEST_ASSERT(ctx->processed_metrics == 405, "Every decoded metric should be ingested");
+    TEST_ASSERT(analytics_get_series_count(ctx) == 3, "Decoded metrics should form one series per cell and type");
+    const metric_history_t* history = analytics_get_series_history(ctx, METRIC_RSRP, 7, 12);
+    TEST_ASSERT(history && history->count == MIN(400, history->capacity), "RSRP series should hold the whole cell");
+    analytics_cleanup(ctx);
+    
+    return 1;
+}
+
+// Test autoregressive forecasting used by ML detection
+int test_ml_model() {
+    printf("\n🧪 Testing Autoregressive ML Model...\n");
+    
+    analytics_context_t* online = analytics_init(NULL);
+    analytics_context_t* trained = analytics_init(NULL);
+    TEST_ASSERT(online != NULL && trained != NULL, "Analytics contexts should be created");
+    
+    // AR(2) process around 50 with small deterministic noise
+    static metric_data_t samples[600];
+    double x1 = 0.0, x2 = 0.0;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 600; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double noise = ((seed >> 8) / (double)(1u << 24) - 0.5) * 0.2;
+        double x = 1.6 * x1 - 0.8 * x2 + noise;
+        x2 = x1;
+        x1 = x;
+        samples[i] = (metric_data_t){ .type = METRIC_THROUGHPUT, .value = 50.0 + x,
+                                      .node_id = 1, .cell_id = 1, .timestamp = 1700000000 + i };
+    }
+    
+    // Online NLMS training, one sample at a time
+    for (int i = 0; i < 600; i++) {
+        analytics_process_metric(online, &samples[i]);
+    }
+    metric_history_t* history = analytics_get_series_history(online, METRIC_THROUGHPUT, 1, 1);
+    TEST_ASSERT(history && analytics_history_model_ready(history), "Online model should be ready");
+    
+    double series_std = history->last_stats.std_dev;
+    double residual_std = sqrt(history->model.residual_var);
+    TEST_ASSERT(residual_std < 0.5 * series_std, "Online forecast error should be well below the series spread");
+    
+    // Batch warm-up fits the same process in one pass
+    TEST_ASSERT(analytics_train_ml_model(trained, samples, 600) == 0, "Batch training should succeed");
+    metric_history_t* fitted = analytics_get_series_history(trained, METRIC_THROUGHPUT, 1, 1);
+    TEST_ASSERT(fitted && analytics_history_model_ready(fitted), "Trained model should be ready");
+    TEST_ASSERT(fabs(fitted->model.weights[0] - 1.6) < 0.1 && fabs(fitted->model.weights[1] + 0.8) < 0.1,
+                "Batch fit should recover the AR coefficients");
+    TEST_ASSERT(trained->anomaly_count == 0, "Training should not run detection");
+    
+    // Forecast of the next sample
+    double expected = 50.0 + 1.6 * x1 - 0.8 * x2;
+    metric_data_t next = { .type = METRIC_THROUGHPUT, .value = expected, .node_id = 1, .cell_id = 1, .timestamp = 1700000600 };
+    TEST_ASSERT(fabs(analytics_predict_ml(trained, &next) - expected) < 0.2, "Forecast should track the process");
+    TEST_ASSERT(fabs(analytics_predict_ml(online, &next) - expected) < 0.3, "Online forecast should track the process");
+    
+    // Prediction error flags a jump that stays inside the recent range
+    double jump = 6.0 * residual_std;
+    next.value = expected + (expected < history->last_stats.mean ? jump : -jump);
+    TEST_ASSERT(next.value > history->last_stats.min && next.value < history->last_stats.max,
+                "Jump should stay within the recent range of the series");
+    analytics_history_append(history, &next);
+    anomaly_result_t anomaly = analytics_ml_detection(online, &next);
+    TEST_ASSERT(anomaly.severity >= ANOMALY_WARNING, "Forecast error should flag the jump");
+    
+    // Supervised update moves the forecast towards the target
+    double before = analytics_predict_ml(online, &next);
+    TEST_ASSERT(analytics_update_ml_model(online, &next, before + 1.0) == 0, "Supervised update should succeed");
+    TEST_ASSERT(analytics_predict_ml(online, &next) > before, "Supervised update should move the forecast");
+    
+    analytics_cleanup(online);
+    analytics_cleanup(trained);
+    return 1;
+}
+
+// Test rolling window statistics
+int test_rolling_statistics() {
+    printf("\n🧪 Testing Rolling Window Statistics...\n");
+    
+    analytics_context_t* ctx = analytics_init(NULL);
+    TEST_ASSERT(ctx != NULL, "Analytics context should be created");
+    
+    // Push enough samples to wrap the window several times
+    metric_data_t data[250];
+    for (int i = 0; i < 250; i++) {
+        data[i].value = 50.0 + ((i * 37) % 101) * 0.5;
+        data[i].timestamp = time(NULL);
+        analytics_add_metric(ctx, METRIC_LATENCY, data[i].value, 1, 1);
+    }
+    
+    // Reference statistics over the newest window_size samples
+    int window = ctx->config.window_size;
+    stats_result_t expected = analytics_calculate_stats(&data[250 - window], window);
+    const stats_result_t* stats = &analytics_get_series_history(ctx, METRIC_LATENCY, 1, 1)->last_stats;
+    
+    TEST_ASSERT(fabs(stats->mean - expected.mean) < 1e-9, "Rolling mean should match full recomputation");
+    TEST_ASSERT(fabs(stats->variance - expected.variance) < 1e-6, "Rolling variance should match full recomputation");
+    TEST_ASSERT(stats->min == expected.min, "Rolling min should match full recomputation");
+    TEST_ASSERT(stats->max == expected.max, "Rolling max should match full recomputation");
+    TEST_ASSERT(stats->median == expected.median, "Rolling median should match full recomputation");
+    TEST_ASSERT(fabs(stats->p95 - expected.p95) < 1e-9, "Rolling p95 should match full recomputation");
+    TEST_ASSERT(fabs(stats->p99 - expected.p99) < 1e-9, "Rolling p99 should match full recomputation");
+    TEST_ASSERT(fabs(stats->z_score - expected.z_score) < 1e-6, "Z-score should refer to the newest sample");
+    
+    analytics_cleanup(ctx);
+    return 1;
+}
+
 // Test anomaly detection
 int test_anomaly_detection() {
     printf("\n🧪 Testing Anomaly Detection...\n");
@@ -171,7 +791,17 @@ int main() {
     total_tests++; if (test_analytics_init()) tests_passed++;
     total_tests++; if (test_metric_processing()) tests_passed++;
     total_tests++; if (test_statistical_analysis()) tests_passed++;
+    total_tests++; if (test_series_store()) tests_passed++;
+    total_tests++; if (test_quantiles()) tests_passed++;
+    total_tests++; if (test_stats_kernels()) tests_passed++;
+    total_tests++; if (test_trend_tracking()) tests_passed++;
+    total_tests++; if (test_batch_processing()) tests_passed++;
+    total_tests++; if (test_sharded_analytics()) tests_passed++;
+    total_tests++; if (test_event_log()) tests_passed++;
+    total_tests++; if (test_kpm_decoder()) tests_passed++;
+    total_tests++; if (test_ml_model()) tests_passed++;
     total_tests++; if (test_trend_analysis()) tests_passed++;
+    total_tests++; if (test_rolling_statistics()) tests_passed++;
     total_tests++; if (test_anomaly_detection()) tests_passed++;
     total_tests++; if (test_z_score()) tests_passed++;
     total_tests++; if (test_string_conversions()) tests_passed++;
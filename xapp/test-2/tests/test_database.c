@@ -8,7 +8,10 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
+#include <math.h>
 #include "../include/database.h"
+#include "../include/metric_blocks.h"
+#include "../include/segment_log.h"
 #include "../include/analytics.h"
 #include "../include/utils.h"
 
@@ -23,6 +26,8 @@
     } while(0)
 
 #define TEST_DB_PATH "/tmp/test_xapp.db"
+#define TEST_SEGMENT_DIR "/tmp/test_xapp_segments"
+#define TEST_BACKUP_PATH "/tmp/test_xapp_backup.db"
 
 // Test database initialization
 int test_database_init() {
@@ -206,6 +211,1245 @@ int test_string_conversions() {
     return 1;
 }
 
+// Count the rows of a table
+static int count_rows(database_context_t* ctx, const char* table) {
+    char sql[128];
+    snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM %s;", table);
+    
+    sqlite3_stmt* stmt;
+    int count = -1;
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return count;
+}
+
+// Count the rows of all day partitions of a kind
+static int count_partitioned_rows(database_context_t* ctx, database_partition_kind_t kind) {
+    int64_t days[64];
+    int partitions = database_list_partitions(ctx, kind, days, 64);
+    
+    int count = 0;
+    for (int i = 0; i < partitions; i++) {
+        char name[64];
+        database_partition_name(kind, days[i], name, sizeof(name));
+        count += count_rows(ctx, name);
+    }
+    return count;
+}
+
+// Test batch insertion
+int test_batch_insertion() {
+    printf("\n🧪 Testing Batch Insertion...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    metric_data_t metrics[500];
+    time_t now = time(NULL);
+    for (int i = 0; i < 500; i++) {
+        metrics[i] = (metric_data_t){
+            .type = METRIC_LATENCY,
+            .value = 10.0 + i,
+            .node_id = 1 + i % 4,
+            .cell_id = 1,
+            .timestamp = now
+        };
+    }
+    
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 500) == 0, "Batch insertion should succeed");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == 500, "Every metric of the batch should be stored");
+    TEST_ASSERT(ctx->total_inserts == 500, "Insert counter should count the batch rows");
+    TEST_ASSERT(sqlite3_get_autocommit(ctx->db), "Batch transaction should be closed");
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 0) == 0, "Empty batch should succeed");
+    TEST_ASSERT(database_insert_metrics_batch(ctx, NULL, 10) != 0, "NULL batch should fail");
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Test the write-behind writer
+int test_group_commit_writer() {
+    printf("\n🧪 Testing Group Commit Writer...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    const int rows = 20000;
+    time_t now = time(NULL);
+    
+    // Baseline: one autocommit transaction per row
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    const int direct_rows = 1000;
+    uint64_t start = utils_get_timestamp_us();
+    for (int i = 0; i < direct_rows; i++) {
+        metric_data_t metric = { .type = METRIC_THROUGHPUT, .value = i, .node_id = 1, .cell_id = 1, .timestamp = now };
+        database_insert_metric(ctx, &metric);
+    }
+    double direct_rate = direct_rows / ((utils_get_timestamp_us() - start + 1) / 1e6);
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    TEST_ASSERT(database_start_writer(ctx) != 0, "Writer should not start twice");
+    
+    start = utils_get_timestamp_us();
+    int failed = 0;
+    for (int i = 0; i < rows; i++) {
+        metric_data_t metric = { .type = METRIC_THROUGHPUT, .value = i, .node_id = 1 + i % 8, .cell_id = 1, .timestamp = now };
+        if (database_insert_metric(ctx, &metric) != 0) failed++;
+    }
+    
+    anomaly_result_t anomaly = {
+        .metric_type = METRIC_LATENCY,
+        .severity = ANOMALY_WARNING,
+        .threshold_value = 50.0,
+        .actual_value = 80.0,
+        .confidence = 0.9,
+        .detected_at = now
+    };
+    strcpy(anomaly.description, "Queued anomaly");
+    if (database_insert_anomaly(ctx, &anomaly) != 0) failed++;
+    if (database_log_event(ctx, EVENT_ANOMALY_DETECTED, 1, 0, "Queued event", "") != 0) failed++;
+    
+    TEST_ASSERT(database_flush(ctx) == 0, "Flush should succeed");
+    double writer_rate = rows / ((utils_get_timestamp_us() - start + 1) / 1e6);
+    printf("   Direct: %.0f rows/s, group commit: %.0f rows/s (%.1fx, %llu commits)\n",
+           direct_rate, writer_rate, writer_rate / direct_rate, (unsigned long long)ctx->group_commits);
+    
+    int queued = rows + 2 - failed;
+    TEST_ASSERT(failed == (int)atomic_load(&ctx->dropped_writes), "Only full queues should reject rows");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) + count_rows(ctx, "anomalies") + count_partitioned_rows(ctx, DATABASE_PARTITION_EVENTS) == queued,
+                "Flushed rows should be visible");
+    TEST_ASSERT(ctx->total_inserts == (uint64_t)queued, "Insert counter should count committed rows");
+    TEST_ASSERT(ctx->group_commits < (uint64_t)queued, "Rows should share transactions");
+    
+    // Rows still queued at stop are committed before the writer exits
+    metric_data_t metrics[100];
+    for (int i = 0; i < 100; i++) {
+        metrics[i] = (metric_data_t){ .type = METRIC_CPU_UTILIZATION, .value = i, .node_id = 1, .cell_id = 1, .timestamp = now };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 100) == 0, "Batch should be queued");
+    database_stop_writer(ctx);
+    TEST_ASSERT(!atomic_load(&ctx->writer_running), "Writer should stop");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == rows - failed + 100, "Stop should drain the queue");
+    
+    // Without the writer inserts are synchronous again
+    TEST_ASSERT(database_insert_metric(ctx, &metrics[0]) == 0, "Direct insert should succeed after stop");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == rows - failed + 101, "Direct insert should be visible at once");
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Test day partitions and retention
+int test_partition_retention() {
+    printf("\n🧪 Testing Partition Retention...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    ctx->config.retention_chunk_rows = 10;
+    
+    // Start of the current UTC day, so the offsets below land on known days
+    time_t today = time(NULL) / 86400 * 86400;
+    metric_data_t metrics[40];
+    for (int i = 0; i < 40; i++) {
+        metrics[i] = (metric_data_t){
+            .type = METRIC_THROUGHPUT,
+            .value = i,
+            .node_id = 1,
+            .cell_id = 1,
+            .timestamp = today - (i % 4) * 86400
+        };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 40) == 0, "Batch over four days should be stored");
+    
+    int64_t days[8];
+    TEST_ASSERT(database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 8) == 4, "Each day should get a partition");
+    TEST_ASSERT(days[0] == today / 86400 - 3 && days[3] == today / 86400, "Partitions should be listed oldest first");
+    
+    char name[64];
+    database_partition_name(DATABASE_PARTITION_METRICS, days[3], name, sizeof(name));
+    TEST_ASSERT(count_rows(ctx, name) == 10, "Rows should land in their day's partition");
+    
+    database_log_event(ctx, EVENT_XAPP_START, 0, 0, "Start", "");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_EVENTS) == 1, "Events should be partitioned by day");
+    
+    for (int i = 0; i < 25; i++) {
+        anomaly_result_t anomaly = {
+            .metric_type = METRIC_LATENCY,
+            .severity = ANOMALY_WARNING,
+            .detected_at = (i < 20) ? today - 3 * 86400 : time(NULL)
+        };
+        database_insert_anomaly(ctx, &anomaly);
+    }
+    
+    // Two days back: the oldest partition goes whole, the one straddling the
+    // cutoff and the old anomalies are swept in chunks
+    TEST_ASSERT(database_cleanup_old_data(ctx, 2) == 0, "Cleanup should succeed");
+    TEST_ASSERT(database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 8) == 3, "Expired partition should be dropped");
+    TEST_ASSERT(ctx->dropped_partitions == 1, "Drops should be counted");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == 20, "Recent metrics should survive");
+    TEST_ASSERT(count_rows(ctx, "anomalies") == 5, "Old anomalies should be swept");
+    TEST_ASSERT(ctx->swept_rows == 30, "Sweep should delete exactly the old rows");
+    TEST_ASSERT(atomic_load(&ctx->cleanup_cutoff) == 0, "Cleanup request should be finished");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_EVENTS) == 1, "Recent events should survive");
+    
+    // Writes into a dropped day recreate its partition
+    TEST_ASSERT(database_insert_metric(ctx, &metrics[3]) == 0, "Insert into an old day should succeed");
+    TEST_ASSERT(database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 8) == 4, "Partition should be recreated");
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Test that retention due inside a caller's transaction leaves it alone
+int test_retention_in_transaction() {
+    printf("\n🧪 Testing Retention Inside a Transaction...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    time_t today = time(NULL) / 86400 * 86400;
+    metric_data_t old_metric = {
+        .type = METRIC_THROUGHPUT, .value = 1, .node_id = 1, .cell_id = 1, .timestamp = today - 5 * 86400
+    };
+    TEST_ASSERT(database_insert_metric(ctx, &old_metric) == 0, "Old metric should be stored");
+    
+    // The old partition is now expired and retention is due
+    ctx->config.metric_retention_days = 2;
+    atomic_store(&ctx->retention_wakeup, true);
+    
+    metric_data_t metrics[10];
+    for (int i = 0; i < 10; i++) {
+        metrics[i] = (metric_data_t){
+            .type = METRIC_THROUGHPUT, .value = i, .node_id = 1, .cell_id = 1, .timestamp = today
+        };
+    }
+    
+    TEST_ASSERT(database_begin_transaction(ctx) == 0, "Transaction should begin");
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 10) == 0, "Batch inside the transaction should be stored");
+    TEST_ASSERT(database_log_event(ctx, EVENT_XAPP_START, 0, 0, "Start", "") == 0, "Event inside the transaction should be stored");
+    
+    int64_t days[8];
+    TEST_ASSERT(database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 8) == 2, "Retention should wait for the commit");
+    TEST_ASSERT(database_commit_transaction(ctx) == 0, "Caller's transaction should commit");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == 11, "Caller's rows should survive");
+    
+    // The next write outside a transaction catches up
+    TEST_ASSERT(database_log_event(ctx, EVENT_XAPP_STOP, 0, 0, "Stop", "") == 0, "Event should be stored");
+    TEST_ASSERT(database_list_partitions(ctx, DATABASE_PARTITION_METRICS, days, 8) == 1, "Expired partition should be dropped");
+    TEST_ASSERT(ctx->dropped_partitions == 1, "Drop should be counted");
+    TEST_ASSERT(count_partitioned_rows(ctx, DATABASE_PARTITION_METRICS) == 10, "Recent metrics should survive");
+    TEST_ASSERT(database_insert_metric(ctx, &old_metric) == 0, "Insert into the dropped day should recreate it");
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Chunk callback checking that rows arrive newest first
+typedef struct {
+    int64_t rows;
+    int chunks;
+    int max_chunk;
+    time_t last_timestamp;
+    bool ordered;
+    int64_t stop_after;
+} scan_state_t;
+
+static int check_metric_chunk(const database_cursor_t* cursor, void* user_data) {
+    scan_state_t* state = user_data;
+    
+    for (int i = 0; i < cursor->count; i++) {
+        if (cursor->metrics[i].timestamp > state->last_timestamp) state->ordered = false;
+        state->last_timestamp = cursor->metrics[i].timestamp;
+    }
+    state->rows += cursor->count;
+    state->chunks++;
+    if (cursor->count > state->max_chunk) state->max_chunk = cursor->count;
+    
+    return (state->stop_after > 0 && state->rows >= state->stop_after);
+}
+
+// Test streaming cursor queries
+int test_streaming_queries() {
+    printf("\n🧪 Testing Streaming Queries...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    // 15000 metrics over three days, alternating between two nodes
+    time_t today = time(NULL) / 86400 * 86400;
+    metric_data_t* metrics = malloc(15000 * sizeof(metric_data_t));
+    for (int i = 0; i < 15000; i++) {
+        metrics[i] = (metric_data_t){
+            .type = (i % 10 == 0) ? METRIC_LATENCY : METRIC_THROUGHPUT,
+            .value = i,
+            .node_id = 1 + i % 2,
+            .cell_id = 1,
+            .timestamp = today - 2 * 86400 + i * 15
+        };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 15000) == 0, "Metrics should be stored");
+    
+    database_cursor_t* cursor = database_open_metric_cursor(ctx, METRIC_THROUGHPUT, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    TEST_ASSERT(cursor != NULL, "Metric cursor should open");
+    TEST_ASSERT(cursor->day_count == 3, "Cursor should visit the three partitions");
+    
+    scan_state_t state = { .last_timestamp = INT64_MAX, .ordered = true };
+    TEST_ASSERT(database_cursor_scan(cursor, check_metric_chunk, &state) == 13500, "Scan should return every matching row");
+    TEST_ASSERT(state.rows == 13500, "Callback should see every row");
+    TEST_ASSERT(state.ordered, "Rows should come newest first across partitions");
+    TEST_ASSERT(state.chunks > 1 && state.max_chunk <= cursor->chunk_rows, "Rows should arrive in fixed-size chunks");
+    TEST_ASSERT(database_cursor_next(cursor) == 0, "Finished cursor should return no rows");
+    database_cursor_close(cursor);
+    
+    // Node and time filters, limit, early stop
+    cursor = database_open_metric_cursor(ctx, METRIC_LATENCY, 2, 0, INT64_MAX, -1);
+    TEST_ASSERT(database_cursor_scan(cursor, NULL, NULL) == 0, "Latency rows all belong to node 1");
+    database_cursor_close(cursor);
+    
+    time_t range_start = today - 2 * 86400 + 1000 * 15;
+    time_t range_end = today - 2 * 86400 + 1999 * 15;
+    metric_query_result_t* result = database_query_metrics(ctx, METRIC_THROUGHPUT, 1, range_start, range_end);
+    TEST_ASSERT(result != NULL && result->count == 400, "Range query should match node 1 throughput inside bounds");
+    TEST_ASSERT(result->metrics[0].timestamp == range_end - 15 && result->metrics[399].timestamp == range_start + 30,
+                "Range query should be newest first and inclusive");
+    database_free_metric_result(result);
+    
+    result = database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 10);
+    TEST_ASSERT(result != NULL && result->count == 10, "Recent query should honour the limit");
+    TEST_ASSERT(result->metrics[0].timestamp == metrics[14999].timestamp, "Recent query should start at the newest row");
+    database_free_metric_result(result);
+    
+    cursor = database_open_metric_cursor(ctx, DATABASE_ANY, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    scan_state_t partial = { .last_timestamp = INT64_MAX, .ordered = true, .stop_after = 1 };
+    database_cursor_scan(cursor, check_metric_chunk, &partial);
+    TEST_ASSERT(partial.chunks == 1, "Callback should be able to stop the scan");
+    database_cursor_close(cursor);
+    free(metrics);
+    
+    // Concurrent anomaly cursors read on connections of their own
+    for (int i = 0; i < 30; i++) {
+        anomaly_result_t anomaly = {
+            .metric_type = METRIC_LATENCY,
+            .severity = (i % 3 == 0) ? ANOMALY_CRITICAL : ANOMALY_WARNING,
+            .detected_at = today + i
+        };
+        snprintf(anomaly.description, sizeof(anomaly.description), "Anomaly %d", i);
+        database_insert_anomaly(ctx, &anomaly);
+    }
+    
+    database_cursor_t* first = database_open_anomaly_cursor(ctx, ANOMALY_CRITICAL, 0, INT64_MAX, -1);
+    database_cursor_t* second = database_open_anomaly_cursor(ctx, ANOMALY_NONE, 0, INT64_MAX, 5);
+    first->chunk_rows = 4;
+    TEST_ASSERT(database_cursor_next(first) == 4, "Chunk should stop at chunk_rows");
+    TEST_ASSERT(first->reader && second->reader && first->reader != second->reader,
+                "Concurrent cursors should hold their own read connections");
+    TEST_ASSERT(database_cursor_next(second) == 5, "Concurrent cursor should use its own statement");
+    TEST_ASSERT(strcmp(second->anomalies[0].description, "Anomaly 29") == 0, "Text columns should be decoded");
+    database_cursor_close(second);
+    TEST_ASSERT(database_cursor_scan(first, NULL, NULL) == 6, "Critical anomalies should be filtered");
+    database_cursor_close(first);
+    TEST_ASSERT(ctx->idle_reader_count == ctx->reader_count, "Closed cursors should hand their connections back");
+    
+    anomaly_query_result_t* anomalies = database_query_recent_anomalies(ctx, 100);
+    TEST_ASSERT(anomalies != NULL && anomalies->count == 30, "Recent anomalies should be materialized");
+    database_free_anomaly_result(anomalies);
+    
+    database_log_event(ctx, EVENT_NODE_CONNECT, 1, 0, "Node connected", "");
+    database_log_event(ctx, EVENT_NODE_DISCONNECT, 1, 0, "Node disconnected", "");
+    event_query_result_t* events = database_query_events(ctx, EVENT_NODE_CONNECT, 0, INT64_MAX);
+    TEST_ASSERT(events != NULL && events->count == 1, "Event query should filter by type");
+    TEST_ASSERT(strcmp(events->events[0].message, "Node connected") == 0, "Event message should be decoded");
+    database_free_event_result(events);
+    
+    // IDs above INT32_MAX are stored unsigned, as the rollups store them
+    metric_data_t high = { .type = METRIC_THROUGHPUT, .value = 1.0, .node_id = 3000000000u, .cell_id = 4000000000u,
+                           .timestamp = today };
+    TEST_ASSERT(database_insert_metric(ctx, &high) == 0, "Metric with a high node ID should be stored");
+    result = database_query_metrics(ctx, METRIC_THROUGHPUT, 3000000000u, today, today);
+    TEST_ASSERT(result != NULL && result->count == 1 && result->metrics[0].cell_id == 4000000000u,
+                "High node and cell IDs should round-trip");
+    database_free_metric_result(result);
+    
+    database_log_event(ctx, EVENT_SUBSCRIPTION_CREATE, 3000000000u, 4000000000u, "Subscription created", "");
+    events = database_query_events(ctx, EVENT_SUBSCRIPTION_CREATE, 0, INT64_MAX);
+    TEST_ASSERT(events != NULL && events->count == 1 && events->events[0].node_id == 3000000000u &&
+                events->events[0].subscription_id == 4000000000u, "High event IDs should round-trip");
+    database_free_event_result(events);
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Brute-force statistics of the generated series over [start, end]
+static int expected_stats(const metric_data_t* metrics, int count, uint32_t node_id, time_t start, time_t end,
+                          double* mean, double* variance, double* min, double* max) {
+    int n = 0;
+    double sum = 0.0, m2 = 0.0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < count; i++) {
+            const metric_data_t* m = &metrics[i];
+            if (m->timestamp < start || m->timestamp > end) continue;
+            if (node_id != DATABASE_ANY_NODE && m->node_id != node_id) continue;
+            if (pass == 1) {
+                m2 += (m->value - *mean) * (m->value - *mean);
+                continue;
+            }
+            if (n == 0 || m->value < *min) *min = m->value;
+            if (n == 0 || m->value > *max) *max = m->value;
+            sum += m->value;
+            n++;
+        }
+        *mean = n ? sum / n : 0.0;
+    }
+    *variance = n ? m2 / n : 0.0;
+    return n;
+}
+
+// Compare rollup statistics with a brute-force pass over the raw samples
+static int stats_match(database_context_t* ctx, const metric_data_t* metrics, int count,
+                       uint32_t node_id, time_t start, time_t end) {
+    double mean, variance, min, max;
+    int n = expected_stats(metrics, count, node_id, start, end, &mean, &variance, &min, &max);
+    
+    stats_result_t stats;
+    int rc = database_get_metric_stats(ctx, METRIC_THROUGHPUT, node_id, start, end, &stats);
+    if (n == 0) return rc != 0;
+    
+    return rc == 0 && fabs(stats.mean - mean) < 1e-6 && fabs(stats.variance - variance) < 1e-3 &&
+           stats.min == min && stats.max == max;
+}
+
+// Test multi-resolution rollups
+int test_metric_rollups() {
+    printf("\n🧪 Testing Metric Rollups...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    // Three days of samples every 10 s from two nodes
+    const int count = 3 * 8640 * 2;
+    time_t origin = time(NULL) / 86400 * 86400 - 3 * 86400;
+    metric_data_t* metrics = malloc(count * sizeof(metric_data_t));
+    for (int i = 0; i < count; i++) {
+        metrics[i] = (metric_data_t){
+            .type = METRIC_THROUGHPUT,
+            .value = (i * 37) % 1000 / 10.0,
+            .node_id = 1 + i % 2,
+            .cell_id = 1 + i % 3,
+            .timestamp = origin + (i / 2) * 10
+        };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, count) == 0, "Metrics should be stored");
+    
+    time_t last = origin + 3 * 86400 - 10;
+    TEST_ASSERT(stats_match(ctx, metrics, count, 1, origin, last), "Whole range should match the raw samples");
+    TEST_ASSERT(stats_match(ctx, metrics, count, DATABASE_ANY_NODE, origin + 37, last - 123),
+                "Ragged range over all nodes should match");
+    TEST_ASSERT(stats_match(ctx, metrics, count, 2, origin + 3600 + 65, origin + 3600 + 115),
+                "Range inside one minute should match");
+    TEST_ASSERT(stats_match(ctx, metrics, count, 2, origin + 7199, origin + 7201), "Range across an hour edge should match");
+    TEST_ASSERT(stats_match(ctx, metrics, count, 1, origin + 5, origin + 9), "Empty range should report no samples");
+    
+    stats_result_t stats;
+    TEST_ASSERT(database_get_metric_stats(ctx, METRIC_THROUGHPUT, 1, last, origin, &stats) != 0, "Inverted range should fail");
+    
+    // Past the per-second retention, edges are rounded out to whole minutes
+    ctx->config.metric_retention_days = 1;
+    double mean, variance, min, max;
+    int n = expected_stats(metrics, count, 2, origin + 3600 + 60, origin + 3600 + 119, &mean, &variance, &min, &max);
+    TEST_ASSERT(n > 0 && database_get_metric_stats(ctx, METRIC_THROUGHPUT, 2, origin + 3600 + 65, origin + 3600 + 115, &stats) == 0 &&
+                fabs(stats.mean - mean) < 1e-6 && stats.min == min && stats.max == max,
+                "Expired second edges should fall back to minute rollups");
+    ctx->config.metric_retention_days = DATABASE_METRIC_RETENTION_DAYS;
+    
+    uint64_t start = utils_get_timestamp_us();
+    for (int i = 0; i < 100; i++) {
+        database_get_metric_stats(ctx, METRIC_THROUGHPUT, 1, origin + 1 + i, last - i, &stats);
+    }
+    double query_ms = (utils_get_timestamp_us() - start) / 100.0 / 1000.0;
+    printf("   Three-day stats query: %.3f ms\n", query_ms);
+    TEST_ASSERT(query_ms < 50.0, "Multi-day stats should be answered from rollups");
+    
+    // Writer groups maintain rollups too
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    metric_data_t extra = { .type = METRIC_THROUGHPUT, .value = 1000.0, .node_id = 1, .cell_id = 1, .timestamp = last };
+    database_insert_metric(ctx, &extra);
+    database_flush(ctx);
+    TEST_ASSERT(database_get_metric_stats(ctx, METRIC_THROUGHPUT, 1, origin, last, &stats) == 0 && stats.max == 1000.0,
+                "Queued metrics should reach the rollups");
+    database_stop_writer(ctx);
+    database_cleanup(ctx);
+    
+    // Rollups are rebuilt from stored metrics when their tables are missing
+    sqlite3* db;
+    sqlite3_open(TEST_DB_PATH, &db);
+    sqlite3_exec(db, "DROP TABLE rollup_1s; DROP TABLE rollup_1m; DROP TABLE rollup_1h;", NULL, NULL, NULL);
+    sqlite3_close(db);
+    
+    ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database should reopen");
+    metrics[0] = extra;
+    TEST_ASSERT(stats_match(ctx, metrics, count, DATABASE_ANY_NODE, origin + 37, last),
+                "Rebuilt rollups should match the raw samples");
+    
+    // Variance stays exact for values far from zero
+    metric_data_t offset[600];
+    for (int i = 0; i < 600; i++) {
+        offset[i] = (metric_data_t){ .type = METRIC_LATENCY, .value = 1e9 + (i % 3) * 0.5, .node_id = 3,
+                                     .cell_id = 1, .timestamp = origin + 7000 + i * 7 };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, offset, 600) == 0, "Offset metrics should be stored");
+    TEST_ASSERT(database_get_metric_stats(ctx, METRIC_LATENCY, 3, origin + 7013, origin + 11000, &stats) == 0 &&
+                fabs(stats.variance - 1.0 / 6.0) < 1e-3,
+                "Rollup variance should not cancel for large values");
+    
+    free(metrics);
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Run a query returning one integer
+static int64_t query_int64(database_context_t* ctx, const char* sql) {
+    sqlite3_stmt* stmt;
+    int64_t value = -1;
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Slowly changing gauge, like PRB usage in percent
+static double block_test_value(uint32_t node_id, uint32_t cell_id, int i) {
+    return 40.0 + ((i + cell_id * 7 + node_id * 3) / 30) % 20;
+}
+
+// Test compressed metric blocks
+int test_metric_blocks() {
+    printf("\n🧪 Testing Compressed Metric Blocks...\n");
+    
+    // Lossless round trip of irregular timestamps and arbitrary values
+    enum { SAMPLES = 2000 };
+    int64_t times[SAMPLES];
+    double values[SAMPLES];
+    int64_t t = 1700000000;
+    unsigned int seed = 42;
+    for (int i = 0; i < SAMPLES; i++) {
+        t += (i % 50 == 0) ? -3 : (i % 7 == 0) ? 100000 : (i % 3 == 0) ? 1 : 10;
+        times[i] = t;
+        switch (i % 5) {
+            case 0: values[i] = (double)rand_r(&seed) / RAND_MAX * 1e6 - 5e5; break;
+            case 1: values[i] = values[i - 1]; break;
+            case 2: values[i] = -0.0; break;
+            case 3: values[i] = 1e-300 * (i + 1); break;
+            default: values[i] = (double)(i % 17); break;
+        }
+    }
+    
+    metric_block_t block;
+    metric_block_init(&block);
+    int encoded = 0;
+    while (encoded < SAMPLES && metric_block_append(&block, times[encoded], values[encoded]) == 0) {
+        encoded++;
+    }
+    TEST_ASSERT(encoded == SAMPLES, "Every sample should be encoded");
+    
+    metric_block_reader_t reader;
+    metric_block_reader_init(&reader, block.data, metric_block_size(&block), block.count);
+    int matched = 0;
+    int64_t read_time;
+    double read_value;
+    while (metric_block_read(&reader, &read_time, &read_value)) {
+        if (read_time == times[matched] && memcmp(&read_value, &values[matched], sizeof(double)) == 0) matched++;
+        else break;
+    }
+    TEST_ASSERT(matched == SAMPLES, "Decoded samples should match bit for bit");
+    metric_block_free(&block);
+    
+    // Store three series in blocks
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    ctx->config.metric_storage = DATABASE_METRIC_STORAGE_BLOCKS;
+    
+    const uint32_t series[3][2] = { {1, 1}, {1, 2}, {2, 1} };
+    const int per_series = 3000;
+    time_t base = time(NULL) - per_series - 60;
+    metric_data_t batch[300];
+    int stored = 0;
+    
+    for (int i = 0; i < per_series; i += 100) {
+        int count = 0;
+        for (int j = i; j < i + 100; j++) {
+            for (int s = 0; s < 3; s++) {
+                batch[count++] = (metric_data_t){
+                    .type = METRIC_PRB_USAGE,
+                    .node_id = series[s][0],
+                    .cell_id = series[s][1],
+                    .value = block_test_value(series[s][0], series[s][1], j),
+                    .timestamp = base + j
+                };
+            }
+        }
+        if (database_insert_metrics_batch(ctx, batch, count) == 0) stored += count;
+    }
+    TEST_ASSERT(stored == 3 * per_series, "Every sample should be stored");
+    printf("   Block writes: %llu for %d commits\n", (unsigned long long)ctx->block_writes, per_series / 100);
+    TEST_ASSERT(ctx->block_writes < 3 * (per_series / 100), "Open blocks should not be rewritten on every commit");
+    TEST_ASSERT(database_sync_blocks(ctx) == 0, "Open blocks should be written back");
+    TEST_ASSERT(count_rows(ctx, "metric_blocks") == 3 * ((per_series + DATABASE_BLOCK_SAMPLES - 1) / DATABASE_BLOCK_SAMPLES),
+                "Series should be cut into blocks of block_samples");
+    TEST_ASSERT(query_int64(ctx, "SELECT SUM(sample_count) FROM metric_blocks;") == stored, "Blocks should count every sample");
+    
+    double bytes_per_sample = (double)query_int64(ctx, "SELECT SUM(LENGTH(data)) FROM metric_blocks;") / stored;
+    printf("   Compressed size: %.2f bytes/sample\n", bytes_per_sample);
+    TEST_ASSERT(bytes_per_sample < 2.0, "Gauge samples should take under 2 bytes");
+    
+    // Range scan of one node merges its two cells newest first
+    metric_query_result_t* result = database_query_metrics(ctx, METRIC_PRB_USAGE, 1, base + 100, base + 2500);
+    TEST_ASSERT(result != NULL && result->count == 2 * 2401, "Range query should return both cells of the node");
+    
+    bool ordered = true;
+    for (int i = 0; i < result->count; i++) {
+        const metric_data_t* m = &result->metrics[i];
+        if ((i > 0 && m->timestamp > result->metrics[i - 1].timestamp) || m->node_id != 1 ||
+            m->value != block_test_value(m->node_id, m->cell_id, (int)(m->timestamp - base))) {
+            ordered = false;
+        }
+    }
+    TEST_ASSERT(ordered, "Samples should come newest first with their values");
+    database_free_metric_result(result);
+    
+    result = database_query_recent_metrics(ctx, METRIC_PRB_USAGE, 5);
+    TEST_ASSERT(result != NULL && result->count == 5 && result->metrics[0].timestamp == base + per_series - 1,
+                "Recent query should start at the newest sample");
+    database_free_metric_result(result);
+    
+    // Writer groups append to the open blocks; an older sample opens a new block
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    metric_data_t late = { .type = METRIC_PRB_USAGE, .node_id = 2, .cell_id = 1, .value = 99.5, .timestamp = base + per_series };
+    metric_data_t early = late;
+    early.timestamp = base + 5;
+    database_insert_metric(ctx, &late);
+    database_insert_metric(ctx, &early);
+    database_flush(ctx);
+    
+    result = database_query_metrics(ctx, METRIC_PRB_USAGE, 2, base, base + per_series);
+    TEST_ASSERT(result != NULL && result->count == per_series + 2 && result->metrics[0].value == 99.5,
+                "Queued samples should be readable after a flush");
+    database_free_metric_result(result);
+    database_cleanup(ctx);
+    
+    // Blocks survive a reopen
+    ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database should reopen");
+    ctx->config.metric_storage = DATABASE_METRIC_STORAGE_BLOCKS;
+    
+    database_cursor_t* cursor = database_open_metric_cursor(ctx, DATABASE_ANY, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    TEST_ASSERT(cursor != NULL, "Cursor should open");
+    TEST_ASSERT(database_cursor_scan(cursor, NULL, NULL) == stored + 2, "Every stored sample should be read back");
+    database_cursor_close(cursor);
+    
+    // A rollback keeps committed samples an open block has not written yet,
+    // even when the rolled back transaction sealed that block
+    metric_data_t more[600];
+    for (int i = 0; i < 600; i++) {
+        more[i] = (metric_data_t){ .type = METRIC_PRB_USAGE, .node_id = 3, .cell_id = 1,
+                                   .value = block_test_value(3, 1, i), .timestamp = base + i };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, more, 10) == 0, "Samples should be stored");
+    for (int sealed = 0; sealed < 2; sealed++) {
+        database_begin_transaction(ctx);
+        database_insert_metrics_batch(ctx, more + 10, sealed ? 590 : 20);
+        database_rollback_transaction(ctx);
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, more + 10, 5) == 0 && database_sync_blocks(ctx) == 0,
+                "Samples should be stored after a rollback");
+    result = database_query_metrics(ctx, METRIC_PRB_USAGE, 3, base, base + 600);
+    TEST_ASSERT(result != NULL && result->count == 15 && result->metrics[0].timestamp == base + 14 &&
+                result->metrics[14].value == block_test_value(3, 1, 0),
+                "Rolled back samples should be gone and committed ones kept");
+    database_free_metric_result(result);
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Compactor callback storing segments in the test database
+static int test_compact_segment(uint64_t sequence, const metric_data_t* metrics, size_t count, void* user_data) {
+    return database_compact_segment((database_context_t*)user_data, sequence, metrics, (int)count) < 0 ? -1 : 0;
+}
+
+static int64_t count_stored_metrics(database_context_t* ctx) {
+    database_cursor_t* cursor = database_open_metric_cursor(ctx, DATABASE_ANY, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    int64_t count = cursor ? database_cursor_scan(cursor, NULL, NULL) : -1;
+    database_cursor_close(cursor);
+    return count;
+}
+
+// Appender thread state for the segment log test
+typedef struct {
+    segment_log_t* log;
+    uint32_t node_id;
+    size_t appended;
+} segment_appender_state_t;
+
+// Append 5000 records of one node in uneven batches, so ranges cross segment ends
+static void* segment_appender_thread(void* arg) {
+    segment_appender_state_t* state = (segment_appender_state_t*)arg;
+    metric_data_t batch[37];
+    
+    for (int i = 0; i < 5000; i += 37) {
+        int count = MIN(37, 5000 - i);
+        for (int j = 0; j < count; j++) {
+            batch[j] = (metric_data_t){ .type = METRIC_THROUGHPUT, .node_id = state->node_id, .cell_id = 1,
+                                        .value = i + j, .timestamp = time(NULL) - 100 };
+        }
+        state->appended += segment_log_append(state->log, batch, (size_t)count);
+    }
+    return NULL;
+}
+
+// Test segment log capture, recovery and compaction
+int test_segment_log() {
+    printf("\n🧪 Testing Segment Log...\n");
+    
+    unlink(TEST_DB_PATH);
+    system("rm -rf " TEST_SEGMENT_DIR);
+    
+    metric_data_t metrics[2500];
+    time_t base = time(NULL) - 3000;
+    for (int i = 0; i < 2500; i++) {
+        metrics[i] = (metric_data_t){
+            .type = METRIC_PRB_USAGE, .node_id = 1, .cell_id = (uint32_t)(i % 4) + 1,
+            .value = 50.0 + i % 40, .timestamp = base + i
+        };
+    }
+    
+    // Fill two segments and half of a third
+    segment_log_t* log = segment_log_open(TEST_SEGMENT_DIR, 1000, SEGMENT_LOG_SYNC_MS);
+    TEST_ASSERT(log != NULL, "Segment log should open");
+    TEST_ASSERT(segment_log_append(log, metrics, 2500) == 2500, "Every record should be appended");
+    TEST_ASSERT(segment_log_pending_segments(log) == 2, "Full segments should be sealed");
+    
+    char active_path[640];
+    segment_log_segment_path(log, log->sequence, active_path, sizeof(active_path));
+    segment_log_close(log);
+    
+    // Tear record 400 of the last segment, as a crash mid-write would
+    FILE* file = fopen(active_path, "r+b");
+    TEST_ASSERT(file != NULL, "Last segment should be on disk");
+    fseek(file, (long)(sizeof(segment_header_t) + 400 * sizeof(segment_record_t) + offsetof(segment_record_t, value)), SEEK_SET);
+    double torn = -1.0;
+    fwrite(&torn, sizeof(torn), 1, file);
+    fclose(file);
+    
+    log = segment_log_open(TEST_SEGMENT_DIR, 1000, SEGMENT_LOG_SYNC_MS);
+    TEST_ASSERT(log != NULL, "Segment log should reopen");
+    TEST_ASSERT(segment_log_pending_segments(log) == 3, "Every segment left behind should be queued");
+    TEST_ASSERT(log->recovered_records == 400, "Recovery should stop at the torn record");
+    
+    // Compact into the database, exactly once
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    uint64_t first_sequence = log->sealed[0];
+    TEST_ASSERT(segment_log_compact_pending(log, test_compact_segment, ctx) == 3, "Every sealed segment should be compacted");
+    TEST_ASSERT(segment_log_pending_segments(log) == 0, "No segment should be left pending");
+    TEST_ASSERT(count_stored_metrics(ctx) == 2400, "Valid records should be stored");
+    TEST_ASSERT(count_rows(ctx, "compacted_segments") == 3, "Compacted segments should be recorded");
+    
+    char first_path[640];
+    segment_log_segment_path(log, first_sequence, first_path, sizeof(first_path));
+    TEST_ASSERT(access(first_path, F_OK) != 0, "Compacted segment files should be deleted");
+    
+    TEST_ASSERT(database_compact_segment(ctx, first_sequence, metrics, 1000) == 0,
+                "A segment compacted again should be skipped");
+    TEST_ASSERT(count_stored_metrics(ctx) == 2400, "Skipped segment should add no rows");
+    
+    // Background compactor folds segments as they are sealed
+    TEST_ASSERT(segment_log_start_compactor(log, test_compact_segment, ctx) == 0, "Compactor should start");
+    TEST_ASSERT(segment_log_append(log, metrics, 1500) == 1500, "Records should be appended");
+    segment_log_stop_compactor(log);
+    TEST_ASSERT(segment_log_pending_segments(log) == 0, "Stop should drain sealed segments");
+    TEST_ASSERT(count_stored_metrics(ctx) == 3400, "Sealed segment should be stored");
+    segment_log_close(log);
+    
+    // Concurrent appenders share segments without a lock; every record
+    // survives rollovers, a reopen and compaction
+    log = segment_log_open(TEST_SEGMENT_DIR, 1000, SEGMENT_LOG_SYNC_MS);
+    TEST_ASSERT(log != NULL && log->spare != NULL, "Segment log should open with a spare segment");
+    TEST_ASSERT(segment_log_compact_pending(log, test_compact_segment, ctx) == 1 && count_stored_metrics(ctx) == 3900,
+                "Records left in the active segment should be compacted after a reopen");
+    
+    enum { APPENDERS = 4 };
+    pthread_t appenders[APPENDERS];
+    segment_appender_state_t appender_states[APPENDERS];
+    for (int i = 0; i < APPENDERS; i++) {
+        appender_states[i] = (segment_appender_state_t){ .log = log, .node_id = 10 + (uint32_t)i };
+        pthread_create(&appenders[i], NULL, segment_appender_thread, &appender_states[i]);
+    }
+    size_t concurrent = 0;
+    for (int i = 0; i < APPENDERS; i++) {
+        pthread_join(appenders[i], NULL);
+        concurrent += appender_states[i].appended;
+    }
+    TEST_ASSERT(concurrent == APPENDERS * 5000 && atomic_load(&log->failed_records) == 0,
+                "Every concurrent record should be appended");
+    TEST_ASSERT(segment_log_pending_segments(log) == APPENDERS * 5 - 1,
+                "Full segments should be sealed; the last one stays active until written past");
+    segment_log_close(log);
+    
+    log = segment_log_open(TEST_SEGMENT_DIR, 1000, SEGMENT_LOG_SYNC_MS);
+    TEST_ASSERT(log != NULL, "Segment log should reopen");
+    TEST_ASSERT(segment_log_compact_pending(log, test_compact_segment, ctx) == APPENDERS * 5,
+                "Sealed segments and the last active one should be compacted");
+    TEST_ASSERT(count_stored_metrics(ctx) == 3900 + APPENDERS * 5000, "Concurrent records should all be stored");
+    for (int i = 0; i < APPENDERS; i++) {
+        metric_query_result_t* node = database_query_metrics(ctx, METRIC_THROUGHPUT, 10 + (uint32_t)i, 0, INT64_MAX);
+        TEST_ASSERT(node != NULL && node->count == 5000, "Each appender's records should be stored");
+        database_free_metric_result(node);
+    }
+    segment_log_close(log);
+    
+    // Append cost
+    log = segment_log_open(TEST_SEGMENT_DIR, SEGMENT_LOG_RECORDS, SEGMENT_LOG_SYNC_MS);
+    TEST_ASSERT(log != NULL, "Segment log should reopen");
+    
+    const int rounds = 20;
+    uint64_t start = utils_get_timestamp_us();
+    size_t appended = 0;
+    for (int round = 0; round < rounds; round++) {
+        appended += segment_log_append(log, metrics, 2500);
+    }
+    double ns_per_record = (double)(utils_get_timestamp_us() - start) * 1000.0 / appended;
+    printf("   Append: %.1f ns/record\n", ns_per_record);
+    TEST_ASSERT(appended == (size_t)rounds * 2500, "Every record should be appended");
+    
+    segment_log_close(log);
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    system("rm -rf " TEST_SEGMENT_DIR);
+    
+    return 1;
+}
+
+// Reader thread state for the read pool test
+typedef struct {
+    database_context_t* ctx;
+    int iterations;
+    int failures;
+} pool_reader_state_t;
+
+static void* pool_reader_thread(void* arg) {
+    pool_reader_state_t* state = (pool_reader_state_t*)arg;
+    
+    for (int i = 0; i < state->iterations; i++) {
+        metric_query_result_t* result = database_query_recent_metrics(state->ctx, METRIC_THROUGHPUT, 100);
+        if (!result || result->count != 100) state->failures++;
+        database_free_metric_result(result);
+        
+        stats_result_t stats;
+        if (database_get_metric_stats(state->ctx, METRIC_THROUGHPUT, DATABASE_ANY_NODE, 0, INT64_MAX, &stats) != 0) {
+            state->failures++;
+        }
+    }
+    return NULL;
+}
+
+// Test the read connection pool
+int test_read_pool() {
+    printf("\n🧪 Testing Read Connection Pool...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    TEST_ASSERT(ctx->reader_count == DATABASE_READ_CONNECTIONS, "Read connections should be opened under WAL");
+    
+    // Two chunks of rows today, a few yesterday
+    time_t today = time(NULL) / 86400 * 86400;
+    int today_rows = 2 * (int)(DATABASE_CURSOR_CHUNK_BYTES / sizeof(metric_data_t));
+    metric_data_t* metrics = malloc((size_t)today_rows * sizeof(metric_data_t));
+    for (int i = 0; i < today_rows; i++) {
+        metrics[i] = (metric_data_t){ .type = METRIC_THROUGHPUT, .value = i, .node_id = 1, .cell_id = 1,
+                                      .timestamp = today + i % 3600 };
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, today_rows) == 0, "Today's metrics should be stored");
+    for (int i = 0; i < 100; i++) {
+        metrics[i].timestamp = today - 3600 + i;
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 100) == 0, "Yesterday's metrics should be stored");
+    
+    // A cursor reads the snapshot it started on, across partitions
+    database_cursor_t* cursor = database_open_metric_cursor(ctx, DATABASE_ANY, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    TEST_ASSERT(cursor != NULL && cursor->reader != NULL, "Cursor should read on a pooled connection");
+    TEST_ASSERT(database_cursor_next(cursor) == cursor->chunk_rows, "First chunk should be full");
+    
+    for (int i = 0; i < 50; i++) {
+        metrics[i].timestamp = today - 7200 + i;
+    }
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 50) == 0, "Writes should commit while the cursor reads");
+    TEST_ASSERT(cursor->count + database_cursor_scan(cursor, NULL, NULL) == today_rows + 100,
+                "Cursor should not see rows committed after it started");
+    database_cursor_close(cursor);
+    
+    cursor = database_open_metric_cursor(ctx, DATABASE_ANY, DATABASE_ANY_NODE, 0, INT64_MAX, -1);
+    TEST_ASSERT(database_cursor_scan(cursor, NULL, NULL) == today_rows + 150, "A new cursor should see every row");
+    database_cursor_close(cursor);
+    
+    // Queries from several threads while the writer ingests
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    
+    enum { READERS = 3 };
+    pthread_t threads[READERS];
+    pool_reader_state_t states[READERS];
+    for (int i = 0; i < READERS; i++) {
+        states[i] = (pool_reader_state_t){ .ctx = ctx, .iterations = 200 };
+        pthread_create(&threads[i], NULL, pool_reader_thread, &states[i]);
+    }
+    
+    int queued = 0;
+    for (int batch = 0; batch < 50; batch++) {
+        for (int i = 0; i < 200; i++) {
+            metrics[i].timestamp = today + 3600 + batch * 200 + i;
+        }
+        if (database_insert_metrics_batch(ctx, metrics, 200) == 0) queued += 200;
+    }
+    
+    int failures = 0;
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        failures += states[i].failures;
+    }
+    database_flush(ctx);
+    
+    TEST_ASSERT(queued == 10000, "Writer should accept every row");
+    TEST_ASSERT(failures == 0, "Concurrent queries should all succeed");
+    TEST_ASSERT(atomic_load(&ctx->reader_fallbacks) == 0, "Queries should not fall back to the main connection");
+    TEST_ASSERT(atomic_load(&ctx->stmt_cache_hits) > atomic_load(&ctx->stmt_cache_misses),
+                "Readers should reuse their prepared statements");
+    
+    metric_query_result_t* result = database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 1);
+    TEST_ASSERT(result != NULL && result->count == 1 && result->metrics[0].timestamp == today + 3600 + 9999,
+                "Committed rows should be visible to new queries");
+    database_free_metric_result(result);
+    
+    // With every reader lent out, a query never reads on the writer's
+    // connection; once the writer stops it falls back to the main connection
+    ctx->config.busy_timeout = 10;
+    database_cursor_t* held[DATABASE_READ_CONNECTIONS];
+    for (int i = 0; i < DATABASE_READ_CONNECTIONS; i++) {
+        held[i] = database_open_anomaly_cursor(ctx, ANOMALY_NONE, 0, INT64_MAX, -1);
+    }
+    stats_result_t stats;
+    TEST_ASSERT(database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 10) == NULL,
+                "Query should fail without a free reader while the writer runs");
+    TEST_ASSERT(database_get_metric_stats(ctx, METRIC_THROUGHPUT, DATABASE_ANY_NODE, 0, INT64_MAX, &stats) != 0,
+                "Statistics should fail without a free reader while the writer runs");
+    TEST_ASSERT(atomic_load(&ctx->reader_timeouts) == 2 && atomic_load(&ctx->reader_fallbacks) == 0,
+                "Refused queries should be counted");
+    
+    database_stop_writer(ctx);
+    result = database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 10);
+    TEST_ASSERT(result != NULL && result->count == 10, "Query should run on the main connection once the writer stops");
+    TEST_ASSERT(atomic_load(&ctx->reader_fallbacks) == 1, "Fallback should be counted");
+    database_free_metric_result(result);
+    for (int i = 0; i < DATABASE_READ_CONNECTIONS; i++) {
+        database_cursor_close(held[i]);
+    }
+    TEST_ASSERT(ctx->idle_reader_count == ctx->reader_count, "Every reader should be handed back");
+    
+    // Readers follow the journal mode
+    TEST_ASSERT(database_set_journal_mode(ctx, "delete", "full") == 0 && ctx->reader_count == 0,
+                "Leaving WAL should close the readers");
+    result = database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 10);
+    TEST_ASSERT(result != NULL && result->count == 10, "Queries should read on the main connection");
+    database_free_metric_result(result);
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start without WAL");
+    TEST_ASSERT(database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 10) == NULL,
+                "Queries without readers should fail while the writer runs");
+    database_stop_writer(ctx);
+    TEST_ASSERT(database_set_journal_mode(ctx, "wal", "normal") == 0 && ctx->reader_count == DATABASE_READ_CONNECTIONS,
+                "Returning to WAL should reopen the readers");
+    TEST_ASSERT(database_set_journal_mode(ctx, "bogus", NULL) != 0, "Unknown journal modes should be refused");
+    
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    // In-memory databases have no pool and read on their one connection
+    ctx = database_init(":memory:");
+    TEST_ASSERT(ctx != NULL && ctx->reader_count == 0, "In-memory database should not open readers");
+    database_insert_metrics_batch(ctx, metrics, 10);
+    result = database_query_recent_metrics(ctx, METRIC_THROUGHPUT, 100);
+    TEST_ASSERT(result != NULL && result->count == 10, "Queries should read on the main connection");
+    database_free_metric_result(result);
+    database_cleanup(ctx);
+    free(metrics);
+    
+    return 1;
+}
+
+// Sum the counts of the event rows of one type
+static int64_t sum_event_counts(database_context_t* ctx, event_type_t type, int* rows) {
+    event_query_result_t* events = database_query_events(ctx, type, 0, INT64_MAX);
+    int64_t total = 0;
+    *rows = events ? events->count : -1;
+    for (int i = 0; events && i < events->count; i++) {
+        total += events->events[i].count;
+    }
+    database_free_event_result(events);
+    return total;
+}
+
+// Test aggregated event counters
+int test_event_counters() {
+    printf("\n🧪 Testing Event Counters...\n");
+    
+    unlink(TEST_DB_PATH);
+    
+    // An event partition from before summary counts existed
+    time_t now = time(NULL);
+    char table[64];
+    database_partition_name(DATABASE_PARTITION_EVENTS, now / 86400, table, sizeof(table));
+    
+    sqlite3* db;
+    TEST_ASSERT(sqlite3_open(TEST_DB_PATH, &db) == SQLITE_OK, "Old database should be created");
+    char sql[1024];
+    snprintf(sql, sizeof(sql),
+             "CREATE TABLE partitions (name TEXT PRIMARY KEY, kind INTEGER NOT NULL, day INTEGER NOT NULL);"
+             "CREATE TABLE %s (id INTEGER PRIMARY KEY, event_type INTEGER NOT NULL, node_id INTEGER NOT NULL,"
+             " subscription_id INTEGER NOT NULL, timestamp INTEGER NOT NULL, message TEXT NOT NULL, details TEXT NOT NULL);"
+             "INSERT INTO partitions VALUES ('%s', %d, %lld);"
+             "INSERT INTO %s VALUES (1, %d, 1, 0, %lld, 'Old event', '');",
+             table, table, DATABASE_PARTITION_EVENTS, (long long)(now / 86400),
+             table, EVENT_XAPP_START, (long long)now);
+    TEST_ASSERT(sqlite3_exec(db, sql, NULL, NULL, NULL) == SQLITE_OK, "Old event partition should be created");
+    sqlite3_close(db);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    int rows;
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_XAPP_START, &rows) == 1 && rows == 1, "Old events should count once");
+    TEST_ASSERT(ctx->config.event_policy[EVENT_INDICATION_RECEIVED] == DATABASE_EVENT_COUNT &&
+                ctx->config.event_policy[EVENT_NODE_CONNECT] == DATABASE_EVENT_LOG,
+                "Only indications should be counted by default");
+    
+    // Counted events stay in memory until the summary
+    for (int i = 0; i < 1000; i++) {
+        database_log_event(ctx, EVENT_INDICATION_RECEIVED, 1, 10 + i % 2, "Indication received", "");
+    }
+    database_log_event(ctx, EVENT_NODE_CONNECT, 1, 0, "Node connected", "");
+    
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 0 && rows == 0,
+                "Counted events should not be stored one by one");
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_NODE_CONNECT, &rows) == 1 && rows == 1, "Logged events should be stored at once");
+    
+    TEST_ASSERT(database_flush_event_counters(ctx) == 0, "Counters should flush");
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 1000 && rows == 2,
+                "One summary row per subscription should hold every occurrence");
+    
+    event_query_result_t* events = database_query_events(ctx, EVENT_INDICATION_RECEIVED, 0, INT64_MAX);
+    TEST_ASSERT(events != NULL && events->events[0].count == 500 &&
+                strcmp(events->events[0].message, "Indication received") == 0 &&
+                strstr(events->events[0].details, "first_seen") != NULL, "Summary rows should keep the message and first time");
+    database_free_event_result(events);
+    
+    // Policy per type
+    ctx->config.event_policy[EVENT_INDICATION_RECEIVED] = DATABASE_EVENT_LOG;
+    database_log_event(ctx, EVENT_INDICATION_RECEIVED, 1, 10, "Indication received", "");
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 1001 && rows == 3,
+                "Logged policy should store the event itself");
+    ctx->config.event_policy[EVENT_INDICATION_RECEIVED] = DATABASE_EVENT_COUNT;
+    
+    // Summaries are due every event_summary_ms, on the next event without a writer
+    ctx->config.event_summary_ms = 20;
+    database_flush_event_counters(ctx);
+    database_log_event(ctx, EVENT_INDICATION_RECEIVED, 2, 10, "Indication received", "");
+    usleep(30000);
+    database_log_event(ctx, EVENT_INDICATION_RECEIVED, 2, 10, "Indication received", "");
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 1003 && rows == 4,
+                "Due summary should be written by the next event");
+    
+    // and on the writer thread with the writer running
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    database_log_event(ctx, EVENT_INDICATION_RECEIVED, 3, 10, "Indication received", "");
+    usleep(60000);
+    database_flush(ctx);
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 1004 && rows == 5,
+                "Writer thread should write due summaries");
+    database_stop_writer(ctx);
+    
+    // Cost of a counted event against a stored one
+    ctx->config.event_summary_ms = DATABASE_EVENT_SUMMARY_MS;
+    database_flush_event_counters(ctx);
+    
+    uint64_t start = utils_get_timestamp_us();
+    for (int i = 0; i < 100000; i++) {
+        database_log_event(ctx, EVENT_INDICATION_RECEIVED, 1 + i % 4, 10 + i % 8, "Indication received", "");
+    }
+    double counted_ns = (double)(utils_get_timestamp_us() - start) * 1000.0 / 100000;
+    
+    start = utils_get_timestamp_us();
+    for (int i = 0; i < 1000; i++) {
+        database_log_event(ctx, EVENT_CONTROL_SENT, 1, i, "Control successful", "");
+    }
+    double logged_ns = (double)(utils_get_timestamp_us() - start) * 1000.0 / 1000;
+    printf("   Counted event: %.1f ns, logged event: %.1f ns\n", counted_ns, logged_ns);
+    TEST_ASSERT(counted_ns < logged_ns, "Counting should be cheaper than storing");
+    
+    database_cleanup(ctx);
+    
+    // Cleanup writes what is still counted
+    ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(sum_event_counts(ctx, EVENT_INDICATION_RECEIVED, &rows) == 101004, "Cleanup should flush the counters");
+    database_cleanup(ctx);
+    unlink(TEST_DB_PATH);
+    
+    return 1;
+}
+
+// Test online backup beside ingestion, cancellation and restore
+int test_online_backup() {
+    printf("\n🧪 Testing Online Backup and Restore...\n");
+    
+    unlink(TEST_DB_PATH);
+    unlink(TEST_BACKUP_PATH);
+    
+    database_context_t* ctx = database_init(TEST_DB_PATH);
+    TEST_ASSERT(ctx != NULL, "Database context should be created");
+    
+    time_t base = time(NULL) / 86400 * 86400;
+    metric_data_t metrics[1000];
+    for (int batch = 0; batch < 20; batch++) {
+        for (int i = 0; i < 1000; i++) {
+            metrics[i] = (metric_data_t){ .type = METRIC_THROUGHPUT, .value = i, .node_id = 1, .cell_id = 1,
+                                          .timestamp = base + batch * 1000 + i };
+        }
+        database_insert_metrics_batch(ctx, metrics, 1000);
+    }
+    int64_t stored = count_stored_metrics(ctx);
+    TEST_ASSERT(stored == 20000, "Metrics should be stored before the backup");
+    
+    // Small steps so the copy overlaps the inserts below
+    ctx->config.backup_step_pages = 4;
+    ctx->config.backup_step_ms = 2;
+    TEST_ASSERT(database_start_backup(ctx, TEST_BACKUP_PATH) == 0, "Backup should start");
+    TEST_ASSERT(database_start_backup(ctx, TEST_BACKUP_PATH) != 0, "A second backup should not start meanwhile");
+    
+    database_backup_progress_t progress;
+    int inserted = 0;
+    int partial_progress = 0;
+    uint64_t worst_us = 0;
+    
+    for (int batch = 0; ; batch++) {
+        database_get_backup_progress(ctx, &progress);
+        if (!progress.running) break;
+        if (progress.total_pages > 0 && progress.remaining_pages > 0 && progress.remaining_pages < progress.total_pages) {
+            partial_progress++;
+        }
+        
+        for (int i = 0; i < 100; i++) {
+            metrics[i] = (metric_data_t){ .type = METRIC_LATENCY, .value = i, .node_id = 2, .cell_id = 1,
+                                          .timestamp = base + batch * 100 + i };
+        }
+        uint64_t start = utils_get_timestamp_us();
+        if (database_insert_metrics_batch(ctx, metrics, 100) == 0) inserted += 100;
+        worst_us = MAX(worst_us, utils_get_timestamp_us() - start);
+    }
+    
+    printf("   %d pages in %.1f ms, %d rows inserted meanwhile, slowest batch %.1f ms\n",
+           progress.total_pages, progress.elapsed_us / 1000.0, inserted, worst_us / 1000.0);
+    TEST_ASSERT(database_wait_backup(ctx) == 0 && progress.result == 0, "Backup should complete");
+    TEST_ASSERT(partial_progress > 0 && progress.remaining_pages == 0, "Progress should be reported step by step");
+    TEST_ASSERT(inserted > 0 && worst_us < 1000000, "Inserts should not wait for the backup");
+    TEST_ASSERT(access(TEST_BACKUP_PATH, F_OK) == 0 && access(TEST_BACKUP_PATH ".tmp", F_OK) != 0,
+                "Only the complete backup file should remain");
+    TEST_ASSERT(atomic_load(&ctx->completed_backups) == 1, "Completed backups should be counted");
+    
+    database_context_t* copy = database_init(TEST_BACKUP_PATH);
+    TEST_ASSERT(copy != NULL && count_stored_metrics(copy) == stored, "Backup should hold the snapshot it started on");
+    database_cleanup(copy);
+    
+    // A cancelled backup leaves the previous file alone
+    ctx->config.backup_step_pages = 1;
+    ctx->config.backup_step_ms = 20;
+    TEST_ASSERT(database_start_backup(ctx, TEST_BACKUP_PATH) == 0, "Second backup should start");
+    database_cancel_backup(ctx);
+    database_get_backup_progress(ctx, &progress);
+    TEST_ASSERT(!progress.running && progress.result == -1, "Cancelled backup should fail");
+    TEST_ASSERT(access(TEST_BACKUP_PATH ".tmp", F_OK) != 0, "Cancelled copy should be removed");
+    
+    // Restore replaces everything written since the backup
+    TEST_ASSERT(count_stored_metrics(ctx) == stored + inserted, "Live database should hold the later inserts");
+    
+    TEST_ASSERT(database_start_writer(ctx) == 0, "Writer should start");
+    TEST_ASSERT(database_restore(ctx, TEST_BACKUP_PATH) != 0, "Restore should refuse while the writer runs");
+    database_stop_writer(ctx);
+    
+    FILE* garbage = fopen(TEST_BACKUP_PATH ".bad", "w");
+    fputs("not a database", garbage);
+    fclose(garbage);
+    TEST_ASSERT(database_restore(ctx, TEST_BACKUP_PATH ".bad") != 0, "Invalid backups should be refused");
+    TEST_ASSERT(count_stored_metrics(ctx) == stored + inserted, "A refused restore should change nothing");
+    unlink(TEST_BACKUP_PATH ".bad");
+    
+    TEST_ASSERT(database_restore(ctx, TEST_BACKUP_PATH) == 0, "Restore should succeed");
+    TEST_ASSERT(count_stored_metrics(ctx) == stored, "Restored database should match the backup");
+    TEST_ASSERT(ctx->reader_count == DATABASE_READ_CONNECTIONS, "Read connections should be reopened");
+    
+    TEST_ASSERT(database_insert_metrics_batch(ctx, metrics, 100) == 0 && count_stored_metrics(ctx) == stored + 100,
+                "Restored database should take new metrics");
+    
+    database_cleanup(ctx);
+    
+    // Memory databases have no second connection to copy from
+    ctx = database_init(":memory:");
+    TEST_ASSERT(database_start_backup(ctx, TEST_BACKUP_PATH) != 0, "Memory databases should not be backed up online");
+    database_cleanup(ctx);
+    
+    unlink(TEST_DB_PATH);
+    unlink(TEST_BACKUP_PATH);
+    return 1;
+}
+
 // Test database maintenance
 int test_database_maintenance() {
     printf("\n🧪 Testing Database Maintenance...\n");
@@ -259,6 +1503,17 @@ int main() {
     total_tests++; if (test_error_handling()) tests_passed++;
     total_tests++; if (test_string_conversions()) tests_passed++;
     total_tests++; if (test_database_maintenance()) tests_passed++;
+    total_tests++; if (test_batch_insertion()) tests_passed++;
+    total_tests++; if (test_group_commit_writer()) tests_passed++;
+    total_tests++; if (test_partition_retention()) tests_passed++;
+    total_tests++; if (test_retention_in_transaction()) tests_passed++;
+    total_tests++; if (test_streaming_queries()) tests_passed++;
+    total_tests++; if (test_metric_rollups()) tests_passed++;
+    total_tests++; if (test_metric_blocks()) tests_passed++;
+    total_tests++; if (test_segment_log()) tests_passed++;
+    total_tests++; if (test_read_pool()) tests_passed++;
+    total_tests++; if (test_event_counters()) tests_passed++;
+    total_tests++; if (test_online_backup()) tests_passed++;
     
     printf("\n===========================\n");
     printf("📊 Test Results: %d/%d passed\n", tests_passed, total_tests);
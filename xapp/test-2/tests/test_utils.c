@@ -0,0 +1,371 @@
+/*
+ * Utility Tests for Smart Monitor xApp
+ *
+ * Unit tests for the utility module
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../include/analytics.h"
+#include "../include/registry.h"
+#include "../include/utils.h"
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("❌ FAILED: %s\n", message); \
+            return 0; \
+        } else { \
+            printf("✅ PASSED: %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_PRODUCERS 4
+#define TEST_ITEMS_PER_PRODUCER 200000
+
+// Test single-threaded circular buffer behaviour
+int test_circular_buffer_basic() {
+    printf("\n🧪 Testing Circular Buffer Basics...\n");
+
+    circular_buffer_t* buffer = utils_circular_buffer_create(6, sizeof(int));
+    TEST_ASSERT(buffer != NULL, "Circular buffer should be created");
+    TEST_ASSERT(buffer->capacity == 8, "Capacity should round up to a power of two");
+    TEST_ASSERT(utils_circular_buffer_is_empty(buffer), "New buffer should be empty");
+
+    int value = 0;
+    TEST_ASSERT(!utils_circular_buffer_pop(buffer, &value), "Pop on empty buffer should fail");
+
+    // Fill across the wrap point several times
+    int next_push = 0, next_pop = 0;
+    bool in_order = true;
+    for (int round = 0; round < 10; round++) {
+        int values[5];
+        for (int i = 0; i < 5; i++) values[i] = next_push + i;
+        next_push += (int)utils_circular_buffer_push_bulk(buffer, values, 5);
+
+        int out[5];
+        size_t popped = utils_circular_buffer_pop_bulk(buffer, out, 3);
+        for (size_t i = 0; i < popped; i++) {
+            in_order &= (out[i] == next_pop++);
+        }
+    }
+    TEST_ASSERT(in_order, "Elements should come out in push order across wraps");
+
+    while (utils_circular_buffer_push(buffer, &next_push)) {
+        next_push++;
+    }
+    TEST_ASSERT(utils_circular_buffer_is_full(buffer), "Buffer should fill up when consumer lags");
+
+    value = -1;
+    TEST_ASSERT(!utils_circular_buffer_push(buffer, &value), "Push on full buffer should fail");
+
+    int peeked = 0;
+    TEST_ASSERT(utils_circular_buffer_peek(buffer, &peeked, 0) && peeked == next_pop, "Peek should return the oldest element");
+    TEST_ASSERT(utils_circular_buffer_size(buffer) == 8, "Size should count queued elements");
+
+    utils_circular_buffer_clear(buffer);
+    TEST_ASSERT(utils_circular_buffer_is_empty(buffer), "Clear should drop all elements");
+    TEST_ASSERT(utils_circular_buffer_push(buffer, &value), "Push should succeed after clear");
+
+    utils_circular_buffer_destroy(buffer);
+    return 1;
+}
+
+typedef struct {
+    circular_buffer_t* buffer;
+    uint32_t producer_id;
+} producer_args_t;
+
+static void* producer_thread(void* arg) {
+    producer_args_t* args = (producer_args_t*)arg;
+    metric_data_t batch[16];
+    uint32_t sent = 0;
+
+    while (sent < TEST_ITEMS_PER_PRODUCER) {
+        uint32_t count = MIN(16u, TEST_ITEMS_PER_PRODUCER - sent);
+        for (uint32_t i = 0; i < count; i++) {
+            batch[i] = (metric_data_t){ .type = METRIC_LATENCY, .value = sent + i,
+                                        .node_id = args->producer_id, .cell_id = sent + i };
+        }
+
+        // Push what fits, retry the rest
+        uint32_t pushed = 0;
+        while (pushed < count) {
+            pushed += (uint32_t)utils_circular_buffer_push_bulk(args->buffer, &batch[pushed], count - pushed);
+        }
+        sent += count;
+    }
+
+    return NULL;
+}
+
+// Test concurrent producers with one consumer
+int test_circular_buffer_mpsc() {
+    printf("\n🧪 Testing Circular Buffer with Concurrent Producers...\n");
+
+    circular_buffer_t* buffer = utils_circular_buffer_create(1024, sizeof(metric_data_t));
+    TEST_ASSERT(buffer != NULL, "Circular buffer should be created");
+
+    pthread_t threads[TEST_PRODUCERS];
+    producer_args_t args[TEST_PRODUCERS];
+    for (uint32_t p = 0; p < TEST_PRODUCERS; p++) {
+        args[p] = (producer_args_t){ buffer, p };
+        pthread_create(&threads[p], NULL, producer_thread, &args[p]);
+    }
+
+    // Each producer's elements must arrive complete and in order
+    uint32_t expected[TEST_PRODUCERS] = {0};
+    uint64_t received = 0;
+    bool ordered = true;
+    metric_data_t out[64];
+
+    while (received < (uint64_t)TEST_PRODUCERS * TEST_ITEMS_PER_PRODUCER) {
+        size_t count = utils_circular_buffer_pop_bulk(buffer, out, 64);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t producer = out[i].node_id;
+            ordered &= producer < TEST_PRODUCERS &&
+                       out[i].cell_id == expected[producer] &&
+                       out[i].value == (double)expected[producer];
+            if (producer < TEST_PRODUCERS) expected[producer]++;
+        }
+        received += count;
+    }
+
+    for (uint32_t p = 0; p < TEST_PRODUCERS; p++) {
+        pthread_join(threads[p], NULL);
+    }
+
+    TEST_ASSERT(ordered, "Per-producer order and contents should be preserved");
+    TEST_ASSERT(utils_circular_buffer_is_empty(buffer), "Buffer should be drained");
+
+    utils_circular_buffer_destroy(buffer);
+    return 1;
+}
+
+typedef struct {
+    uint32_t key;
+    uint32_t check;            // key ^ TEST_REGISTRY_CHECK while the entry is live
+} test_entry_t;
+
+#define TEST_REGISTRY_CHECK 0x5A5A5A5Au
+#define TEST_REGISTRY_KEYS 5000
+#define TEST_REGISTRY_READERS 3
+#define TEST_REGISTRY_ROUNDS 20000
+
+static test_entry_t* test_entry_create(uint32_t key) {
+    test_entry_t* entry = malloc(sizeof(test_entry_t));
+    entry->key = key;
+    entry->check = key ^ TEST_REGISTRY_CHECK;
+    return entry;
+}
+
+// Test registry maps from a single thread
+int test_registry_basic() {
+    printf("\n🧪 Testing Registry Maps...\n");
+
+    registry_t* registry = registry_create();
+    registry_map_t* map = registry_map_create(8);
+    TEST_ASSERT(registry != NULL && map != NULL, "Registry and map should be created");
+
+    // Far past the initial capacity, so the table grows several times
+    registry_write_lock(registry);
+    bool inserted = true;
+    for (uint32_t key = 1; key <= TEST_REGISTRY_KEYS; key++) {
+        inserted &= registry_map_insert(registry, map, test_entry_create(key)) == 0;
+    }
+    test_entry_t* duplicate = test_entry_create(7);
+    TEST_ASSERT(registry_map_insert(registry, map, duplicate) == -1, "Duplicate key should be rejected");
+    free(duplicate);
+    registry_write_unlock(registry);
+
+    TEST_ASSERT(inserted && registry_map_count(map) == TEST_REGISTRY_KEYS, "Every entry should be inserted");
+    TEST_ASSERT(atomic_load(&registry->resizes) >= 9, "Map should have grown");
+
+    int slot = registry_read_lock(registry);
+    bool found = true;
+    for (uint32_t key = 1; key <= TEST_REGISTRY_KEYS; key++) {
+        test_entry_t* entry = registry_map_find(map, key);
+        found &= entry && entry->key == key;
+    }
+    TEST_ASSERT(found, "Every entry should be found");
+    TEST_ASSERT(registry_map_find(map, TEST_REGISTRY_KEYS + 1) == NULL, "Missing key should not be found");
+    registry_read_unlock(registry, slot);
+
+    // Remove the even keys; the odd ones stay reachable past the removed slots
+    registry_write_lock(registry);
+    for (uint32_t key = 2; key <= TEST_REGISTRY_KEYS; key += 2) {
+        registry_retire(registry, registry_map_remove(map, key));
+    }
+    TEST_ASSERT(registry_map_remove(map, 2) == NULL, "Removed key should not be removed twice");
+    registry_write_unlock(registry);
+
+    slot = registry_read_lock(registry);
+    bool odd_only = true;
+    for (uint32_t key = 1; key <= TEST_REGISTRY_KEYS; key++) {
+        odd_only &= (registry_map_find(map, key) != NULL) == (key % 2 == 1);
+    }
+    uint32_t iterated = 0;
+    registry_iter_t iter;
+    registry_iter_init(&iter, map);
+    while (registry_iter_next(&iter)) {
+        iterated++;
+    }
+    registry_read_unlock(registry, slot);
+
+    TEST_ASSERT(odd_only, "Only the odd keys should remain");
+    TEST_ASSERT(registry_map_count(map) == TEST_REGISTRY_KEYS / 2 && iterated == TEST_REGISTRY_KEYS / 2,
+                "Count and iteration should agree");
+
+    // With no reader open, retired entries and old tables are freed right away
+    TEST_ASSERT(registry_pending(registry) == 0, "Retired objects should be reclaimed without readers");
+
+    // An open read section holds back reclamation
+    slot = registry_read_lock(registry);
+    registry_write_lock(registry);
+    registry_retire(registry, registry_map_remove(map, 1));
+    registry_write_unlock(registry);
+    TEST_ASSERT(registry_pending(registry) == 1, "Reader should hold back reclamation");
+    registry_read_unlock(registry, slot);
+    TEST_ASSERT(registry_reclaim(registry) == 1 && registry_pending(registry) == 0,
+                "Entry should be freed once the reader is gone");
+
+    registry_map_destroy(map);
+    registry_destroy(registry);
+    return 1;
+}
+
+typedef struct {
+    registry_t* registry;
+    registry_map_t* map;
+    atomic_bool* stop;
+    atomic_int* ready;           // Readers done with their first read section
+    uint64_t lookups;
+    uint64_t hits;
+    bool valid;
+} registry_reader_args_t;
+
+static void* registry_reader_thread(void* arg) {
+    registry_reader_args_t* args = (registry_reader_args_t*)arg;
+    uint32_t key = 1;
+
+    args->valid = true;
+    while (!atomic_load(args->stop)) {
+        int slot = registry_read_lock(args->registry);
+        for (int i = 0; i < 64; i++) {
+            key = key * 1103515245u + 12345u;
+            test_entry_t* entry = registry_map_find(args->map, key % 1024 + 1);
+            if (entry) {
+                args->valid &= entry->check == (entry->key ^ TEST_REGISTRY_CHECK);
+                args->hits++;
+            }
+            args->lookups++;
+        }
+        registry_read_unlock(args->registry, slot);
+
+        if (args->lookups == 64) {
+            atomic_fetch_add(args->ready, 1);
+        }
+    }
+
+    return NULL;
+}
+
+// Test lock-free readers against a writer that churns the map
+int test_registry_concurrent() {
+    printf("\n🧪 Testing Registry with Concurrent Readers...\n");
+
+    registry_t* registry = registry_create();
+    registry_map_t* map = registry_map_create(8);
+    TEST_ASSERT(registry != NULL && map != NULL, "Registry and map should be created");
+
+    // Every key is present until the writer starts, so the first read
+    // section of each reader only finds entries
+    registry_write_lock(registry);
+    for (uint32_t key = 1; key <= 1024; key++) {
+        registry_map_insert(registry, map, test_entry_create(key));
+    }
+    registry_write_unlock(registry);
+
+    atomic_bool stop = false;
+    atomic_int ready = 0;
+    pthread_t threads[TEST_REGISTRY_READERS];
+    registry_reader_args_t args[TEST_REGISTRY_READERS];
+    for (int r = 0; r < TEST_REGISTRY_READERS; r++) {
+        args[r] = (registry_reader_args_t){ .registry = registry, .map = map, .stop = &stop, .ready = &ready };
+        pthread_create(&threads[r], NULL, registry_reader_thread, &args[r]);
+    }
+    while (atomic_load(&ready) < TEST_REGISTRY_READERS) {
+        sched_yield();
+    }
+
+    // Insert and remove keys in turn while the readers look them up; an
+    // entry freed too early shows up as a bad check or under ASan
+    for (uint32_t round = 0; round < TEST_REGISTRY_ROUNDS; round++) {
+        uint32_t key = round % 1024 + 1;
+        registry_write_lock(registry);
+        test_entry_t* entry = registry_map_remove(map, key);
+        if (entry) {
+            registry_retire(registry, entry);
+        } else {
+            registry_map_insert(registry, map, test_entry_create(key));
+        }
+        registry_write_unlock(registry);
+    }
+
+    atomic_store(&stop, true);
+    bool valid = true;
+    uint64_t lookups = 0, hits = 0;
+    for (int r = 0; r < TEST_REGISTRY_READERS; r++) {
+        pthread_join(threads[r], NULL);
+        valid &= args[r].valid;
+        lookups += args[r].lookups;
+        hits += args[r].hits;
+    }
+
+    TEST_ASSERT(lookups >= 64 * TEST_REGISTRY_READERS && hits >= 64 * TEST_REGISTRY_READERS,
+                "Readers should find entries before and while the writer runs");
+    TEST_ASSERT(valid, "Readers should never see a freed entry");
+    registry_reclaim(registry);
+    TEST_ASSERT(registry_pending(registry) == 0,
+                "Everything retired should be reclaimed once readers stop");
+    TEST_ASSERT(atomic_load(&registry->reclaimed) >= TEST_REGISTRY_ROUNDS / 2 - 1024,
+                "Removed entries should have been freed");
+
+    registry_map_destroy(map);
+    registry_destroy(registry);
+    return 1;
+}
+
+// Main test function
+int main() {
+    printf("🚀 Starting Utility Tests\n");
+    printf("==========================\n");
+
+    // Initialize logging for tests
+    utils_init_logging(NULL, LOG_LEVEL_ERROR);
+
+    int tests_passed = 0;
+    int total_tests = 0;
+
+    total_tests++; if (test_circular_buffer_basic()) tests_passed++;
+    total_tests++; if (test_circular_buffer_mpsc()) tests_passed++;
+    total_tests++; if (test_registry_basic()) tests_passed++;
+    total_tests++; if (test_registry_concurrent()) tests_passed++;
+
+    printf("\n==========================\n");
+    printf("📊 Test Results: %d/%d passed\n", tests_passed, total_tests);
+
+    // Cleanup
+    utils_cleanup_logging();
+
+    if (tests_passed == total_tests) {
+        printf("🎉 All utility tests passed!\n");
+        return 0;
+    } else {
+        printf("❌ Some utility tests failed!\n");
+        return 1;
+    }
+}